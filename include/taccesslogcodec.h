@@ -0,0 +1 @@
+#include "../src/taccesslogcodec.h"
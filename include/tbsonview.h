@@ -0,0 +1 @@
+#include "../src/tbsonview.h"
@@ -0,0 +1 @@
+#include "../src/tcryptaead.h"
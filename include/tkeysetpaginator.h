@@ -0,0 +1 @@
+#include "../src/tkeysetpaginator.h"
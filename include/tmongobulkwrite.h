@@ -0,0 +1 @@
+#include "../src/tmongobulkwrite.h"
@@ -0,0 +1 @@
+#include "../src/tredisreply.h"
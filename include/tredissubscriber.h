@@ -0,0 +1 @@
+#include "../src/tredissubscriber.h"
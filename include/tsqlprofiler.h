@@ -0,0 +1 @@
+#include "../src/tsqlprofiler.h"
@@ -0,0 +1 @@
+#include "../src/tsqlrelation.h"
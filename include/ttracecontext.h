@@ -0,0 +1 @@
+#include "../src/ttracecontext.h"
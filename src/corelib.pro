@@ -64,6 +64,11 @@ windows {
   DEFINES += TF_NO_DEBUG
 }
 
+!isEmpty( use_zstd ) {
+  DEFINES += TF_USE_ZSTD
+  LIBS += -lzstd
+}
+
 isEmpty( use_gui ) {
   QT    -= gui widgets
 } else {
@@ -119,6 +124,10 @@ HEADERS += tsqlqueryormapper.h
 SOURCES += tsqlqueryormapper.cpp
 HEADERS += tsqlqueryormapperiterator.h
 SOURCES += tsqlqueryormapperiterator.cpp
+HEADERS += tsqlquerycache.h
+SOURCES += tsqlquerycache.cpp
+HEADERS += tsqlprofiler.h
+SOURCES += tsqlprofiler.cpp
 HEADERS += tsqltransaction.h
 SOURCES += tsqltransaction.cpp
 HEADERS += tsqldriverextension.h
@@ -171,6 +180,8 @@ HEADERS += tsessionmongostore.h
 SOURCES += tsessionmongostore.cpp
 HEADERS += tsessioncookiestore.h
 SOURCES += tsessioncookiestore.cpp
+HEADERS += tsessioncookiecodec.h
+SOURCES += tsessioncookiecodec.cpp
 HEADERS += tsessionfilestore.h
 SOURCES += tsessionfilestore.cpp
 HEADERS += tsessionredisstore.h
@@ -191,6 +202,10 @@ HEADERS += taccesslog.h
 SOURCES += taccesslog.cpp
 HEADERS += taccesslogstream.h
 SOURCES += taccesslogstream.cpp
+HEADERS += taccesslogcodec.h
+SOURCES += taccesslogcodec.cpp
+HEADERS += ttracecontext.h
+SOURCES += ttracecontext.cpp
 HEADERS += tlog.h
 SOURCES += tlog.cpp
 HEADERS += tlogger.h
@@ -217,6 +232,12 @@ HEADERS += tsendmailmailer.h
 SOURCES += tsendmailmailer.cpp
 HEADERS += tcryptmac.h
 SOURCES += tcryptmac.cpp
+HEADERS += tcryptaead.h
+SOURCES += tcryptaead.cpp
+HEADERS += tloglayout.h
+SOURCES += tloglayout.cpp
+HEADERS += tlogsampler.h
+SOURCES += tlogsampler.cpp
 HEADERS += tinternetmessageheader.h
 SOURCES += tinternetmessageheader.cpp
 HEADERS += thttpheader.h
@@ -231,16 +252,24 @@ HEADERS += taccessvalidator.h
 SOURCES += taccessvalidator.cpp
 HEADERS += tpaginator.h
 SOURCES += tpaginator.cpp
+HEADERS += tkeysetpaginator.h
+SOURCES += tkeysetpaginator.cpp
 HEADERS += tkvsdatabase.h
 SOURCES += tkvsdatabase.cpp
 HEADERS += tkvsdatabasepool.h
 SOURCES += tkvsdatabasepool.cpp
+HEADERS += tpoolwaitqueue.h
+SOURCES += tpoolwaitqueue.cpp
 HEADERS += tkvsdriver.h
 SOURCES += tkvsdriver.cpp
 HEADERS += tredisdriver.h
 SOURCES += tredisdriver.cpp
 HEADERS += tredis.h
 SOURCES += tredis.cpp
+HEADERS += tredisreply.h
+SOURCES += tredisreply.cpp
+HEADERS += tredissubscriber.h
+SOURCES += tredissubscriber.cpp
 HEADERS += tfileaiologger.h
 SOURCES += tfileaiologger.cpp
 HEADERS += tfileaiowriter.h
@@ -319,6 +348,10 @@ HEADERS += tcachemongostore.h
 SOURCES += tcachemongostore.cpp
 HEADERS += tcacheredisstore.h
 SOURCES += tcacheredisstore.cpp
+HEADERS += tcachememorystore.h
+SOURCES += tcachememorystore.cpp
+HEADERS += tcachecodec.h
+SOURCES += tcachecodec.cpp
 SOURCES += tactioncontroller_qt5.cpp
 
 HEADERS += \
@@ -334,6 +367,7 @@ HEADERS += \
            tjavascriptobject.h \
            tsqlormapper.h \
            tsqljoin.h \
+           tsqlrelation.h \
            thttprequestheader.h \
            thttpresponseheader.h \
            tcommandlineinterface.h
@@ -415,8 +449,12 @@ HEADERS += tmongoquery.h
 SOURCES += tmongoquery.cpp
 HEADERS += tmongocursor.h
 SOURCES += tmongocursor.cpp
+HEADERS += tmongobulkwrite.h
+SOURCES += tmongobulkwrite.cpp
 HEADERS += tbson.h
 SOURCES += tbson.cpp
+HEADERS += tbsonview.h
+SOURCES += tbsonview.cpp
 HEADERS += tmongoobject.h
 SOURCES += tmongoobject.cpp
 HEADERS += tmongoodmapper.h
@@ -55,10 +55,34 @@ void TAbstractLogStream::loggerClose(LoggerType type)
 }
 
 
-void TAbstractLogStream::loggerWrite(const TLog &log)
+/*!
+  Returns the set of the loggers which write a log of the \a priority,
+  by their thresholds and their sampling settings; bit i stands for the
+  i-th logger. Call this before formatting a log message, so that logs
+  sampled out cost nothing more.
+*/
+quint64 TAbstractLogStream::sample(int priority) const
 {
-    for (auto logger : (const QList<TLogger*>&)loggerList) {
-        if (logger && logger->isOpen() && log.priority <= logger->threshold()) {
+    quint64 loggers = 0;
+    for (int i = 0; i < loggerList.count() && i < 64; ++i) {
+        TLogger *logger = loggerList[i];
+        if (logger && priority <= logger->threshold() && logger->sample(priority)) {
+            loggers |= (1ULL << i);
+        }
+    }
+    return loggers;
+}
+
+/*!
+  Writes the \a log to the \a loggers, the set of loggers returned by
+  sample().
+*/
+void TAbstractLogStream::loggerWrite(const TLog &log, quint64 loggers)
+{
+    for (int i = 0; i < loggerList.count(); ++i) {
+        TLogger *logger = loggerList[i];
+        bool selected = (i < 64) ? (loggers >> i) & 1 : true;
+        if (selected && logger && logger->isOpen() && log.priority <= logger->threshold()) {
             logger->log(log);
             if (nonBuffering)
                 logger->flush();
@@ -12,10 +12,13 @@ class TAbstractLogStream : public QObject
 {
     Q_OBJECT
 public:
+    static constexpr quint64 AllLoggers = ~0ULL;
+
     TAbstractLogStream(const QList<TLogger *> &loggers, QObject *parent);
     virtual ~TAbstractLogStream() { }
-    virtual void writeLog(const TLog &log) = 0;
+    virtual void writeLog(const TLog &log, quint64 loggers = AllLoggers) = 0;
     virtual void flush() = 0;
+    quint64 sample(int priority) const;
 
     bool isNonBufferingMode() const { return nonBuffering; }
 
@@ -31,7 +34,7 @@ protected:
 
     bool loggerOpen(LoggerType type = All);
     void loggerClose(LoggerType type = All);
-    void loggerWrite(const TLog &log);
+    void loggerWrite(const TLog &log, quint64 loggers = AllLoggers);
     void loggerWrite(const QList<TLog> &logs);
     void loggerFlush();
     
@@ -7,6 +7,7 @@
 
 #include <TAccessLog>
 #include "tsystemglobal.h"
+#include "tloglayout.h"
 
 /*!
   \class TAccessLog
@@ -24,85 +25,21 @@ TAccessLog::TAccessLog(const QByteArray &host, const QByteArray &req) :
 { }
 
 
+/*!
+  Returns the text of the log formatted by the \a layout and the
+  \a dateTimeFormat. The layout compiled last is reused in each thread.
+*/
 QByteArray TAccessLog::toByteArray(const QByteArray &layout, const QByteArray &dateTimeFormat) const
 {
-    QByteArray message;
-    int pos = 0;
-    QByteArray dig;
-    message.reserve(127);
-
-    while (pos < layout.length()) {
-        char c = layout.at(pos++);
-        if (c != '%') {
-            message.append(c);
-            continue;
-        }
-
-        dig.clear();
-        for (;;) {
-            if (pos >= layout.length()) {
-                message.append('%').append(dig);
-                break;
-            }
-
-            c = layout.at(pos++);
-            if (c >= '0' && c <= '9') {
-                dig += c;
-                continue;
-            }
-
-            switch (c) {
-            case 'h':
-                message.append(remoteHost);
-                break;
-
-            case 'd': // %d : timestamp
-                if (!dateTimeFormat.isEmpty()) {
-                    message.append(timestamp.toString(dateTimeFormat).toLocal8Bit());
-                } else {
-                    message.append(timestamp.toString(Qt::ISODate).toLatin1());
-                }
-                break;
-
-            case 'r':
-                message.append(request);
-                break;
-
-            case 's':
-                message.append(QString::number(statusCode));
-                break;
-
-            case 'O':
-                if (dig.isEmpty()) {
-                    message.append(QString::number(responseBytes));
-                } else {
-                    const QChar fillChar = (dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                    message.append(QString("%1").arg(responseBytes, dig.toInt(), 10, fillChar).toLatin1());
-                }
-                break;
-
-            case 'n': // %n : newline
-                message.append('\n');
-                break;
-
-            case '%':
-                message.append('%').append(dig);
-                dig.clear();
-                continue;
-                break;
-
-            default:
-                message.append('%').append(dig).append(c);
-                break;
-            }
-            break;
-        }
+    thread_local TLogLayout compiled(TLogLayout::AccessLog);
+
+    if (compiled.layout() != layout || compiled.dateTimeFormat() != dateTimeFormat || compiled.isEmpty()) {
+        compiled.compile(layout, dateTimeFormat);
     }
-    return message;
+    return compiled.format(*this);
 }
 
 
-
 TAccessLogger::TAccessLogger()
 { }
 
@@ -18,6 +18,10 @@ public:
     QByteArray request;
     int statusCode {0};
     int responseBytes {0};
+    int queryCount {0};
+    qint64 queryTime {0};  // microseconds
+    QByteArray traceId;
+    QByteArray spanId;
 };
 
 
@@ -39,6 +43,8 @@ public:
     void setStatusCode(int statusCode) { if (accessLog) accessLog->statusCode = statusCode; }
     int responseBytes() const { return (accessLog) ? accessLog->responseBytes : -1; }
     void setResponseBytes(int bytes) { if (accessLog) accessLog->responseBytes = bytes; }
+    void setQueryStatistics(int count, qint64 usecs) { if (accessLog) { accessLog->queryCount = count; accessLog->queryTime = usecs; } }
+    void setTraceContext(const QByteArray &traceId, const QByteArray &spanId) { if (accessLog) { accessLog->traceId = traceId; accessLog->spanId = spanId; } }
 
 private:
     TAccessLog *accessLog {nullptr};
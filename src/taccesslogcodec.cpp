@@ -0,0 +1,508 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "taccesslogcodec.h"
+#include <TAccessLog>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QPair>
+
+constexpr char MAGIC[] = "TFAL";
+constexpr int MAGIC_LENGTH = 4;
+constexpr char FORMAT_VERSION = 1;
+constexpr int MAX_INTERNED_STRINGS = 4096;
+constexpr int MAX_INTERNED_LENGTH = 256;
+constexpr int MAX_SESSION_RECORDS = 100000;
+
+/*
+  A binary access log is a sequence of frames; each frame consists of a
+  type byte, the varint length of the payload and the payload. A session
+  of an encoder begins with a header frame, and strings are interned in
+  the string table of the session.
+
+  Header: "TFAL", version(1), stream ID, base msecs since epoch, UTC offset
+  String: stream ID, index, bytes
+  Record: stream ID, msecs from the base, status code, response bytes,
+          query count, query time, and the references of the remote host,
+          the method, the target and the protocol of the request,
+          optionally followed by the trace ID and the span ID in bytes
+
+  A reference is the index of an interned string, or 0 followed by the
+  length and the bytes of a string. Integers are varints, and signed ones
+  are zigzag encoded.
+*/
+enum FrameType : char {
+    HeaderFrame = 1,
+    StringFrame = 2,
+    RecordFrame = 3,
+};
+
+namespace {
+
+inline void writeVarint(QByteArray &out, quint64 n)
+{
+    while (n >= 0x80) {
+        out += (char)((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    out += (char)n;
+}
+
+
+inline void writeSigned(QByteArray &out, qint64 n)
+{
+    writeVarint(out, ((quint64)n << 1) ^ (quint64)(n >> 63));  // zigzag
+}
+
+
+inline int varintSize(quint64 n)
+{
+    int size = 1;
+    while (n >= 0x80) {
+        n >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+
+bool readVarint(const char *&p, const char *end, quint64 &n)
+{
+    n = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uchar c = *p++;
+        n |= (quint64)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Returns the stream ID of the string or record frame at the beginning
+// of the data, or 0
+quint64 leadingStreamId(const QByteArray &data)
+{
+    const char *p = data.constData();
+    const char *end = p + data.length();
+    quint64 len, streamId;
+
+    if (p == end || (*p != StringFrame && *p != RecordFrame)) {
+        return 0;
+    }
+    ++p;
+    return (readVarint(p, end, len) && readVarint(p, end, streamId)) ? streamId : 0;
+}
+
+
+inline bool readSigned(const char *&p, const char *end, qint64 &n)
+{
+    quint64 u;
+    if (!readVarint(p, end, u)) {
+        return false;
+    }
+    n = (qint64)(u >> 1) ^ -(qint64)(u & 1);
+    return true;
+}
+
+
+// Splits a request line into the method, the target and the protocol
+void splitRequest(const QByteArray &request, QByteArray &method, QByteArray &target, QByteArray &protocol)
+{
+    int first = request.indexOf(' ');
+    int last = request.lastIndexOf(' ');
+
+    if (first < 0) {
+        method.clear();
+        target = request;
+        protocol.clear();
+    } else if (first == last || !request.mid(last + 1).startsWith("HTTP/")) {
+        method = request.left(first);
+        target = request.mid(first + 1);
+        protocol.clear();
+    } else {
+        method = request.left(first);
+        target = request.mid(first + 1, last - first - 1);
+        protocol = request.mid(last + 1);
+    }
+}
+
+
+struct Session {
+    qint64 baseMSecs {0};
+    int utcOffset {0};
+};
+
+}  // namespace
+
+/*!
+  \class TAccessLogEncoder
+  \brief The TAccessLogEncoder class encodes access logs into the compact
+  binary format, which is converted to text by the tfaccesslog command.
+
+  The strings of the remote hosts and the requests are interned, and each
+  of them is written only once in a session of the encoder.
+*/
+
+/*!
+  Returns the frames of the access log \a log.
+*/
+QByteArray TAccessLogEncoder::encode(const TAccessLog &log)
+{
+    QByteArray buffer;
+    encode(log, buffer);
+    return buffer;
+}
+
+/*!
+  Appends the frames of the access log \a log to the \a buffer; a header
+  frame and the definitions of new strings precede the record.
+*/
+void TAccessLogEncoder::encode(const TAccessLog &log, QByteArray &buffer)
+{
+    const qint64 msecs = log.timestamp.toMSecsSinceEpoch();
+    const int offset = log.timestamp.offsetFromUtc();
+
+    if (_streamId == 0 || _recordCount >= MAX_SESSION_RECORDS || _strings.count() >= MAX_INTERNED_STRINGS
+        || offset != _utcOffset) {
+        startSession(log, buffer);
+    }
+    ++_recordCount;
+
+    QByteArray method, target, protocol;
+    splitRequest(log.request, method, target, protocol);
+
+    _payload.resize(0);
+    writeVarint(_payload, _streamId);
+    writeSigned(_payload, msecs - _baseMSecs);
+    writeSigned(_payload, log.statusCode);
+    writeSigned(_payload, log.responseBytes);
+    writeSigned(_payload, log.queryCount);
+    writeSigned(_payload, log.queryTime);
+    writeString(log.remoteHost, buffer);
+    writeString(method, buffer);
+    writeString(target, buffer);
+    writeString(protocol, buffer);
+
+    if (!log.traceId.isEmpty()) {
+        writeId(log.traceId);
+        writeId(log.spanId);
+    }
+
+    buffer += (char)RecordFrame;
+    writeVarint(buffer, _payload.length());
+    buffer += _payload;
+}
+
+/*!
+  Resets the string table; the next log begins a new session.
+*/
+void TAccessLogEncoder::reset()
+{
+    QMutexLocker locker(&_framesMutex);
+    // Records of the session may still be waiting to be written
+    if (_streamId) {
+        _previousStreamId = _streamId;
+        _previousFrames = _sessionFrames;
+    }
+    _sessionFrames.clear();
+    _streamId = 0;  // read by sessionFrames() in other threads
+    locker.unlock();
+
+    _recordCount = 0;
+    _strings.clear();
+}
+
+/*!
+  Returns the header frame and the string frames of the current session.
+  Written at the beginning of another file, they make the following
+  records of the session decodable there. This function is thread-safe.
+*/
+QByteArray TAccessLogEncoder::sessionFrames() const
+{
+    QMutexLocker locker(&_framesMutex);
+    return _sessionFrames;
+}
+
+/*!
+  Returns the header frame and the string frames of the session which the
+  frames at the beginning of the \a data belong to, either the current
+  session or the previous one. Returns an empty byte array if the \a data
+  begin with a header frame, or their session is unknown. This function
+  is thread-safe.
+*/
+QByteArray TAccessLogEncoder::sessionFrames(const QByteArray &data) const
+{
+    const quint64 streamId = leadingStreamId(data);
+    QMutexLocker locker(&_framesMutex);
+
+    if (streamId == 0) {
+        return QByteArray();
+    }
+    if (streamId == _streamId) {
+        return _sessionFrames;
+    }
+    return (streamId == _previousStreamId) ? _previousFrames : QByteArray();
+}
+
+
+void TAccessLogEncoder::writeId(const QByteArray &hexId)
+{
+    QByteArray id = QByteArray::fromHex(hexId);
+    writeVarint(_payload, id.length());
+    _payload += id;
+}
+
+
+void TAccessLogEncoder::startSession(const TAccessLog &log, QByteArray &buffer)
+{
+    reset();
+    const quint32 streamId = Tf::random(1, 0x0fffffff);
+    _baseMSecs = log.timestamp.toMSecsSinceEpoch();
+    _utcOffset = log.timestamp.offsetFromUtc();
+
+    QByteArray header(MAGIC, MAGIC_LENGTH);
+    header += FORMAT_VERSION;
+    writeVarint(header, streamId);
+    writeSigned(header, _baseMSecs);
+    writeSigned(header, _utcOffset);
+
+    const int pos = buffer.length();
+    buffer += (char)HeaderFrame;
+    writeVarint(buffer, header.length());
+    buffer += header;
+
+    QMutexLocker locker(&_framesMutex);
+    _streamId = streamId;
+    _sessionFrames = buffer.mid(pos);
+}
+
+
+void TAccessLogEncoder::writeString(const QByteArray &str, QByteArray &buffer)
+{
+    if (str.length() > MAX_INTERNED_LENGTH) {
+        writeVarint(_payload, 0);
+        writeVarint(_payload, str.length());
+        _payload += str;
+        return;
+    }
+
+    quint32 index = _strings.value(str);
+    if (!index) {
+        index = _strings.count() + 1;
+        _strings.insert(str, index);
+
+        const int pos = buffer.length();
+        buffer += (char)StringFrame;
+        writeVarint(buffer, varintSize(_streamId) + varintSize(index) + str.length());
+        writeVarint(buffer, _streamId);
+        writeVarint(buffer, index);
+        buffer += str;
+
+        QMutexLocker locker(&_framesMutex);
+        _sessionFrames += buffer.mid(pos);
+    }
+    writeVarint(_payload, index);
+}
+
+/*!
+  \class TAccessLogDecoder
+  \brief The TAccessLogDecoder class decodes access logs of the binary
+  format written by TAccessLogEncoder.
+*/
+
+/*!
+  Returns true if the \a data begins with a header frame of the binary
+  access log.
+*/
+bool TAccessLogDecoder::isBinary(const QByteArray &data)
+{
+    return data.length() > MAGIC_LENGTH + 1 && data.at(0) == HeaderFrame
+        && data.mid(2, MAGIC_LENGTH) == QByteArray(MAGIC, MAGIC_LENGTH);
+}
+
+/*!
+  Decodes the access logs in the \a data. The strings are collected
+  beforehand, so records may precede the definitions of their strings as
+  asynchronous writes can reorder them. If \a ok is not nullptr, failure
+  is reported by setting *\a ok to false; the logs decoded until the
+  broken frame are returned in that case.
+*/
+QList<TAccessLog> TAccessLogDecoder::decode(const QByteArray &data, bool *ok)
+{
+    QList<Session> sessions;
+    QList<quint64> streamIds;  // of the sessions
+    QHash<quint64, int> firstSessions;  // key: stream ID
+    QHash<quint64, int> currentSessions;  // key: stream ID
+    QHash<quint64, QByteArray> strings;  // key: session << 32 | index
+    QList<QPair<quint64, QPair<quint64, QByteArray>>> pendingStrings;
+    QList<TAccessLog> logs;
+    const char *const begin = data.constData();
+    const char *stop = (isBinary(data)) ? begin + data.length() : begin;
+    bool valid = (stop != begin);
+
+    // Calls the func for each frame, and returns the end of the valid frames
+    auto forEachFrame = [&](auto func) {
+        const char *p = begin;
+        while (p < stop) {
+            const char *frame = p;
+            char type = *p++;
+            quint64 len;
+            if (!readVarint(p, stop, len) || len > (quint64)(stop - p) || !func(type, p, p + len)) {
+                valid = false;
+                return frame;
+            }
+            p += len;
+        }
+        return stop;
+    };
+
+    // Stream IDs are random and may be reused by sessions of a file, so a
+    // frame belongs to the last session of its stream begun before it, or
+    // to the first one if it precedes all the headers of the stream
+    auto sessionOf = [&](quint64 streamId) {
+        return currentSessions.value(streamId, firstSessions.value(streamId, -1));
+    };
+
+    // Collects the sessions and the strings
+    stop = forEachFrame([&](char type, const char *p, const char *end) {
+        quint64 streamId, index;
+        Session session;
+        qint64 offset;
+
+        switch (type) {
+        case HeaderFrame:
+            if (end - p < MAGIC_LENGTH + 1 || QByteArray(p, MAGIC_LENGTH) != QByteArray(MAGIC, MAGIC_LENGTH)) {
+                return false;
+            }
+            p += MAGIC_LENGTH;
+            if (*p++ != FORMAT_VERSION) {
+                return false;
+            }
+            if (!readVarint(p, end, streamId) || !readSigned(p, end, session.baseMSecs) || !readSigned(p, end, offset)) {
+                return false;
+            }
+            session.utcOffset = offset;
+            if (!firstSessions.contains(streamId)) {
+                firstSessions.insert(streamId, sessions.count());
+            }
+            currentSessions.insert(streamId, sessions.count());
+            streamIds << streamId;
+            sessions << session;
+            break;
+
+        case StringFrame:
+            if (!readVarint(p, end, streamId) || !readVarint(p, end, index)) {
+                return false;
+            }
+            if (currentSessions.contains(streamId)) {
+                strings.insert(((quint64)currentSessions.value(streamId) << 32) | index, QByteArray(p, (int)(end - p)));
+            } else {
+                pendingStrings << qMakePair(streamId, qMakePair(index, QByteArray(p, (int)(end - p))));
+            }
+            break;
+
+        default:
+            break;
+        }
+        return true;
+    });
+
+    // Strings preceding the headers of their streams
+    for (auto &str : pendingStrings) {
+        int session = firstSessions.value(str.first, -1);
+        if (session >= 0) {
+            strings.insert(((quint64)session << 32) | str.second.first, str.second.second);
+        }
+    }
+
+    // Decodes the records
+    currentSessions.clear();
+    int headerCount = 0;
+    forEachFrame([&](char type, const char *p, const char *end) {
+        if (type == HeaderFrame) {
+            currentSessions.insert(streamIds.at(headerCount), headerCount);
+            ++headerCount;
+            return true;
+        }
+        if (type != RecordFrame) {
+            return true;  // skips the others
+        }
+
+        quint64 streamId;
+        qint64 msecs, statusCode, responseBytes, queryCount, queryTime;
+        if (!readVarint(p, end, streamId) || !readSigned(p, end, msecs) || !readSigned(p, end, statusCode)
+            || !readSigned(p, end, responseBytes) || !readSigned(p, end, queryCount) || !readSigned(p, end, queryTime)) {
+            return false;
+        }
+
+        const int session = sessionOf(streamId);
+        QByteArray str[4];  // remote host, method, target and protocol
+        for (auto &s : str) {
+            quint64 index;
+            if (!readVarint(p, end, index)) {
+                return false;
+            }
+            if (index > 0) {
+                s = strings.value(((quint64)session << 32) | index);
+                continue;
+            }
+
+            quint64 len;
+            if (!readVarint(p, end, len) || len > (quint64)(end - p)) {
+                return false;
+            }
+            s = QByteArray(p, (int)len);
+            p += len;
+        }
+
+        QByteArray ids[2];  // trace ID and span ID
+        for (auto &id : ids) {
+            quint64 len;
+            if (p == end) {
+                break;  // none
+            }
+            if (!readVarint(p, end, len) || len > (quint64)(end - p)) {
+                return false;
+            }
+            id = QByteArray(p, (int)len).toHex();
+            p += len;
+        }
+
+        if (session < 0) {
+            return true;  // header lost, skips it
+        }
+
+        const Session &ses = sessions.at(session);
+        TAccessLog log;
+        log.timestamp = QDateTime::fromMSecsSinceEpoch(ses.baseMSecs + msecs, Qt::OffsetFromUTC, ses.utcOffset);
+        log.remoteHost = str[0];
+        log.request = str[1];
+        for (int i = 2; i < 4; ++i) {
+            if (!str[i].isEmpty()) {
+                if (!log.request.isEmpty()) {
+                    log.request += ' ';
+                }
+                log.request += str[i];
+            }
+        }
+        log.statusCode = statusCode;
+        log.responseBytes = responseBytes;
+        log.queryCount = queryCount;
+        log.queryTime = queryTime;
+        log.traceId = ids[0];
+        log.spanId = ids[1];
+        logs << log;
+        return true;
+    });
+
+    if (ok) {
+        *ok = valid;
+    }
+    return logs;
+}
@@ -0,0 +1,52 @@
+#ifndef TACCESSLOGCODEC_H
+#define TACCESSLOGCODEC_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <TGlobal>
+
+class TAccessLog;
+
+
+class T_CORE_EXPORT TAccessLogEncoder
+{
+public:
+    TAccessLogEncoder() { }
+
+    QByteArray encode(const TAccessLog &log);
+    void encode(const TAccessLog &log, QByteArray &buffer);
+    void reset();
+    QByteArray sessionFrames() const;
+    QByteArray sessionFrames(const QByteArray &data) const;
+
+private:
+    void startSession(const TAccessLog &log, QByteArray &buffer);
+    void writeString(const QByteArray &str, QByteArray &buffer);
+    void writeId(const QByteArray &hexId);
+
+    quint32 _streamId {0};  // written with _framesMutex locked
+    qint64 _baseMSecs {0};
+    int _utcOffset {0};
+    int _recordCount {0};
+    QHash<QByteArray, quint32> _strings;
+    QByteArray _payload;
+    QByteArray _sessionFrames;  // the header and the strings
+    quint32 _previousStreamId {0};
+    QByteArray _previousFrames;  // of the previous session
+    mutable QMutex _framesMutex;
+
+    T_DISABLE_COPY(TAccessLogEncoder)
+    T_DISABLE_MOVE(TAccessLogEncoder)
+};
+
+
+class T_CORE_EXPORT TAccessLogDecoder
+{
+public:
+    static bool isBinary(const QByteArray &data);
+    static QList<TAccessLog> decode(const QByteArray &data, bool *ok = nullptr);
+};
+
+#endif // TACCESSLOGCODEC_H
@@ -7,6 +7,8 @@
 
 #include "taccesslogstream.h"
 #include "tfileaiologger.h"
+#include <TAccessLog>
+#include <QMutexLocker>
 
 /*!
   \class TAccessLogStream
@@ -18,6 +20,9 @@ TAccessLogStream::TAccessLogStream(const QString &fileName)
 {
     TFileAioLogger *aioLogger = new TFileAioLogger();
     aioLogger->setFileName(fileName);
+    // A rotated file of binary logs begins with the session of the
+    // records following
+    aioLogger->setRotationHandler([this](const QByteArray &data) { return encoder.sessionFrames(data); });
     aioLogger->open();
     logger = aioLogger;
 }
@@ -38,6 +43,22 @@ void TAccessLogStream::writeLog(const QByteArray &log)
 }
 
 
+/*!
+  Writes the access log \a log in the binary format. The encoding and
+  the writing are serialized, so that the strings are written in the
+  order of their indexes.
+*/
+void TAccessLogStream::writeLog(const TAccessLog &log)
+{
+    if (logger->isOpen()) {
+        QMutexLocker locker(&mutex);
+        QByteArray buffer;
+        encoder.encode(log, buffer);
+        logger->log(buffer);
+    }
+}
+
+
 void TAccessLogStream::flush()
 {
     logger->flush();
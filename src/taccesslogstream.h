@@ -3,9 +3,12 @@
 
 #include <QString>
 #include <QByteArray>
+#include <QMutex>
 #include <TGlobal>
+#include "taccesslogcodec.h"
 
 class TLogger;
+class TAccessLog;
 
 
 class T_CORE_EXPORT TAccessLogStream
@@ -14,10 +17,13 @@ public:
     TAccessLogStream(const QString &fileName);
     ~TAccessLogStream();
     void writeLog(const QByteArray &log);
+    void writeLog(const TAccessLog &log);
     void flush();
 
 private:
     TLogger *logger {nullptr};
+    QMutex mutex;
+    TAccessLogEncoder encoder;
 
     // Disable
     TAccessLogStream();
@@ -14,12 +14,12 @@
 #include <TDispatcher>
 #include <TActionController>
 #include <TSessionStore>
-#include <TCache>
 #include "tsystemglobal.h"
 #include "thttpsocket.h"
 #include "tsessionmanager.h"
 #include "turlroute.h"
 #include "tabstractwebsocket.h"
+#include "ttracecontext.h"
 #include <QtCore>
 #include <QHostAddress>
 #include <QSet>
@@ -40,7 +40,6 @@ TActionContext::~TActionContext()
 {
     release();
     accessLogger.close();
-    delete cachep;
 }
 
 
@@ -67,6 +66,10 @@ void TActionContext::execute(THttpRequest &request, int sid)
         httpReq = &request;
         const THttpRequestHeader &reqHeader = httpReq->header();
 
+        // Trace context
+        TTraceContext::setCurrent(TTraceContext::fromTraceParent(reqHeader.rawHeader(QByteArrayLiteral("traceparent"))));
+        accessLogger.setTraceContext(TTraceContext::current().traceId(), TTraceContext::current().spanId());
+
         // Access log
         QByteArray firstLine;
         firstLine.reserve(200);
@@ -77,6 +80,7 @@ void TActionContext::execute(THttpRequest &request, int sid)
         accessLogger.setTimestamp(QDateTime::currentDateTime());
         accessLogger.setRequest(firstLine);
         accessLogger.setRemoteHost( (ListenPort > 0) ? clientAddress().toString().toLatin1() : QByteArrayLiteral("(unix)") );
+        sqlProfile.clear();
 
         tSystemDebug("method : %s", reqHeader.method().data());
         tSystemDebug("path : %s", reqHeader.path().data());
@@ -95,6 +99,7 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
         tSystemDebug("Routing: controller:%s  action:%s", route.controller.data(),
                      route.action.data());
+        sqlProfile.setLabel(route.controller + '#' + route.action);
 
         if (! route.exists) {
             // Default URL routing
@@ -124,16 +129,24 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
             // Session
             if (currController->sessionEnabled()) {
+                static const bool LazySessionLoading = !SessionAutoIdRegeneration && TSessionManager::instance().storeType() != QLatin1String("cookie");
+
                 TSession session;
                 QByteArray sessionId = httpReq->cookie(TSession::sessionName());
-                if (!sessionId.isEmpty()) {
-                    // Finds a session
-                    session = TSessionManager::instance().findSession(sessionId);
-                }
-                currController->setSession(session);
+                if (LazySessionLoading && !sessionId.isEmpty()) {
+                    // Loads the session when it is accessed first
+                    currController->setSession(TSession(sessionId));
+                    currController->sessionLoaded = false;
+                } else {
+                    if (!sessionId.isEmpty()) {
+                        // Finds a session
+                        session = TSessionManager::instance().findSession(sessionId);
+                    }
+                    currController->setSession(session);
 
-                // Exports flash-variant
-                currController->exportAllFlashVariants();
+                    // Exports flash-variant
+                    currController->exportAllFlashVariants();
+                }
             }
 
             // Verify authenticity token
@@ -146,14 +159,14 @@ void TActionContext::execute(THttpRequest &request, int sid)
             }
 
             if (currController->sessionEnabled()) {
-                if (SessionAutoIdRegeneration || currController->session().id().isEmpty()) {
-                    TSessionManager::instance().remove(currController->session().sessionId); // Removes the old session
+                if (SessionAutoIdRegeneration || currController->sessionStore.id().isEmpty()) {
+                    TSessionManager::instance().remove(currController->sessionStore.sessionId); // Removes the old session
                     // Re-generate session ID
-                    currController->session().sessionId = TSessionManager::instance().generateId();
-                    tSystemDebug("Re-generate session ID: %s", currController->session().sessionId.data());
+                    currController->sessionStore.sessionId = TSessionManager::instance().generateId();
+                    tSystemDebug("Re-generate session ID: %s", currController->sessionStore.sessionId.data());
                 }
                 // Sets CSRF protection information
-                TActionController::setCsrfProtectionInto(currController->session());
+                TActionController::setCsrfProtectionInto(currController->sessionStore);
             }
 
             // Database Transaction
@@ -180,7 +193,14 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
                     // Session store
                     if (currController->sessionEnabled()) {
-                        bool stored = TSessionManager::instance().store(currController->session());
+                        bool stored;
+                        if (currController->sessionLoaded) {
+                            stored = TSessionManager::instance().store(currController->sessionStore);
+                        } else {
+                            // Never accessed; refreshes only the expiration time
+                            TSessionManager::instance().touch(currController->sessionStore.id());
+                            stored = true;
+                        }
                         if (Q_LIKELY(stored)) {
                             static const int SessionCookieMaxAge = ([]() -> int {
                                 QString maxagestr = Tf::appSettings()->value(Tf::SessionCookieMaxAge).toString().trimmed();
@@ -196,7 +216,7 @@ void TActionContext::execute(THttpRequest &request, int sid)
                                 expire = QDateTime::currentDateTime().addSecs(SessionCookieMaxAge);
                             }
 
-                            currController->addCookie(TSession::sessionName(), currController->session().id(), expire, SessionCookiePath, SessionCookieDomain, false, true);
+                            currController->addCookie(TSession::sessionName(), currController->sessionStore.id(), expire, SessionCookiePath, SessionCookieDomain, false, true);
 
                             // Commits a transaction for session
                             commitTransactions();
@@ -355,7 +375,10 @@ void TActionContext::execute(THttpRequest &request, int sid)
         accessLogger.setStatusCode(Tf::InternalServerError);
     }
 
+    sqlProfile.writeSummary();
+    accessLogger.setQueryStatistics(sqlProfile.queryCount(), sqlProfile.totalTime());
     accessLogger.write();  // Writes access log
+    TTraceContext::clearCurrent();
 }
 
 
@@ -443,12 +466,3 @@ QHostAddress TActionContext::clientAddress() const
 {
     return httpReq->clientAddress();
 }
-
-
-TCache *TActionContext::cache()
-{
-    if (! cachep) {
-        cachep = new TCache;
-    }
-    return cachep;
-}
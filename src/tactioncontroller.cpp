@@ -237,6 +237,52 @@ QByteArray TActionController::authenticityToken() const
 void TActionController::setSession(const TSession &session)
 {
     sessionStore = session;
+    sessionLoaded = true;
+}
+
+/*!
+  Loads the session data from the session store if it has not been
+  loaded yet; the data is not read until the session is accessed.
+  Internal use.
+*/
+void TActionController::loadSession()
+{
+    if (sessionLoaded) {
+        return;
+    }
+
+    sessionLoaded = true;
+    QByteArray id = sessionStore.id();
+    TSession session = TSessionManager::instance().findSession(id);
+    if (session.id().isEmpty()) {
+        // Not found; starts a new session instead of the one requested
+        session = TSession(TSessionManager::instance().generateId());
+        tSystemDebug("Re-generate session ID: %s", session.id().data());
+    }
+    sessionStore = session;
+    exportAllFlashVariants();
+}
+
+/*!
+  Returns the current HTTP session, allows associating information
+  with individual visitors.
+  \sa setSession(), sessionEnabled()
+*/
+const TSession &TActionController::session() const
+{
+    const_cast<TActionController *>(this)->loadSession();
+    return sessionStore;
+}
+
+/*!
+  Returns the current HTTP session, allows associating information
+  with individual visitors.
+  \sa setSession(), sessionEnabled()
+*/
+TSession &TActionController::session()
+{
+    loadSession();
+    return sessionStore;
 }
 
 /*!
@@ -306,7 +352,11 @@ bool TActionController::verifyRequest(const THttpRequest &request) const
     }
 
     if (Tf::appSettings()->value(Tf::SessionStoreType).toString().toLower() != QLatin1String("cookie")) {
-        if (session().id().isEmpty()) {
+        // Loads the session; the ID in the cookie is trusted only if a
+        // session is stored with it
+        QByteArray requestedId = sessionStore.id();
+        QByteArray id = session().id();
+        if (id.isEmpty() || id != requestedId) {
             throw SecurityException("Request Forgery Protection requires a valid session", __FILE__, __LINE__);
         }
     }
@@ -478,10 +528,15 @@ bool TActionController::renderAndStoreInCache(const QByteArray &key, int seconds
         return false;
     }
 
-    render(action, layout);
-    if (rendered) {
-        QByteArray responseMsg = response.body();
-        Tf::cache()->set(key, responseMsg, seconds);
+    // Concurrent requests for the key wait for one rendering
+    QByteArray responseMsg = Tf::cache()->getOrCompute(key, seconds, [&]() {
+        render(action, layout);
+        return (rendered) ? response.body() : QByteArray();
+    });
+
+    if (!rendered && !responseMsg.isEmpty()) {
+        response.setBody(responseMsg);
+        rendered = true;
     }
     return rendered;
 }
@@ -494,7 +549,8 @@ bool TActionController::renderFromCache(const QByteArray &key)
         return false;
     }
 
-    auto responseMsg = Tf::cache()->get(key);
+    // A hit due for an early refresh is treated as a miss
+    auto responseMsg = Tf::cache()->getUnlessExpiring(key);
     if (responseMsg.isEmpty()) {
         return false;
     }
@@ -519,6 +575,7 @@ void TActionController::removeFromCache(const QByteArray &key)
 */
 QString TActionController::getRenderingData(const QString &templateName, const QVariantMap &vars)
 {
+    loadSession();  // exports flash variants
 
     // Creates view-object
     QStringList names = templateName.split("/");
@@ -556,6 +613,7 @@ QByteArray TActionController::renderView(TActionView *view)
         tSystemError("view null pointer.  action:%s", qPrintable(activeAction()));
         return QByteArray();
     }
+    loadSession();  // exports flash variants
     view->setController(this);
     view->setVariantMap(allVariants());
 
@@ -663,7 +721,7 @@ void TActionController::redirect(const QUrl &url, int statusCode)
     // Enable flash-variants
     QVariant var;
     var.setValue(flashVars);
-    sessionStore.insert(FLASH_VARS_SESSION_KEY, var);
+    session().insert(FLASH_VARS_SESSION_KEY, var);
 }
 
 /*!
@@ -916,22 +974,6 @@ void TActionController::closeWebSokcet(int sid, int closeCode)
 }
 
 
-/*!
-  \fn const TSession &TActionController::session() const;
-
-  Returns the current HTTP session, allows associating information
-  with individual visitors.
-  \sa setSession(), sessionEnabled()
-*/
-
-/*!
-  \fn TSession &TActionController::session();
-
-  Returns the current HTTP session, allows associating information
-  with individual visitors.
-  \sa setSession(), sessionEnabled()
-*/
-
 /*!
   \fn virtual bool TActionController::sessionEnabled() const
 
@@ -32,7 +32,7 @@ public:
     const THttpRequest &httpRequest() const;
     const THttpResponse &httpResponse() const { return response; }
     QString getRenderingData(const QString &templateName, const QVariantMap &vars = QVariantMap());
-    const TSession &session() const { return sessionStore; }
+    const TSession &session() const;
     virtual bool sessionEnabled() const { return true; }
     virtual bool csrfProtectionEnabled() const { return true; }
     virtual QStringList exceptionActionsOfCsrfProtection() const { return QStringList(); }
@@ -60,7 +60,7 @@ protected:
     int statusCode() const { return statCode; }
     void setFlash(const QString &name, const QVariant &value);
     void setFlashValidationErrors(const TFormValidator &validator, const QString &prefix = QString("err_"));
-    TSession &session() { return sessionStore; }
+    TSession &session();
     void setSession(const TSession &session);
     bool addCookie(const TCookie &cookie);
     bool addCookie(const QByteArray &name, const QByteArray &value, const QDateTime &expire = QDateTime(), const QString &path = QString(), const QString &domain = QString(), bool secure = false, bool httpOnly = false);
@@ -123,6 +123,7 @@ private:
     bool verifyRequest(const THttpRequest &request) const;
     QByteArray renderView(TActionView *view);
     void exportAllFlashVariants();
+    void loadSession();
     const TActionController *controller() const { return this; }
     bool rollbackRequested() const { return rollback; }
     static QString layoutClassName(const QString &layout);
@@ -138,6 +139,7 @@ private:
     THttpResponse response;
     QVariantMap flashVars;
     TSession sessionStore;
+    bool sessionLoaded {true};
     TCookieJar cookieJar;
     bool rollback {false};
     QStringList autoRemoveFiles;
@@ -36,6 +36,9 @@ public:
         insert(Tf::DirectViewRenderMode, "DirectViewRenderMode");
         insert(Tf::SystemLogFile, "SystemLogFile");
         insert(Tf::SqlQueryLogFile, "SqlQueryLogFile");
+        insert(Tf::SqlQuerySlowLogFile, "SqlQuerySlowLogFile");
+        insert(Tf::SqlQuerySlowThreshold, "SqlQuerySlowThreshold");
+        insert(Tf::SqlQueryRepeatThreshold, "SqlQueryRepeatThreshold");
         insert(Tf::ApplicationAbortOnFatal, "ApplicationAbortOnFatal");
         insert(Tf::LimitRequestBody, "LimitRequestBody");
         insert(Tf::EnableCsrfProtectionModule, "EnableCsrfProtectionModule");
@@ -54,6 +57,10 @@ public:
         insert(Tf::SessionGcMaxLifeTime, "Session.GcMaxLifeTime");
         insert(Tf::SessionSecret, "Session.Secret");
         insert(Tf::SessionCsrfProtectionKey, "Session.CsrfProtectionKey");
+        insert(Tf::SessionTouchUnmodified, "Session.TouchUnmodified");
+        insert(Tf::SessionCookieEncryptionKeys, "Session.CookieEncryptionKeys");
+        insert(Tf::SessionCookieCompressionThreshold, "Session.CookieCompressionThreshold");
+        insert(Tf::SessionCookieMaxSize, "Session.CookieMaxSize");
         insert(Tf::MPMThreadMaxAppServers, "MPM.thread.MaxAppServers");
         insert(Tf::MPMThreadMaxThreadsPerAppServer, "MPM.thread.MaxThreadsPerAppServer");
         insert(Tf::MPMEpollMaxAppServers, "MPM.epoll.MaxAppServers");
@@ -63,6 +70,12 @@ public:
         insert(Tf::AccessLogFilePath, "AccessLog.FilePath");
         insert(Tf::AccessLogLayout, "AccessLog.Layout");
         insert(Tf::AccessLogDateTimeFormat, "AccessLog.DateTimeFormat");
+        insert(Tf::AccessLogFormat, "AccessLog.Format");
+        insert(Tf::LogFileMaxBufferSize, "LogFile.MaxBufferSize");
+        insert(Tf::LogFileSyncPolicy, "LogFile.SyncPolicy");
+        insert(Tf::LogFileSyncInterval, "LogFile.SyncInterval");
+        insert(Tf::LogFileRotationSize, "LogFile.RotationSize");
+        insert(Tf::LogFileRotationPeriod, "LogFile.RotationPeriod");
         insert(Tf::ActionMailerDeliveryMethod, "ActionMailer.DeliveryMethod");
         insert(Tf::ActionMailerCharacterSet, "ActionMailer.CharacterSet");
         insert(Tf::ActionMailerDelayedDelivery, "ActionMailer.DelayedDelivery");
@@ -81,6 +94,14 @@ public:
         insert(Tf::CacheBackend, "Cache.Backend");
         insert(Tf::CacheGcProbability, "Cache.GcProbability");
         insert(Tf::CacheEnableCompression, "Cache.EnableCompression");
+        insert(Tf::CacheEnableQueryCache, "Cache.EnableQueryCache");
+        insert(Tf::CacheNearCacheSize, "Cache.NearCacheSize");
+        insert(Tf::CacheNearCacheLifetime, "Cache.NearCacheLifetime");
+        insert(Tf::CacheCompressionCodec, "Cache.CompressionCodec");
+        insert(Tf::CacheCompressionThreshold, "Cache.CompressionThreshold");
+        insert(Tf::CacheZstdLevel, "Cache.ZstdLevel");
+        insert(Tf::CacheZstdDictionaryFile, "Cache.ZstdDictionaryFile");
+        insert(Tf::WebSocketEnableRedisPublisher, "WebSocket.EnableRedisPublisher");
     }
 };
 Q_GLOBAL_STATIC(AttributeMap, attributeMap)
@@ -29,10 +29,10 @@ TBasicLogStream::~TBasicLogStream()
 }
 
 
-void TBasicLogStream::writeLog(const TLog &log)
+void TBasicLogStream::writeLog(const TLog &log, quint64 loggers)
 {
     QMutexLocker locker(&mutex);
-    loggerWrite(log);
+    loggerWrite(log, loggers);
 
     if (!isNonBufferingMode()) {
         if (thread() == QThread::currentThread()) {
@@ -12,7 +12,7 @@ public:
     TBasicLogStream(const QList<TLogger *> loggers, QObject *parent = 0);
     ~TBasicLogStream();
 
-    void writeLog(const TLog &log);
+    void writeLog(const TLog &log, quint64 loggers = AllLoggers);
     void flush();
     void setNonBufferingMode();
 
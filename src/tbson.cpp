@@ -12,6 +12,7 @@
 #include <QCoreApplication>
 #include <QtEndian>
 #include <atomic>
+#include <cstring>
 #include "tsystemglobal.h"
 extern "C" {
 #include <bson.h>
@@ -47,7 +48,11 @@ TBson::TBson(const TBsonObject *bson)
 
 QVariant TBson::value(const QString &key, const QVariant &defaultValue) const
 {
-    return fromBson(*this).value(key, defaultValue);
+    bson_iter_t it;
+    if (bson_iter_init_find(&it, bsonData, key.toUtf8().constData())) {
+        return fromBsonIterator(&it);
+    }
+    return defaultValue;
 }
 
 
@@ -66,125 +71,129 @@ QVariantMap TBson::fromBson(const TBsonObject *obj)
     bson_iter_init(&it, bson);
     while (bson_iter_next(&it)) {
         bson_type_t t = bson_iter_type(&it);
-        QString key(bson_iter_key(&it));
 
         switch (t) {
         case BSON_TYPE_EOD:
             return ret;
             break;
 
-        case BSON_TYPE_DOUBLE:
-            ret[key] = bson_iter_double(&it);
+        case BSON_TYPE_CODEWSCOPE: // FALLTHRU
+        case BSON_TYPE_TIMESTAMP:  // FALLTHRU (internal use)
+            // do nothing
             break;
 
-        case BSON_TYPE_UTF8:
-            ret[key] = QString::fromUtf8(bson_iter_utf8(&it, nullptr));
+        default:
+            ret.insert(QString::fromUtf8(bson_iter_key(&it)), fromBsonIterator(&it));
             break;
+        }
+    }
+    return ret;
+}
 
-        case BSON_TYPE_ARRAY: {
-            const uint8_t *docbuf = nullptr;
-            uint32_t doclen = 0;
-            bson_t sub[1];
-
-            bson_iter_array(&it, &doclen, &docbuf);
-            if (bson_init_static(sub, docbuf, doclen)) {
-                ret[key] = fromBson(sub).values();
+/*!
+  Returns the value of the element at the iterator \a iter, which points
+  to a bson_iter_t object.
+*/
+QVariant TBson::fromBsonIterator(const void *iter)
+{
+    const bson_iter_t *it = (const bson_iter_t *)iter;
+    bson_type_t t = bson_iter_type(it);
+
+    switch (t) {
+    case BSON_TYPE_DOUBLE:
+        return bson_iter_double(it);
+
+    case BSON_TYPE_UTF8: {
+        uint32_t len = 0;
+        const char *str = bson_iter_utf8(it, &len);
+        return QString::fromUtf8(str, len); }
+
+    case BSON_TYPE_ARRAY: {
+        const uint8_t *docbuf = nullptr;
+        uint32_t doclen = 0;
+        bson_t sub[1];
+        bson_iter_t child;
+        QVariantList list;
+
+        bson_iter_array(it, &doclen, &docbuf);
+        if (bson_init_static(sub, docbuf, doclen) && bson_iter_init(&child, sub)) {
+            while (bson_iter_next(&child)) {
+                list << fromBsonIterator(&child);
             }
-            break; }
+        }
+        return list; }
 
-        case BSON_TYPE_DOCUMENT: {
-            const uint8_t *docbuf = nullptr;
-            uint32_t doclen = 0;
-            bson_t sub[1];
+    case BSON_TYPE_DOCUMENT: {
+        const uint8_t *docbuf = nullptr;
+        uint32_t doclen = 0;
+        bson_t sub[1];
 
-            bson_iter_document(&it, &doclen, &docbuf);
-            if (bson_init_static(sub, docbuf, doclen)) {
-                ret[key] = fromBson(sub);
-            }
-            break; }
+        bson_iter_document(it, &doclen, &docbuf);
+        if (bson_init_static(sub, docbuf, doclen)) {
+            return fromBson(sub);
+        }
+        return QVariantMap(); }
 
-        case BSON_TYPE_BINARY: {
-            const uint8_t *binary = nullptr;
-            bson_subtype_t subtype = BSON_SUBTYPE_BINARY;
-            uint32_t len = 0;
+    case BSON_TYPE_BINARY: {
+        const uint8_t *binary = nullptr;
+        bson_subtype_t subtype = BSON_SUBTYPE_BINARY;
+        uint32_t len = 0;
 
-            bson_iter_binary(&it, &subtype, &len, &binary);
-            if (binary) {
-                ret[key] = QByteArray((char *)binary, len);
-            }
-            break; }
+        bson_iter_binary(it, &subtype, &len, &binary);
+        return (binary) ? QByteArray((char *)binary, len) : QVariant(); }
 
-        case BSON_TYPE_UNDEFINED:
-            ret[key] = QVariant();
-            break;
+    case BSON_TYPE_UNDEFINED:
+        return QVariant();
 
-        case BSON_TYPE_OID: {
-            char oidhex[25];
-            bson_oid_to_string(bson_iter_oid(&it), oidhex);
-            ret[key] = QString(oidhex);
-            break; }
+    case BSON_TYPE_OID: {
+        char oidhex[25];
+        bson_oid_to_string(bson_iter_oid(it), oidhex);
+        return QString::fromLatin1(oidhex, 24); }
 
-        case BSON_TYPE_BOOL:
-            ret[key] = (bool)bson_iter_bool(&it);
-            break;
+    case BSON_TYPE_BOOL:
+        return (bool)bson_iter_bool(it);
 
-        case BSON_TYPE_DATE_TIME: {
-#if QT_VERSION >= 0x040700
-            QDateTime date;
-            date.setMSecsSinceEpoch(bson_iter_date_time(&it));
-#else
-            qint64 val = bson_iter_date_time(&it);
-            qint64 days = val / 86400000;  // 24*60*60*1000
-            int msecs = val % 86400000;
-            QDate dt = QDate(1970, 1, 1).addDays(days);
-            QTime tm = QTime(0, 0, 0).addMSecs(msecs);
-            QDateTime date(dt, tm, Qt::UTC);
-#endif
-            ret[key] = date;
-            break; }
-
-        case BSON_TYPE_NULL:
-            ret[key] = QVariant();
-            break;
+    case BSON_TYPE_DATE_TIME:
+        return QDateTime::fromMSecsSinceEpoch(bson_iter_date_time(it));
 
-        case BSON_TYPE_REGEX:
-            ret[key] = QRegExp(QLatin1String(bson_iter_regex(&it, nullptr)));
-            break;
+    case BSON_TYPE_NULL:
+        return QVariant();
 
-        case BSON_TYPE_CODE:
-            ret[key] = QString(bson_iter_code(&it, nullptr));
-            break;
+    case BSON_TYPE_REGEX:
+        return QRegExp(QLatin1String(bson_iter_regex(it, nullptr)));
 
-        case BSON_TYPE_SYMBOL:
-            ret[key] = QString(bson_iter_symbol(&it, nullptr));
-            break;
+    case BSON_TYPE_CODE:
+        return QString(bson_iter_code(it, nullptr));
 
-        case BSON_TYPE_INT32:
-            ret[key] = bson_iter_int32(&it);
-            break;
+    case BSON_TYPE_SYMBOL:
+        return QString(bson_iter_symbol(it, nullptr));
 
-        case BSON_TYPE_INT64:
-            ret[key] = (qint64)bson_iter_int64(&it);
-            break;
+    case BSON_TYPE_INT32:
+        return bson_iter_int32(it);
 
-        case BSON_TYPE_CODEWSCOPE: // FALLTHRU
-        case BSON_TYPE_TIMESTAMP:  // FALLTHRU (internal use)
-            // do nothing
-            break;
+    case BSON_TYPE_INT64:
+        return (qint64)bson_iter_int64(it);
 
-        default:
-            tError("fromBson() unknown type: %d", t);
-            break;
-        }
-        //tSystemDebug("fromBson : t:%d key:%s = %s", t, qPrintable(key), qPrintable(ret[key].toString()));
+    case BSON_TYPE_CODEWSCOPE: // FALLTHRU
+    case BSON_TYPE_TIMESTAMP:  // FALLTHRU (internal use)
+        // do nothing
+        break;
+
+    default:
+        tError("fromBson() unknown type: %d", t);
+        break;
     }
-    return ret;
+    return QVariant();
 }
 
 
-static bool appendBsonValue(bson_t *bson, const QString &key, const QVariant &value)
+static void appendBson(bson_t *bson, const QVariantMap &map);
+
+static bool appendBsonValue(bson_t *bson, const QByteArray &key, const QVariant &value)
 {
-    static const QLatin1String oidkey("_id");
+    static const QByteArray oidkey("_id");
+    const char *k = key.constData();
+    const int klen = key.length();
     bool ok = true;
     int type = value.type();
 
@@ -195,13 +204,14 @@ static bool appendBsonValue(bson_t *bson, const QString &key, const QVariant &va
             // ObjectId
             bson_oid_t oid;
             bson_oid_init_from_string(&oid, oidVal.data());
-            BSON_APPEND_OID(bson, oidkey.latin1(), &oid);
+            bson_append_oid(bson, k, klen, &oid);
         } else {
             int id = value.toInt(&ok);
             if (ok) {
-                BSON_APPEND_INT32(bson, oidkey.latin1(), id);
+                bson_append_int32(bson, k, klen, id);
             } else {
-                BSON_APPEND_UTF8(bson, oidkey.latin1(), value.toString().toUtf8().data());
+                QByteArray str = value.toString().toUtf8();
+                bson_append_utf8(bson, k, klen, str.constData(), str.length());
             }
         }
         return true;
@@ -209,66 +219,61 @@ static bool appendBsonValue(bson_t *bson, const QString &key, const QVariant &va
 
     switch (type) {
     case QVariant::Int:
-        BSON_APPEND_INT32(bson, qPrintable(key), value.toInt(&ok));
+        bson_append_int32(bson, k, klen, value.toInt(&ok));
         break;
 
-    case QVariant::String:
-        BSON_APPEND_UTF8(bson, qPrintable(key), value.toString().toUtf8().data());
-        break;
+    case QVariant::String: {
+        QByteArray str = value.toString().toUtf8();
+        bson_append_utf8(bson, k, klen, str.constData(), str.length());
+        break; }
 
     case QVariant::LongLong:
-        BSON_APPEND_INT64(bson, qPrintable(key), value.toLongLong(&ok));
+        bson_append_int64(bson, k, klen, value.toLongLong(&ok));
         break;
 
-    case QVariant::Map:
-        BSON_APPEND_DOCUMENT(bson, qPrintable(key), (const bson_t *)TBson::toBson(value.toMap()).constData());
-        break;
+    case QVariant::Map: {
+        // Builds the sub-document in place
+        bson_t child;
+        bson_append_document_begin(bson, k, klen, &child);
+        appendBson(&child, value.toMap());
+        bson_append_document_end(bson, &child);
+        break; }
 
     case QVariant::Double:
-        BSON_APPEND_DOUBLE(bson, qPrintable(key), value.toDouble(&ok));
+        bson_append_double(bson, k, klen, value.toDouble(&ok));
         break;
 
     case QVariant::Bool:
-        BSON_APPEND_BOOL(bson, qPrintable(key), value.toBool());
+        bson_append_bool(bson, k, klen, value.toBool());
         break;
 
-    case QVariant::DateTime: {
-#if QT_VERSION >= 0x040700
-        BSON_APPEND_DATE_TIME(bson, qPrintable(key), value.toDateTime().toMSecsSinceEpoch());
-#else
-        QDateTime utcDate = value.toDateTime().toUTC();
-        qint64 ms = utcDate.time().msec();
-        qint64 tm = utcDate.toTime_t() * 1000LL;
-        if (ms > 0) {
-          tm += ms;
-        }
-        BSON_APPEND_DATE_TIME(bson, qPrintable(key), tm);
-#endif
-        break; }
+    case QVariant::DateTime:
+        bson_append_date_time(bson, k, klen, value.toDateTime().toMSecsSinceEpoch());
+        break;
 
     case QVariant::ByteArray: {
         QByteArray ba = value.toByteArray();
-        BSON_APPEND_BINARY(bson, qPrintable(key), BSON_SUBTYPE_BINARY, (uint8_t *)ba.constData(), ba.length());
+        bson_append_binary(bson, k, klen, BSON_SUBTYPE_BINARY, (uint8_t *)ba.constData(), ba.length());
         break; }
 
     case QVariant::List:  // FALLTHRU
     case QVariant::StringList: {
         bson_t child;
-        BSON_APPEND_ARRAY_BEGIN(bson, qPrintable(key), &child);
+        bson_append_array_begin(bson, k, klen, &child);
 
         int i = 0;
         for (auto &var : (const QList<QVariant>&)value.toList()) {
-            appendBsonValue(&child, QString::number(i++), var);
+            appendBsonValue(&child, QByteArray::number(i++), var);
         }
         bson_append_array_end(bson, &child);
         break; }
 
     case QVariant::Invalid:
-        BSON_APPEND_UNDEFINED(bson, qPrintable(key));
+        bson_append_undefined(bson, k, klen);
         break;
 
     default:
-        tError("toBson() failed to convert  name:%s  type:%d", qPrintable(key), type);
+        tError("toBson() failed to convert  name:%s  type:%d", k, type);
         ok = false;
         break;
     }
@@ -276,10 +281,10 @@ static bool appendBsonValue(bson_t *bson, const QString &key, const QVariant &va
 }
 
 
-static void appendBson(TBsonObject *bson, const QVariantMap &map)
+static void appendBson(bson_t *bson, const QVariantMap &map)
 {
     for (auto it = map.begin(); it != map.end(); ++it) {
-        bool res = appendBsonValue((bson_t *)bson, qPrintable(it.key()), it.value());
+        bool res = appendBsonValue(bson, it.key().toUtf8(), it.value());
         if (!res) {
             break;
         }
@@ -289,7 +294,13 @@ static void appendBson(TBsonObject *bson, const QVariantMap &map)
 
 bool TBson::insert(const QString &key, const QVariant &value)
 {
-    return appendBsonValue(bsonData, key, value);
+    return appendBsonValue(bsonData, key.toUtf8(), value);
+}
+
+
+bool TBson::insert(const char *key, const QVariant &value)
+{
+    return appendBsonValue(bsonData, QByteArray::fromRawData(key, (int)strlen(key)), value);
 }
 
 
@@ -297,7 +308,7 @@ TBson TBson::toBson(const QVariantMap &map)
 {
     TBson ret;
     if (!map.isEmpty()) {
-        appendBson(ret.data(), map);
+        appendBson(ret.bsonData, map);
     }
     return ret;
 }
@@ -312,6 +323,20 @@ TBson TBson::toBson(const QString &op, const QVariantMap &map)
     return ret;
 }
 
+/*!
+  Returns a BSON that has the document \a bson as the value of the
+  operator \a op, such as '$set', without converting it to QVariantMap.
+*/
+TBson TBson::toBson(const QString &op, const TBson &bson)
+{
+    TBson ret;
+    if (!op.isEmpty()) {
+        QByteArray key = op.toUtf8();
+        bson_append_document(ret.bsonData, key.constData(), key.length(), bson.bsonData);
+    }
+    return ret;
+}
+
 
 TBson TBson::toBson(const QVariantMap &query, const QVariantMap &orderBy)
 {
@@ -338,7 +363,7 @@ TBson TBson::toBson(const QStringList &lst)
 {
     TBson ret;
     for (auto &str : lst) {
-        bool res = appendBsonValue((bson_t *)ret.data(), qPrintable(str), 1);
+        bool res = appendBsonValue(ret.bsonData, str.toUtf8(), 1);
         if (!res)
             break;
     }
@@ -16,6 +16,7 @@ public:
     TBson(const TBsonObject *bson);
 
     bool insert(const QString &key, const QVariant &value);
+    bool insert(const char *key, const QVariant &value);
     QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
     TBsonObject *data() { return bsonData; }
     const TBsonObject *constData() const { return bsonData; }
@@ -23,12 +24,14 @@ public:
     static QVariantMap fromBson(const TBson &bson);
     static TBson toBson(const QVariantMap &map);
     static TBson toBson(const QString &op, const QVariantMap &map);
+    static TBson toBson(const QString &op, const TBson &bson);
     static TBson toBson(const QVariantMap &query, const QVariantMap &orderBy);
     static TBson toBson(const QStringList &lst);
     static QString generateObjectId();
 
 protected:
     static QVariantMap fromBson(const TBsonObject *obj);
+    static QVariant fromBsonIterator(const void *iter);
 
 private:
     typedef struct _bson_t bson_t;
@@ -36,6 +39,8 @@ private:
 
     friend class TMongoDriver;
     friend class TMongoCursor;
+    friend class TBsonView;
+    friend class TMongoBulkWrite;
     TBson &operator=(const TBson &other);
 };
 
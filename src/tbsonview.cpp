@@ -0,0 +1,130 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <TBsonView>
+#include <cstring>
+extern "C" {
+#include <bson.h>
+}
+
+/*!
+  \class TBsonView
+  \brief The TBsonView class provides read-only access to the fields of
+  a BSON document without converting the entire document.
+
+  A field is looked up and converted to QVariant only when value() is
+  called. The view does not own the document, so it is valid as long
+  as the document exists; a view of the current document of a cursor is
+  valid until the cursor moves to the next one.
+  \sa TMongoCursor::valueView()
+*/
+
+/*!
+  Returns true if the document has no fields.
+*/
+bool TBsonView::isEmpty() const
+{
+    return !bsonData || bson_empty((const bson_t *)bsonData);
+}
+
+/*!
+  Returns the number of the fields of the document.
+*/
+int TBsonView::count() const
+{
+    return (bsonData) ? (int)bson_count_keys((const bson_t *)bsonData) : 0;
+}
+
+
+bool TBsonView::contains(const QString &key) const
+{
+    return contains(key.toUtf8().constData());
+}
+
+/*!
+  Returns true if the document contains the field \a key, which can be
+  a dot-notated path to a field of an embedded document, such as
+  "address.city".
+*/
+bool TBsonView::contains(const char *key) const
+{
+    return bsonData && bson_has_field((const bson_t *)bsonData, key);
+}
+
+
+QVariant TBsonView::value(const QString &key, const QVariant &defaultValue) const
+{
+    return value(key.toUtf8().constData(), defaultValue);
+}
+
+/*!
+  Returns the value of the field \a key converted to QVariant, or
+  \a defaultValue if the document does not contain the field. The \a key
+  can be a dot-notated path to a field of an embedded document.
+*/
+QVariant TBsonView::value(const char *key, const QVariant &defaultValue) const
+{
+    bson_iter_t it;
+    bson_iter_t desc;
+
+    if (!bsonData || !bson_iter_init(&it, (const bson_t *)bsonData)) {
+        return defaultValue;
+    }
+
+    if (std::strchr(key, '.')) {
+        if (bson_iter_find_descendant(&it, key, &desc)) {
+            return TBson::fromBsonIterator(&desc);
+        }
+    } else if (bson_iter_find(&it, key)) {
+        return TBson::fromBsonIterator(&it);
+    }
+    return defaultValue;
+}
+
+/*!
+  Returns the names of the fields in the order of the document.
+*/
+QStringList TBsonView::keys() const
+{
+    QStringList list;
+    bson_iter_t it;
+
+    if (bsonData && bson_iter_init(&it, (const bson_t *)bsonData)) {
+        while (bson_iter_next(&it)) {
+            list << QString::fromUtf8(bson_iter_key(&it));
+        }
+    }
+    return list;
+}
+
+/*!
+  Converts the entire document to QVariantMap.
+*/
+QVariantMap TBsonView::toVariantMap() const
+{
+    return (bsonData) ? TBson::fromBson(bsonData) : QVariantMap();
+}
+
+/*!
+  Converts the fields of the \a keys only to QVariantMap, iterating over
+  the document once.
+*/
+QVariantMap TBsonView::toVariantMap(const QSet<QByteArray> &keys) const
+{
+    QVariantMap map;
+    bson_iter_t it;
+
+    if (bsonData && bson_iter_init(&it, (const bson_t *)bsonData)) {
+        while (bson_iter_next(&it)) {
+            const char *key = bson_iter_key(&it);
+            if (keys.contains(QByteArray::fromRawData(key, (int)std::strlen(key)))) {
+                map.insert(QString::fromUtf8(key), TBson::fromBsonIterator(&it));
+            }
+        }
+    }
+    return map;
+}
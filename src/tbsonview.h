@@ -0,0 +1,34 @@
+#ifndef TBSONVIEW_H
+#define TBSONVIEW_H
+
+#include <QVariant>
+#include <QStringList>
+#include <QSet>
+#include <TGlobal>
+#include <TBson>
+
+
+class T_CORE_EXPORT TBsonView
+{
+public:
+    TBsonView() { }
+    TBsonView(const TBson &bson) : bsonData(bson.constData()) { }
+    explicit TBsonView(const TBsonObject *bson) : bsonData(bson) { }
+
+    bool isNull() const { return !bsonData; }
+    bool isEmpty() const;
+    int count() const;
+    bool contains(const QString &key) const;
+    bool contains(const char *key) const;
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+    QVariant value(const char *key, const QVariant &defaultValue = QVariant()) const;
+    QStringList keys() const;
+    QVariantMap toVariantMap() const;
+    QVariantMap toVariantMap(const QSet<QByteArray> &keys) const;
+    const TBsonObject *constData() const { return bsonData; }
+
+private:
+    const TBsonObject *bsonData {nullptr};  // pointer to object of bson_t, not owned
+};
+
+#endif // TBSONVIEW_H
@@ -10,12 +10,129 @@
 #include <TAppSettings>
 #include "tcachefactory.h"
 #include "tcachestore.h"
+#include "tcachememorystore.h"
+#include "tcachecodec.h"
+#include "tsystembus.h"
+#include "tpublisher.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+#include <QtEndian>
+#include <climits>
+#include <cmath>
+#include <memory>
+
+constexpr int ENVELOPE_LEN = 8 + 4;
+constexpr auto LOCK_KEY_SUFFIX = ":lock";
+constexpr int LOCK_SECONDS = 10;
+constexpr int LOCK_WAIT_MSECS = 5000;
+constexpr int LOCK_POLL_MSECS = 50;
+constexpr double XFETCH_BETA = 1.0;
 
 /*!
   \class TCache
   \brief The TCache class stores items so that can be served faster.
+
+  If Cache.NearCacheSize is set in the application.ini, the values are
+  also kept decompressed in the memory of the process for at most
+  Cache.NearCacheLifetime seconds, so that hot keys are served without
+  accessing the backend. Setting or removing an item invalidates it in
+  the near caches of the other application server processes through the
+  system bus.
 */
 
+namespace {
+
+TCacheMemoryArena *nearCache()
+{
+    static TCacheMemoryArena *arena = []() -> TCacheMemoryArena * {
+        if (!Tf::app()->cacheEnabled() || TCacheFactory::dbType(Tf::app()->cacheBackend()) == TCacheStore::Memory) {
+            return nullptr;
+        }
+
+        qint64 size = TCacheMemoryArena::parseSize(Tf::appSettings()->value(Tf::CacheNearCacheSize), 0);
+        return (size > 0) ? TCacheMemoryArena::create(size, 16) : nullptr;
+    }();
+    return arena;
+}
+
+
+// Expiry in the near cache; not later than the \a expire of the backend
+// if known
+qint64 nearCacheExpire(int seconds, qint64 expire = 0)
+{
+    static int lifetime = Tf::appSettings()->value(Tf::CacheNearCacheLifetime, 5).toInt();
+    qint64 nearExpire = QDateTime::currentMSecsSinceEpoch() + qMin(lifetime, seconds) * 1000LL;
+    return (expire > 0) ? qMin(nearExpire, expire) : nearExpire;
+}
+
+// Notifies the other processes; an empty key means all the keys
+void sendInvalidation(const QByteArray &key)
+{
+    if (Tf::app()->maxNumberOfAppServers() > 1) {
+        TSystemBus::instance()->send(Tf::CacheInvalidate, QString(), key);
+    }
+}
+
+// Wraps the value with its expiry and the time taken to compute it; all
+// the values in the near cache are wrapped, and so are those in the
+// backend flagged TCacheCodec::Envelope
+QByteArray wrapValue(const QByteArray &value, qint64 expire, qint32 delta)
+{
+    QByteArray data;
+    data.reserve(ENVELOPE_LEN + value.size());
+    qint64 e = qToBigEndian(expire);
+    qint32 d = qToBigEndian(delta);
+    data.append((const char *)&e, sizeof(e));
+    data.append((const char *)&d, sizeof(d));
+    data.append(value);
+    return data;
+}
+
+
+QByteArray unwrapValue(const QByteArray &data, qint64 *expire = nullptr, qint32 *delta = nullptr)
+{
+    if (data.size() < ENVELOPE_LEN) {
+        return QByteArray();
+    }
+
+    if (expire) {
+        *expire = qFromBigEndian<qint64>((const uchar *)data.constData());
+    }
+    if (delta) {
+        *delta = qFromBigEndian<qint32>((const uchar *)data.constData() + 8);
+    }
+    return data.mid(ENVELOPE_LEN);
+}
+
+// XFetch; the probability rises as the expiry approaches, weighted by
+// the time taken to recompute
+bool expiresEarly(qint64 expire, qint32 delta)
+{
+    if (expire <= 0) {
+        return false;
+    }
+
+    double r = Tf::random(1, 1000000) / 1000000.0;
+    return QDateTime::currentMSecsSinceEpoch() - delta * XFETCH_BETA * std::log(r) >= expire;
+}
+
+
+struct Flight {
+    QMutex mutex {QMutex::NonRecursive};
+    QWaitCondition finished;
+    bool done {false};
+    QByteArray value;
+};
+
+QMutex flightMutex(QMutex::NonRecursive);
+QMap<QByteArray, std::shared_ptr<Flight>> flights;
+
+}  // namespace
+
+
 TCache::TCache()
 {
     static int CacheGcProbability = TAppSettings::instance()->value(Tf::CacheGcProbability, 0).toInt();
@@ -49,19 +166,38 @@ TCache::~TCache()
   timeout after a given number of \a seconds.
  */
 bool TCache::set(const QByteArray &key, const QByteArray &value, int seconds)
+{
+    qint64 expire = QDateTime::currentMSecsSinceEpoch() + seconds * 1000LL;
+    return setValue(key, wrapValue(value, expire, 0), seconds);
+}
+
+/*!
+  Stores the \a data, a value wrapped with its expiry, for \a seconds.
+*/
+bool TCache::setValue(const QByteArray &key, const QByteArray &data, int seconds)
 {
     bool ret = false;
 
     if (_cache) {
-        if (compressionEnabled()) {
-            ret = _cache->set(key, Tf::lz4Compress(value), seconds);
-        } else {
-            ret = _cache->set(key, value, seconds);
+        // Tagged even if uncompressed
+        ret = _cache->set(key, TCacheCodec::encode(data, compressionEnabled(), TCacheCodec::Envelope), seconds);
+
+        TCacheMemoryArena *near = nearCache();
+        if (near) {
+            if (ret) {
+                near->set(key, data, nearCacheExpire(seconds));
+            } else {
+                near->remove(key);
+            }
+            sendInvalidation(key);
         }
 
         // GC
         if (_gcDivisor > 0 && Tf::random(1, _gcDivisor) == 1) {
             _cache->gc();
+            if (near) {
+                near->gc();
+            }
         }
     }
     return ret;
@@ -71,13 +207,175 @@ bool TCache::set(const QByteArray &key, const QByteArray &value, int seconds)
   Returns the value associated with the \a key.
  */
 QByteArray TCache::get(const QByteArray &key)
+{
+    return unwrapValue(getValue(key));
+}
+
+/*!
+  Returns the value associated with the \a key, or an empty byte array
+  if the value is due for an early recomputation (XFetch); in that case
+  the caller should compute and store a new value.
+  \sa getOrCompute()
+ */
+QByteArray TCache::getUnlessExpiring(const QByteArray &key)
+{
+    qint64 expire = 0;
+    qint32 delta = 0;
+    QByteArray value = unwrapValue(getValue(key), &expire, &delta);
+    return (value.isEmpty() || expiresEarly(expire, delta)) ? QByteArray() : value;
+}
+
+/*!
+  Returns the value associated with the \a key; if the value does not
+  exist, calls \a compute and stores its result for \a seconds.
+  Concurrent calls in this process for the same key wait for one
+  computation, and other processes wait for the lock taken through
+  the backend. The value may be recomputed before it expires, with the
+  probability rising as the expiry approaches (XFetch), so that the
+  popular keys do not expire at once.
+ */
+QByteArray TCache::getOrCompute(const QByteArray &key, int seconds, const std::function<QByteArray()> &compute)
+{
+    qint64 expire = 0;
+    qint32 delta = 0;
+    QByteArray value = unwrapValue(getValue(key), &expire, &delta);
+
+    if (!value.isEmpty() && !expiresEarly(expire, delta)) {
+        return value;
+    }
+
+    // Single-flight
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+        QMutexLocker locker(&flightMutex);
+        flight = flights.value(key);
+        if (!flight) {
+            flight = std::make_shared<Flight>();
+            flights.insert(key, flight);
+            leader = true;
+        }
+    }
+
+    if (!leader) {
+        if (!value.isEmpty()) {
+            return value;  // being refreshed
+        }
+
+        QMutexLocker locker(&flight->mutex);
+        while (!flight->done) {
+            if (!flight->finished.wait(&flight->mutex, LOCK_WAIT_MSECS)) {
+                break;
+            }
+        }
+        return (flight->done) ? flight->value : compute();
+    }
+
+    // Finishes the flight even if compute() throws
+    struct FlightFinisher {
+        const QByteArray &key;
+        std::shared_ptr<Flight> flight;
+        QByteArray result;
+        ~FlightFinisher()
+        {
+            {
+                QMutexLocker locker(&flightMutex);
+                flights.remove(key);
+            }
+            QMutexLocker locker(&flight->mutex);
+            flight->value = result;
+            flight->done = true;
+            flight->finished.wakeAll();
+        }
+    } finisher {key, flight, QByteArray()};
+
+    finisher.result = computeAndSet(key, seconds, value, compute);
+    return finisher.result;
+}
+
+
+QByteArray TCache::computeAndSet(const QByteArray &key, int seconds, const QByteArray &staleValue, const std::function<QByteArray()> &compute)
+{
+    const QByteArray lockKey = key + LOCK_KEY_SUFFIX;
+    // Identifies this holder, so that an expired lock taken over by
+    // another process is never released by this one
+    const QByteArray token = QByteArray::number(QCoreApplication::applicationPid()) + ':' + QByteArray::number((qulonglong)Tf::rand64_r(), 36);
+    bool locked = !_cache || _cache->tryLock(lockKey, token, LOCK_SECONDS);
+
+    if (!locked) {
+        // Another process computes the value
+        if (!staleValue.isEmpty()) {
+            return staleValue;
+        }
+
+        QElapsedTimer wait;
+        wait.start();
+        while (wait.elapsed() < LOCK_WAIT_MSECS) {
+            Tf::msleep(LOCK_POLL_MSECS);
+            QByteArray value = get(key);
+            if (!value.isEmpty()) {
+                return value;
+            }
+        }
+    }
+
+    // Releases the lock even if compute() throws
+    struct LockReleaser {
+        TCacheStore *cache;
+        const QByteArray &key;
+        const QByteArray &token;
+        ~LockReleaser()
+        {
+            if (cache) {
+                cache->unlock(key, token);
+            }
+        }
+    } releaser {(locked) ? _cache : nullptr, lockKey, token};
+
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray value = compute();
+    if (!value.isEmpty()) {
+        qint64 expire = QDateTime::currentMSecsSinceEpoch() + seconds * 1000LL;
+        setValue(key, wrapValue(value, expire, (qint32)timer.elapsed()), seconds);
+    }
+    return value;
+}
+
+
+/*!
+  Returns the value of the \a key wrapped with its expiry, or an empty
+  byte array if not found.
+*/
+QByteArray TCache::getValue(const QByteArray &key)
 {
     QByteArray value;
+    TCacheMemoryArena *near = nearCache();
+
+    if (near) {
+        value = near->get(key);
+        if (!value.isEmpty()) {
+            return value;
+        }
+    }
 
     if (_cache) {
-        value = _cache->get(key);
-        if (compressionEnabled()) {
-            value = Tf::lz4Uncompress(value);
+        QByteArray data = _cache->get(key);
+        if (data.isEmpty()) {
+            return value;
+        }
+
+        int flags = 0;
+        value = TCacheCodec::decode(data, compressionEnabled(), &flags);
+        if (!(flags & TCacheCodec::Envelope)) {
+            // Stored by an older version; the expiry is unknown
+            value = (value.isEmpty()) ? QByteArray() : wrapValue(value, 0, 0);
+        }
+
+        if (near && !value.isEmpty()) {
+            qint64 expire = 0;
+            unwrapValue(value, &expire);
+            near->set(key, value, nearCacheExpire(INT_MAX, expire));
         }
     }
     return value;
@@ -91,6 +389,12 @@ void TCache::remove(const QByteArray &key)
     if (_cache) {
         _cache->remove(key);
     }
+
+    TCacheMemoryArena *near = nearCache();
+    if (near) {
+        near->remove(key);
+        sendInvalidation(key);
+    }
 }
 
 /*!
@@ -101,6 +405,12 @@ void TCache::clear()
     if (_cache) {
         _cache->clear();
     }
+
+    TCacheMemoryArena *near = nearCache();
+    if (near) {
+        near->clear();
+        sendInvalidation(QByteArray());
+    }
 }
 
 
@@ -109,3 +419,70 @@ bool TCache::compressionEnabled()
     static bool compression = Tf::appSettings()->value(Tf::CacheEnableCompression, true).toBool();
     return compression;
 }
+
+/*!
+  Returns true if the near cache is enabled. The first call should be
+  made in the main thread, where the invalidations from the other
+  processes are received.
+*/
+bool TCache::nearCacheEnabled()
+{
+    static bool enabled = []() {
+        bool ret = (bool)nearCache();
+        if (ret && Tf::app()->maxNumberOfAppServers() > 1) {
+            TPublisher::instance();  // receiver of the system bus
+        }
+        return ret;
+    }();
+    return enabled;
+}
+
+/*!
+  Removes the item that have the \a key from the near cache of this
+  process. If \a key is empty, removes all items from it.
+*/
+void TCache::invalidateNearCache(const QByteArray &key)
+{
+    TCacheMemoryArena *near = nearCache();
+    if (near) {
+        if (key.isEmpty()) {
+            near->clear();
+        } else {
+            near->remove(key);
+        }
+    }
+}
+
+/*!
+  Returns the statistics of the cache in this process: those of the
+  compression prefixed with "codec.", those of the near cache prefixed
+  with "nearCache." and those of the memory backend prefixed with
+  "memory.", if enabled.
+  \sa TCacheCodec::stats(), TCacheMemoryStore::stats()
+*/
+QMap<QString, QVariant> TCache::stats()
+{
+    QMap<QString, QVariant> ret;
+
+    auto merge = [&ret](const QString &prefix, const QMap<QString, QVariant> &map) {
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            ret.insert(prefix + it.key(), it.value());
+        }
+    };
+
+    if (!Tf::app()->cacheEnabled()) {
+        return ret;
+    }
+
+    merge(QLatin1String("codec."), TCacheCodec::stats());
+
+    TCacheMemoryArena *near = nearCache();
+    if (near) {
+        merge(QLatin1String("nearCache."), near->stats());
+    }
+
+    if (TCacheFactory::dbType(Tf::app()->cacheBackend()) == TCacheStore::Memory) {
+        merge(QLatin1String("memory."), TCacheMemoryStore::stats());
+    }
+    return ret;
+}
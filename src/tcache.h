@@ -2,6 +2,9 @@
 #define TCACHE_H
 
 #include <TGlobal>
+#include <QMap>
+#include <QVariant>
+#include <functional>
 
 class TCacheStore;
 
@@ -14,12 +17,21 @@ public:
 
     bool set(const QByteArray &key, const QByteArray &value, int seconds);
     QByteArray get(const QByteArray &key);
+    QByteArray getUnlessExpiring(const QByteArray &key);
+    QByteArray getOrCompute(const QByteArray &key, int seconds, const std::function<QByteArray()> &compute);
     void remove(const QByteArray &key);
     void clear();
 
     static bool compressionEnabled();
+    static bool nearCacheEnabled();
+    static void invalidateNearCache(const QByteArray &key);
+    static QMap<QString, QVariant> stats();
 
 private:
+    QByteArray getValue(const QByteArray &key);
+    bool setValue(const QByteArray &key, const QByteArray &data, int seconds);
+    QByteArray computeAndSet(const QByteArray &key, int seconds, const QByteArray &staleValue, const std::function<QByteArray()> &compute);
+
     TCacheStore *_cache {nullptr};
     int _gcDivisor {0};
 
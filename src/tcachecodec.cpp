@@ -0,0 +1,328 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tcachecodec.h"
+#include "tsystemglobal.h"
+#include <TWebApplication>
+#include <TAppSettings>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QFile>
+#include <cmath>
+#include <climits>
+#ifdef TF_USE_ZSTD
+#include <zstd.h>
+#include <memory>
+#endif
+
+// Tag of 4 bytes; never a valid length of an LZ4 block of Tf::lz4Compress()
+constexpr char TAG_PREFIX[] = "\xffTF";
+constexpr int TAG_PREFIX_LEN = 3;
+constexpr int TAG_LEN = 4;
+constexpr int CODEC_MASK = 0x7f;
+constexpr int PROBE_FULL_SIZE = 4096;
+constexpr int PROBE_CHUNKS = 16;
+constexpr int PROBE_CHUNK_SIZE = 256;
+constexpr double MAX_ENTROPY = 7.5;  // bits per byte
+constexpr double MIN_SAVING = 0.1;
+
+/*!
+  \class TCacheCodec
+  \brief The TCacheCodec class compresses the values of the cache.
+
+  Values shorter than Cache.CompressionThreshold bytes, or those which
+  look random by the entropy of their bytes, such as images or gzip
+  data, are stored uncompressed. Each value has a tag of the codec, so
+  that values of different codecs can be mixed in a cache; the last
+  byte of the tag also carries the flags of the value.
+  This class is for internal use only.
+*/
+
+namespace {
+
+QAtomicInteger<qint64> attemptCount {0};
+QAtomicInteger<qint64> encodeCount {0};
+QAtomicInteger<qint64> skipCount {0};
+QAtomicInteger<qint64> rawBytes {0};
+QAtomicInteger<qint64> compressedBytes {0};
+QAtomicInteger<qint64> encodeNsecs {0};
+QAtomicInteger<qint64> decodeCount {0};
+QAtomicInteger<qint64> decodeNsecs {0};
+
+int compressionThreshold()
+{
+    static int threshold = Tf::appSettings()->value(Tf::CacheCompressionThreshold, 256).toInt();
+    return threshold;
+}
+
+
+QByteArray tag(TCacheCodec::Codec codec, int flags)
+{
+    QByteArray t(TAG_PREFIX, TAG_PREFIX_LEN);
+    t += (char)(codec | (flags & ~CODEC_MASK));
+    return t;
+}
+
+#ifdef TF_USE_ZSTD
+
+struct ZstdDictionary {
+    ZSTD_CDict *cdict {nullptr};
+    ZSTD_DDict *ddict {nullptr};
+};
+
+int zstdLevel()
+{
+    static int level = Tf::appSettings()->value(Tf::CacheZstdLevel, 3).toInt();
+    return level;
+}
+
+// Dictionary trained by 'zstd --train' for small values
+const ZstdDictionary &zstdDictionary()
+{
+    static ZstdDictionary dictionary = []() {
+        ZstdDictionary dict;
+        QString path = Tf::appSettings()->value(Tf::CacheZstdDictionaryFile).toString().trimmed();
+        if (!path.isEmpty()) {
+            QFile file(Tf::app()->configPath() + path);
+            if (file.open(QIODevice::ReadOnly)) {
+                QByteArray data = file.readAll();
+                dict.cdict = ZSTD_createCDict(data.constData(), data.size(), zstdLevel());
+                dict.ddict = ZSTD_createDDict(data.constData(), data.size());
+            } else {
+                tSystemError("Zstd dictionary not found: %s", qPrintable(file.fileName()));
+            }
+        }
+        return dict;
+    }();
+    return dictionary;
+}
+
+
+QByteArray zstdCompress(const QByteArray &data)
+{
+    thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    const auto &dict = zstdDictionary();
+    QByteArray out;
+
+    out.resize((int)ZSTD_compressBound(data.size()));
+    size_t len = (dict.cdict) ? ZSTD_compress_usingCDict(cctx.get(), out.data(), out.size(), data.constData(), data.size(), dict.cdict)
+                              : ZSTD_compressCCtx(cctx.get(), out.data(), out.size(), data.constData(), data.size(), zstdLevel());
+    if (ZSTD_isError(len)) {
+        tError("Zstd compression error: %s", ZSTD_getErrorName(len));
+        return QByteArray();
+    }
+    out.resize((int)len);
+    return out;
+}
+
+
+QByteArray zstdUncompress(const char *data, int length)
+{
+    thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    const auto &dict = zstdDictionary();
+    QByteArray out;
+
+    unsigned long long size = ZSTD_getFrameContentSize(data, length);
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > INT_MAX) {
+        tError("Zstd uncompression format error");
+        return out;
+    }
+
+    out.resize((int)size);
+    size_t len = (dict.ddict) ? ZSTD_decompress_usingDDict(dctx.get(), out.data(), out.size(), data, length, dict.ddict)
+                              : ZSTD_decompressDCtx(dctx.get(), out.data(), out.size(), data, length);
+    if (ZSTD_isError(len)) {
+        tError("Zstd uncompression error: %s", ZSTD_getErrorName(len));
+        return QByteArray();
+    }
+    out.resize((int)len);
+    return out;
+}
+
+#endif  // TF_USE_ZSTD
+
+}  // namespace
+
+/*!
+  Returns the codec set by Cache.CompressionCodec.
+*/
+TCacheCodec::Codec TCacheCodec::codec()
+{
+    static Codec codec = []() {
+        QString name = Tf::appSettings()->value(Tf::CacheCompressionCodec, "lz4").toString().trimmed().toLower();
+        if (name == QLatin1String("zstd")) {
+#ifdef TF_USE_ZSTD
+            return Zstd;
+#else
+            tSystemWarn("Zstd not available, uses LZ4 for the cache. Configure with --enable-zstd.");
+#endif
+        }
+        return Lz4;
+    }();
+    return codec;
+}
+
+/*!
+  Returns false if \a data seems random and so not worth compressing,
+  judging from the entropy of bytes sampled from it.
+*/
+bool TCacheCodec::isCompressible(const QByteArray &data)
+{
+    int counts[256] = {0};
+    int total = 0;
+
+    auto sample = [&](int from, int length) {
+        const uchar *p = reinterpret_cast<const uchar *>(data.constData()) + from;
+        for (int i = 0; i < length; ++i) {
+            counts[p[i]]++;
+        }
+        total += length;
+    };
+
+    if (data.size() <= PROBE_FULL_SIZE) {
+        sample(0, data.size());
+    } else {
+        int step = (data.size() - PROBE_CHUNK_SIZE) / (PROBE_CHUNKS - 1);
+        for (int i = 0; i < PROBE_CHUNKS; ++i) {
+            sample(i * step, PROBE_CHUNK_SIZE);
+        }
+    }
+
+    if (total == 0) {
+        return false;
+    }
+
+    double entropy = 0;
+    for (int count : counts) {
+        if (count > 0) {
+            double p = (double)count / total;
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy < MAX_ENTROPY;
+}
+
+/*!
+  Compresses the \a data if worthwhile and returns it with the tag of
+  the codec and the \a flags. If \a compression is false, the data is
+  returned with the tag of None, so that raw data which happens to begin
+  with the tag is never misread.
+*/
+QByteArray TCacheCodec::encode(const QByteArray &data, bool compression, int flags)
+{
+    if (!compression) {
+        return tag(None, flags) + data;
+    }
+
+    if (data.size() < compressionThreshold() || !isCompressible(data)) {
+        skipCount++;
+        return tag(None, flags) + data;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Codec cdc = codec();
+    QByteArray compressed = compress(cdc, data);
+    encodeNsecs += timer.nsecsElapsed();
+    attemptCount++;
+
+    if (compressed.isEmpty() || compressed.size() > data.size() * (1 - MIN_SAVING)) {
+        skipCount++;
+        return tag(None, flags) + data;
+    }
+
+    encodeCount++;
+    rawBytes += data.size();
+    compressedBytes += compressed.size();
+    return tag(cdc, flags) + compressed;
+}
+
+/*!
+  Returns the data uncompressed according to its tag, and sets the
+  flags of the tag to \a flags if not null. Data without a tag is
+  uncompressed by LZ4 if \a legacyLz4 is true, which is the format
+  before the tag was introduced.
+*/
+QByteArray TCacheCodec::decode(const QByteArray &data, bool legacyLz4, int *flags)
+{
+    if (flags) {
+        *flags = 0;
+    }
+
+    if (data.size() < TAG_LEN || !data.startsWith(QByteArray::fromRawData(TAG_PREFIX, TAG_PREFIX_LEN))) {
+        return (legacyLz4) ? Tf::lz4Uncompress(data) : data;
+    }
+
+    const quint8 tagByte = (quint8)data.at(TAG_PREFIX_LEN);
+    if (flags) {
+        *flags = tagByte & ~CODEC_MASK;
+    }
+
+    Codec cdc = (Codec)(tagByte & CODEC_MASK);
+    if (cdc == None) {
+        return data.mid(TAG_LEN);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray ret = uncompress(cdc, data.constData() + TAG_LEN, data.size() - TAG_LEN);
+    decodeNsecs += timer.nsecsElapsed();
+    decodeCount++;
+    return ret;
+}
+
+
+QByteArray TCacheCodec::compress(Codec codec, const QByteArray &data)
+{
+    switch (codec) {
+    case Lz4:
+        return Tf::lz4Compress(data);
+#ifdef TF_USE_ZSTD
+    case Zstd:
+        return zstdCompress(data);
+#endif
+    default:
+        return QByteArray();
+    }
+}
+
+
+QByteArray TCacheCodec::uncompress(Codec codec, const char *data, int length)
+{
+    switch (codec) {
+    case Lz4:
+        return Tf::lz4Uncompress(data, length);
+#ifdef TF_USE_ZSTD
+    case Zstd:
+        return zstdUncompress(data, length);
+#endif
+    default:
+        tError("Unsupported codec of cache: %d", (int)codec);
+        return QByteArray();
+    }
+}
+
+/*!
+  Returns the statistics of the compression: the numbers of values
+  compressed and stored uncompressed, the compression ratio, and the
+  average CPU time in microseconds per compression and uncompression.
+  \sa TCache::stats()
+*/
+QMap<QString, QVariant> TCacheCodec::stats()
+{
+    qint64 attempts = attemptCount;
+    qint64 decodes = decodeCount;
+    qint64 raw = rawBytes;
+
+    return QMap<QString, QVariant> {
+        {"compressed", (qint64)encodeCount},
+        {"uncompressed", (qint64)skipCount},
+        {"compressionRatio", (raw > 0) ? (double)compressedBytes / raw : 1.0},
+        {"compressUsecs", (attempts > 0) ? (double)encodeNsecs / attempts / 1000 : 0.0},
+        {"uncompressUsecs", (decodes > 0) ? (double)decodeNsecs / decodes / 1000 : 0.0},
+    };
+}
@@ -0,0 +1,33 @@
+#ifndef TCACHECODEC_H
+#define TCACHECODEC_H
+
+#include <TGlobal>
+#include <QMap>
+#include <QVariant>
+
+
+class T_CORE_EXPORT TCacheCodec
+{
+public:
+    enum Codec {
+        None = 0,
+        Lz4,
+        Zstd,
+    };
+
+    enum Flag {
+        Envelope = 0x80,  // wrapped with the expiry by TCache
+    };
+
+    static QByteArray encode(const QByteArray &data, bool compression = true, int flags = 0);
+    static QByteArray decode(const QByteArray &data, bool legacyLz4 = true, int *flags = nullptr);
+    static bool isCompressible(const QByteArray &data);
+    static Codec codec();
+    static QMap<QString, QVariant> stats();
+
+private:
+    static QByteArray compress(Codec codec, const QByteArray &data);
+    static QByteArray uncompress(Codec codec, const char *data, int length);
+};
+
+#endif // TCACHECODEC_H
@@ -0,0 +1,707 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tcachememorystore.h"
+#include "tsystemglobal.h"
+#include "tprocessinfo.h"
+#include <TWebApplication>
+#include <QSharedMemory>
+#include <QMutex>
+#include <QHash>
+#include <QDateTime>
+#include <QAtomicInteger>
+#include <QThread>
+#include <list>
+#include <memory>
+
+constexpr int DEFAULT_SHARDS = 16;
+constexpr qint64 DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+constexpr qint64 DEFAULT_SLOT_SIZE = 16 * 1024;
+constexpr int ITEM_OVERHEAD = 64;  // approximate bytes of bookkeeping per item
+constexpr int SET_WAYS = 8;
+constexpr quint32 ARENA_MAGIC = 0x54464d43;  // "TFMC"
+constexpr int LOCK_SPIN_LIMIT = 1000000;
+constexpr qint64 ATTACH_TIMEOUT = 1000;  // msecs
+
+/*!
+  \class TCacheMemoryStore
+  \brief The TCacheMemoryStore class stores cache items in the memory
+  of the application server process.
+
+  The items are kept in a hash divided into shards, each of which has its
+  own lock and evicts the least recently used items when it exceeds its
+  share of 'MaxSize' bytes. If 'SharedMemory' is true in the cache.ini,
+  the items are kept in a shared memory arena instead, so that all the
+  application server processes on the host share them; the arena is
+  divided into sets of slots of 'SlotSize' bytes and evicts items by the
+  CLOCK algorithm. Items larger than a slot are not stored.
+*/
+
+namespace {
+
+inline qint64 currentMSecs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+// FNV-1a, same value in every process
+quint32 hashKey(const QByteArray &key)
+{
+    quint32 hash = 2166136261u;
+    for (char c : key) {
+        hash ^= (quint8)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+}  // namespace
+
+/*!
+  \class TCacheMemoryArena
+  \brief The TCacheMemoryArena class is the storage of TCacheMemoryStore.
+  This class is for internal use only.
+*/
+
+/*!
+  Parses a size like "512K", "64M" or "1G" and returns it in bytes.
+*/
+qint64 TCacheMemoryArena::parseSize(const QVariant &value, qint64 defaultValue)
+{
+    QString str = value.toString().trimmed().toUpper();
+    qint64 unit = 1;
+
+    if (str.endsWith(QLatin1Char('K'))) {
+        unit = 1024;
+    } else if (str.endsWith(QLatin1Char('M'))) {
+        unit = 1024 * 1024;
+    } else if (str.endsWith(QLatin1Char('G'))) {
+        unit = 1024 * 1024 * 1024;
+    }
+    if (unit > 1) {
+        str.chop(1);
+    }
+
+    bool ok;
+    qint64 num = str.toLongLong(&ok);
+    return (ok && num > 0) ? num * unit : defaultValue;
+}
+
+namespace {
+
+/*
+  Arena in the process memory; LRU per shard
+*/
+class LocalArena : public TCacheMemoryArena {
+public:
+    LocalArena(int shardCount, qint64 maxBytes);
+
+    QByteArray get(const QByteArray &key) override;
+    bool set(const QByteArray &key, const QByteArray &value, qint64 expire) override;
+    bool remove(const QByteArray &key) override;
+    void clear() override;
+    void gc() override;
+    QMap<QString, QVariant> stats() override;
+
+private:
+    struct Item {
+        QByteArray key;
+        QByteArray value;
+        qint64 expire {0};
+    };
+    using ItemIterator = std::list<Item>::iterator;
+
+    struct Shard {
+        QMutex mutex {QMutex::NonRecursive};
+        std::list<Item> lru;  // most recently used first
+        QHash<QByteArray, ItemIterator> index;
+        qint64 bytes {0};
+    };
+
+    Shard &shardFor(const QByteArray &key) { return _shards[hashKey(key) % _shardCount]; }
+    static qint64 itemSize(const Item &item) { return item.key.size() + item.value.size() + ITEM_OVERHEAD; }
+    static void erase(Shard &shard, ItemIterator item);
+
+    int _shardCount {0};
+    qint64 _maxBytes {0};
+    qint64 _shardMaxBytes {0};
+    std::unique_ptr<Shard[]> _shards;
+    QAtomicInteger<qint64> _hits {0};
+    QAtomicInteger<qint64> _misses {0};
+    QAtomicInteger<qint64> _sets {0};
+    QAtomicInteger<qint64> _evictions {0};
+    QAtomicInteger<qint64> _expirations {0};
+};
+
+
+LocalArena::LocalArena(int shardCount, qint64 maxBytes) :
+    _shardCount(shardCount),
+    _maxBytes(maxBytes),
+    _shardMaxBytes(qMax(maxBytes / shardCount, (qint64)1)),
+    _shards(new Shard[shardCount])
+{ }
+
+
+void LocalArena::erase(Shard &shard, ItemIterator item)
+{
+    shard.bytes -= itemSize(*item);
+    shard.index.remove(item->key);
+    shard.lru.erase(item);
+}
+
+
+QByteArray LocalArena::get(const QByteArray &key)
+{
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+
+    auto it = shard.index.constFind(key);
+    if (it == shard.index.constEnd()) {
+        _misses++;
+        return QByteArray();
+    }
+
+    ItemIterator item = it.value();
+    if (item->expire <= currentMSecs()) {
+        erase(shard, item);
+        _expirations++;
+        _misses++;
+        return QByteArray();
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, item);
+    _hits++;
+    return item->value;
+}
+
+
+bool LocalArena::set(const QByteArray &key, const QByteArray &value, qint64 expire)
+{
+    Item newItem {key, value, expire};
+    qint64 size = itemSize(newItem);
+    if (size > _shardMaxBytes) {
+        return false;
+    }
+
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+
+    auto it = shard.index.constFind(key);
+    if (it != shard.index.constEnd()) {
+        erase(shard, it.value());
+    }
+
+    shard.lru.push_front(newItem);
+    shard.index.insert(key, shard.lru.begin());
+    shard.bytes += size;
+
+    while (shard.bytes > _shardMaxBytes) {
+        erase(shard, std::prev(shard.lru.end()));
+        _evictions++;
+    }
+    _sets++;
+    return true;
+}
+
+
+bool LocalArena::remove(const QByteArray &key)
+{
+    Shard &shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+
+    auto it = shard.index.constFind(key);
+    if (it == shard.index.constEnd()) {
+        return false;
+    }
+    erase(shard, it.value());
+    return true;
+}
+
+
+void LocalArena::clear()
+{
+    for (int i = 0; i < _shardCount; ++i) {
+        Shard &shard = _shards[i];
+        QMutexLocker locker(&shard.mutex);
+        shard.lru.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+}
+
+
+void LocalArena::gc()
+{
+    const qint64 now = currentMSecs();
+
+    for (int i = 0; i < _shardCount; ++i) {
+        Shard &shard = _shards[i];
+        QMutexLocker locker(&shard.mutex);
+        for (auto item = shard.lru.begin(); item != shard.lru.end();) {
+            auto next = std::next(item);
+            if (item->expire <= now) {
+                erase(shard, item);
+                _expirations++;
+            }
+            item = next;
+        }
+    }
+}
+
+
+QMap<QString, QVariant> LocalArena::stats()
+{
+    qint64 items = 0;
+    qint64 bytes = 0;
+
+    for (int i = 0; i < _shardCount; ++i) {
+        Shard &shard = _shards[i];
+        QMutexLocker locker(&shard.mutex);
+        items += shard.index.count();
+        bytes += shard.bytes;
+    }
+
+    return QMap<QString, QVariant> {
+        {"hits", (qint64)_hits},
+        {"misses", (qint64)_misses},
+        {"sets", (qint64)_sets},
+        {"evictions", (qint64)_evictions},
+        {"expirations", (qint64)_expirations},
+        {"items", items},
+        {"bytes", bytes},
+        {"maxBytes", _maxBytes},
+    };
+}
+
+/*
+  Arena in the shared memory; set-associative, CLOCK per set
+*/
+class SharedArena : public TCacheMemoryArena {
+public:
+    SharedArena(const QString &key, qint64 maxBytes, int slotSize);
+    bool isAttached() const { return _base; }
+
+    QByteArray get(const QByteArray &key) override;
+    bool set(const QByteArray &key, const QByteArray &value, qint64 expire) override;
+    bool remove(const QByteArray &key) override;
+    void clear() override;
+    void gc() override;
+    QMap<QString, QVariant> stats() override;
+
+private:
+    struct Header {
+        QBasicAtomicInteger<quint32> magic;  // set last by the creator
+        quint32 slotSize;
+        QBasicAtomicInteger<qint64> hits;
+        QBasicAtomicInteger<qint64> misses;
+        QBasicAtomicInteger<qint64> sets;
+        QBasicAtomicInteger<qint64> evictions;
+        QBasicAtomicInteger<qint64> expirations;
+    };
+
+    struct SetHeader {
+        QBasicAtomicInt lock;  // pid of the owner, or 0
+        quint32 hand;
+    };
+
+    struct Slot {
+        quint32 hash;
+        quint32 keyLength;  // 0: empty
+        quint32 valueLength;
+        quint32 referenced;
+        qint64 expire;
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+        bool matches(quint32 h, const QByteArray &key)
+        {
+            return hash == h && keyLength == (quint32)key.size() && !memcmp(data(), key.constData(), keyLength);
+        }
+    };
+
+    static constexpr int align8(qint64 size) { return (int)((size + 7) & ~7); }
+    Header *header() const { return reinterpret_cast<Header *>(_base); }
+    SetHeader *setAt(int index) const { return reinterpret_cast<SetHeader *>(_base + align8(sizeof(Header)) + (qint64)index * _setStride); }
+    SetHeader *setFor(quint32 hash) const { return setAt(hash % _setCount); }
+    Slot *slotAt(SetHeader *set, int way) const { return reinterpret_cast<Slot *>(reinterpret_cast<char *>(set) + align8(sizeof(SetHeader)) + way * _slotStride); }
+    Slot *find(SetHeader *set, quint32 hash, const QByteArray &key) const;
+    static void lock(SetHeader *set);
+    static void unlock(SetHeader *set) { set->lock.storeRelease(0); }
+
+    std::unique_ptr<QSharedMemory> _memory;
+    char *_base {nullptr};
+    int _slotSize {0};
+    int _slotStride {0};
+    int _setStride {0};
+    int _setCount {0};
+};
+
+
+SharedArena::SharedArena(const QString &key, qint64 maxBytes, int slotSize) :
+    _memory(new QSharedMemory(key)),
+    _slotSize(slotSize),
+    _slotStride(align8(sizeof(Slot) + slotSize)),
+    _setStride(align8(sizeof(SetHeader)) + SET_WAYS * _slotStride)
+{
+    _setCount = qMax((maxBytes - align8(sizeof(Header))) / _setStride, (qint64)1);
+    const qint64 size = align8(sizeof(Header)) + (qint64)_setCount * _setStride;
+
+    // The memory created is zero-filled, that is, all slots are empty
+    if (_memory->create(size)) {
+        _base = static_cast<char *>(_memory->data());
+        header()->slotSize = _slotSize;
+        header()->magic.storeRelease(ARENA_MAGIC);
+    } else if (_memory->error() == QSharedMemory::AlreadyExists && _memory->attach()) {
+        _base = static_cast<char *>(_memory->data());
+
+        // The creator may not have initialized the header yet; waits for
+        // the magic
+        quint32 magic = 0;
+        if (_memory->size() >= (int)sizeof(Header)) {
+            const qint64 started = currentMSecs();
+            while ((magic = header()->magic.loadAcquire()) == 0 && currentMSecs() - started <= ATTACH_TIMEOUT) {
+                QThread::msleep(10);
+            }
+        }
+
+        if (magic != ARENA_MAGIC) {
+            tSystemError("Shared memory of an incompatible cache: %s", qPrintable(key));
+            _memory->detach();
+            _base = nullptr;
+        } else if (_memory->size() < size || (int)header()->slotSize != _slotSize) {
+            tSystemError("Shared memory cache layout mismatch, size:%lld slotSize:%d", (qint64)_memory->size(), _slotSize);
+            _memory->detach();
+            _base = nullptr;
+        }
+    } else {
+        tSystemError("Shared memory cache error: %s", qPrintable(_memory->errorString()));
+    }
+}
+
+
+void SharedArena::lock(SetHeader *set)
+{
+    static const int pid = (int)QCoreApplication::applicationPid();
+    int spin = 0;
+
+    while (!set->lock.testAndSetAcquire(0, pid)) {
+        if (++spin > LOCK_SPIN_LIMIT) {
+            // Takes over the lock only if the owner process has died;
+            // a live owner is just slow and keeps its lock
+            int owner = set->lock.loadAcquire();
+            if (owner != 0 && owner != pid && !TProcessInfo(owner).exists()) {
+                if (set->lock.testAndSetAcquire(owner, pid)) {
+                    tSystemWarn("Shared memory cache: lock taken over from dead process %d", owner);
+                    return;
+                }
+            }
+            spin = 0;
+        }
+        QThread::yieldCurrentThread();
+    }
+}
+
+
+SharedArena::Slot *SharedArena::find(SetHeader *set, quint32 hash, const QByteArray &key) const
+{
+    for (int way = 0; way < SET_WAYS; ++way) {
+        Slot *slot = slotAt(set, way);
+        if (slot->matches(hash, key)) {
+            return slot;
+        }
+    }
+    return nullptr;
+}
+
+
+QByteArray SharedArena::get(const QByteArray &key)
+{
+    QByteArray value;
+    bool hit = false;
+    if (key.isEmpty()) {
+        return value;
+    }
+
+    const quint32 hash = hashKey(key);
+    SetHeader *set = setFor(hash);
+    lock(set);
+
+    Slot *slot = find(set, hash, key);
+    if (slot) {
+        if (slot->expire > currentMSecs()) {
+            hit = true;
+            slot->referenced = 1;
+            value = QByteArray(slot->data() + slot->keyLength, slot->valueLength);
+        } else {
+            slot->keyLength = 0;
+            header()->expirations.fetchAndAddRelaxed(1);
+        }
+    }
+    unlock(set);
+
+    if (hit) {
+        header()->hits.fetchAndAddRelaxed(1);
+    } else {
+        header()->misses.fetchAndAddRelaxed(1);
+    }
+    return value;
+}
+
+
+bool SharedArena::set(const QByteArray &key, const QByteArray &value, qint64 expire)
+{
+    if (key.isEmpty() || key.size() + value.size() > _slotSize) {
+        return false;
+    }
+
+    const quint32 hash = hashKey(key);
+    const qint64 now = currentMSecs();
+    SetHeader *set = setFor(hash);
+    lock(set);
+
+    Slot *slot = find(set, hash, key);
+    if (!slot) {
+        // Empty or expired slot
+        for (int way = 0; way < SET_WAYS; ++way) {
+            Slot *s = slotAt(set, way);
+            if (s->keyLength == 0 || s->expire <= now) {
+                slot = s;
+                break;
+            }
+        }
+    }
+
+    if (!slot) {
+        // CLOCK; the hand clears the reference bits until a victim is found
+        for (;;) {
+            Slot *s = slotAt(set, set->hand);
+            set->hand = (set->hand + 1) % SET_WAYS;
+            if (!s->referenced) {
+                slot = s;
+                break;
+            }
+            s->referenced = 0;
+        }
+        header()->evictions.fetchAndAddRelaxed(1);
+    }
+
+    slot->hash = hash;
+    slot->keyLength = key.size();
+    slot->valueLength = value.size();
+    slot->referenced = 0;
+    slot->expire = expire;
+    memcpy(slot->data(), key.constData(), key.size());
+    memcpy(slot->data() + key.size(), value.constData(), value.size());
+    unlock(set);
+
+    header()->sets.fetchAndAddRelaxed(1);
+    return true;
+}
+
+
+bool SharedArena::remove(const QByteArray &key)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    const quint32 hash = hashKey(key);
+    SetHeader *set = setFor(hash);
+    lock(set);
+
+    Slot *slot = find(set, hash, key);
+    if (slot) {
+        slot->keyLength = 0;
+    }
+    unlock(set);
+    return slot;
+}
+
+
+void SharedArena::clear()
+{
+    for (int i = 0; i < _setCount; ++i) {
+        SetHeader *set = setAt(i);
+        lock(set);
+        for (int way = 0; way < SET_WAYS; ++way) {
+            slotAt(set, way)->keyLength = 0;
+        }
+        unlock(set);
+    }
+}
+
+
+void SharedArena::gc()
+{
+    const qint64 now = currentMSecs();
+
+    for (int i = 0; i < _setCount; ++i) {
+        SetHeader *set = setAt(i);
+        lock(set);
+        for (int way = 0; way < SET_WAYS; ++way) {
+            Slot *slot = slotAt(set, way);
+            if (slot->keyLength > 0 && slot->expire <= now) {
+                slot->keyLength = 0;
+                header()->expirations.fetchAndAddRelaxed(1);
+            }
+        }
+        unlock(set);
+    }
+}
+
+
+QMap<QString, QVariant> SharedArena::stats()
+{
+    qint64 items = 0;
+    qint64 bytes = 0;
+
+    for (int i = 0; i < _setCount; ++i) {
+        SetHeader *set = setAt(i);
+        lock(set);
+        for (int way = 0; way < SET_WAYS; ++way) {
+            Slot *slot = slotAt(set, way);
+            if (slot->keyLength > 0) {
+                items++;
+                bytes += slot->keyLength + slot->valueLength;
+            }
+        }
+        unlock(set);
+    }
+
+    return QMap<QString, QVariant> {
+        {"hits", header()->hits.load()},
+        {"misses", header()->misses.load()},
+        {"sets", header()->sets.load()},
+        {"evictions", header()->evictions.load()},
+        {"expirations", header()->expirations.load()},
+        {"items", items},
+        {"bytes", bytes},
+        {"maxBytes", (qint64)_setCount * SET_WAYS * _slotSize},
+    };
+}
+
+}  // namespace
+
+
+TCacheMemoryArena *TCacheMemoryArena::instance()
+{
+    static TCacheMemoryArena *arena = []() -> TCacheMemoryArena * {
+        const QVariantMap &settings = Tf::app()->cacheSettings();
+        const qint64 maxSize = TCacheMemoryArena::parseSize(settings.value("MaxSize"), DEFAULT_MAX_SIZE);
+
+        if (settings.value("SharedMemory").toBool()) {
+            // One arena per application
+            QString key = QString("TreeFrogCache_%1").arg(qHash(Tf::app()->webRootPath()), 0, 16);
+            int slotSize = (int)TCacheMemoryArena::parseSize(settings.value("SlotSize"), DEFAULT_SLOT_SIZE);
+            auto *shared = createShared(key, maxSize, slotSize);
+            if (shared) {
+                return shared;
+            }
+            tSystemWarn("Shared memory cache not available, uses the process memory instead");
+        }
+
+        return create(maxSize, settings.value("Shards", DEFAULT_SHARDS).toInt());
+    }();
+    return arena;
+}
+
+/*!
+  Creates a new arena in the shared memory of the \a key, or attaches
+  to the arena created by another process, which holds \a maxBytes
+  bytes at most in slots of \a slotSize bytes. Returns nullptr if the
+  shared memory is not available.
+*/
+TCacheMemoryArena *TCacheMemoryArena::createShared(const QString &key, qint64 maxBytes, int slotSize)
+{
+    auto *shared = new SharedArena(key, maxBytes, slotSize);
+    if (!shared->isAttached()) {
+        delete shared;
+        return nullptr;
+    }
+    return shared;
+}
+
+/*!
+  Creates a new arena in the process memory, which holds \a maxBytes
+  bytes at most.
+*/
+TCacheMemoryArena *TCacheMemoryArena::create(qint64 maxBytes, int shards)
+{
+    return new LocalArena(qMax(shards, 1), maxBytes);
+}
+
+
+TCacheMemoryStore::TCacheMemoryStore()
+{ }
+
+
+bool TCacheMemoryStore::open()
+{
+    _arena = TCacheMemoryArena::instance();
+    return _arena;
+}
+
+
+void TCacheMemoryStore::close()
+{
+    _arena = nullptr;
+}
+
+
+QByteArray TCacheMemoryStore::get(const QByteArray &key)
+{
+    return (_arena) ? _arena->get(key) : QByteArray();
+}
+
+
+bool TCacheMemoryStore::set(const QByteArray &key, const QByteArray &value, int seconds)
+{
+    return (_arena) ? _arena->set(key, value, currentMSecs() + seconds * 1000LL) : false;
+}
+
+
+bool TCacheMemoryStore::remove(const QByteArray &key)
+{
+    return (_arena) ? _arena->remove(key) : false;
+}
+
+
+void TCacheMemoryStore::clear()
+{
+    if (_arena) {
+        _arena->clear();
+    }
+}
+
+
+void TCacheMemoryStore::gc()
+{
+    if (_arena) {
+        _arena->gc();
+    }
+}
+
+
+QMap<QString, QVariant> TCacheMemoryStore::defaultSettings() const
+{
+    QMap<QString, QVariant> settings {
+        {"MaxSize", "64M"},
+        {"Shards", DEFAULT_SHARDS},
+        {"SharedMemory", false},
+        {"SlotSize", "16K"},
+    };
+    return settings;
+}
+
+/*!
+  Returns the statistics of the memory cache: the numbers of hits,
+  misses, sets, evictions and expirations, and the current number of
+  items and bytes.
+*/
+QMap<QString, QVariant> TCacheMemoryStore::stats()
+{
+    return TCacheMemoryArena::instance()->stats();
+}
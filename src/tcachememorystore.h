@@ -0,0 +1,54 @@
+#ifndef TCACHEMEMORYSTORE_H
+#define TCACHEMEMORYSTORE_H
+
+#include <TGlobal>
+#include "tcachestore.h"
+
+
+class T_CORE_EXPORT TCacheMemoryArena
+{
+public:
+    virtual ~TCacheMemoryArena() {}
+    virtual QByteArray get(const QByteArray &key) = 0;
+    virtual bool set(const QByteArray &key, const QByteArray &value, qint64 expire) = 0;
+    virtual bool remove(const QByteArray &key) = 0;
+    virtual void clear() = 0;
+    virtual void gc() = 0;
+    virtual QMap<QString, QVariant> stats() = 0;
+
+    static TCacheMemoryArena *instance();
+    static TCacheMemoryArena *create(qint64 maxBytes, int shards);
+    static TCacheMemoryArena *createShared(const QString &key, qint64 maxBytes, int slotSize);
+    static qint64 parseSize(const QVariant &value, qint64 defaultValue);
+};
+
+
+class T_CORE_EXPORT TCacheMemoryStore : public TCacheStore
+{
+public:
+    virtual ~TCacheMemoryStore() {}
+
+    QString key() const override { return QLatin1String("memory"); }
+    DbType dbType() const override { return Memory; }
+    bool open() override;
+    void close() override;
+
+    QByteArray get(const QByteArray &key) override;
+    bool set(const QByteArray &key, const QByteArray &value, int seconds) override;
+    bool remove(const QByteArray &key) override;
+    void clear() override;
+    void gc() override;
+    QMap<QString, QVariant> defaultSettings() const override;
+
+    static QMap<QString, QVariant> stats();
+
+protected:
+    TCacheMemoryStore();
+
+private:
+    TCacheMemoryArena *_arena {nullptr};
+
+    friend class TCacheFactory;
+};
+
+#endif // TCACHEMEMORYSTORE_H
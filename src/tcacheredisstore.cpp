@@ -55,6 +55,25 @@ void TCacheRedisStore::gc()
 { }
 
 
+bool TCacheRedisStore::tryLock(const QByteArray &key, const QByteArray &token, int seconds)
+{
+    TRedis redis(Tf::KvsEngine::CacheKvs);
+    return redis.setNxEx(key, token, seconds);
+}
+
+/*!
+  Deletes the lock of the \a key only if it still holds the \a token;
+  after it has expired, the lock may be owned by another process.
+*/
+void TCacheRedisStore::unlock(const QByteArray &key, const QByteArray &token)
+{
+    static const QByteArray script = "if redis.call('get', KEYS[1]) == ARGV[1] then return redis.call('del', KEYS[1]) else return 0 end";
+
+    TRedis redis(Tf::KvsEngine::CacheKvs);
+    redis.eval(script, { key }, { token });
+}
+
+
 QMap<QString, QVariant> TCacheRedisStore::defaultSettings() const
 {
     QMap<QString, QVariant> settings {
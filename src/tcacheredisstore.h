@@ -20,6 +20,8 @@ public:
     bool remove(const QByteArray &key) override;
     void clear() override;
     void gc() override;
+    bool tryLock(const QByteArray &key, const QByteArray &token, int seconds) override;
+    void unlock(const QByteArray &key, const QByteArray &token) override;
     QMap<QString, QVariant> defaultSettings() const override;
 
 protected:
@@ -6,17 +6,28 @@
  */
 
 #include "tcachesqlitestore.h"
+#include "tcachememorystore.h"
 #include "tsystemglobal.h"
 #include "tsqlquery.h"
 #include <TDatabaseContext>
+#include <TScheduler>
 #include <QByteArray>
 #include <QDateTime>
+#include <QMutex>
+#include <QHash>
 
 constexpr auto TABLE_NAME = "kb";
 constexpr auto KEY_COLUMN  = "k";
 constexpr auto BLOB_COLUMN = "b";
 constexpr auto TIMESTAMP_COLUMN = "t";
-constexpr int  PAGESIZE = 4096;
+constexpr int  PAGESIZE = 8192;
+constexpr int  EVICTION_BATCH = 1000;  // rows deleted per statement
+
+// Prepared statements cached per connection; a connection is used by
+// one context at a time, so are its statements. They are discarded
+// when the connection is closed.
+static QMutex statementMutex(QMutex::NonRecursive);
+static QHash<QString, QHash<QString, TSqlQuery>> statementCache;
 
 
 inline QSqlError lastError()
@@ -42,10 +53,64 @@ static bool query(const QString &sql)
 }
 
 
+static TSqlQuery statement(const QString &sql)
+{
+    QSqlDatabase &db = Tf::currentSqlDatabase(Tf::app()->databaseIdForCache());
+    QMutexLocker locker(&statementMutex);
+
+    auto &statements = statementCache[db.connectionName()];
+    auto it = statements.constFind(sql);
+    if (it != statements.constEnd()) {
+        return *it;
+    }
+
+    TSqlQuery qry(db);
+    qry.prepare(sql);
+    if (!qry.lastError().isValid()) {
+        statements.insert(sql, qry);
+    }
+    return qry;
+}
+
+// UPSERT is available in SQLite 3.24.0 or later
+static bool isUpsertSupported()
+{
+    static const bool supported = []() {
+        TSqlQuery qry(Tf::app()->databaseIdForCache());
+        if (qry.exec(QStringLiteral("select sqlite_version()")) && qry.next()) {
+            QStringList ver = qry.value(0).toString().split('.');
+            int major = ver.value(0).toInt();
+            int minor = ver.value(1).toInt();
+            return major > 3 || (major == 3 && minor >= 24);
+        }
+        return false;
+    }();
+    return supported;
+}
+
+
+static bool execStatement(TSqlQuery &qry, const QString &sql)
+{
+    bool ret = qry.exec();
+    if (!ret) {
+        tSystemError("SQLite error : %s, query:'%s' [%s:%d]", qPrintable(qry.lastError().text()), qPrintable(sql), __FILE__, __LINE__);
+        // Prepares it again next time; the connection may have been reopened
+        QSqlDatabase &db = Tf::currentSqlDatabase(Tf::app()->databaseIdForCache());
+        QMutexLocker locker(&statementMutex);
+        statementCache[db.connectionName()].remove(sql);
+    }
+    return ret;
+}
+
+
 bool TCacheSQLiteStore::createTable(const QString &table)
 {
     query(QStringLiteral("PRAGMA page_size=%1").arg(PAGESIZE));
     bool ret = query(QStringLiteral("CREATE TABLE IF NOT EXISTS %1 (%2 TEXT PRIMARY KEY, %3 INTEGER, %4 BLOB)").arg(table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN));
+    if (ret) {
+        // Index for the expiry
+        ret = query(QStringLiteral("CREATE INDEX IF NOT EXISTS %1_%2 ON %1 (%2)").arg(table, TIMESTAMP_COLUMN));
+    }
     return ret;
 }
 
@@ -81,13 +146,13 @@ bool TCacheSQLiteStore::isOpen() const
 int TCacheSQLiteStore::count()
 {
     int cnt = -1;
+    const QString sql = QStringLiteral("select count(1) from %1").arg(_table);
 
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("select count(1) from %1").arg(_table);
-
-    if (query.exec(sql) && query.next()) {
+    TSqlQuery query = statement(sql);
+    if (execStatement(query, sql) && query.next()) {
         cnt = query.value(0).toInt();
     }
+    query.finish();
     return cnt;
 }
 
@@ -95,16 +160,16 @@ int TCacheSQLiteStore::count()
 bool TCacheSQLiteStore::exists(const QByteArray &key)
 {
     int exist = 0;
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("select exists(select 1 from %1 where %2=:name and %3>:ts limit 1)").arg(_table).arg(KEY_COLUMN).arg(TIMESTAMP_COLUMN);
+    const QString sql = QStringLiteral("select exists(select 1 from %1 where %2=:name and %3>:ts limit 1)").arg(_table).arg(KEY_COLUMN).arg(TIMESTAMP_COLUMN);
     qint64 current = QDateTime::currentMSecsSinceEpoch() / 1000;
 
-    query.prepare(sql);
+    TSqlQuery query = statement(sql);
     query.bind(":name", key);
     query.bind(":ts", current);
-    if (query.exec() && query.next()) {
+    if (execStatement(query, sql) && query.next()) {
         exist = query.value(0).toInt();
     }
+    query.finish();
     return (exist > 0);
 }
 
@@ -117,8 +182,8 @@ QByteArray TCacheSQLiteStore::get(const QByteArray &key)
 
     if (read(key, value, expire)) {
         if (expire <= current) {
+            // Expired rows are removed by gc() in batches
             value.clear();
-            remove(key);
         }
     }
     return value;
@@ -131,9 +196,14 @@ bool TCacheSQLiteStore::set(const QByteArray &key, const QByteArray &value, int
         return false;
     }
 
-    remove(key);
+    const QString sql = (isUpsertSupported())
+        ? QStringLiteral("insert into %1 (%2,%3,%4) values (:key,:ts,:blob) on conflict(%2) do update set %3=excluded.%3, %4=excluded.%4").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN)
+        : QStringLiteral("insert or replace into %1 (%2,%3,%4) values (:key,:ts,:blob)").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN);
     qint64 expire = QDateTime::currentMSecsSinceEpoch() / 1000 + seconds;
-    return write(key, value, expire);
+
+    TSqlQuery query = statement(sql);
+    query.bind(":key", key).bind(":ts", expire).bind(":blob", value);
+    return execStatement(query, sql);
 }
 
 
@@ -145,18 +215,17 @@ bool TCacheSQLiteStore::read(const QByteArray &key, QByteArray &blob, qint64 &ti
         return ret;
     }
 
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    query.prepare(QStringLiteral("select %1,%2 from %3 where %4=:key").arg(TIMESTAMP_COLUMN, BLOB_COLUMN, _table, KEY_COLUMN));
+    const QString sql = QStringLiteral("select %1,%2 from %3 where %4=:key").arg(TIMESTAMP_COLUMN, BLOB_COLUMN, _table, KEY_COLUMN);
+    TSqlQuery query = statement(sql);
     query.bind(":key", key);
-    ret = query.exec();
+    ret = execStatement(query, sql);
     if (ret) {
         if (query.next()) {
             timestamp = query.value(0).toLongLong();
             blob = query.value(1).toByteArray();
         }
-    } else {
-        tSystemError("SQLite error : %s [%s:%d]", qPrintable(lastErrorString()), __FILE__, __LINE__);
     }
+    query.finish();  // releases the read transaction
     return ret;
 }
 
@@ -169,15 +238,10 @@ bool TCacheSQLiteStore::write(const QByteArray &key, const QByteArray &blob, qin
         return ret;
     }
 
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("insert into %1 (%2,%3,%4) values (:key,:ts,:blob)").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN);
-
-    query.prepare(sql);
+    const QString sql = QStringLiteral("insert into %1 (%2,%3,%4) values (:key,:ts,:blob)").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN);
+    TSqlQuery query = statement(sql);
     query.bind(":key", key).bind(":ts", timestamp).bind(":blob", blob);
-    ret = query.exec();
-    if (!ret && lastError().isValid()) {
-        tSystemError("SQLite error : %s [%s:%d]", qPrintable(lastErrorString()), __FILE__, __LINE__);
-    }
+    ret = execStatement(query, sql);
     return ret;
 }
 
@@ -190,18 +254,63 @@ bool TCacheSQLiteStore::remove(const QByteArray &key)
         return ret;
     }
 
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("delete from %1 where %2=:key").arg(_table, KEY_COLUMN);
-
-    query.prepare(sql);
+    const QString sql = QStringLiteral("delete from %1 where %2=:key").arg(_table, KEY_COLUMN);
+    TSqlQuery query = statement(sql);
     query.bind(":key", key);
-    ret = query.exec();
-    if (!ret && lastError().isValid()) {
-        tSystemError("SQLite error : %s [%s:%d]", qPrintable(lastErrorString()), __FILE__, __LINE__);
-    }
+    ret = execStatement(query, sql);
     return ret;
 }
 
+/*!
+  Inserts a lock row of the \a key which expires after \a seconds, only
+  if no valid one exists. Returns true if inserted.
+*/
+bool TCacheSQLiteStore::tryLock(const QByteArray &key, const QByteArray &token, int seconds)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    qint64 current = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+    // Expired lock
+    const QString deleteSql = QStringLiteral("delete from %1 where %2=:key and %3<=:ts").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN);
+    TSqlQuery del = statement(deleteSql);
+    del.bind(":key", key).bind(":ts", current);
+    execStatement(del, deleteSql);
+
+    const QString insertSql = QStringLiteral("insert or ignore into %1 (%2,%3,%4) values (:key,:ts,:blob)").arg(_table, KEY_COLUMN, TIMESTAMP_COLUMN, BLOB_COLUMN);
+    TSqlQuery ins = statement(insertSql);
+    ins.bind(":key", key).bind(":ts", current + seconds).bind(":blob", token);
+    if (!execStatement(ins, insertSql)) {
+        return false;
+    }
+    return ins.numRowsAffected() == 1;
+}
+
+
+/*!
+  Deletes the lock row of the \a key only if it still holds the \a token.
+*/
+void TCacheSQLiteStore::unlock(const QByteArray &key, const QByteArray &token)
+{
+    const QString sql = QStringLiteral("delete from %1 where %2=:key and %3=:blob").arg(_table, KEY_COLUMN, BLOB_COLUMN);
+    TSqlQuery query = statement(sql);
+    query.bind(":key", key).bind(":blob", token);
+    execStatement(query, sql);
+}
+
+
+/*!
+  Discards the prepared statements of the connection \a connectionName,
+  which is about to be closed.
+*/
+void TCacheSQLiteStore::releaseStatements(const QString &connectionName)
+{
+    QMutexLocker locker(&statementMutex);
+    statementCache.remove(connectionName);
+}
+
 
 void TCacheSQLiteStore::clear()
 {
@@ -217,34 +326,35 @@ int TCacheSQLiteStore::removeOlder(int num)
         return cnt;
     }
 
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("delete from %1 where ROWID in (select ROWID from %1 order by t asc limit :num)").arg(_table);
-
-    query.prepare(sql);
+    const QString sql = QStringLiteral("delete from %1 where ROWID in (select ROWID from %1 order by %2 asc limit :num)").arg(_table, TIMESTAMP_COLUMN);
+    TSqlQuery query = statement(sql);
     query.bind(":num", num);
-    if (query.exec()) {
+    if (execStatement(query, sql)) {
         cnt = query.numRowsAffected();
-    } else {
-        tSystemError("SQLite error : %s [%s:%d]", qPrintable(lastErrorString()), __FILE__, __LINE__);
     }
     return cnt;
 }
 
-
+/*!
+  Removes the rows older than \a timestamp, in batches of a limited
+  number of rows so that each write lock is held only for a short time.
+*/
 int TCacheSQLiteStore::removeOlderThan(qint64 timestamp)
 {
-    int cnt = -1;
-
-    TSqlQuery query(Tf::app()->databaseIdForCache());
-    QString sql = QStringLiteral("delete from %1 where %2<:ts").arg(_table, TIMESTAMP_COLUMN);
+    int cnt = 0;
+    const QString sql = QStringLiteral("delete from %1 where ROWID in (select ROWID from %1 where %2<:ts limit :num)").arg(_table, TIMESTAMP_COLUMN);
+
+    for (;;) {
+        TSqlQuery query = statement(sql);
+        query.bind(":ts", timestamp).bind(":num", EVICTION_BATCH);
+        if (!execStatement(query, sql)) {
+            return (cnt > 0) ? cnt : -1;
+        }
 
-    query.prepare(sql);
-    query.bind(":ts", timestamp);
-    if (query.exec()) {
-        cnt = query.numRowsAffected();
-    } else {
-        if (lastError().isValid()) {
-            tSystemError("SQLite error : %s [%s:%d]", qPrintable(lastErrorString()), __FILE__, __LINE__);
+        int removed = query.numRowsAffected();
+        cnt += removed;
+        if (removed < EVICTION_BATCH) {
+            break;
         }
     }
     return cnt;
@@ -266,7 +376,10 @@ int TCacheSQLiteStore::removeAll()
     return cnt;
 }
 
-
+/*!
+  Returns the size in bytes of the pages in use, excluding the free
+  pages left by deleted rows.
+*/
 qint64 TCacheSQLiteStore::dbSize()
 {
     qint64 sz = -1;
@@ -279,17 +392,79 @@ qint64 TCacheSQLiteStore::dbSize()
         ok = query.exec(QStringLiteral("PRAGMA page_count"));
         if (ok && query.next()) {
             qint64 count = query.value(0).toLongLong();
+
+            ok = query.exec(QStringLiteral("PRAGMA freelist_count"));
+            if (ok && query.next()) {
+                count -= query.value(0).toLongLong();
+            }
             sz = size * count;
         }
     }
     return sz;
 }
 
+/*!
+  \class TCacheSQLiteCollector
+  \brief The TCacheSQLiteCollector class runs the garbage collection
+  of a table in a thread of its own, so that the request which
+  triggered it does not wait for the deletions.
+*/
+class TCacheSQLiteCollector : public TScheduler
+{
+public:
+    TCacheSQLiteCollector(const QString &table) : TScheduler(), _table(table) { setSingleShot(true); }
+
+protected:
+    void job() override
+    {
+        TCacheSQLiteStore store(_table.toUtf8());
+        store.collect();
+    }
+
+private:
+    QString _table;
+};
 
+/*!
+  Starts removing the expired rows in the background, unless it is
+  already running.
+  \sa collect()
+*/
 void TCacheSQLiteStore::gc()
 {
+    static QMutex mutex(QMutex::NonRecursive);
+    static QHash<QString, TCacheSQLiteCollector *> collectors;
+
+    QMutexLocker locker(&mutex);
+    auto &collector = collectors[_table];
+    if (!collector) {
+        collector = new TCacheSQLiteCollector(_table);
+    }
+    if (!collector->isRunning()) {
+        collector->start(0);
+    }
+}
+
+/*!
+  Removes the expired rows, and then the rows expiring soonest while
+  the database exceeds 'MaxDbSize' in the cache.ini.
+*/
+void TCacheSQLiteStore::collect()
+{
+    static const qint64 maxDbSize = TCacheMemoryArena::parseSize(Tf::app()->cacheSettings().value("MaxDbSize"), 0);
+
     int removed = removeOlderThan(1 + QDateTime::currentMSecsSinceEpoch() / 1000);
     tSystemDebug("removeOlderThan: %d\n", removed);
+
+    if (maxDbSize > 0) {
+        while (dbSize() > maxDbSize) {
+            removed = removeOlder(EVICTION_BATCH);
+            tSystemDebug("removeOlder: %d\n", removed);
+            if (removed <= 0) {
+                break;
+            }
+        }
+    }
 }
 
 
@@ -298,7 +473,7 @@ QMap<QString, QVariant> TCacheSQLiteStore::defaultSettings() const
     QMap<QString, QVariant> settings {
         {"DriverType", "QSQLITE"},
         {"DatabaseName", "cachedb"},
-        {"PostOpenStatements", "PRAGMA journal_mode=WAL; PRAGMA busy_timeout=5000; PRAGMA synchronous=NORMAL;"},
+        {"PostOpenStatements", "PRAGMA journal_mode=WAL; PRAGMA busy_timeout=5000; PRAGMA synchronous=NORMAL; PRAGMA mmap_size=268435456;"},
     };
     return settings;
 }
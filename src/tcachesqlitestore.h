@@ -22,6 +22,8 @@ public:
     bool remove(const QByteArray &key) override;
     void clear() override;
     void gc() override;
+    bool tryLock(const QByteArray &key, const QByteArray &token, int seconds) override;
+    void unlock(const QByteArray &key, const QByteArray &token) override;
     QMap<QString, QVariant> defaultSettings() const override;
 
     bool exists(const QByteArray &key);
@@ -35,13 +37,16 @@ public:
     qint64 dbSize();
 
     static bool createTable(const QString &table);
+    static void releaseStatements(const QString &connectionName);
 
 protected:
     TCacheSQLiteStore(const QByteArray &table = QByteArray());
+    void collect();
 
     QString _table;
 
     friend class TCacheFactory;
+    friend class TCacheSQLiteCollector;
     friend class TSessionFileDbStore;
 };
 
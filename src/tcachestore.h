@@ -13,6 +13,7 @@ public:
     enum DbType {
         SQL,
         KVS,
+        Memory,
         Invalid,
     };
 
@@ -26,6 +27,8 @@ public:
     virtual bool remove(const QByteArray &key) = 0;
     virtual void clear() = 0;
     virtual void gc() = 0;
+    virtual bool tryLock(const QByteArray &key, const QByteArray &token, int seconds) { Q_UNUSED(key); Q_UNUSED(token); Q_UNUSED(seconds); return true; }
+    virtual void unlock(const QByteArray &key, const QByteArray &token) { Q_UNUSED(key); Q_UNUSED(token); }
     virtual QMap<QString, QVariant> defaultSettings() const { return QMap<QString, QVariant>(); }
 };
 
@@ -99,6 +99,23 @@ TCriteria::TCriteria(int property, TSql::ComparisonOperator op1, TSql::Compariso
     cri1 = QVariant::fromValue(TCriteriaData(property, op1, op2, val));
 }
 
+/*!
+  Constructs a criteria initialized with a WHERE clause to which
+  the row value of the properties of ORM object with the indexes
+  \a properties is compared with the row value \a values by a means
+  of the \a op parameter, such as "(a, b) > (1, 2)".
+  The \a op parameter must be one of the following constants:\n
+  TSql::Equal, TSql::NotEqual, TSql::LessThan, TSql::GreaterThan,
+  TSql::LessEqual, TSql::GreaterEqual.
+
+  @sa TCriteria &TCriteria::add(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values)
+*/
+TCriteria::TCriteria(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values) :
+    logiOp(None)
+{
+    cri1 = QVariant::fromValue(TCriteriaData(properties, op, values));
+}
+
 
 TCriteria::TCriteria(int property, TMongo::ComparisonOperator op) :
     logiOp(None)
@@ -172,6 +189,18 @@ TCriteria &TCriteria::add(int property, TSql::ComparisonOperator op1, TSql::Comp
     return add(And, TCriteria(property, op1, op2, val));
 }
 
+/*!
+  Adds a WHERE clause to which the row value of the properties of
+  ORM object with the indexes \a properties is compared with the
+  row value \a values by a means of the \a op parameter.
+  This is used for keyset pagination.
+  \sa TKeysetPaginator
+*/
+TCriteria &TCriteria::add(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values)
+{
+    return add(And, TCriteria(properties, op, values));
+}
+
 
 TCriteria &TCriteria::add(int property, TMongo::ComparisonOperator op)
 {
@@ -251,6 +280,17 @@ TCriteria &TCriteria::addOr(int property, TSql::ComparisonOperator op1, TSql::Co
     return add(Or, TCriteria(property, op1, op2, val));
 }
 
+/*!
+  Adds a WHERE clause with OR operator to which the row value of
+  the properties of ORM object with the indexes \a properties is
+  compared with the row value \a values by a means of the \a op
+  parameter.
+*/
+TCriteria &TCriteria::addOr(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values)
+{
+    return add(Or, TCriteria(properties, op, values));
+}
+
 
 TCriteria &TCriteria::addOr(int property, TMongo::ComparisonOperator op)
 {
@@ -16,6 +16,7 @@ public:
     TCriteria(int property, TSql::ComparisonOperator op, const QVariant &val);
     TCriteria(int property, TSql::ComparisonOperator op, const QVariant &val1, const QVariant &val2);
     TCriteria(int property, TSql::ComparisonOperator op1, TSql::ComparisonOperator op2, const QVariant &val);
+    TCriteria(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values);
     TCriteria(int property, TMongo::ComparisonOperator op);
     TCriteria(int property, TMongo::ComparisonOperator op, const QVariant &val);
     ~TCriteria() { }
@@ -25,12 +26,14 @@ public:
     TCriteria &add(int property, TSql::ComparisonOperator op, const QVariant &val);
     TCriteria &add(int property, TSql::ComparisonOperator op, const QVariant &val1, const QVariant &val2);
     TCriteria &add(int property, TSql::ComparisonOperator op1, TSql::ComparisonOperator op2, const QVariant &val);
+    TCriteria &add(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values);
     TCriteria &add(const TCriteria &criteria);
     TCriteria &addOr(int property, const QVariant &val);
     TCriteria &addOr(int property, TSql::ComparisonOperator op);
     TCriteria &addOr(int property, TSql::ComparisonOperator op, const QVariant &val);
     TCriteria &addOr(int property, TSql::ComparisonOperator op, const QVariant &val1, const QVariant &val2);
     TCriteria &addOr(int property, TSql::ComparisonOperator op1, TSql::ComparisonOperator op2, const QVariant &val);
+    TCriteria &addOr(const QList<int> &properties, TSql::ComparisonOperator op, const QVariantList &values);
     TCriteria &addOr(const TCriteria &criteria);
 
     // For MongoDB
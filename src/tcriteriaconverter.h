@@ -28,6 +28,7 @@ public:
     TCriteriaData(int property, int op, const QVariant &val);
     TCriteriaData(int property, int op, const QVariant &val1, const QVariant &val2);
     TCriteriaData(int property, int op1, int op2, const QVariant &val);
+    TCriteriaData(const QList<int> &properties, int op, const QVariantList &values);
     bool isEmpty() const;
 
     int property {-1};
@@ -36,6 +37,7 @@ public:
     int op2 {TSql::Invalid};
     QVariant val1;
     QVariant val2;
+    QList<int> properties;  // row value comparison
 };
 
 
@@ -44,7 +46,7 @@ inline TCriteriaData::TCriteriaData()
 
 
 inline TCriteriaData::TCriteriaData(const TCriteriaData &other)
-    :  property(other.property), op1(other.op1), op2(other.op2), val1(other.val1), val2(other.val2)
+    :  property(other.property), op1(other.op1), op2(other.op2), val1(other.val1), val2(other.val2), properties(other.properties)
 { }
 
 
@@ -68,6 +70,11 @@ inline TCriteriaData::TCriteriaData(int property, int op1, int op2, const QVaria
 { }
 
 
+inline TCriteriaData::TCriteriaData(const QList<int> &properties, int op, const QVariantList &values)
+    : property(properties.value(0, -1)), op1(op), op2(TSql::Invalid), val1(values), properties(properties)
+{ }
+
+
 inline bool TCriteriaData::isEmpty() const
 {
     return (property < 0 || op1 == TSql::Invalid);
@@ -89,6 +96,8 @@ public:
 protected:
     static QString getPropertyName(const QMetaObject *metaObject, int property, const QSqlDriver *driver, const QString &aliasTableName);
     QString criteriaToString(const QVariant &cri) const;
+    QString rowValueToString(const TCriteriaData &cri) const;
+    static bool isRowValueSupported(const QSqlDatabase &database);
     static QString criteriaToString(const QString &propertyName, QVariant::Type varType, TSql::ComparisonOperator op, const QVariant &val1, const QVariant &val2, const QSqlDatabase &database);
     static QString criteriaToString(const QString &propertyName, QVariant::Type varType, TSql::ComparisonOperator op1, TSql::ComparisonOperator op2, const QVariant &val, const QSqlDatabase &database);
     static QString concat(const QString &s1, TCriteria::LogicalOperator op, const QString &s2);
@@ -131,6 +140,10 @@ inline QString TCriteriaConverter<T>::criteriaToString(const QVariant &var) cons
         if (cri.isEmpty()) {
             return QString();
         }
+
+        if (!cri.properties.isEmpty()) {
+            return rowValueToString(cri);
+        }
         cri.varType = variantType(cri.property);
 
         QString name = propertyName(cri.property, database.driver(), tableAlias);
@@ -246,6 +259,103 @@ inline QString TCriteriaConverter<T>::criteriaToString(const QVariant &var) cons
 }
 
 
+/*!
+  Returns a SQL string of the row value comparison such as
+  "(a, b) > (1, 2)". For a database that can not compare row values,
+  the comparison is expanded to the equivalent form
+  "(a > 1) OR (a = 1 AND b > 2)".
+*/
+template <class T>
+inline QString TCriteriaConverter<T>::rowValueToString(const TCriteriaData &cri) const
+{
+    const QVariantList values = cri.val1.toList();
+    if (cri.properties.count() != values.count()) {
+        tWarn("Invalid parameters  [%s:%d]", __FILE__, __LINE__);
+        return QString();
+    }
+
+    switch (cri.op1) {
+    case TSql::Equal:
+    case TSql::NotEqual:
+    case TSql::LessThan:
+    case TSql::GreaterThan:
+    case TSql::LessEqual:
+    case TSql::GreaterEqual:
+        break;
+
+    default:
+        tWarn("Invalid parameters  [%s:%d]", __FILE__, __LINE__);
+        return QString();
+    }
+
+    QStringList names;
+    QStringList vals;
+    for (int i = 0; i < cri.properties.count(); i++) {
+        int prop = cri.properties[i];
+        QString name = propertyName(prop, database.driver(), tableAlias);
+        if (name.isEmpty()) {
+            return QString();
+        }
+        names << name;
+        vals << TSqlQuery::formatValue(values[i], variantType(prop), database);
+    }
+
+    if (names.count() == 1) {
+        return names[0] + TSql::formatArg(cri.op1, vals[0]);
+    }
+
+    if (isRowValueSupported(database)) {
+        QString str = QLatin1Char('(') + names.join(QLatin1String(", ")) + QLatin1Char(')');
+        str += TSql::formatArg(cri.op1, QLatin1Char('(') + vals.join(QLatin1String(", ")) + QLatin1Char(')'));
+        return str;
+    }
+
+    QString sqlString;
+    if (cri.op1 == TSql::Equal || cri.op1 == TSql::NotEqual) {
+        QStringList terms;
+        for (int i = 0; i < names.count(); i++) {
+            terms << names[i] + TSql::formatArg(TSql::Equal, vals[i]);
+        }
+        sqlString = QLatin1Char('(') + terms.join(QLatin1String(" AND ")) + QLatin1Char(')');
+        if (cri.op1 == TSql::NotEqual) {
+            sqlString = QLatin1String("(NOT ") + sqlString + QLatin1Char(')');
+        }
+    } else {
+        // Only the last column may be compared inclusively
+        int strictOp = (cri.op1 == TSql::LessEqual) ? TSql::LessThan : ((cri.op1 == TSql::GreaterEqual) ? TSql::GreaterThan : cri.op1);
+        QString prefix;
+        QStringList terms;
+        for (int i = 0; i < names.count(); i++) {
+            int op = (i == names.count() - 1) ? cri.op1 : strictOp;
+            terms << QLatin1Char('(') + prefix + names[i] + TSql::formatArg(op, vals[i]) + QLatin1Char(')');
+            prefix += names[i] + TSql::formatArg(TSql::Equal, vals[i]) + QLatin1String(" AND ");
+        }
+        sqlString = QLatin1Char('(') + terms.join(QLatin1String(" OR ")) + QLatin1Char(')');
+    }
+    return sqlString;
+}
+
+
+template <class T>
+inline bool TCriteriaConverter<T>::isRowValueSupported(const QSqlDatabase &database)
+{
+#if QT_VERSION >= 0x050400
+    switch (database.driver()->dbmsType()) {
+    case QSqlDriver::PostgreSQL:
+    case QSqlDriver::MySqlServer:
+    case QSqlDriver::SQLite:
+    case QSqlDriver::DB2:
+        return true;
+    default:
+        return false;
+    }
+#else
+    static const QStringList drivers = {"QPSQL", "QMYSQL", "QSQLITE", "QDB2"};
+    return drivers.contains(database.driverName().toUpper());
+#endif
+}
+
+
 template <class T>
 inline QString TCriteriaConverter<T>::getPropertyName(const QMetaObject *metaObject, int property, const QSqlDriver *driver, const QString &aliasTableName)
 {
@@ -21,6 +21,7 @@ public:
 
 protected:
     static QVariantMap criteriaToVariantMap(const QVariant &cri);
+    static QVariantMap rowValueToVariantMap(const TCriteriaData &cri);
     static QVariantMap join(const QVariantMap &v1, TCriteria::LogicalOperator op, const QVariantMap &v2);
 
 private:
@@ -57,6 +58,10 @@ inline QVariantMap TCriteriaMongoConverter<T>::criteriaToVariantMap(const QVaria
             return ret;
         }
 
+        if (!cri.properties.isEmpty()) {
+            return rowValueToVariantMap(cri);
+        }
+
         switch (cri.op1) {
         case TMongo::Equal:
             ret.insert(name, cri.val1);
@@ -152,6 +157,90 @@ inline QVariantMap TCriteriaMongoConverter<T>::criteriaToVariantMap(const QVaria
 }
 
 
+/*!
+  Returns a query document of the row value comparison, which is
+  expanded to the form of {$or: [{a: {$gt: 1}}, {a: 1, b: {$gt: 2}}]}.
+*/
+template <class T>
+inline QVariantMap TCriteriaMongoConverter<T>::rowValueToVariantMap(const TCriteriaData &cri)
+{
+    QVariantMap ret;
+    const QVariantList values = cri.val1.toList();
+    if (cri.properties.count() != values.count()) {
+        tWarn("error parameter  [%s:%d]", __FILE__, __LINE__);
+        return ret;
+    }
+
+    auto opName = [](int op) {
+        switch (op) {
+        case TMongo::LessThan:
+            return QStringLiteral("$lt");
+        case TMongo::GreaterThan:
+            return QStringLiteral("$gt");
+        case TMongo::LessEqual:
+            return QStringLiteral("$lte");
+        case TMongo::GreaterEqual:
+            return QStringLiteral("$gte");
+        default:
+            return QString();
+        }
+    };
+
+    QStringList names;
+    for (int prop : cri.properties) {
+        QString name = propertyName(prop);
+        if (name.isEmpty()) {
+            return ret;
+        }
+        names << name;
+    }
+
+    QVariantMap equal;
+    for (int i = 0; i < names.count(); i++) {
+        equal.insert(names[i], values[i]);
+    }
+
+    switch (cri.op1) {
+    case TMongo::Equal:
+        ret = equal;
+        break;
+
+    case TMongo::NotEqual:
+        ret.insert("$nor", QVariantList({equal}));
+        break;
+
+    case TMongo::LessThan:
+    case TMongo::GreaterThan:
+    case TMongo::LessEqual:
+    case TMongo::GreaterEqual: {
+        // Only the last field may be compared inclusively
+        int strictOp = (cri.op1 == TMongo::LessEqual) ? TMongo::LessThan : ((cri.op1 == TMongo::GreaterEqual) ? TMongo::GreaterThan : cri.op1);
+        QVariantMap prefix;
+        QVariantList terms;
+        for (int i = 0; i < names.count(); i++) {
+            QVariantMap cmp;
+            cmp.insert(opName((i == names.count() - 1) ? cri.op1 : strictOp), values[i]);
+            QVariantMap term = prefix;
+            term.insert(names[i], cmp);
+            terms << term;
+            prefix.insert(names[i], values[i]);
+        }
+
+        if (terms.count() == 1) {
+            ret = terms.first().toMap();
+        } else {
+            ret.insert("$or", terms);
+        }
+        break; }
+
+    default:
+        tWarn("error parameter: %d", cri.op1);
+        break;
+    }
+    return ret;
+}
+
+
 template <class T>
 inline QString TCriteriaMongoConverter<T>::propertyName(int property)
 {
@@ -0,0 +1,257 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <TCryptAead>
+#include <cstring>
+
+namespace {
+
+inline quint32 load32(const uchar *p)
+{
+    return (quint32)p[0] | ((quint32)p[1] << 8) | ((quint32)p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+
+inline void store32(uchar *p, quint32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+
+inline quint32 rotl(quint32 v, int c)
+{
+    return (v << c) | (v >> (32 - c));
+}
+
+
+inline void quarterRound(quint32 *x, int a, int b, int c, int d)
+{
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+}
+
+// ChaCha20 block function of RFC 8439
+void chachaBlock(const uchar *key, quint32 counter, const uchar *nonce, uchar *out)
+{
+    quint32 in[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    for (int i = 0; i < 8; ++i) {
+        in[4 + i] = load32(key + i * 4);
+    }
+    in[12] = counter;
+    for (int i = 0; i < 3; ++i) {
+        in[13 + i] = load32(nonce + i * 4);
+    }
+
+    quint32 x[16];
+    std::memcpy(x, in, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        quarterRound(x, 0, 4, 8, 12);
+        quarterRound(x, 1, 5, 9, 13);
+        quarterRound(x, 2, 6, 10, 14);
+        quarterRound(x, 3, 7, 11, 15);
+        quarterRound(x, 0, 5, 10, 15);
+        quarterRound(x, 1, 6, 11, 12);
+        quarterRound(x, 2, 7, 8, 13);
+        quarterRound(x, 3, 4, 9, 14);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        store32(out + i * 4, x[i] + in[i]);
+    }
+}
+
+
+void chachaXor(const uchar *key, quint32 counter, const uchar *nonce, const uchar *in, uchar *out, int length)
+{
+    uchar block[64];
+    while (length > 0) {
+        chachaBlock(key, counter++, nonce, block);
+        int n = qMin(length, 64);
+        for (int i = 0; i < n; ++i) {
+            out[i] = in[i] ^ block[i];
+        }
+        in += n;
+        out += n;
+        length -= n;
+    }
+}
+
+// Poly1305 with 26-bit limbs; the length of the message must be a multiple of 16
+void poly1305(const uchar *key, const uchar *msg, int length, uchar *mac)
+{
+    constexpr quint32 Mask = 0x3ffffff;
+    const quint32 r0 = load32(key + 0) & 0x3ffffff;
+    const quint32 r1 = (load32(key + 3) >> 2) & 0x3ffff03;
+    const quint32 r2 = (load32(key + 6) >> 4) & 0x3ffc0ff;
+    const quint32 r3 = (load32(key + 9) >> 6) & 0x3f03fff;
+    const quint32 r4 = (load32(key + 12) >> 8) & 0x00fffff;
+    const quint32 s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    quint32 h0 = 0, h1 = 0, h2 = 0, h3 = 0, h4 = 0;
+    quint32 c;
+
+    for (; length >= 16; msg += 16, length -= 16) {
+        h0 += load32(msg + 0) & Mask;
+        h1 += (load32(msg + 3) >> 2) & Mask;
+        h2 += (load32(msg + 6) >> 4) & Mask;
+        h3 += (load32(msg + 9) >> 6) & Mask;
+        h4 += (load32(msg + 12) >> 8) | (1 << 24);
+
+        quint64 d0 = (quint64)h0 * r0 + (quint64)h1 * s4 + (quint64)h2 * s3 + (quint64)h3 * s2 + (quint64)h4 * s1;
+        quint64 d1 = (quint64)h0 * r1 + (quint64)h1 * r0 + (quint64)h2 * s4 + (quint64)h3 * s3 + (quint64)h4 * s2;
+        quint64 d2 = (quint64)h0 * r2 + (quint64)h1 * r1 + (quint64)h2 * r0 + (quint64)h3 * s4 + (quint64)h4 * s3;
+        quint64 d3 = (quint64)h0 * r3 + (quint64)h1 * r2 + (quint64)h2 * r1 + (quint64)h3 * r0 + (quint64)h4 * s4;
+        quint64 d4 = (quint64)h0 * r4 + (quint64)h1 * r3 + (quint64)h2 * r2 + (quint64)h3 * r1 + (quint64)h4 * r0;
+
+        c = d0 >> 26; h0 = d0 & Mask;
+        d1 += c; c = d1 >> 26; h1 = d1 & Mask;
+        d2 += c; c = d2 >> 26; h2 = d2 & Mask;
+        d3 += c; c = d3 >> 26; h3 = d3 & Mask;
+        d4 += c; c = d4 >> 26; h4 = d4 & Mask;
+        h0 += c * 5; c = h0 >> 26; h0 &= Mask;
+        h1 += c;
+    }
+
+    // Fully carries h
+    c = h1 >> 26; h1 &= Mask;
+    h2 += c; c = h2 >> 26; h2 &= Mask;
+    h3 += c; c = h3 >> 26; h3 &= Mask;
+    h4 += c; c = h4 >> 26; h4 &= Mask;
+    h0 += c * 5; c = h0 >> 26; h0 &= Mask;
+    h1 += c;
+
+    // Computes h - p and selects it if not negative
+    quint32 g0 = h0 + 5; c = g0 >> 26; g0 &= Mask;
+    quint32 g1 = h1 + c; c = g1 >> 26; g1 &= Mask;
+    quint32 g2 = h2 + c; c = g2 >> 26; g2 &= Mask;
+    quint32 g3 = h3 + c; c = g3 >> 26; g3 &= Mask;
+    quint32 g4 = h4 + c - (1 << 26);
+
+    quint32 mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    // mac = (h + s) mod 2^128
+    quint32 w0 = h0 | (h1 << 26);
+    quint32 w1 = (h1 >> 6) | (h2 << 20);
+    quint32 w2 = (h2 >> 12) | (h3 << 14);
+    quint32 w3 = (h3 >> 18) | (h4 << 8);
+
+    quint64 f = (quint64)w0 + load32(key + 16);
+    store32(mac + 0, (quint32)f);
+    f = (quint64)w1 + load32(key + 20) + (f >> 32);
+    store32(mac + 4, (quint32)f);
+    f = (quint64)w2 + load32(key + 24) + (f >> 32);
+    store32(mac + 8, (quint32)f);
+    f = (quint64)w3 + load32(key + 28) + (f >> 32);
+    store32(mac + 12, (quint32)f);
+}
+
+
+QByteArray computeTag(const uchar *key, const uchar *nonce, const QByteArray &aad, const char *ciphertext, int length)
+{
+    uchar otk[64];
+    chachaBlock(key, 0, nonce, otk);  // one-time key
+
+    auto pad16 = [](QByteArray &data) {
+        data += QByteArray((16 - data.length() % 16) % 16, '\0');
+    };
+
+    QByteArray macData;
+    macData.reserve(aad.length() + length + 48);
+    macData += aad;
+    pad16(macData);
+    macData.append(ciphertext, length);
+    pad16(macData);
+
+    uchar lens[16];
+    store32(lens + 0, (quint32)aad.length());
+    store32(lens + 4, 0);
+    store32(lens + 8, (quint32)length);
+    store32(lens + 12, 0);
+    macData.append((const char *)lens, sizeof(lens));
+
+    QByteArray tag(TCryptAead::TagLength, '\0');
+    poly1305(otk, (const uchar *)macData.constData(), macData.length(), (uchar *)tag.data());
+    return tag;
+}
+
+}  // namespace
+
+/*!
+  \class TCryptAead
+  \brief The TCryptAead class provides the authenticated encryption with
+  associated data (AEAD) of ChaCha20-Poly1305, as specified in RFC 8439.
+
+  A 32-byte key and a 12-byte nonce are used; a nonce must never be used
+  twice with the same key.
+*/
+
+/*!
+  Encrypts the \a plaintext with the \a key and the \a nonce, and returns
+  the ciphertext followed by the 16-byte authentication tag, which also
+  authenticates the associated data \a aad. Returns an empty byte array
+  if the length of the key or the nonce is invalid.
+*/
+QByteArray TCryptAead::encrypt(const QByteArray &plaintext, const QByteArray &key, const QByteArray &nonce, const QByteArray &aad)
+{
+    if (key.length() != KeyLength || nonce.length() != NonceLength) {
+        return QByteArray();
+    }
+
+    const uchar *k = (const uchar *)key.constData();
+    const uchar *n = (const uchar *)nonce.constData();
+    QByteArray ciphertext(plaintext.length(), '\0');
+    chachaXor(k, 1, n, (const uchar *)plaintext.constData(), (uchar *)ciphertext.data(), plaintext.length());
+    ciphertext += computeTag(k, n, aad, ciphertext.constData(), ciphertext.length());
+    return ciphertext;
+}
+
+/*!
+  Verifies and decrypts the \a ciphertext, which is followed by the
+  authentication tag, with the \a key, the \a nonce and the associated
+  data \a aad. If \a ok is not nullptr, failure is reported by setting
+  *\a ok to false; an empty byte array is returned in that case.
+*/
+QByteArray TCryptAead::decrypt(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &nonce, const QByteArray &aad, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    if (key.length() != KeyLength || nonce.length() != NonceLength || ciphertext.length() < TagLength) {
+        return QByteArray();
+    }
+
+    const uchar *k = (const uchar *)key.constData();
+    const uchar *n = (const uchar *)nonce.constData();
+    const int length = ciphertext.length() - TagLength;
+    QByteArray tag = computeTag(k, n, aad, ciphertext.constData(), length);
+
+    // Compares in constant time
+    uchar diff = 0;
+    for (int i = 0; i < TagLength; ++i) {
+        diff |= tag[i] ^ ciphertext[length + i];
+    }
+    if (diff != 0) {
+        return QByteArray();
+    }
+
+    QByteArray plaintext(length, '\0');
+    chachaXor(k, 1, n, (const uchar *)ciphertext.constData(), (uchar *)plaintext.data(), length);
+    if (ok) {
+        *ok = true;
+    }
+    return plaintext;
+}
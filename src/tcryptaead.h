@@ -0,0 +1,21 @@
+#ifndef TCRYPTAEAD_H
+#define TCRYPTAEAD_H
+
+#include <TGlobal>
+#include <QByteArray>
+
+
+class T_CORE_EXPORT TCryptAead
+{
+public:
+    enum {
+        KeyLength   = 32,
+        NonceLength = 12,
+        TagLength   = 16,
+    };
+
+    static QByteArray encrypt(const QByteArray &plaintext, const QByteArray &key, const QByteArray &nonce, const QByteArray &aad = QByteArray());
+    static QByteArray decrypt(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &nonce, const QByteArray &aad = QByteArray(), bool *ok = nullptr);
+};
+
+#endif // TCRYPTAEAD_H
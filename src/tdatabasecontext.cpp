@@ -8,9 +8,11 @@
 #include "tdatabasecontext.h"
 #include "tsqldatabasepool.h"
 #include "tkvsdatabasepool.h"
+#include "tsqlquerycache.h"
 #include "tsystemglobal.h"
 #include <TWebApplication>
 #include <TKvsDriver>
+#include <TCache>
 #include <QtCore>
 #include <QSqlDatabase>
 #include <QThreadStorage>
@@ -38,6 +40,7 @@ TDatabaseContext::TDatabaseContext() :
 TDatabaseContext::~TDatabaseContext()
 {
     release();
+    delete cachep;
 }
 
 
@@ -129,7 +132,8 @@ void TDatabaseContext::commitTransactions()
 {
     for (QMap<int, TSqlTransaction>::iterator it = sqlDatabases.begin(); it != sqlDatabases.end(); ++it) {
         TSqlTransaction &tx = it.value();
-        tx.commit();
+        bool res = tx.commit();
+        flushQueryCache(it.key(), res);
         TSqlDatabasePool::instance()->pool(tx.database());
     }
 }
@@ -146,6 +150,7 @@ bool TDatabaseContext::commitTransaction(int id)
 
     TSqlTransaction &tx = sqlDatabases[id];
     res = tx.commit();
+    flushQueryCache(id, res);
     TSqlDatabasePool::instance()->pool(sqlDatabases[id].database());
     return res;
 }
@@ -156,6 +161,7 @@ void TDatabaseContext::rollbackTransactions()
     for (QMap<int, TSqlTransaction>::iterator it = sqlDatabases.begin(); it != sqlDatabases.end(); ++it) {
         TSqlTransaction &tx = it.value();
         tx.rollback();
+        flushQueryCache(it.key(), false);
         TSqlDatabasePool::instance()->pool(tx.database(), true);
     }
 }
@@ -170,11 +176,56 @@ bool TDatabaseContext::rollbackTransaction(int id)
         return res;
     }
     res = sqlDatabases[id].rollback();
+    flushQueryCache(id, false);
     TSqlDatabasePool::instance()->pool(sqlDatabases[id].database(), true);
     return res;
 }
 
 
+/*!
+  Returns the cache of this context, which is created on first use.
+*/
+TCache *TDatabaseContext::cache()
+{
+    if (! cachep) {
+        cachep = new TCache;
+    }
+    return cachep;
+}
+
+/*!
+  Invalidates the query cache entries that read the \a table on the
+  database \a id. While a transaction is active, the invalidation is
+  deferred until it is committed; otherwise a concurrent reader could
+  store the uncommitted old rows under the new version of the table.
+*/
+void TDatabaseContext::invalidateQueryCache(const QString &table, int id)
+{
+    auto it = sqlDatabases.constFind(id);
+    if (it != sqlDatabases.constEnd() && it.value().isActive()) {
+        dirtyTables[id] << table;
+    } else {
+        TSqlQueryCache::invalidate(cache(), table, id);
+    }
+}
+
+
+void TDatabaseContext::flushQueryCache(int id, bool committed)
+{
+    auto it = dirtyTables.find(id);
+    if (it == dirtyTables.end()) {
+        return;
+    }
+
+    if (committed) {
+        for (auto &table : it.value()) {
+            TSqlQueryCache::invalidate(cache(), table, id);
+        }
+    }
+    dirtyTables.erase(it);
+}
+
+
 int TDatabaseContext::idleTime() const
 {
     return (idleElapsed > 0) ? (uint)std::time(nullptr) - idleElapsed : -1;
@@ -2,10 +2,14 @@
 #define TDATABASECONTEXT_H
 
 #include <QMap>
+#include <QSet>
 #include <QSqlDatabase>
 #include <TSqlTransaction>
 #include <TKvsDatabase>
 #include <TGlobal>
+#include "tsqlprofiler.h"
+
+class TCache;
 
 
 class T_CORE_EXPORT TDatabaseContext
@@ -24,6 +28,9 @@ public:
     void rollbackTransactions();
     bool rollbackTransaction(int id = 0);
     int idleTime() const;
+    TSqlProfiler &sqlProfiler() { return sqlProfile; }
+    TCache *cache();
+    void invalidateQueryCache(const QString &table, int id = 0);
     static TDatabaseContext *currentDatabaseContext();
     static void setCurrentDatabaseContext(TDatabaseContext *context);
 
@@ -33,9 +40,14 @@ protected:
 
     QMap<int, TSqlTransaction> sqlDatabases;
     QMap<int, TKvsDatabase> kvsDatabases;
+    TSqlProfiler sqlProfile;
 
 private:
+    void flushQueryCache(int id, bool committed);
+
     uint idleElapsed {0};
+    TCache *cachep {nullptr};
+    QMap<int, QSet<QString>> dirtyTables;
 
     T_DISABLE_COPY(TDatabaseContext)
     T_DISABLE_MOVE(TDatabaseContext)
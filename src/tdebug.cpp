@@ -11,6 +11,7 @@
 #include <TAppSettings>
 #include "tloggerfactory.h"
 #include "tbasiclogstream.h"
+#include "tsharedmemorylogstream.h"
 #include "tsystemglobal.h"
 
 #undef tFatal
@@ -47,10 +48,47 @@ void Tf::setupAppLoggers()
     }
 
     if (!stream) {
-        stream = new TBasicLogStream(loggers, qApp);
+        // Buffers the logs of the application server processes in the
+        // shared memory, if set
+        const QVariantMap &settings = Tf::app()->loggerSettings();
+        int bufferSize = settings.value("SharedMemoryLogBuffer.Size").toInt();
+
+        if (bufferSize > 0 && Tf::app()->maxNumberOfAppServers() > 1) {
+            auto *shared = new TSharedMemoryLogStream(loggers, bufferSize, qApp);
+            if (shared->isAvailable()) {
+                QString policy = settings.value("SharedMemoryLogBuffer.OverflowPolicy").toString().trimmed().toLower();
+                shared->setOverflowPolicy((policy == QLatin1String("block")) ? TSharedMemoryLogStream::Block : TSharedMemoryLogStream::Drop);
+                stream = shared;
+            } else {
+                tSystemWarn("Shared memory log buffer not available: %s", qPrintable(shared->errorString()));
+                delete shared;
+            }
+        }
+
+        if (!stream) {
+            stream = new TBasicLogStream(loggers, qApp);
+        }
     }
 }
 
+/*!
+  Reloads the sampling settings in the logger.ini, and applies them to
+  the loggers, the access log and the SQL query log.
+  This function is for internal use only.
+*/
+void Tf::reloadLoggerSettings()
+{
+    QSettings settings(Tf::app()->configPath() + "logger.ini", QSettings::IniFormat);
+    settings.setIniCodec(Tf::app()->codecForInternal());
+    const QVariantMap map = Tf::settingsToMap(settings);
+
+    for (auto &logger : (const QList<TLogger*>&)loggers) {
+        logger->loadSamplingSettings(map);
+    }
+    Tf::loadLogSamplingSettings(map);
+    tSystemInfo("Reloaded the sampling settings of logs");
+}
+
 /*!
   Releases all the loggers.
   This function is for internal use only.
@@ -70,8 +108,12 @@ void Tf::releaseAppLoggers()
 static void tMessage(int priority, const char *msg, va_list ap)
 {
     if (stream) {
-        TLog log(priority, QString().vsprintf(msg, ap).toLocal8Bit());
-        stream->writeLog(log);
+        // Samples the log before formatting the message
+        quint64 loggers = stream->sample(priority);
+        if (loggers) {
+            TLog log(priority, QString().vsprintf(msg, ap).toLocal8Bit());
+            stream->writeLog(log, loggers);
+        }
     }
 }
 
@@ -90,14 +132,15 @@ TDebug::~TDebug()
     if (!buffer.isNull()) {
         TLog log(msgPriority, buffer.toLocal8Bit());
         if (stream) {
-            stream->writeLog(log);
+            stream->writeLog(log, loggers);
         }
     }
 }
 
 
 TDebug::TDebug(const TDebug &other)
-    :  buffer(other.buffer), ts(&buffer, QIODevice::WriteOnly), msgPriority(other.msgPriority)
+    :  buffer(other.buffer), ts(&buffer, QIODevice::WriteOnly), msgPriority(other.msgPriority),
+       sampled(other.sampled), loggers(other.loggers)
 { }
 
 
@@ -106,9 +149,17 @@ TDebug &TDebug::operator=(const TDebug &other)
     buffer = other.buffer;
     ts.setString(&buffer, QIODevice::WriteOnly);
     msgPriority = other.msgPriority;
+    sampled = other.sampled;
+    loggers = other.loggers;
     return *this;
 }
 
+
+quint64 TDebug::sample(int priority)
+{
+    return (stream) ? stream->sample(priority) : 0;
+}
+
 /*!
   Writes the fatal message \a fmt to the file app.log.
 */
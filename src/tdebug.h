@@ -9,6 +9,7 @@ namespace Tf
 {
     T_CORE_EXPORT void setupAppLoggers();   // internal use
     T_CORE_EXPORT void releaseAppLoggers(); // internal use
+    T_CORE_EXPORT void reloadLoggerSettings(); // internal use
 }
 
 
@@ -34,32 +35,45 @@ public:
     void debug(const char *fmt, ...) const T_ATTRIBUTE_FORMAT(2,3);
     void trace(const char *fmt, ...) const T_ATTRIBUTE_FORMAT(2,3);
 
-    inline TDebug &operator<<(QChar t) { ts << t; return *this; }
-    inline TDebug &operator<<(bool t) { ts << (t ? "true" : "false"); return *this; }
-    inline TDebug &operator<<(char t) { ts << t; return *this; }
-    inline TDebug &operator<<(short t) { ts << t; return *this; }
-    inline TDebug &operator<<(unsigned short t) { ts << t; return *this; }
-    inline TDebug &operator<<(int t) { ts << t; return *this; }
-    inline TDebug &operator<<(unsigned int t) { ts << t; return *this; }
-    inline TDebug &operator<<(long t) { ts << t; return *this; }
-    inline TDebug &operator<<(unsigned long t) { ts << t; return *this; }
-    inline TDebug &operator<<(qint64 t) { ts << t; return *this; }
-    inline TDebug &operator<<(quint64 t) { ts << t; return *this; }
-    inline TDebug &operator<<(float t) { ts << t; return *this; }
-    inline TDebug &operator<<(double t) { ts << t; return *this; }
-    inline TDebug &operator<<(const char* t) { ts << t; return *this; }
-    inline TDebug &operator<<(const QString &t) { ts << t; return *this; }
-    inline TDebug &operator<<(const QStringRef &t) { ts << t.toString(); return *this; }
-    inline TDebug &operator<<(const QLatin1String &t) { ts << t; return *this; }
-    inline TDebug &operator<<(const QByteArray &t) { ts << t; return *this; }
-    inline TDebug &operator<<(const QVariant &t) { ts << t.toString(); return *this; }
-    inline TDebug &operator<<(const void *t) { ts << t; return *this; }
-    inline TDebug &operator<<(std::nullptr_t) { ts << "(nullptr)"; return *this; }
+    inline TDebug &operator<<(QChar t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(bool t) { if (isSampled()) ts << (t ? "true" : "false"); return *this; }
+    inline TDebug &operator<<(char t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(short t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(unsigned short t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(int t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(unsigned int t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(long t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(unsigned long t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(qint64 t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(quint64 t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(float t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(double t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(const char* t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(const QString &t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(const QStringRef &t) { if (isSampled()) ts << t.toString(); return *this; }
+    inline TDebug &operator<<(const QLatin1String &t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(const QByteArray &t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(const QVariant &t) { if (isSampled()) ts << t.toString(); return *this; }
+    inline TDebug &operator<<(const void *t) { if (isSampled()) ts << t; return *this; }
+    inline TDebug &operator<<(std::nullptr_t) { if (isSampled()) ts << "(nullptr)"; return *this; }
 
 private:
+    // Samples the message before it is formatted
+    bool isSampled()
+    {
+        if (Q_UNLIKELY(!sampled)) {
+            loggers = sample(msgPriority);
+            sampled = true;
+        }
+        return loggers != 0;
+    }
+    static quint64 sample(int priority);
+
     QString buffer;
     QTextStream ts {&buffer, QIODevice::WriteOnly};
     int msgPriority {0};
+    bool sampled {false};
+    quint64 loggers {0};  // which write the message
 };
 
 #endif // TDEBUG_H
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = accesslogcodec
+SOURCES = main.cpp
@@ -0,0 +1,262 @@
+#include <QTest>
+#include <QDebug>
+#include "tglobal.h"
+#include "taccesslogcodec.h"
+#include <TAccessLog>
+
+// Rewrites the stream IDs of the frames to the id
+static QByteArray setStreamId(const QByteArray &data, quint8 id)
+{
+    QByteArray out;
+    int i = 0;
+    while (i < data.length()) {
+        char type = data[i];
+        int len = data[i + 1];  // less than 128
+        QByteArray payload = data.mid(i + 2, len);
+        int pos = (type == 1) ? 5 : 0;  // after the magic and the version of a header
+        int idLength = 1;
+        while (payload[pos + idLength - 1] & 0x80) {
+            ++idLength;
+        }
+        payload.replace(pos, idLength, QByteArray(1, (char)id));
+        out += type;
+        out += (char)payload.length();
+        out += payload;
+        i += 2 + len;
+    }
+    return out;
+}
+
+
+class TestAccessLogCodec : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void interning();
+    void reordered();
+    void traceId();
+    void broken();
+    void reusedStreamId();
+    void sessionFrames();
+    void bench_encode();
+};
+
+
+void TestAccessLogCodec::roundTrip_data()
+{
+    QTest::addColumn<QByteArray>("host");
+    QTest::addColumn<QByteArray>("request");
+
+    QTest::newRow("1") << QByteArray("127.0.0.1") << QByteArray("GET / HTTP/1.1");
+    QTest::newRow("2") << QByteArray("::1") << QByteArray("POST /blog/create?a=1 HTTP/1.0");
+    QTest::newRow("3") << QByteArray("10.0.0.1") << QByteArray("GET /");
+    QTest::newRow("4") << QByteArray("") << QByteArray("");
+    QTest::newRow("5") << QByteArray("10.0.0.1") << QByteArray("GET /" + QByteArray(300, 'a') + " HTTP/1.1");
+}
+
+
+void TestAccessLogCodec::roundTrip()
+{
+    QFETCH(QByteArray, host);
+    QFETCH(QByteArray, request);
+
+    TAccessLog log(host, request);
+    log.timestamp = QDateTime(QDate(2019, 1, 2), QTime(3, 4, 5, 678));
+    log.statusCode = 404;
+    log.responseBytes = 5120;
+    log.queryCount = 3;
+    log.queryTime = 12045;
+
+    TAccessLogEncoder encoder;
+    QByteArray data = encoder.encode(log);
+    QVERIFY(TAccessLogDecoder::isBinary(data));
+
+    bool ok;
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(data, &ok);
+    QVERIFY(ok);
+    QCOMPARE(logs.count(), 1);
+    QCOMPARE(logs[0].timestamp, log.timestamp);
+    QCOMPARE(logs[0].remoteHost, host);
+    QCOMPARE(logs[0].request, request);
+    QCOMPARE(logs[0].statusCode, 404);
+    QCOMPARE(logs[0].responseBytes, 5120);
+    QCOMPARE(logs[0].queryCount, 3);
+    QCOMPARE(logs[0].queryTime, (qint64)12045);
+    QCOMPARE(logs[0].toByteArray("%d", "yyyy-MM-dd hh:mm:ss"), QByteArray("2019-01-02 03:04:05"));
+}
+
+
+void TestAccessLogCodec::interning()
+{
+    TAccessLog log("127.0.0.1", "GET /index.html HTTP/1.1");
+    log.timestamp = QDateTime::currentDateTime();
+    log.statusCode = 200;
+
+    TAccessLogEncoder encoder;
+    QByteArray first = encoder.encode(log);
+    log.timestamp = log.timestamp.addMSecs(15);
+    QByteArray second = encoder.encode(log);
+
+    // Strings are written only once
+    QVERIFY(second.length() <= 16);
+    QVERIFY(!second.contains("index.html"));
+    QCOMPARE(TAccessLogDecoder::decode(first + second).count(), 2);
+
+    // A new session begins after reset
+    encoder.reset();
+    QByteArray third = encoder.encode(log);
+    QVERIFY(TAccessLogDecoder::isBinary(third));
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(first + second + third);
+    QCOMPARE(logs.count(), 3);
+    QCOMPARE(logs[2].request, log.request);
+}
+
+
+void TestAccessLogCodec::reordered()
+{
+    TAccessLog log1("127.0.0.1", "GET /a HTTP/1.1");
+    TAccessLog log2("127.0.0.1", "GET /b HTTP/1.1");
+    log1.timestamp = log2.timestamp = QDateTime::currentDateTime();
+
+    TAccessLogEncoder encoder;
+    QByteArray first = encoder.encode(log1);
+    QByteArray second = encoder.encode(log2);
+
+    // The record of log2 precedes its string definition
+    int pos = second.indexOf("/b") + 2;
+    QByteArray data = first + second.mid(pos) + second.left(pos);
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(data);
+    QCOMPARE(logs.count(), 2);
+    QCOMPARE(logs[1].request, log2.request);
+}
+
+
+void TestAccessLogCodec::traceId()
+{
+    TAccessLog log("127.0.0.1", "GET / HTTP/1.1");
+    log.timestamp = QDateTime::currentDateTime();
+    log.traceId = "4bf92f3577b34da6a3ce929d0e0e4736";
+    log.spanId = "00f067aa0ba902b7";
+
+    TAccessLogEncoder encoder;
+    QByteArray data = encoder.encode(log);
+    TAccessLog untraced = log;
+    untraced.traceId.clear();
+    untraced.spanId.clear();
+    data += encoder.encode(untraced);
+
+    bool ok;
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(data, &ok);
+    QVERIFY(ok);
+    QCOMPARE(logs.count(), 2);
+    QCOMPARE(logs[0].traceId, log.traceId);
+    QCOMPARE(logs[0].spanId, log.spanId);
+    QVERIFY(logs[1].traceId.isEmpty());
+}
+
+
+void TestAccessLogCodec::broken()
+{
+    TAccessLog log("127.0.0.1", "GET / HTTP/1.1");
+    log.timestamp = QDateTime::currentDateTime();
+
+    TAccessLogEncoder encoder;
+    QByteArray data = encoder.encode(log);
+    data += encoder.encode(log);
+    data.chop(1);
+
+    bool ok;
+    QCOMPARE(TAccessLogDecoder::decode(data, &ok).count(), 1);
+    QVERIFY(!ok);
+    QVERIFY(!TAccessLogDecoder::isBinary("127.0.0.1 - \"GET / HTTP/1.1\" 200\n"));
+}
+
+
+void TestAccessLogCodec::reusedStreamId()
+{
+    TAccessLog log1("127.0.0.1", "GET /a HTTP/1.1");
+    TAccessLog log2("192.168.0.1", "POST /b HTTP/1.0");
+    log1.timestamp = QDateTime::fromMSecsSinceEpoch(Q_INT64_C(1500000000000));
+    log2.timestamp = log1.timestamp.addDays(1);
+
+    // Two sessions of the same stream ID in a file
+    TAccessLogEncoder encoder1, encoder2;
+    QByteArray first = setStreamId(encoder1.encode(log1), 7);
+    QByteArray second = setStreamId(encoder2.encode(log2), 7);
+
+    QByteArray third = setStreamId(encoder1.encode(log1), 7);  // a record only
+
+    bool ok;
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(first + second + third, &ok);
+    QVERIFY(ok);
+    QCOMPARE(logs.count(), 3);
+    QCOMPARE(logs[0].request, log1.request);
+    QCOMPARE(logs[0].timestamp, log1.timestamp);
+    QCOMPARE(logs[1].remoteHost, log2.remoteHost);
+    QCOMPARE(logs[1].request, log2.request);
+    QCOMPARE(logs[1].timestamp, log2.timestamp);
+    // A record following the second header belongs to it
+    QCOMPARE(logs[2].remoteHost, log2.remoteHost);
+}
+
+
+void TestAccessLogCodec::sessionFrames()
+{
+    TAccessLog log("127.0.0.1", "GET /index.html HTTP/1.1");
+    log.timestamp = QDateTime::fromMSecsSinceEpoch(Q_INT64_C(1500000000000));
+
+    TAccessLogEncoder encoder;
+    QVERIFY(encoder.sessionFrames().isEmpty());
+    QByteArray first = encoder.encode(log);
+    QByteArray frames = encoder.sessionFrames();
+    QVERIFY(first.startsWith(frames));
+    QVERIFY(frames.contains("/index.html") && frames.contains("HTTP/1.1"));
+    QCOMPARE(first.at(frames.length()), (char)3);  // the record follows
+
+    // A rotated file begins with the session frames
+    log.timestamp = log.timestamp.addSecs(1);
+    QByteArray data = encoder.sessionFrames() + encoder.encode(log);
+    QVERIFY(TAccessLogDecoder::isBinary(data));
+    bool ok;
+    QList<TAccessLog> logs = TAccessLogDecoder::decode(data, &ok);
+    QVERIFY(ok);
+    QCOMPARE(logs.count(), 1);
+    QCOMPARE(logs[0].request, log.request);
+    QCOMPARE(logs[0].timestamp, log.timestamp);
+
+    // Records of the previous session are decodable with its frames
+    log.timestamp = log.timestamp.addSecs(1);
+    QByteArray previous = encoder.encode(log);
+    encoder.reset();
+    QVERIFY(encoder.sessionFrames().isEmpty());
+    QByteArray current = encoder.encode(log);
+    QVERIFY(encoder.sessionFrames(current).isEmpty());  // begins with the header
+    QCOMPARE(encoder.sessionFrames(previous), frames);
+    logs = TAccessLogDecoder::decode(encoder.sessionFrames(previous) + previous + current, &ok);
+    QVERIFY(ok);
+    QCOMPARE(logs.count(), 2);
+    QCOMPARE(logs[0].timestamp, log.timestamp);
+    QCOMPARE(logs[1].timestamp, log.timestamp);
+    QCOMPARE(logs[1].request, log.request);
+}
+
+
+void TestAccessLogCodec::bench_encode()
+{
+    TAccessLog log("127.0.0.1", "GET /index.html HTTP/1.1");
+    log.timestamp = QDateTime::currentDateTime();
+    log.statusCode = 200;
+    log.responseBytes = 5120;
+    TAccessLogEncoder encoder;
+    QByteArray buffer;
+
+    QBENCHMARK {
+        buffer.resize(0);
+        encoder.encode(log, buffer);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestAccessLogCodec)
+#include "main.moc"
@@ -1,6 +1,7 @@
-#include <QTest>
+#include <TfTest/TfTest>
 #include <QDebug>
 #include "tglobal.h"
+#include "tcachecodec.h"
 
 static QByteArray dummydata;
 static const QByteArray testdata2("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
@@ -22,6 +23,11 @@ private slots:
     void lz4_l2();
     void lz4_l5_data();
     void lz4_l5();
+    void codec_data();
+    void codec();
+    void codecUncompressed();
+    void codecLegacy_data();
+    void codecLegacy();
     void bench_lz4_l1_512();
     void bench_lz4_l2_512();
     void bench_lz4_l5_512();
@@ -282,5 +288,79 @@ void LZ4Compress::bench_base64_10m()
     }
 }
 
-QTEST_APPLESS_MAIN(LZ4Compress)
+
+void LZ4Compress::codec_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("flags");
+
+    QByteArray random;
+    for (int i = 0; i < 8192; ++i) {
+        random += (char)Tf::random(0, 255);
+    }
+
+    QTest::newRow("1") << QByteArray("") << 0;
+    QTest::newRow("2") << testdata2 << 0;
+    QTest::newRow("3") << testdata5.repeated(10) << 0;
+    QTest::newRow("4") << testdata5.repeated(10) << (int)TCacheCodec::Envelope;
+    QTest::newRow("5") << dummydata.mid(0, 1024 * 1021) << (int)TCacheCodec::Envelope;
+    QTest::newRow("6") << random << 0;
+    QTest::newRow("7") << QByteArray("\xffTF\x01" "abc") << 0;  // looks tagged
+}
+
+
+void LZ4Compress::codec()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, flags);
+
+    QByteArray encoded = TCacheCodec::encode(data, true, flags);
+    int decodedFlags = -1;
+    QCOMPARE(TCacheCodec::decode(encoded, true, &decodedFlags), data);
+    QCOMPARE(decodedFlags, flags);
+    QCOMPARE(TCacheCodec::decode(encoded, false), data);
+}
+
+
+void LZ4Compress::codecUncompressed()
+{
+    // Compressible but not compressed
+    QByteArray data = testdata5.repeated(10);
+    QByteArray encoded = TCacheCodec::encode(data, false);
+    QCOMPARE(encoded.size(), data.size() + 4);
+    QCOMPARE(TCacheCodec::decode(encoded, false), data);
+
+    // Compressed; counted in the statistics
+    qint64 compressed = TCacheCodec::stats().value("compressed").toLongLong();
+    encoded = TCacheCodec::encode(data, true);
+    QVERIFY(encoded.size() < data.size());
+    QCOMPARE(TCacheCodec::stats().value("compressed").toLongLong(), compressed + 1);
+}
+
+
+void LZ4Compress::codecLegacy_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("1") << testdata2;
+    QTest::newRow("2") << testdata3;
+    QTest::newRow("3") << dummydata.mid(0, 1025);
+}
+
+
+void LZ4Compress::codecLegacy()
+{
+    QFETCH(QByteArray, data);
+
+    // Untagged LZ4 of the format before the tag
+    QByteArray legacy = Tf::lz4Compress(data);
+    int flags = -1;
+    QCOMPARE(TCacheCodec::decode(legacy, true, &flags), data);
+    QCOMPARE(flags, 0);
+
+    // Untagged raw data if compression is disabled
+    QCOMPARE(TCacheCodec::decode(data, false), data);
+}
+
+TF_TEST_SQLLESS_MAIN(LZ4Compress)
 #include "main.moc"
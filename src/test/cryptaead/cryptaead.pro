@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = cryptaead
+SOURCES = main.cpp
@@ -0,0 +1,105 @@
+#include <QTest>
+#include <QByteArray>
+#include <tcryptaead.h>
+
+
+class TestCryptAead : public QObject
+{
+    Q_OBJECT
+private slots:
+    void encrypt_data();
+    void encrypt();
+    void decrypt_data();
+    void decrypt();
+    void tamper();
+};
+
+
+void TestCryptAead::encrypt_data()
+{
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QByteArray>("nonce");
+    QTest::addColumn<QByteArray>("aad");
+    QTest::addColumn<QByteArray>("plaintext");
+    QTest::addColumn<QByteArray>("result");
+
+    // RFC 8439 2.8.2
+    QTest::newRow("1") << QByteArray::fromHex("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f")
+                       << QByteArray::fromHex("070000004041424344454647")
+                       << QByteArray::fromHex("50515253c0c1c2c3c4c5c6c7")
+                       << QByteArray("Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.")
+                       << QByteArray::fromHex("d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc3ff4def08e4b7a9de576d26586cec64b6116"
+                                              "1ae10b594f09e26a7e902ecbd0600691");
+}
+
+
+void TestCryptAead::encrypt()
+{
+    QFETCH(QByteArray, key);
+    QFETCH(QByteArray, nonce);
+    QFETCH(QByteArray, aad);
+    QFETCH(QByteArray, plaintext);
+    QFETCH(QByteArray, result);
+
+    QCOMPARE(TCryptAead::encrypt(plaintext, key, nonce, aad).toHex(), result.toHex());
+}
+
+
+void TestCryptAead::decrypt_data()
+{
+    QTest::addColumn<int>("length");
+    QTest::addColumn<QByteArray>("aad");
+
+    QTest::newRow("1") << 0 << QByteArray();
+    QTest::newRow("2") << 1 << QByteArray("a");
+    QTest::newRow("3") << 64 << QByteArray("TFSESSION");
+    QTest::newRow("4") << 65 << QByteArray(17, 'x');
+    QTest::newRow("5") << 4000 << QByteArray();
+}
+
+
+void TestCryptAead::decrypt()
+{
+    QFETCH(int, length);
+    QFETCH(QByteArray, aad);
+
+    QByteArray key(32, '\x5a');
+    QByteArray nonce(12, '\x01');
+    QByteArray plaintext(length, '\0');
+    for (int i = 0; i < length; ++i) {
+        plaintext[i] = (char)i;
+    }
+
+    QByteArray ciphertext = TCryptAead::encrypt(plaintext, key, nonce, aad);
+    QCOMPARE(ciphertext.length(), length + (int)TCryptAead::TagLength);
+
+    bool ok;
+    QCOMPARE(TCryptAead::decrypt(ciphertext, key, nonce, aad, &ok), plaintext);
+    QVERIFY(ok);
+}
+
+
+void TestCryptAead::tamper()
+{
+    QByteArray key(32, '\x5a');
+    QByteArray nonce(12, '\x01');
+    QByteArray ciphertext = TCryptAead::encrypt("hello world", key, nonce, "aad");
+    bool ok;
+
+    for (int i = 0; i < ciphertext.length(); ++i) {
+        QByteArray broken = ciphertext;
+        broken[i] = broken[i] ^ 0x01;
+        QVERIFY(TCryptAead::decrypt(broken, key, nonce, "aad", &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+
+    TCryptAead::decrypt(ciphertext, key, nonce, "other", &ok);
+    QVERIFY(!ok);
+    TCryptAead::decrypt(ciphertext, QByteArray(32, '\x5b'), nonce, "aad", &ok);
+    QVERIFY(!ok);
+    TCryptAead::decrypt(ciphertext.left(15), key, nonce, "aad", &ok);
+    QVERIFY(!ok);
+}
+
+QTEST_APPLESS_MAIN(TestCryptAead)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = fileaiowriter
+SOURCES = main.cpp
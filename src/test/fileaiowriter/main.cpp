@@ -0,0 +1,276 @@
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include "tglobal.h"
+#include "tfileaiowriter.h"
+#include <atomic>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::atomic<int> signalCount {0};
+
+static void countSignal(int)
+{
+    signalCount++;
+}
+
+
+static QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+
+// Reads the length bytes from the fd
+static QByteArray readAll(int fd, int length)
+{
+    QByteArray data;
+    char buf[4096];
+    while (data.length() < length) {
+        int len = ::read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+        data.append(buf, len);
+    }
+    return data;
+}
+
+
+static QByteArray lines(int from, int to)
+{
+    QByteArray data;
+    for (int i = from; i < to; ++i) {
+        data += "line " + QByteArray::number(i) + '\n';
+    }
+    return data;
+}
+
+
+class TestFileAioWriter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+    void flushAndClose();
+    void backpressure();
+    void interruptedWrite();
+    void rotationBySize();
+    void rotationByPeriod();
+};
+
+
+void TestFileAioWriter::init()
+{
+    TFileAioWriter::setDefaultOptions(TFileAioWriter::Options());
+}
+
+
+void TestFileAioWriter::cleanup()
+{
+    TFileAioWriter::setDefaultOptions(TFileAioWriter::Options());
+}
+
+
+void TestFileAioWriter::flushAndClose()
+{
+    QTemporaryDir dir;
+    QString path = dir.path() + "/test.log";
+    TFileAioWriter writer(path);
+    QVERIFY(writer.open());
+
+    QByteArray expected;
+    for (int i = 0; i < 1000; ++i) {
+        QByteArray line = lines(i, i + 1);
+        QCOMPARE(writer.write(line.constData(), line.length()), 0);
+        expected += line;
+    }
+
+    // Flush waits for all queued data
+    writer.flush();
+    QCOMPARE(readFile(path), expected);
+
+    for (int i = 1000; i < 2000; ++i) {
+        QByteArray line = lines(i, i + 1);
+        writer.write(line.constData(), line.length());
+        expected += line;
+    }
+
+    // So does close
+    writer.close();
+    QVERIFY(!writer.isOpen());
+    QCOMPARE(readFile(path), expected);
+    QCOMPARE(writer.write("x", 1), -1);
+}
+
+
+void TestFileAioWriter::backpressure()
+{
+    QTemporaryDir dir;
+    QString path = dir.path() + "/fifo";
+    QVERIFY(::mkfifo(QFile::encodeName(path).constData(), 0600) == 0);
+    int rfd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK);
+    QVERIFY(rfd >= 0);
+
+    TFileAioWriter::Options options;
+    options.maxBufferSize = 4096;
+    TFileAioWriter::setDefaultOptions(options);
+    TFileAioWriter writer(path);
+    QVERIFY(writer.open());
+
+    // Far more than the pipe and the buffer can hold
+    const QByteArray data = lines(0, 30000);
+    std::atomic<bool> done {false};
+    std::thread thread([&]() {
+        for (int i = 0; i < data.length(); i += 1000) {
+            writer.write(data.constData() + i, qMin(1000, data.length() - i));
+        }
+        done = true;
+    });
+
+    // Writers wait while nothing is read
+    QThread::msleep(200);
+    QVERIFY(!done);
+
+    ::fcntl(rfd, F_SETFL, 0);  // blocking
+    QByteArray received = readAll(rfd, data.length());
+    thread.join();
+    QVERIFY(done);
+    QCOMPARE(received, data);
+
+    writer.close();
+    ::close(rfd);
+}
+
+
+void TestFileAioWriter::interruptedWrite()
+{
+    QTemporaryDir dir;
+    QString path = dir.path() + "/fifo";
+    QVERIFY(::mkfifo(QFile::encodeName(path).constData(), 0600) == 0);
+    int rfd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK);
+    QVERIFY(rfd >= 0);
+    ::fcntl(rfd, F_SETFL, 0);
+
+    struct sigaction sa, old;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = countSignal;  // no SA_RESTART
+    ::sigaction(SIGUSR2, &sa, &old);
+    signalCount = 0;
+
+    TFileAioWriter writer(path);
+    QVERIFY(writer.open());
+
+    // Only the writer thread receives the signal
+    sigset_t set, oldset;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &set, &oldset);
+
+    // Writes to the full pipe are interrupted partway, and resumed
+    const QByteArray data = lines(0, 200000);
+    QByteArray received;
+    std::thread reader([&]() { received = readAll(rfd, data.length()); });
+    for (int i = 0; i < data.length(); i += 8192) {
+        writer.write(data.constData() + i, qMin(8192, data.length() - i));
+    }
+    while (signalCount < 100) {
+        ::kill(::getpid(), SIGUSR2);
+        QThread::usleep(200);
+    }
+    writer.flush();
+    reader.join();
+    QCOMPARE(received.length(), data.length());
+    QVERIFY(received == data);
+
+    writer.close();
+    ::close(rfd);
+    pthread_sigmask(SIG_SETMASK, &oldset, nullptr);
+    ::sigaction(SIGUSR2, &old, nullptr);
+}
+
+
+void TestFileAioWriter::rotationBySize()
+{
+    QTemporaryDir dir;
+    QString path = dir.path() + "/test.log";
+    TFileAioWriter::Options options;
+    options.rotationSize = 100;
+    TFileAioWriter::setDefaultOptions(options);
+
+    TFileAioWriter writer(path);
+    QByteArray following;
+    writer.setRotationHandler([&](const QByteArray &data) {
+        following = data;
+        return QByteArray("HEADER\n");
+    });
+    QVERIFY(writer.open());
+
+    QByteArray first = lines(0, 10);
+    QByteArray second = lines(10, 20);
+    QVERIFY(first.length() < 100 && first.length() + second.length() > 100);
+    writer.write(first.constData(), first.length());
+    writer.flush();
+    writer.write(second.constData(), second.length());
+    writer.flush();
+
+    // The new file begins with the data of the handler
+    QStringList rotated = QDir(dir.path()).entryList(QStringList("test.log.*"), QDir::Files);
+    QCOMPARE(rotated.count(), 1);
+    QCOMPARE(readFile(dir.path() + "/" + rotated.first()), first);
+    QCOMPARE(readFile(path), "HEADER\n" + second);
+    QCOMPARE(following, second);
+    writer.close();
+}
+
+
+void TestFileAioWriter::rotationByPeriod()
+{
+    QTemporaryDir dir;
+    QString path = dir.path() + "/test.log";
+    TFileAioWriter::Options options;
+    options.rotationPeriod = TFileAioWriter::Daily;
+    TFileAioWriter::setDefaultOptions(options);
+
+    // The local date moves by changing the time zone from UTC+14 to UTC-12
+    QByteArray tz = qgetenv("TZ");
+    qputenv("TZ", "AAA-14");
+    tzset();
+
+    TFileAioWriter writer(path);
+    QVERIFY(writer.open());
+    writer.write("first\n", 6);
+    writer.flush();
+
+    qputenv("TZ", "AAA+12");
+    tzset();
+    writer.write("second\n", 7);
+    writer.flush();
+    writer.close();
+
+    if (tz.isNull()) {
+        qunsetenv("TZ");
+    } else {
+        qputenv("TZ", tz);
+    }
+    tzset();
+
+    QStringList rotated = QDir(dir.path()).entryList(QStringList("test.log.*"), QDir::Files);
+    QCOMPARE(rotated.count(), 1);
+    QCOMPARE(readFile(dir.path() + "/" + rotated.first()), QByteArray("first\n"));
+    QCOMPARE(readFile(path), QByteArray("second\n"));
+}
+
+QTEST_APPLESS_MAIN(TestFileAioWriter)
+#include "main.moc"
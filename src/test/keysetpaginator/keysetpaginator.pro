@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = keysetpaginator
+SOURCES = main.cpp
@@ -0,0 +1,153 @@
+#include <QTest>
+#include <QDateTime>
+#include "tglobal.h"
+#include "tkeysetpaginator.h"
+
+
+class KeysetPaginator : public TKeysetPaginator
+{
+public:
+    KeysetPaginator(const QList<int> &columns, const QByteArray &key = "secret") :
+        TKeysetPaginator(columns), key(key) { }
+
+    using TKeysetPaginator::encode;
+    using TKeysetPaginator::decode;
+
+protected:
+    QByteArray cursorKey() const override { return key; }
+
+private:
+    QByteArray key;
+};
+
+
+static QByteArray toBytes(const QString &cursor)
+{
+    return QByteArray::fromBase64(cursor.toLatin1(), QByteArray::Base64UrlEncoding);
+}
+
+
+static QString toCursor(const QByteArray &bytes)
+{
+    return QString::fromLatin1(bytes.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+
+class TestKeysetPaginator : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void tampered();
+    void truncated();
+    void wrongKey();
+    void wrongColumns();
+    void setCursor();
+};
+
+
+void TestKeysetPaginator::roundTrip_data()
+{
+    QTest::addColumn<QVariantList>("values");
+
+    QTest::newRow("int") << QVariantList({(qint64)-12345, (quint64)18446744073709551615ULL});
+    QTest::newRow("double") << QVariantList({1.5, true});
+    QTest::newRow("string") << QVariantList({QString::fromUtf8("\xe6\x97\xa5\xe6\x9c\xac"), QString("")});
+    QTest::newRow("bytes") << QVariantList({QByteArray("\x00\xff", 2), QVariant()});
+    QTest::newRow("datetime") << QVariantList({QDateTime::fromMSecsSinceEpoch(1500000000123LL), (qint64)1});
+}
+
+
+void TestKeysetPaginator::roundTrip()
+{
+    QFETCH(QVariantList, values);
+
+    KeysetPaginator pager({1, 2});
+    QString cursor = pager.encode(values);
+    QVERIFY(!cursor.isEmpty());
+
+    QVariantList decoded = pager.decode(cursor);
+    QCOMPARE(decoded.count(), values.count());
+    for (int i = 0; i < values.count(); ++i) {
+        QCOMPARE(decoded[i].isNull(), values[i].isNull());
+        QCOMPARE(decoded[i], values[i]);
+    }
+}
+
+
+void TestKeysetPaginator::tampered()
+{
+    KeysetPaginator pager({1, 2});
+    QByteArray bytes = toBytes(pager.encode({(qint64)100, QString("abc")}));
+
+    // Any flipped bit is rejected
+    for (int i = 0; i < bytes.length(); ++i) {
+        QByteArray forged = bytes;
+        forged[i] = forged[i] ^ 0x01;
+        QVERIFY(pager.decode(toCursor(forged)).isEmpty());
+    }
+
+    // So is a huge string length in an unsigned cursor
+    QByteArray huge = bytes;
+    huge.chop(16);
+    huge += QByteArray("\x05\xff\xff\xff\xfe", 5);
+    huge += QByteArray(16, '\0');
+    QVERIFY(pager.decode(toCursor(huge)).isEmpty());
+    QVERIFY(pager.decode(QString(8192, QLatin1Char('A'))).isEmpty());
+}
+
+
+void TestKeysetPaginator::truncated()
+{
+    KeysetPaginator pager({1, 2});
+    QByteArray bytes = toBytes(pager.encode({(qint64)100, QString("abc")}));
+
+    for (int len = 0; len < bytes.length(); ++len) {
+        QVERIFY(pager.decode(toCursor(bytes.left(len))).isEmpty());
+    }
+    QVERIFY(pager.decode(toCursor(bytes + 'x')).isEmpty());
+    QCOMPARE(pager.decode(toCursor(bytes)).count(), 2);
+}
+
+
+void TestKeysetPaginator::wrongKey()
+{
+    KeysetPaginator pager({1});
+    KeysetPaginator other({1}, "another");
+    QString cursor = pager.encode({(qint64)1});
+    QVERIFY(other.decode(cursor).isEmpty());
+    QCOMPARE(pager.decode(cursor).count(), 1);
+}
+
+
+void TestKeysetPaginator::wrongColumns()
+{
+    KeysetPaginator pager({1, 2});
+    QString cursor = pager.encode({(qint64)1, (qint64)2});
+
+    KeysetPaginator swapped({2, 1});
+    QVERIFY(swapped.decode(cursor).isEmpty());
+
+    KeysetPaginator descending({1, 2});
+    descending.setSortOrder(Tf::DescendingOrder);
+    QVERIFY(descending.decode(cursor).isEmpty());
+
+    // The count of values must match the columns
+    QVERIFY(pager.encode({(qint64)1}).isEmpty());
+}
+
+
+void TestKeysetPaginator::setCursor()
+{
+    KeysetPaginator pager({1});
+    QString cursor = pager.encode({QString("abc")});
+    QVERIFY(pager.setCursor(cursor));
+    QCOMPARE(pager.cursorValues(), QVariantList({QString("abc")}));
+
+    QVERIFY(!pager.setCursor("AAAA"));
+    QVERIFY(pager.isFirstPage());
+}
+
+QTEST_APPLESS_MAIN(TestKeysetPaginator)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = loglayout
+SOURCES = main.cpp
@@ -0,0 +1,162 @@
+#include <QTest>
+#include <QDebug>
+#include "tglobal.h"
+#include "tloglayout.h"
+#include <TLog>
+#include <TAccessLog>
+#include <TTraceContext>
+
+
+class TestLogLayout : public QObject
+{
+    Q_OBJECT
+private slots:
+    void applicationLog_data();
+    void applicationLog();
+    void accessLog_data();
+    void accessLog();
+    void timestamp();
+    void traceId();
+    void json();
+    void bench_accessLog();
+};
+
+
+void TestLogLayout::applicationLog_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+    QTest::addColumn<QByteArray>("result");
+
+    QTest::newRow("1") << QByteArray("%d %5P %m%n") << QByteArray("2019-01-02 03:04:05 WARN  hello\n");
+    QTest::newRow("2") << QByteArray("%p [%t] [%08T] %i %I") << QByteArray("warn [1234] [000004d2] 99 63");
+    QTest::newRow("3") << QByteArray("%6t|%x|100%") << QByteArray("  1234|%x|100%");
+    QTest::newRow("4") << QByteArray("%%d %h") << QByteArray("%2019-01-02 03:04:05 %h");
+    QTest::newRow("5") << QByteArray("") << QByteArray("");
+}
+
+
+void TestLogLayout::applicationLog()
+{
+    QFETCH(QByteArray, layout);
+    QFETCH(QByteArray, result);
+
+    TLog log(Tf::WarnLevel, "hello");
+    log.timestamp = QDateTime(QDate(2019, 1, 2), QTime(3, 4, 5));
+    log.threadId = 1234;
+    log.pid = 99;
+
+    TLogLayout compiled(layout, "yyyy-MM-dd hh:mm:ss");
+    QCOMPARE(compiled.format(log), result);
+}
+
+
+void TestLogLayout::accessLog_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+    QTest::addColumn<QByteArray>("result");
+
+    QTest::newRow("1") << QByteArray("%h %d \"%r\" %s %O%n") << QByteArray("127.0.0.1 2019-01-02 03:04:05 \"GET / HTTP/1.1\" 200 5120\n");
+    QTest::newRow("2") << QByteArray("%8O|%08O|%q|%Q") << QByteArray("    5120|00005120|3|12.045");
+    QTest::newRow("3") << QByteArray("%m %p") << QByteArray("%m %p");
+}
+
+
+void TestLogLayout::accessLog()
+{
+    QFETCH(QByteArray, layout);
+    QFETCH(QByteArray, result);
+
+    TAccessLog log("127.0.0.1", "GET / HTTP/1.1");
+    log.timestamp = QDateTime(QDate(2019, 1, 2), QTime(3, 4, 5));
+    log.statusCode = 200;
+    log.responseBytes = 5120;
+    log.queryCount = 3;
+    log.queryTime = 12045;
+
+    TLogLayout compiled(layout, "yyyy-MM-dd hh:mm:ss", TLogLayout::AccessLog);
+    QCOMPARE(compiled.format(log), result);
+    QCOMPARE(log.toByteArray(layout, "yyyy-MM-dd hh:mm:ss"), result);
+}
+
+
+void TestLogLayout::timestamp()
+{
+    TLog log(Tf::InfoLevel, "");
+    TLogLayout seconds("%d", "hh:mm:ss");
+    TLogLayout msecs("%d", "hh:mm:ss.zzz");
+
+    // Cached text must not be used for another second or another layout
+    log.timestamp = QDateTime(QDate(2019, 1, 2), QTime(3, 4, 5, 100));
+    QCOMPARE(seconds.format(log), QByteArray("03:04:05"));
+    QCOMPARE(msecs.format(log), QByteArray("03:04:05.100"));
+    log.timestamp = log.timestamp.addMSecs(200);
+    QCOMPARE(seconds.format(log), QByteArray("03:04:05"));
+    QCOMPARE(msecs.format(log), QByteArray("03:04:05.300"));
+    log.timestamp = log.timestamp.addSecs(1);
+    QCOMPARE(seconds.format(log), QByteArray("03:04:06"));
+}
+
+
+void TestLogLayout::traceId()
+{
+    TLogLayout layout("%c %C %m", "");
+    QCOMPARE(TLog(Tf::InfoLevel, "a").traceId, QByteArray());
+    QCOMPARE(layout.format(TLog(Tf::InfoLevel, "a")), QByteArray("- - a"));
+
+    TTraceContext::setCurrent(TTraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+    TLog log(Tf::InfoLevel, "b");
+    TTraceContext::clearCurrent();
+    QCOMPARE(log.traceId, QByteArray("4bf92f3577b34da6a3ce929d0e0e4736"));
+    QCOMPARE(log.spanId.length(), 16);
+    QCOMPARE(layout.format(log), "4bf92f3577b34da6a3ce929d0e0e4736 " + log.spanId + " b");
+
+    TAccessLog alog("127.0.0.1", "GET / HTTP/1.1");
+    alog.traceId = log.traceId;
+    TLogLayout accessLayout("%h %c", "", TLogLayout::AccessLog);
+    QCOMPARE(accessLayout.format(alog), QByteArray("127.0.0.1 4bf92f3577b34da6a3ce929d0e0e4736"));
+}
+
+
+void TestLogLayout::json()
+{
+    TLog log(Tf::ErrorLevel, "say \"hi\"\n\x01");
+    log.timestamp = QDateTime(QDate(2019, 1, 2), QTime(3, 4, 5));
+    log.threadId = 1234;
+    log.pid = 99;
+
+    TLogLayout layout("json", "yyyy-MM-dd hh:mm:ss");
+    QVERIFY(layout.isJson());
+    QCOMPARE(layout.format(log), QByteArray("{\"timestamp\":\"2019-01-02 03:04:05\",\"priority\":\"ERROR\",\"pid\":99,"
+                                            "\"thread_id\":1234,\"message\":\"say \\\"hi\\\"\\n\\u0001\"}\n"));
+
+    TAccessLog alog("127.0.0.1", "GET / HTTP/1.1");
+    alog.timestamp = log.timestamp;
+    alog.statusCode = 200;
+    alog.responseBytes = 5120;
+    alog.queryTime = 12045;
+    alog.traceId = "4bf92f3577b34da6a3ce929d0e0e4736";
+    alog.spanId = "00f067aa0ba902b7";
+
+    TLogLayout accessLayout("json", "yyyy-MM-dd hh:mm:ss", TLogLayout::AccessLog);
+    QCOMPARE(accessLayout.format(alog), QByteArray("{\"timestamp\":\"2019-01-02 03:04:05\",\"remote_host\":\"127.0.0.1\","
+                                                   "\"request\":\"GET / HTTP/1.1\",\"status\":200,\"bytes\":5120,"
+                                                   "\"query_count\":0,\"query_time_ms\":12.045,"
+                                                   "\"trace_id\":\"4bf92f3577b34da6a3ce929d0e0e4736\",\"span_id\":\"00f067aa0ba902b7\"}\n"));
+}
+
+
+void TestLogLayout::bench_accessLog()
+{
+    TAccessLog log("127.0.0.1", "GET /index.html HTTP/1.1");
+    log.timestamp = QDateTime::currentDateTime();
+    log.statusCode = 200;
+    log.responseBytes = 5120;
+    TLogLayout compiled("%h %d \"%r\" %s %O%n", "yyyy-MM-dd hh:mm:ss", TLogLayout::AccessLog);
+
+    QBENCHMARK {
+        compiled.format(log);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestLogLayout)
+#include "main.moc"
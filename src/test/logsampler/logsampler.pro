@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = logsampler
+SOURCES = main.cpp
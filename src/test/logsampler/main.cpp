@@ -0,0 +1,82 @@
+#include <QTest>
+#include "tglobal.h"
+#include "tlogsampler.h"
+
+
+class TestLogSampler : public QObject
+{
+    Q_OBJECT
+private slots:
+    void disabled();
+    void sampleRate();
+    void rateLimit();
+    void settings();
+};
+
+
+void TestLogSampler::disabled()
+{
+    TLogSampler sampler;
+    QVERIFY(!sampler.isEnabled());
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(sampler.sample());
+    }
+}
+
+
+void TestLogSampler::sampleRate()
+{
+    TLogSampler sampler;
+    sampler.setParameters(10, 0);
+    QVERIFY(sampler.isEnabled());
+
+    int count = 0;
+    for (int i = 0; i < 100; ++i) {
+        count += sampler.sample() ? 1 : 0;
+    }
+    QCOMPARE(count, 10);
+}
+
+
+void TestLogSampler::rateLimit()
+{
+    TLogSampler sampler;
+    sampler.setParameters(1, 3);
+    quint64 suppressed;
+
+    int count = 0;
+    for (int i = 0; i < 10; ++i) {
+        count += sampler.sample(100, &suppressed) ? 1 : 0;
+        QCOMPARE(suppressed, (quint64)0);
+    }
+    QCOMPARE(count, 3);
+
+    // The count is reported with the first log in the next second
+    QVERIFY(sampler.sample(101, &suppressed));
+    QCOMPARE(suppressed, (quint64)7);
+    QVERIFY(sampler.sample(101, &suppressed));
+    QCOMPARE(suppressed, (quint64)0);
+}
+
+
+void TestLogSampler::settings()
+{
+    QVariantMap settings;
+    settings.insert("FileLogger.SampleRate", 5);
+    settings.insert("FileLogger.RateLimit", 100);
+    settings.insert("FileLogger.Debug.SampleRate", 20);
+
+    TLogSampler sampler;
+    sampler.loadSettings(settings, "FileLogger.Debug", "FileLogger");
+    QCOMPARE(sampler.sampleRate(), 20);
+    QCOMPARE(sampler.rateLimit(), 100);
+
+    sampler.loadSettings(settings, "FileLogger.Info", "FileLogger");
+    QCOMPARE(sampler.sampleRate(), 5);
+
+    sampler.loadSettings(QVariantMap(), "QueryLog");
+    QVERIFY(!sampler.isEnabled());
+}
+
+QTEST_APPLESS_MAIN(TestLogSampler)
+#include "main.moc"
@@ -0,0 +1,207 @@
+#include <QTest>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSharedMemory>
+#include "tglobal.h"
+#include "tcachememorystore.h"
+#include <memory>
+
+const int SLOT_SIZE = 256;
+const int SET_WAYS = 8;
+const int HEADER_SIZE = 48;  // offset of the first set in the arena
+
+static qint64 now()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+
+static QString arenaKey(const char *name)
+{
+    return QString("TestMemoryCache_%1_%2").arg(QCoreApplication::applicationPid()).arg(name);
+}
+
+
+class TestMemoryCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void setAndGet_data();
+    void setAndGet();
+    void expire_data();
+    void expire();
+    void evictShared();
+    void evictLocal();
+    void attach();
+    void rejectIncompatible();
+    void takeOverLockOfDeadOwner();
+};
+
+
+static TCacheMemoryArena *createArena(bool shared, const char *name)
+{
+    // maxBytes of 1 makes the shared arena of a single set
+    return (shared) ? TCacheMemoryArena::createShared(arenaKey(name), 1, SLOT_SIZE) : TCacheMemoryArena::create(1024 * 1024, 4);
+}
+
+
+void TestMemoryCache::setAndGet_data()
+{
+    QTest::addColumn<bool>("shared");
+    QTest::newRow("local") << false;
+    QTest::newRow("shared") << true;
+}
+
+
+void TestMemoryCache::setAndGet()
+{
+    QFETCH(bool, shared);
+    std::unique_ptr<TCacheMemoryArena> arena(createArena(shared, "setAndGet"));
+    QVERIFY(arena);
+
+    QVERIFY(arena->get("foo").isNull());
+    QVERIFY(arena->set("foo", "bar", now() + 10000));
+    QCOMPARE(arena->get("foo"), QByteArray("bar"));
+    QVERIFY(arena->set("foo", "baz", now() + 10000));
+    QCOMPARE(arena->get("foo"), QByteArray("baz"));
+
+    QVERIFY(arena->remove("foo"));
+    QVERIFY(arena->get("foo").isNull());
+    QVERIFY(!arena->remove("foo"));
+
+    QVERIFY(arena->set("foo", "bar", now() + 10000));
+    arena->clear();
+    QVERIFY(arena->get("foo").isNull());
+
+    auto stats = arena->stats();
+    QCOMPARE(stats.value("sets").toLongLong(), 3LL);
+    QCOMPARE(stats.value("hits").toLongLong(), 2LL);
+    QCOMPARE(stats.value("items").toLongLong(), 0LL);
+}
+
+
+void TestMemoryCache::expire_data()
+{
+    setAndGet_data();
+}
+
+
+void TestMemoryCache::expire()
+{
+    QFETCH(bool, shared);
+    std::unique_ptr<TCacheMemoryArena> arena(createArena(shared, "expire"));
+    QVERIFY(arena);
+
+    QVERIFY(arena->set("short", "1", now() + 100));
+    QVERIFY(arena->set("long", "2", now() + 10000));
+    QTest::qSleep(200);
+
+    QVERIFY(arena->get("short").isNull());
+    QCOMPARE(arena->get("long"), QByteArray("2"));
+    QCOMPARE(arena->stats().value("expirations").toLongLong(), 1LL);
+
+    // Removed by gc
+    QVERIFY(arena->set("short", "1", now() + 100));
+    QTest::qSleep(200);
+    arena->gc();
+    QCOMPARE(arena->stats().value("items").toLongLong(), 1LL);
+}
+
+
+void TestMemoryCache::evictShared()
+{
+    std::unique_ptr<TCacheMemoryArena> arena(createArena(true, "evictShared"));
+    QVERIFY(arena);
+
+    // Larger than a slot
+    QVERIFY(!arena->set("big", QByteArray(SLOT_SIZE, 'x'), now() + 10000));
+
+    for (int i = 0; i < SET_WAYS; ++i) {
+        QVERIFY(arena->set("key" + QByteArray::number(i), "v", now() + 10000));
+    }
+
+    // CLOCK gives a second chance to the item referenced
+    QCOMPARE(arena->get("key0"), QByteArray("v"));
+    QVERIFY(arena->set("new", "v", now() + 10000));
+    QCOMPARE(arena->get("key0"), QByteArray("v"));
+    QVERIFY(arena->get("key1").isNull());
+    QCOMPARE(arena->get("new"), QByteArray("v"));
+
+    auto stats = arena->stats();
+    QCOMPARE(stats.value("evictions").toLongLong(), 1LL);
+    QCOMPARE(stats.value("items").toLongLong(), (qint64)SET_WAYS);
+}
+
+
+void TestMemoryCache::evictLocal()
+{
+    // 4 shards of 1KB
+    std::unique_ptr<TCacheMemoryArena> arena(TCacheMemoryArena::create(4096, 4));
+    const QByteArray value(100, 'x');
+
+    for (int i = 0; i < 200; ++i) {
+        arena->set("key" + QByteArray::number(i), value, now() + 10000);
+    }
+
+    auto stats = arena->stats();
+    QVERIFY(stats.value("evictions").toLongLong() > 0);
+    QVERIFY(stats.value("bytes").toLongLong() <= 4096);
+    QCOMPARE(arena->get("key199"), value);  // the last one is kept
+}
+
+
+void TestMemoryCache::attach()
+{
+    std::unique_ptr<TCacheMemoryArena> arena(createArena(true, "attach"));
+    std::unique_ptr<TCacheMemoryArena> other(createArena(true, "attach"));
+    QVERIFY(arena && other);
+
+    QVERIFY(arena->set("foo", "bar", now() + 10000));
+    QCOMPARE(other->get("foo"), QByteArray("bar"));
+
+    // Different slot size
+    std::unique_ptr<TCacheMemoryArena> mismatch(TCacheMemoryArena::createShared(arenaKey("attach"), 1, SLOT_SIZE * 2));
+    QVERIFY(!mismatch);
+}
+
+
+void TestMemoryCache::rejectIncompatible()
+{
+    QSharedMemory memory(arenaKey("incompatible"));
+    QVERIFY(memory.create(64 * 1024));
+
+    // Not initialized; rejected after waiting for the magic
+    QElapsedTimer timer;
+    timer.start();
+    std::unique_ptr<TCacheMemoryArena> arena(TCacheMemoryArena::createShared(arenaKey("incompatible"), 1, SLOT_SIZE));
+    QVERIFY(!arena);
+    QVERIFY(timer.elapsed() >= 1000);
+
+    // Other contents
+    memset(memory.data(), 0xff, memory.size());
+    arena.reset(TCacheMemoryArena::createShared(arenaKey("incompatible"), 1, SLOT_SIZE));
+    QVERIFY(!arena);
+}
+
+
+void TestMemoryCache::takeOverLockOfDeadOwner()
+{
+    std::unique_ptr<TCacheMemoryArena> arena(createArena(true, "deadOwner"));
+    QVERIFY(arena);
+    QVERIFY(arena->set("foo", "bar", now() + 10000));
+
+    // Locks the only set with a process ID that does not exist
+    QSharedMemory memory(arenaKey("deadOwner"));
+    QVERIFY(memory.attach());
+    const int deadPid = 4194305;  // over the max of pid_max
+    *reinterpret_cast<volatile int *>(static_cast<char *>(memory.data()) + HEADER_SIZE) = deadPid;
+
+    QCOMPARE(arena->get("foo"), QByteArray("bar"));
+    QVERIFY(arena->set("foo", "baz", now() + 10000));
+    QCOMPARE(arena->get("foo"), QByteArray("baz"));
+    QCOMPARE(*reinterpret_cast<volatile int *>(static_cast<char *>(memory.data()) + HEADER_SIZE), 0);
+}
+
+QTEST_APPLESS_MAIN(TestMemoryCache)
+#include "main.moc"
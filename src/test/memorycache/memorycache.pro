@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = memorycache
+SOURCES = main.cpp
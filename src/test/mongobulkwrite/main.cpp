@@ -0,0 +1,61 @@
+#include <QTest>
+#include "tglobal.h"
+#include "tmongobulkwrite.h"
+
+
+static QVariantMap reply(int inserted, const QList<int> &errorIndexes = QList<int>())
+{
+    QVariantList errors;
+    for (int index : errorIndexes) {
+        errors << QVariantMap({{"index", index}, {"code", 11000}, {"errmsg", "duplicate key"}});
+    }
+
+    QVariantMap map {{"nInserted", inserted}};
+    if (!errors.isEmpty()) {
+        map.insert("writeErrors", errors);
+    }
+    return map;
+}
+
+
+class TestMongoBulkWrite : public QObject
+{
+    Q_OBJECT
+private slots:
+    void failedIndexes_data();
+    void failedIndexes();
+};
+
+
+void TestMongoBulkWrite::failedIndexes_data()
+{
+    QTest::addColumn<QVariantMap>("reply");
+    QTest::addColumn<bool>("ordered");
+    QTest::addColumn<QList<int>>("expected");
+
+    // Ordered; stops at the first error
+    QTest::newRow("ordered error") << reply(2, {2}) << true << QList<int>({2, 3, 4});
+    QTest::newRow("ordered no writeErrors") << reply(3) << true << QList<int>({3, 4});
+    QTest::newRow("ordered nothing") << reply(0) << true << QList<int>({0, 1, 2, 3, 4});
+    QTest::newRow("ordered all") << reply(5) << true << QList<int>();
+
+    // Unordered; performs all
+    QTest::newRow("unordered errors") << reply(3, {1, 3}) << false << QList<int>({1, 3});
+    QTest::newRow("unordered out of range") << reply(4, {1, 9}) << false << QList<int>({1});
+    QTest::newRow("unordered no writeErrors") << reply(2) << false << QList<int>({0, 1, 2, 3, 4});
+    QTest::newRow("unordered nothing") << QVariantMap() << false << QList<int>({0, 1, 2, 3, 4});
+    QTest::newRow("unordered all") << reply(5) << false << QList<int>();
+}
+
+
+void TestMongoBulkWrite::failedIndexes()
+{
+    QFETCH(QVariantMap, reply);
+    QFETCH(bool, ordered);
+    QFETCH(QList<int>, expected);
+
+    QCOMPARE(TMongoBulkWrite::failedIndexes(reply, 5, ordered), expected);
+}
+
+QTEST_APPLESS_MAIN(TestMongoBulkWrite)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = mongobulkwrite
+SOURCES = main.cpp
@@ -0,0 +1,86 @@
+#include <QTest>
+#include "tglobal.h"
+#include "tpoolwaitqueue.h"
+#include <QStringList>
+#include <QThread>
+#include <thread>
+
+
+class TestPoolWaitQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void takeFirst();
+    void handOverInOrder();
+    void timeout();
+};
+
+
+void TestPoolWaitQueue::takeFirst()
+{
+    TPoolWaitQueue queue;
+    QString name;
+    bool cached;
+
+    // Takes an idle one without waiting if nobody is ahead
+    bool ret = queue.wait(1000, [](QString &n, bool &c) { n = "db1"; c = true; return true; }, name, cached);
+    QVERIFY(ret);
+    QCOMPARE(name, QString("db1"));
+    QVERIFY(!queue.hasWaiters());
+}
+
+
+void TestPoolWaitQueue::handOverInOrder()
+{
+    TPoolWaitQueue queue;
+    QMutex mutex;
+    QStringList received;  // "waiter:connection"
+    auto none = [](QString &, bool &) { return false; };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; ++i) {
+        threads.emplace_back([&, i]() {
+            QString name;
+            bool cached;
+            if (queue.wait(5000, none, name, cached)) {
+                QMutexLocker locker(&mutex);
+                received << QString::number(i) + ":" + name;
+            }
+        });
+
+        // Queues in the order of i
+        while (queue.statistics().waitingCount < i + 1) {
+            QThread::msleep(1);
+        }
+    }
+
+    bool pushed = false;
+    for (int i = 0; i < 3; ++i) {
+        queue.release("db" + QString::number(i), true, [&]() { pushed = true; });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    QVERIFY(!pushed);
+    received.sort();
+    QCOMPARE(received, QStringList({"0:db0", "1:db1", "2:db2"}));
+
+    // Returned to the pool when nobody is waiting
+    queue.release("db3", true, [&]() { pushed = true; });
+    QVERIFY(pushed);
+}
+
+
+void TestPoolWaitQueue::timeout()
+{
+    TPoolWaitQueue queue;
+    QString name;
+    bool cached;
+
+    QVERIFY(!queue.wait(50, [](QString &, bool &) { return false; }, name, cached));
+    QVERIFY(!queue.hasWaiters());
+}
+
+QTEST_APPLESS_MAIN(TestPoolWaitQueue)
+#include "main.moc"
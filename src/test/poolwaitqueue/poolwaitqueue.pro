@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = poolwaitqueue
+SOURCES = main.cpp
@@ -0,0 +1,304 @@
+#include <QTest>
+#include <QDebug>
+#include "tglobal.h"
+#include "tredisreply.h"
+
+
+static QByteArray bulk(const QByteArray &str)
+{
+    return "$" + QByteArray::number(str.length()) + "\r\n" + str + "\r\n";
+}
+
+// Generates a random reply and its expected value
+static QByteArray generate(int depth, QVariant &expected)
+{
+    int kind = Tf::random((depth < 3) ? 8 : 5);
+
+    switch (kind) {
+    case 0: {
+        QByteArray str = QByteArray::number((qulonglong)Tf::random(1000000), 36);
+        expected = str;
+        return "+" + str + "\r\n"; }
+
+    case 1: {
+        qint64 num = (qint64)Tf::random(2000000) - 1000000;
+        expected = num;
+        return ":" + QByteArray::number(num) + "\r\n"; }
+
+    case 2: {
+        QByteArray str(Tf::random(300), '\0');
+        for (auto &c : str) {
+            c = (char)Tf::random(255);  // including CR and LF
+        }
+        expected = str;
+        return bulk(str); }
+
+    case 3:
+        expected = QByteArray();
+        return "$-1\r\n";
+
+    case 4: {
+        bool b = Tf::random(1);
+        expected = b;
+        return (b) ? "#t\r\n" : "#f\r\n"; }
+
+    case 5:
+        expected = QByteArray("");
+        return "$0\r\n\r\n";
+
+    case 6: {
+        // Attribute followed by the reply
+        QVariant dummy;
+        QByteArray attr = "|1\r\n" + generate(depth + 1, dummy) + generate(depth + 1, dummy);
+        return attr + generate(depth, expected); }
+
+    default: {
+        int count = Tf::random(20);
+        QByteArray prefix = (kind == 7) ? "*" : "~";
+        QByteArray data = prefix + QByteArray::number(count) + "\r\n";
+        QVariantList list;
+        for (int i = 0; i < count; ++i) {
+            QVariant elem;
+            data += generate(depth + 1, elem);
+            list << elem;
+        }
+        expected = list;
+        return data; }
+    }
+}
+
+
+class TestRedisReply : public QObject
+{
+    Q_OBJECT
+private slots:
+    void parse_data();
+    void parse();
+    void partial_data();
+    void partial();
+    void pipeline();
+    void fuzz();
+    void fuzzMutation();
+    void bench_lrange();
+    void bench_lrange_variant();
+    void bench_lrange_chunked();
+};
+
+
+void TestRedisReply::parse_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QVariant>("value");
+
+    QTest::newRow("1") << QByteArray("+OK\r\n") << (int)TRedisReply::SimpleString << QVariant(QByteArray("OK"));
+    QTest::newRow("2") << QByteArray("-ERR unknown\r\n") << (int)TRedisReply::Error << QVariant();
+    QTest::newRow("3") << QByteArray(":-12345\r\n") << (int)TRedisReply::Integer << QVariant((qint64)-12345);
+    QTest::newRow("4") << QByteArray("$5\r\nhe\r\no\r\n") << (int)TRedisReply::BulkString << QVariant(QByteArray("he\r\no"));
+    QTest::newRow("5") << QByteArray("$-1\r\n") << (int)TRedisReply::BulkString << QVariant(QByteArray());
+    QTest::newRow("6") << QByteArray("*2\r\n$1\r\na\r\n:1\r\n") << (int)TRedisReply::Array << QVariant(QVariantList({QByteArray("a"), (qint64)1}));
+    QTest::newRow("7") << QByteArray("*-1\r\n") << (int)TRedisReply::Array << QVariant(QVariantList());
+    QTest::newRow("8") << QByteArray("*0\r\n") << (int)TRedisReply::Array << QVariant(QVariantList());
+    QTest::newRow("9") << QByteArray("*2\r\n*1\r\n+a\r\n*0\r\n") << (int)TRedisReply::Array << QVariant(QVariantList({QVariantList({QByteArray("a")}), QVariantList()}));
+    QTest::newRow("10") << QByteArray("_\r\n") << (int)TRedisReply::Null << QVariant();
+    QTest::newRow("11") << QByteArray("#t\r\n") << (int)TRedisReply::Boolean << QVariant(true);
+    QTest::newRow("12") << QByteArray(",1.5\r\n") << (int)TRedisReply::Double << QVariant(1.5);
+    QTest::newRow("13") << QByteArray("=8\r\ntxt:abcd\r\n") << (int)TRedisReply::VerbatimString << QVariant(QByteArray("abcd"));
+    QTest::newRow("14") << QByteArray("%1\r\n+k\r\n:2\r\n") << (int)TRedisReply::Map << QVariant(QVariantList({QByteArray("k"), (qint64)2}));
+    QTest::newRow("15") << QByteArray("|1\r\n+ttl\r\n:3\r\n$1\r\nv\r\n") << (int)TRedisReply::BulkString << QVariant(QByteArray("v"));
+    QTest::newRow("16") << QByteArray("*2\r\n|1\r\n+a\r\n+b\r\n:1\r\n:2\r\n") << (int)TRedisReply::Array << QVariant(QVariantList({(qint64)1, (qint64)2}));
+}
+
+
+void TestRedisReply::parse()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, type);
+    QFETCH(QVariant, value);
+
+    TRedisReplyParser parser;
+    parser.append(data);
+    QCOMPARE(parser.parse(), TRedisReplyParser::Completed);
+    TRedisReply reply = parser.takeReply();
+    QCOMPARE((int)reply.type(), type);
+    QCOMPARE(reply.toVariant(), value);
+    QVERIFY(!parser.hasPendingData());
+}
+
+
+void TestRedisReply::partial_data()
+{
+    parse_data();
+}
+
+
+void TestRedisReply::partial()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, type);
+    QFETCH(QVariant, value);
+
+    // Appends byte by byte
+    TRedisReplyParser parser;
+    for (int i = 0; i < data.length() - 1; ++i) {
+        parser.append(data.constData() + i, 1);
+        QCOMPARE(parser.parse(), TRedisReplyParser::Incomplete);
+    }
+    parser.append(data.constData() + data.length() - 1, 1);
+    QCOMPARE(parser.parse(), TRedisReplyParser::Completed);
+    TRedisReply reply = parser.takeReply();
+    QCOMPARE((int)reply.type(), type);
+    QCOMPARE(reply.toVariant(), value);
+}
+
+
+void TestRedisReply::pipeline()
+{
+    TRedisReplyParser parser;
+    QList<TRedisReply> replies;
+
+    parser.append("+OK\r\n:1\r\n$3\r\nfoo\r\n*2\r\n$1\r\na");
+    while (parser.parse() == TRedisReplyParser::Completed) {
+        replies << parser.takeReply();
+    }
+    QCOMPARE(replies.count(), 3);
+
+    parser.append("\r\n$1\r\nb\r\n");
+    QCOMPARE(parser.parse(), TRedisReplyParser::Completed);
+    replies << parser.takeReply();
+
+    // Replies taken before are valid after the buffer is compacted
+    QCOMPARE(replies[0].view(), QByteArray("OK"));
+    QCOMPARE(replies[1].toInteger(), (qint64)1);
+    QCOMPARE(replies[2].view(), QByteArray("foo"));
+    QCOMPARE(replies[3].toByteArrayList(), QByteArrayList({"a", "b"}));
+    QCOMPARE(replies[3].at(1).view(), QByteArray("b"));
+    QVERIFY(!replies[3].at(2).isValid());
+}
+
+
+void TestRedisReply::fuzz()
+{
+    for (int n = 0; n < 300; ++n) {
+        QByteArray data;
+        QVariantList expected;
+        int count = Tf::random(1, 10);
+        for (int i = 0; i < count; ++i) {
+            QVariant value;
+            data += generate(0, value);
+            expected << value;
+        }
+
+        // Appends in random chunks
+        TRedisReplyParser parser;
+        QVariantList actual;
+        int pos = 0;
+        while (pos < data.length()) {
+            int len = qMin((int)Tf::random(1, 64), data.length() - pos);
+            parser.append(data.constData() + pos, len);
+            pos += len;
+
+            TRedisReplyParser::Result res;
+            while ((res = parser.parse()) == TRedisReplyParser::Completed) {
+                actual << parser.takeReply().toVariant();
+            }
+            QCOMPARE(res, TRedisReplyParser::Incomplete);
+        }
+        QCOMPARE(actual, expected);
+    }
+}
+
+
+void TestRedisReply::fuzzMutation()
+{
+    // Never crashes nor reads out of the buffer for broken data
+    for (int n = 0; n < 3000; ++n) {
+        QVariant value;
+        QByteArray data = generate(0, value);
+        int mutations = Tf::random(1, 4);
+        for (int i = 0; i < mutations; ++i) {
+            int idx = Tf::random(data.length() - 1);
+            switch (Tf::random(2)) {
+            case 0:
+                data[idx] = (char)Tf::random(255);
+                break;
+            case 1:
+                data.truncate(idx);
+                break;
+            default:
+                data.insert(idx, "\r\n*9\r\n$99\r\n", Tf::random(1, 11));
+                break;
+            }
+            if (data.isEmpty()) {
+                break;
+            }
+        }
+
+        TRedisReplyParser parser;
+        parser.append(data);
+        while (parser.parse() == TRedisReplyParser::Completed) {
+            TRedisReply reply = parser.takeReply();
+            reply.toVariant();
+        }
+    }
+}
+
+
+static QByteArray lrangeReply(int count, int size)
+{
+    QByteArray data = "*" + QByteArray::number(count) + "\r\n";
+    for (int i = 0; i < count; ++i) {
+        data += bulk(QByteArray(size, 'a' + i % 26));
+    }
+    return data;
+}
+
+
+void TestRedisReply::bench_lrange()
+{
+    QByteArray data = lrangeReply(10000, 100);
+    TRedisReplyParser parser;
+
+    QBENCHMARK {
+        parser.append(data);
+        parser.parse();
+        TRedisReply reply = parser.takeReply();
+        qint64 total = 0;
+        for (const auto &elem : reply) {
+            total += elem.view().length();
+        }
+        QCOMPARE(total, (qint64)10000 * 100);
+    }
+}
+
+
+void TestRedisReply::bench_lrange_variant()
+{
+    QByteArray data = lrangeReply(10000, 100);
+    TRedisReplyParser parser;
+
+    QBENCHMARK {
+        parser.append(data);
+        parser.parse();
+        QVariantList list = parser.takeReply().toVariantList();
+        QCOMPARE(list.count(), 10000);
+    }
+}
+
+
+void TestRedisReply::bench_lrange_chunked()
+{
+    QByteArray data = lrangeReply(10000, 100);
+    TRedisReplyParser parser;
+
+    QBENCHMARK {
+        for (int pos = 0; pos < data.length(); pos += 1460) {
+            parser.append(data.constData() + pos, qMin(1460, data.length() - pos));
+            parser.parse();
+        }
+        QCOMPARE(parser.takeReply().count(), 10000);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestRedisReply)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = redisreply
+SOURCES = main.cpp
@@ -0,0 +1,45 @@
+#include <QTest>
+#include "tglobal.h"
+#include "tredissubscriber.h"
+
+
+class TestRedisSubscriber : public QObject
+{
+    Q_OBJECT
+private slots:
+    void setupCommands_data();
+    void setupCommands();
+};
+
+
+void TestRedisSubscriber::setupCommands_data()
+{
+    QTest::addColumn<QVariantMap>("settings");
+    QTest::addColumn<QList<QByteArrayList>>("expected");
+
+    QTest::newRow("none") << QVariantMap() << QList<QByteArrayList>();
+    QTest::newRow("password")
+        << QVariantMap({{"Password", "secret"}})
+        << QList<QByteArrayList>({{"AUTH", "secret"}});
+    QTest::newRow("user")
+        << QVariantMap({{"UserName", "app"}, {"Password", " secret "}})
+        << QList<QByteArrayList>({{"AUTH", "app", "secret"}});
+    QTest::newRow("user only")
+        << QVariantMap({{"UserName", "app"}})
+        << QList<QByteArrayList>();
+    QTest::newRow("statements")
+        << QVariantMap({{"Password", "secret"}, {"PostOpenStatements", "SELECT 2;  CLIENT  SETNAME  sub ;"}})
+        << QList<QByteArrayList>({{"AUTH", "secret"}, {"SELECT", "2"}, {"CLIENT", "SETNAME", "sub"}});
+}
+
+
+void TestRedisSubscriber::setupCommands()
+{
+    QFETCH(QVariantMap, settings);
+    QFETCH(QList<QByteArrayList>, expected);
+
+    QCOMPARE(TRedisSubscriber::setupCommands(settings), expected);
+}
+
+QTEST_APPLESS_MAIN(TestRedisSubscriber)
+#include "main.moc"
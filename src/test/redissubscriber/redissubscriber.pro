@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = redissubscriber
+SOURCES = main.cpp
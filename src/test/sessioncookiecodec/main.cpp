@@ -0,0 +1,228 @@
+#include <QTest>
+#include <QByteArray>
+#include <QDateTime>
+#include <tsessioncookiecodec.h>
+#include <tcryptaead.h>
+
+using Key = TSessionCookieCodec::Key;
+
+static const Key oldKey = qMakePair((uchar)1, QByteArray(32, '\x11'));
+static const Key newKey = qMakePair((uchar)2, QByteArray(32, '\x22'));
+static const QByteArray nonce(TCryptAead::NonceLength, '\x07');
+static const qint64 issued = 1500000000;
+
+
+static QByteArray noise(int length)
+{
+    QByteArray bytes(length, '\0');
+    quint32 x = 12345;
+    for (int i = 0; i < length; ++i) {
+        x = x * 1103515245 + 12345;
+        bytes[i] = (char)(x >> 16);
+    }
+    return bytes;
+}
+
+
+class TestSessionCookieCodec : public QObject
+{
+    Q_OBJECT
+private slots:
+    void varint_data();
+    void varint();
+    void roundTrip_data();
+    void roundTrip();
+    void compression();
+    void keyRotation();
+    void expiry();
+    void maxSize();
+    void tamper();
+};
+
+
+void TestSessionCookieCodec::varint_data()
+{
+    QTest::addColumn<quint64>("value");
+    QTest::addColumn<int>("length");
+
+    QTest::newRow("1") << (quint64)0 << 1;
+    QTest::newRow("2") << (quint64)127 << 1;
+    QTest::newRow("3") << (quint64)128 << 2;
+    QTest::newRow("4") << (quint64)16383 << 2;
+    QTest::newRow("5") << (quint64)16384 << 3;
+    QTest::newRow("6") << (quint64)0xffffffffULL << 5;
+    QTest::newRow("7") << (quint64)0xffffffffffffffffULL << 10;
+}
+
+
+void TestSessionCookieCodec::varint()
+{
+    QFETCH(quint64, value);
+    QFETCH(int, length);
+
+    QByteArray out;
+    TSessionCookieCodec::writeVarint(out, value);
+    QCOMPARE(out.length(), length);
+
+    const char *p = out.constData();
+    quint64 n;
+    QVERIFY(TSessionCookieCodec::readVarint(p, out.constData() + out.length(), n));
+    QCOMPARE(n, value);
+    QCOMPARE(p, out.constData() + out.length());
+
+    // Truncated
+    p = out.constData();
+    QVERIFY(!TSessionCookieCodec::readVarint(p, out.constData() + out.length() - 1, n));
+}
+
+
+void TestSessionCookieCodec::roundTrip_data()
+{
+    QTest::addColumn<QVariantMap>("data");
+    QTest::addColumn<int>("threshold");
+
+    QVariantMap map {
+        {"null", QVariant()},
+        {"bool", true},
+        {"int", -12345},
+        {"long", Q_INT64_C(-9876543210)},
+        {"double", 3.25},
+        {"string", QString::fromUtf8("日本語")},
+        {"bytes", QByteArray("\x00\xff", 2)},
+        {"list", QVariantList {1, "a", QVariantList {2.5}}},
+        {"map", QVariantMap {{"x", 1}, {"y", QVariantMap {{"z", "w"}}}}},
+        {"datetime", QDateTime::fromMSecsSinceEpoch(Q_INT64_C(1500000000123))},
+    };
+
+    QTest::newRow("empty") << QVariantMap() << 0;
+    QTest::newRow("types") << map << 0;
+    QTest::newRow("types-lz4") << map << 1;
+    QTest::newRow("large-lz4") << QVariantMap {{"text", QString(2000, 'a')}} << 256;
+}
+
+
+void TestSessionCookieCodec::roundTrip()
+{
+    QFETCH(QVariantMap, data);
+    QFETCH(int, threshold);
+
+    TSessionCookieCodec codec({ newKey }, "TFSESSION");
+    codec.setCompressionThreshold(threshold);
+
+    QByteArray cookie = codec.encode(data, issued, nonce);
+    QVERIFY(TSessionCookieCodec::isEncrypted(cookie));
+
+    QVariantMap decoded;
+    QVERIFY(codec.decode(cookie, decoded, issued));
+    QCOMPARE(decoded, data);
+}
+
+
+void TestSessionCookieCodec::compression()
+{
+    QVariantMap data {{"text", QString(2000, 'a')}};
+
+    TSessionCookieCodec plain({ newKey });
+    plain.setCompressionThreshold(0);
+    TSessionCookieCodec lz4({ newKey });
+    lz4.setCompressionThreshold(256);
+
+    QByteArray plainCookie = plain.encode(data, issued, nonce);
+    QByteArray lz4Cookie = lz4.encode(data, issued, nonce);
+    QVERIFY(lz4Cookie.length() < plainCookie.length() / 4);
+
+    // Either is decoded by the flag it carries
+    QVariantMap decoded;
+    QVERIFY(plain.decode(lz4Cookie, decoded, issued));
+    QCOMPARE(decoded, data);
+    QVERIFY(lz4.decode(plainCookie, decoded, issued));
+    QCOMPARE(decoded, data);
+
+    // Incompressible data is stored as is
+    QVariantMap random {{"bytes", noise(1000)}};
+    QVERIFY(lz4.decode(lz4.encode(random, issued, nonce), decoded, issued));
+    QCOMPARE(decoded, random);
+}
+
+
+void TestSessionCookieCodec::keyRotation()
+{
+    QVariantMap data {{"user", "alice"}};
+    TSessionCookieCodec oldCodec({ oldKey });
+    TSessionCookieCodec newCodec({ newKey, oldKey });
+    QVariantMap decoded;
+
+    // The old key still decrypts
+    QByteArray oldCookie = oldCodec.encode(data, issued, nonce);
+    QVERIFY(newCodec.decode(oldCookie, decoded, issued));
+    QCOMPARE(decoded, data);
+
+    // The new key encrypts
+    QByteArray newCookie = newCodec.encode(data, issued, nonce);
+    QByteArray raw = QByteArray::fromBase64(newCookie.mid(2), QByteArray::Base64UrlEncoding);
+    QCOMPARE((uchar)raw.at(0), newKey.first);
+    QVERIFY(!oldCodec.decode(newCookie, decoded, issued));
+
+    // A retired key no longer decrypts
+    TSessionCookieCodec retired({ newKey });
+    QVERIFY(!retired.decode(oldCookie, decoded, issued));
+}
+
+
+void TestSessionCookieCodec::expiry()
+{
+    QVariantMap data {{"user", "alice"}};
+    TSessionCookieCodec codec({ newKey });
+    codec.setLifeTime(60);
+    QByteArray cookie = codec.encode(data, issued, nonce);
+    QVariantMap decoded;
+
+    QVERIFY(codec.decode(cookie, decoded, issued));
+    QVERIFY(codec.decode(cookie, decoded, issued + 60));
+    QVERIFY(!codec.decode(cookie, decoded, issued + 61));
+
+    // No lifetime
+    TSessionCookieCodec unlimited({ newKey });
+    QVERIFY(unlimited.decode(cookie, decoded, issued + 3600 * 24 * 365));
+}
+
+
+void TestSessionCookieCodec::maxSize()
+{
+    TSessionCookieCodec codec({ newKey });
+    codec.setMaxSize(200);
+
+    QByteArray small = codec.encode(QVariantMap {{"a", 1}}, issued, nonce);
+    QByteArray large = codec.encode(QVariantMap {{"bytes", noise(1000)}}, issued, nonce);
+    QVERIFY(small.length() <= 200);
+    QVERIFY(!codec.exceedsMaxSize(small));
+    QVERIFY(large.length() > 200);
+    QVERIFY(codec.exceedsMaxSize(large));
+
+    codec.setMaxSize(0);  // unlimited
+    QVERIFY(!codec.exceedsMaxSize(large));
+}
+
+
+void TestSessionCookieCodec::tamper()
+{
+    TSessionCookieCodec codec({ newKey }, "TFSESSION");
+    QByteArray cookie = codec.encode(QVariantMap {{"user", "alice"}}, issued, nonce);
+    QVariantMap decoded;
+
+    // The last character may carry only padding bits
+    for (int i = 2; i < cookie.length() - 1; ++i) {
+        QByteArray broken = cookie;
+        broken[i] = (broken[i] == 'A') ? 'B' : 'A';
+        QVERIFY(!codec.decode(broken, decoded, issued));
+    }
+
+    // Other cookie name
+    TSessionCookieCodec other({ newKey }, "OTHER");
+    QVERIFY(!other.decode(cookie, decoded, issued));
+    QVERIFY(!codec.decode("1.", decoded, issued));
+    QVERIFY(!codec.decode("abc_def", decoded, issued));
+}
+
+QTEST_APPLESS_MAIN(TestSessionCookieCodec)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = sessioncookiecodec
+SOURCES = main.cpp
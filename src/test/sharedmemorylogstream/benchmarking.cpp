@@ -6,11 +6,28 @@
 #include "tfileaiologger.h"
 #include "tfileaiowriter.h"
 
+// Keeps the logs written
+class MemoryLogger : public TLogger
+{
+public:
+    QString key() const override { return "MemoryLogger"; }
+    bool isMultiProcessSafe() const override { return false; }
+    bool open() override { return true; }
+    void close() override { }
+    bool isOpen() const override { return true; }
+    void log(const TLog &log) override { logs << log.message; }
+
+    QList<QByteArray> logs;
+};
+
 
 class BenchMark : public QObject
 {
     Q_OBJECT
 private slots:
+    void wraparound();
+    void overflowDrop();
+    void overflowBlock();
     void systemDebug();
     void smemNonBufferingWriteLog();
     void smemWriteLog();
@@ -23,6 +40,75 @@ private slots:
 };
 
 
+void BenchMark::wraparound()
+{
+    MemoryLogger logger;
+    TSharedMemoryLogStream stream({ &logger }, 2048);
+    QList<QByteArray> expected;
+
+    // Laps the buffer many times, with records of various lengths
+    for (int i = 0; i < 500; ++i) {
+        QByteArray msg = QByteArray::number(i) + ':' + QByteArray(i % 97, 'x');
+        stream.writeLog(TLog(Tf::InfoLevel, msg));
+        expected << msg;
+        if (i % 7 == 6) {
+            stream.flush();
+        }
+    }
+    stream.flush();
+    QCOMPARE(logger.logs, expected);
+}
+
+
+void BenchMark::overflowDrop()
+{
+    MemoryLogger logger;
+    TSharedMemoryLogStream stream({ &logger }, 2048);
+    QCOMPARE(stream.overflowPolicy(), TSharedMemoryLogStream::Drop);
+
+    const quint64 dropped = stream.droppedCount();
+    const quint64 blocked = stream.blockedCount();
+    const int count = 200;
+    for (int i = 0; i < count; ++i) {
+        stream.writeLog(TLog(Tf::InfoLevel, QByteArray(64, 'd')));
+    }
+    stream.flush();
+
+    // Logs which did not fit were dropped, not waited for
+    QVERIFY(stream.droppedCount() > dropped);
+    QCOMPARE(stream.blockedCount(), blocked);
+    QCOMPARE((quint64)logger.logs.count() + stream.droppedCount() - dropped, (quint64)count);
+
+    // Writes again after drained
+    logger.logs.clear();
+    stream.writeLog(TLog(Tf::InfoLevel, "after"));
+    stream.flush();
+    QCOMPARE(logger.logs, QList<QByteArray>() << "after");
+}
+
+
+void BenchMark::overflowBlock()
+{
+    MemoryLogger logger;
+    TSharedMemoryLogStream stream({ &logger }, 2048);
+    stream.setOverflowPolicy(TSharedMemoryLogStream::Block);
+
+    const quint64 dropped = stream.droppedCount();
+    const quint64 blocked = stream.blockedCount();
+    const int count = 200;
+    for (int i = 0; i < count; ++i) {
+        stream.writeLog(TLog(Tf::InfoLevel, QByteArray::number(i)));
+    }
+    stream.flush();
+
+    // Writers drained the buffer instead of dropping
+    QVERIFY(stream.blockedCount() > blocked);
+    QCOMPARE(stream.droppedCount(), dropped);
+    QCOMPARE(logger.logs.count(), count);
+    QCOMPARE(logger.logs.last(), QByteArray::number(count - 1));
+}
+
+
 void BenchMark::systemDebug()
 {
     Tf::setupSystemLogger();
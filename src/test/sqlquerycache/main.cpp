@@ -0,0 +1,57 @@
+#include <QTest>
+#include "tglobal.h"
+#include <TSqlQueryCache>
+
+static const QString query("SELECT * FROM blog WHERE id = ?");
+
+
+static QByteArray key(const QVariantList &values)
+{
+    return TSqlQueryCache::key(query, values, QStringList(), 0);
+}
+
+
+class TestSqlQueryCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sameKey();
+    void distinctKeys_data();
+    void distinctKeys();
+};
+
+
+void TestSqlQueryCache::sameKey()
+{
+    QCOMPARE(key({1, "abc"}), key({1, "abc"}));
+    QVERIFY(key({1}).startsWith("tfqc:"));
+
+    // Whitespaces are normalized
+    QCOMPARE(TSqlQueryCache::key("SELECT *\n  FROM blog WHERE id = ?", {1}, QStringList(), 0), key({1}));
+}
+
+
+void TestSqlQueryCache::distinctKeys_data()
+{
+    QTest::addColumn<QVariant>("value1");
+    QTest::addColumn<QVariant>("value2");
+
+    // Same string forms
+    QTest::newRow("blob") << QVariant(QByteArray("\xff", 1)) << QVariant(QByteArray("\xfe", 1));
+    QTest::newRow("blob-nul") << QVariant(QByteArray("a\0b", 3)) << QVariant(QByteArray("a\0c", 3));
+    QTest::newRow("null") << QVariant(QVariant::String) << QVariant(QString(""));
+    QTest::newRow("list") << QVariant(QVariantList {1, 2}) << QVariant(QVariantList {3});
+    QTest::newRow("type") << QVariant(1) << QVariant(QString("1"));
+}
+
+
+void TestSqlQueryCache::distinctKeys()
+{
+    QFETCH(QVariant, value1);
+    QFETCH(QVariant, value2);
+
+    QVERIFY(key({value1}) != key({value2}));
+}
+
+QTEST_APPLESS_MAIN(TestSqlQueryCache)
+#include "main.moc"
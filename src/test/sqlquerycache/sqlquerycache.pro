@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = sqlquerycache
+SOURCES = main.cpp
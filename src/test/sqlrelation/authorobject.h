@@ -0,0 +1,38 @@
+#ifndef AUTHOROBJECT_H
+#define AUTHOROBJECT_H
+
+#include <TSqlObject>
+#include <TSqlRelation>
+#include <QSharedData>
+
+class BookObject;
+
+
+class AuthorObject : public TSqlObject, public QSharedData
+{
+public:
+    int id {0};
+    QString name;
+
+    enum PropertyIndex {
+        Id = 0,
+        Name,
+    };
+
+    int primaryKeyIndex() const { return Id; }
+    int autoValueIndex() const { return Id; }
+    QString tableName() const { return QStringLiteral("author"); }
+
+    // Relations
+    template <class C = BookObject>
+    static TSqlRelation<C> booksRelation() { return TSqlRelation<C>("books", TSql::HasMany, Id, C::AuthorId); }
+
+private:    /*** Don't modify below this line ***/
+    Q_OBJECT
+    Q_PROPERTY(int id READ getid WRITE setid)
+    T_DEFINE_PROPERTY(int, id)
+    Q_PROPERTY(QString name READ getname WRITE setname)
+    T_DEFINE_PROPERTY(QString, name)
+};
+
+#endif // AUTHOROBJECT_H
@@ -0,0 +1,42 @@
+#ifndef BOOKOBJECT_H
+#define BOOKOBJECT_H
+
+#include <TSqlObject>
+#include <TSqlRelation>
+#include <QSharedData>
+
+class AuthorObject;
+
+
+class BookObject : public TSqlObject, public QSharedData
+{
+public:
+    int id {0};
+    int author_id {0};
+    QString title;
+
+    enum PropertyIndex {
+        Id = 0,
+        AuthorId,
+        Title,
+    };
+
+    int primaryKeyIndex() const { return Id; }
+    int autoValueIndex() const { return Id; }
+    QString tableName() const { return QStringLiteral("book"); }
+
+    // Relations
+    template <class C = AuthorObject>
+    static TSqlRelation<C> authorRelation() { return TSqlRelation<C>("author", TSql::BelongsTo, AuthorId, C::Id); }
+
+private:    /*** Don't modify below this line ***/
+    Q_OBJECT
+    Q_PROPERTY(int id READ getid WRITE setid)
+    T_DEFINE_PROPERTY(int, id)
+    Q_PROPERTY(int author_id READ getauthor_id WRITE setauthor_id)
+    T_DEFINE_PROPERTY(int, author_id)
+    Q_PROPERTY(QString title READ gettitle WRITE settitle)
+    T_DEFINE_PROPERTY(QString, title)
+};
+
+#endif // BOOKOBJECT_H
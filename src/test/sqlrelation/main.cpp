@@ -0,0 +1,90 @@
+#include <TfTest/TfTest>
+#include <TSqlORMapper>
+#include "authorobject.h"
+#include "bookobject.h"
+
+const int NUM_AUTHORS = 1200;  // more than a query can take in an IN list
+
+
+class TestSqlRelation : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void belongsTo();
+    void hasMany();
+    void noRelatedObjects();
+};
+
+
+void TestSqlRelation::initTestCase()
+{
+    QSqlQuery query(Tf::currentSqlDatabase(0));
+    QVERIFY(query.exec("CREATE TABLE author (id INTEGER PRIMARY KEY, name TEXT)"));
+    QVERIFY(query.exec("CREATE TABLE book (id INTEGER PRIMARY KEY, author_id INTEGER, title TEXT)"));
+
+    // Author n has n % 3 books; the last author has none
+    QVERIFY(query.prepare("INSERT INTO author (id, name) VALUES (?, ?)"));
+    for (int i = 1; i <= NUM_AUTHORS; ++i) {
+        query.addBindValue(i);
+        query.addBindValue(QString("author%1").arg(i));
+        QVERIFY(query.exec());
+    }
+
+    QVERIFY(query.prepare("INSERT INTO book (author_id, title) VALUES (?, ?)"));
+    for (int i = 1; i < NUM_AUTHORS; ++i) {
+        for (int j = 0; j < i % 3; ++j) {
+            query.addBindValue(i);
+            query.addBindValue(QString("book%1-%2").arg(i).arg(j));
+            QVERIFY(query.exec());
+        }
+    }
+}
+
+
+void TestSqlRelation::belongsTo()
+{
+    TSqlORMapper<BookObject> mapper;
+    mapper.with(BookObject::authorRelation()).find();
+    QVERIFY(mapper.rowCount() > 999);
+
+    for (const auto &book : mapper) {
+        QVERIFY(book.isRelationLoaded("author"));
+        auto author = book.relatedObject<AuthorObject>("author");
+        QCOMPARE(author.id, book.author_id);
+        QCOMPARE(author.name, QString("author%1").arg(book.author_id));
+    }
+}
+
+
+void TestSqlRelation::hasMany()
+{
+    TSqlORMapper<AuthorObject> mapper;
+    mapper.with(AuthorObject::booksRelation()).find();
+    QCOMPARE(mapper.rowCount(), NUM_AUTHORS);
+
+    int count = 0;
+    for (const auto &author : mapper) {
+        auto books = author.relatedObjects<BookObject>("books");
+        QCOMPARE(books.count(), (author.id < NUM_AUTHORS) ? author.id % 3 : 0);
+        for (auto &book : books) {
+            QCOMPARE(book.author_id, author.id);
+            QVERIFY(book.title.startsWith(QString("book%1-").arg(author.id)));
+        }
+        count += books.count();
+    }
+    QCOMPARE(count, TSqlORMapper<BookObject>().findCount());
+}
+
+
+void TestSqlRelation::noRelatedObjects()
+{
+    TSqlORMapper<AuthorObject> mapper;
+    AuthorObject author = mapper.with(AuthorObject::booksRelation()).findFirst(TCriteria(AuthorObject::Id, NUM_AUTHORS));
+    QCOMPARE(author.id, NUM_AUTHORS);
+    QVERIFY(author.isRelationLoaded("books"));
+    QVERIFY(author.relatedObjects<BookObject>("books").isEmpty());
+}
+
+TF_TEST_MAIN(TestSqlRelation)
+#include "main.moc"
@@ -0,0 +1,4 @@
+include(../test.pri)
+TARGET = sqlrelation
+SOURCES = main.cpp
+HEADERS = authorobject.h bookobject.h
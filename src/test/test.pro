@@ -4,7 +4,8 @@ SUBDIRS  = htmlescape httpheader hmac htmlparser
 SUBDIRS += mailmessage multipartformdata  smtpmailer viewhelper paginator
 SUBDIRS += fieldnametovariablename rand urlrouter urlrouter2
 SUBDIRS += sharedmemorylogstream buildtest stack queue forlist
-SUBDIRS += jscontext compression sqlitedb
+SUBDIRS += jscontext compression sqlitedb redisreply cryptaead loglayout accesslogcodec tracecontext logsampler poolwaitqueue sessioncookiecodec sqlquerycache keysetpaginator sqlrelation memorycache redissubscriber mongobulkwrite
+unix:SUBDIRS += fileaiowriter
 
 fwtests.target = test
 fwtests.commands = make check
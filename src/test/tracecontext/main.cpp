@@ -0,0 +1,85 @@
+#include <QTest>
+#include "tglobal.h"
+#include <TTraceContext>
+
+
+class TestTraceContext : public QObject
+{
+    Q_OBJECT
+private slots:
+    void fromTraceParent();
+    void invalidTraceParent_data();
+    void invalidTraceParent();
+    void generate();
+    void current();
+};
+
+
+void TestTraceContext::fromTraceParent()
+{
+    TTraceContext context = TTraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+    QVERIFY(context.isValid());
+    QVERIFY(context.isSampled());
+    QCOMPARE(context.traceId(), QByteArray("4bf92f3577b34da6a3ce929d0e0e4736"));
+    QCOMPARE(context.parentId(), QByteArray("00f067aa0ba902b7"));
+    QCOMPARE(context.spanId().length(), 16);
+    QVERIFY(context.spanId() != context.parentId());
+    QCOMPARE(context.toTraceParent(), "00-4bf92f3577b34da6a3ce929d0e0e4736-" + context.spanId() + "-01");
+
+    // Future versions may have more fields
+    context = TTraceContext::fromTraceParent("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00-foo");
+    QCOMPARE(context.traceId(), QByteArray("4bf92f3577b34da6a3ce929d0e0e4736"));
+    QVERIFY(!context.isSampled());
+}
+
+
+void TestTraceContext::invalidTraceParent_data()
+{
+    QTest::addColumn<QByteArray>("traceParent");
+
+    QTest::newRow("empty") << QByteArray("");
+    QTest::newRow("version ff") << QByteArray("ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+    QTest::newRow("upper case") << QByteArray("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01");
+    QTest::newRow("zero trace") << QByteArray("00-00000000000000000000000000000000-00f067aa0ba902b7-01");
+    QTest::newRow("zero parent") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01");
+    QTest::newRow("short") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e473-00f067aa0ba902b7-01");
+    QTest::newRow("extra field") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-00");
+}
+
+
+void TestTraceContext::invalidTraceParent()
+{
+    QFETCH(QByteArray, traceParent);
+
+    // A new trace begins
+    TTraceContext context = TTraceContext::fromTraceParent(traceParent);
+    QVERIFY(context.isValid());
+    QVERIFY(context.parentId().isEmpty());
+    QVERIFY(context.traceId() != "4bf92f3577b34da6a3ce929d0e0e4736");
+}
+
+
+void TestTraceContext::generate()
+{
+    TTraceContext c1 = TTraceContext::generate();
+    TTraceContext c2 = TTraceContext::generate();
+    QCOMPARE(c1.traceId().length(), 32);
+    QCOMPARE(c1.spanId().length(), 16);
+    QVERIFY(c1.traceId() != c2.traceId());
+    QCOMPARE(TTraceContext::fromTraceParent(c1.toTraceParent()).traceId(), c1.traceId());
+}
+
+
+void TestTraceContext::current()
+{
+    QVERIFY(!TTraceContext::current().isValid());
+    TTraceContext context = TTraceContext::generate();
+    TTraceContext::setCurrent(context);
+    QCOMPARE(TTraceContext::current().traceId(), context.traceId());
+    TTraceContext::clearCurrent();
+    QVERIFY(!TTraceContext::current().isValid());
+    QVERIFY(TTraceContext::current().toTraceParent().isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestTraceContext)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = tracecontext
+SOURCES = main.cpp
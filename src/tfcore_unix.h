@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <aio.h>
 #ifdef Q_OS_DARWIN
@@ -24,6 +25,22 @@ inline int tf_aio_write(struct aiocb *aiocbp)
 }
 
 
+inline int tf_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    TF_EINTR_LOOP(::writev(fd, iov, iovcnt));
+}
+
+
+inline int tf_fdatasync(int fd)
+{
+#if defined(Q_OS_DARWIN)
+    TF_EINTR_LOOP(::fsync(fd));
+#else
+    TF_EINTR_LOOP(::fdatasync(fd));
+#endif
+}
+
+
 inline pid_t tf_gettid()
 {
 #if defined(Q_OS_LINUX)
@@ -70,3 +70,13 @@ void TFileAioLogger::setFileName(const QString &name)
 {
     writer->setFileName(name);
 }
+
+/*!
+  Sets the \a handler which returns the data written at the beginning of
+  a new log file when the file is rotated; it is passed the first of the
+  logs following them.
+*/
+void TFileAioLogger::setRotationHandler(const std::function<QByteArray(const QByteArray &)> &handler)
+{
+    writer->setRotationHandler(handler);
+}
@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <TLogger>
+#include <functional>
 
 class TFileAioWriter;
 
@@ -22,6 +23,7 @@ public:
     void log(const QByteArray &msg);
     void flush();
     void setFileName(const QString &name);
+    void setRotationHandler(const std::function<QByteArray(const QByteArray &)> &handler);
 
 private:
     TFileAioWriter *writer {nullptr};
@@ -6,9 +6,39 @@
  */
 
 #include "tfileaiowriter.h"
+#include <QMutex>
+#include <QMutexLocker>
 
 /*!
   \class TFileAioWriter
   \brief The TFileAioWriter class provides asynchronous writing functionality
   to a file.
+
+  On Unix, written data are queued and a dedicated thread appends them to
+  the file in batches with writev(); the thread also syncs and rotates
+  the file according to the options.
+*/
+
+namespace {
+    QMutex optionsMutex;
+    TFileAioWriter::Options options;
+}
+
+/*!
+  Returns the options applied to writers when they are opened.
+*/
+TFileAioWriter::Options TFileAioWriter::defaultOptions()
+{
+    QMutexLocker locker(&optionsMutex);
+    return options;
+}
+
+/*!
+  Sets the options applied to writers when they are opened to \a opts.
+  The sync and rotation options are not supported on Windows.
 */
+void TFileAioWriter::setDefaultOptions(const Options &opts)
+{
+    QMutexLocker locker(&optionsMutex);
+    options = opts;
+}
@@ -1,8 +1,10 @@
 #ifndef TFILEAIOWRITER_H
 #define TFILEAIOWRITER_H
 
+#include <QByteArray>
 #include <QString>
 #include <TGlobal>
+#include <functional>
 
 class TFileAioWriterData;
 
@@ -10,6 +12,26 @@ class TFileAioWriterData;
 class T_CORE_EXPORT TFileAioWriter
 {
 public:
+    enum SyncPolicy {
+        NoSync = 0,    // leaves it to the OS
+        SyncInterval,  // syncs at most once per interval
+        SyncAlways,    // syncs after each batch
+    };
+
+    enum RotationPeriod {
+        NoRotation = 0,
+        Hourly,
+        Daily,
+    };
+
+    struct Options {
+        int maxBufferSize {8 * 1024 * 1024};  // bytes queued before writers wait
+        SyncPolicy syncPolicy {NoSync};
+        int syncInterval {1000};  // msecs
+        qint64 rotationSize {0};  // bytes, 0 means no rotation by size
+        RotationPeriod rotationPeriod {NoRotation};
+    };
+
     TFileAioWriter(const QString &name = QString());
     ~TFileAioWriter();
 
@@ -20,6 +42,10 @@ public:
     void flush();
     void setFileName(const QString &name);
     QString fileName() const;
+    void setRotationHandler(const std::function<QByteArray(const QByteArray &)> &handler);
+
+    static Options defaultOptions();
+    static void setDefaultOptions(const Options &options);
 
 private:
     TFileAioWriterData *d {nullptr};
@@ -6,25 +6,253 @@
  */
 
 #include "tfileaiowriter.h"
-#include "tqueue.h"
 #include "tfcore_unix.h"
+#include <QDateTime>
+#include <QFile>
 #include <QList>
+#include <QMutex>
 #include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+#include <sys/stat.h>
 
-constexpr int MAX_NUM_BUFFERING_DATA = 10000;
+constexpr int CHUNK_SIZE = 64 * 1024;
+constexpr int MAX_IOVEC = 1024;
+
+class TFileAioWriterThread;
 
 
 class TFileAioWriterData
 {
 public:
+    QMutex openMutex;  // serializes open and close
     mutable QMutex mutex;
+    QWaitCondition queued;
+    QWaitCondition dequeued;
     QString fileName;
-    int fileDescriptor;
-    TQueue<struct aiocb*> syncBuffer;
+    int fileDescriptor {0};
+    QList<QByteArray> queue;
+    int queuedBytes {0};
+    bool writing {false};
+    bool stopping {false};
+    TFileAioWriter::Options options;
+    std::function<QByteArray(const QByteArray &)> rotationHandler;
+    TFileAioWriterThread *thread {nullptr};
+
+    // Used by the writer thread
+    int period {0};
+    qint64 lastSync {0};
+    bool unsynced {false};
+
+    bool openFile();
+    void run();
+    void writeBatch(QList<QByteArray> &batch, int bytes);
+    bool rotateIfNeeded(int bytes);
+    void sync();
+    int currentPeriod() const;
+};
+
+
+class TFileAioWriterThread : public QThread
+{
+public:
+    TFileAioWriterThread(TFileAioWriterData *data) : QThread(), d(data) { }
+
+protected:
+    void run() override { d->run(); }
 
-    TFileAioWriterData() : mutex(QMutex::Recursive), fileName(), fileDescriptor(0), syncBuffer() { }
+private:
+    TFileAioWriterData *d {nullptr};
 };
 
+
+bool TFileAioWriterData::openFile()
+{
+    int fd = ::open(QFile::encodeName(fileName).constData(), (O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC), 0666);
+    if (fd < 0) {
+        return false;
+    }
+
+    fileDescriptor = fd;
+    period = currentPeriod();
+    lastSync = QDateTime::currentMSecsSinceEpoch();
+    unsynced = false;
+    return true;
+}
+
+
+int TFileAioWriterData::currentPeriod() const
+{
+    switch (options.rotationPeriod) {
+    case TFileAioWriter::Hourly: {
+        QDateTime now = QDateTime::currentDateTime();
+        return now.date().toJulianDay() * 24 + now.time().hour();
+    }
+    case TFileAioWriter::Daily:
+        return QDate::currentDate().toJulianDay();
+    default:
+        return 0;
+    }
+}
+
+
+void TFileAioWriterData::run()
+{
+    QMutexLocker locker(&mutex);
+
+    for (;;) {
+        if (queue.isEmpty()) {
+            if (stopping) {
+                break;
+            }
+
+            if (unsynced && options.syncPolicy == TFileAioWriter::SyncInterval) {
+                // Syncs the rest when idle
+                if (!queued.wait(&mutex, options.syncInterval) && queue.isEmpty()) {
+                    locker.unlock();
+                    sync();
+                    locker.relock();
+                }
+            } else {
+                queued.wait(&mutex);
+            }
+            continue;
+        }
+
+        QList<QByteArray> batch;
+        batch.swap(queue);
+        int bytes = queuedBytes;
+        queuedBytes = 0;
+        writing = true;
+        dequeued.wakeAll();
+        locker.unlock();
+
+        writeBatch(batch, bytes);
+
+        locker.relock();
+        writing = false;
+        dequeued.wakeAll();
+    }
+
+    if (unsynced && options.syncPolicy != TFileAioWriter::NoSync) {
+        sync();
+    }
+}
+
+
+void TFileAioWriterData::writeBatch(QList<QByteArray> &batch, int bytes)
+{
+    if (rotateIfNeeded(bytes)) {
+        QMutexLocker locker(&mutex);
+        auto handler = rotationHandler;
+        locker.unlock();
+
+        // The beginning of the new file, followed by the batch
+        QByteArray header = (handler) ? handler(batch.first()) : QByteArray();
+        if (!header.isEmpty()) {
+            batch.prepend(header);
+        }
+    }
+
+    struct iovec vec[MAX_IOVEC];
+    int idx = 0;
+
+    while (idx < batch.count()) {
+        int cnt = qMin(batch.count() - idx, MAX_IOVEC);
+        for (int i = 0; i < cnt; ++i) {
+            vec[i].iov_base = (void *)batch[idx + i].constData();
+            vec[i].iov_len = batch[idx + i].length();
+        }
+        idx += cnt;
+
+        // Writes all, resuming after a partial write
+        struct iovec *v = vec;
+        while (cnt > 0) {
+            int len = tf_writev(fileDescriptor, v, cnt);
+            if (len <= 0) {
+                break;  // drops the batch
+            }
+
+            while (cnt > 0 && len >= (int)v->iov_len) {
+                len -= v->iov_len;
+                ++v;
+                --cnt;
+            }
+            if (cnt > 0) {
+                v->iov_base = (char *)v->iov_base + len;
+                v->iov_len -= len;
+            }
+        }
+    }
+    unsynced = true;
+
+    switch (options.syncPolicy) {
+    case TFileAioWriter::SyncAlways:
+        sync();
+        break;
+    case TFileAioWriter::SyncInterval:
+        if (QDateTime::currentMSecsSinceEpoch() - lastSync >= options.syncInterval) {
+            sync();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+
+bool TFileAioWriterData::rotateIfNeeded(int bytes)
+{
+    struct stat st;
+    bool bySize = options.rotationSize > 0 && fstat(fileDescriptor, &st) == 0
+        && st.st_size > 0 && st.st_size + bytes > options.rotationSize;
+    bool byPeriod = options.rotationPeriod != TFileAioWriter::NoRotation && currentPeriod() != period;
+
+    if (!bySize && !byPeriod) {
+        return false;
+    }
+
+    // Other processes appending to the same file rotate it exclusively
+    const int fd = fileDescriptor;
+    const QByteArray path = QFile::encodeName(fileName);
+    struct stat cur, now;
+    tf_flock(fd, LOCK_EX);
+
+    if (fstat(fd, &cur) == 0 && ::stat(path.constData(), &now) == 0
+        && cur.st_dev == now.st_dev && cur.st_ino == now.st_ino && now.st_size > 0) {
+        // Not rotated yet
+        QByteArray base = path + '.' + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss").toLatin1();
+        QByteArray rotated = base;
+        for (int i = 1; ::access(rotated.constData(), F_OK) == 0; ++i) {
+            rotated = base + '-' + QByteArray::number(i);
+        }
+        ::rename(path.constData(), rotated.constData());
+    }
+
+    if (unsynced && options.syncPolicy != TFileAioWriter::NoSync) {
+        sync();
+    }
+
+    int newfd = ::open(path.constData(), (O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC), 0666);
+    tf_flock(fd, LOCK_UN);
+    if (newfd >= 0) {
+        QMutexLocker locker(&mutex);
+        fileDescriptor = newfd;
+        locker.unlock();
+        tf_close(fd);
+    }
+    period = currentPeriod();
+    return newfd >= 0;
+}
+
+
+void TFileAioWriterData::sync()
+{
+    tf_fdatasync(fileDescriptor);
+    lastSync = QDateTime::currentMSecsSinceEpoch();
+    unsynced = false;
+}
+
 /*!
   Constructor.
  */
@@ -44,6 +272,7 @@ TFileAioWriter::~TFileAioWriter()
 
 bool TFileAioWriter::open()
 {
+    QMutexLocker openLocker(&d->openMutex);
     QMutexLocker locker(&d->mutex);
 
     if (d->fileDescriptor <= 0) {
@@ -51,10 +280,15 @@ bool TFileAioWriter::open()
             return false;
         }
 
-        d->fileDescriptor = ::open(qPrintable(d->fileName), (O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC), 0666);
-        if (d->fileDescriptor < 0) {
+        d->options = defaultOptions();
+        if (!d->openFile()) {
             //fprintf(stderr, "file open failed: %s\n", qPrintable(d->fileName));
+            return false;
         }
+
+        d->stopping = false;
+        d->thread = new TFileAioWriterThread(d);
+        d->thread->start();
     }
 
     return (d->fileDescriptor > 0);
@@ -63,9 +297,20 @@ bool TFileAioWriter::open()
 
 void TFileAioWriter::close()
 {
+    QMutexLocker openLocker(&d->openMutex);
     QMutexLocker locker(&d->mutex);
 
-    flush();
+    if (d->thread) {
+        // Writes the rest and stops the thread
+        d->stopping = true;
+        d->queued.wakeAll();
+        d->dequeued.wakeAll();
+        locker.unlock();
+        d->thread->wait();
+        locker.relock();
+        delete d->thread;
+        d->thread = nullptr;
+    }
 
     if (d->fileDescriptor > 0) {
         tf_close(d->fileDescriptor);
@@ -79,7 +324,11 @@ bool TFileAioWriter::isOpen() const
     return (d->fileDescriptor > 0);
 }
 
-
+/*!
+  Queues the \a data of \a length bytes to be written. If the queued data
+  exceed the maximum buffer size, waits for the writer thread to take
+  them.
+*/
 int TFileAioWriter::write(const char *data, int length)
 {
     if (!isOpen()) {
@@ -90,95 +339,47 @@ int TFileAioWriter::write(const char *data, int length)
         return -1;
     }
 
-    if (d->syncBuffer.count() > 0) {
-        if (d->mutex.tryLock()) {
-            // check whether head's item  writing is finished
-            struct aiocb *headcb;
-            while (d->syncBuffer.head(headcb)) {
-                if (aio_error(headcb) == EINPROGRESS) {
-                    break;
-                }
-
-                if (d->syncBuffer.dequeue(headcb)) {
-                    delete[] (char *)headcb->aio_buf;
-                    delete headcb;
-                } else {
-                    break;
-                }
-            }
-            d->mutex.unlock();
-        }
+    QMutexLocker locker(&d->mutex);
 
-        if (d->syncBuffer.count() > MAX_NUM_BUFFERING_DATA) {
-            flush();
-        }
+    while (d->queuedBytes > 0 && d->queuedBytes + length > d->options.maxBufferSize && !d->stopping) {
+        d->dequeued.wait(&d->mutex);
     }
 
-    struct aiocb *cb = new struct aiocb;
-    memset(cb, 0, sizeof(struct aiocb));
-
-    cb->aio_fildes = d->fileDescriptor;
-    cb->aio_nbytes = length;
-    cb->aio_buf = new char[length];
-    memcpy((void *)cb->aio_buf, data, length);
-
-    int ret = tf_aio_write(cb);
-    int err = errno;
-
-    if (ret < 0) {
-        //fprintf(stderr, "aio_write error fd:%d (pid:%d tid:%d) ret:%d errno:%d\n", d->fileDescriptor, getpid(), gettid(), ret, err);
-        //fprintf(stderr, "aio_write str: %s\n", data);
-        delete[] (char *)cb->aio_buf;
-        delete cb;
-
-        if (err != EAGAIN) {
-            close();
-        } else {
-#ifdef Q_OS_DARWIN
-            // try sync-write
-            return (tf_write(d->fileDescriptor, data, length) > 0) ? 0 : -1;
-#endif
-        }
-        return ret;
+    if (d->stopping || !d->thread) {
+        return -1;
     }
 
-    d->syncBuffer.enqueue(cb);
+    // Appends to the last chunk to reduce allocations and iovecs
+    if (!d->queue.isEmpty() && d->queue.last().length() + length <= CHUNK_SIZE) {
+        d->queue.last().append(data, length);
+    } else {
+        d->queue << QByteArray(data, length);
+    }
+    d->queuedBytes += length;
+    d->queued.wakeOne();
     return 0;
 }
 
-
+/*!
+  Waits until the queued data are written.
+*/
 void TFileAioWriter::flush()
 {
-    if (!isOpen()) {
-        return;
-    }
-
-    if (d->syncBuffer.count() == 0) {
-        return;
-    }
-
     QMutexLocker locker(&d->mutex);
-    struct aiocb *headcb;
-
-    while (d->syncBuffer.count() > 0) {
-        if (d->syncBuffer.head(headcb) && aio_error(headcb) != EINPROGRESS) {
-            // Dequeue
-            if (d->syncBuffer.dequeue(headcb)) {
-                delete[] (char *)headcb->aio_buf;
-                delete headcb;
-            }
-        }
+
+    while (d->thread && (!d->queue.isEmpty() || d->writing)) {
+        d->dequeued.wait(&d->mutex);
     }
 }
 
 
 void TFileAioWriter::setFileName(const QString &name)
 {
-    QMutexLocker locker(&d->mutex);
-
     if (isOpen()) {
         close();
     }
+
+    QMutexLocker locker(&d->mutex);
     d->fileName = name;
 }
 
@@ -188,3 +389,15 @@ QString TFileAioWriter::fileName() const
     QMutexLocker locker(&d->mutex);
     return d->fileName;
 }
+
+/*!
+  Sets the \a handler called by the writer thread when the file has been
+  rotated; it is passed the first chunk of the queued data to be written
+  to the new file, and the data it returns are written before them. The
+  chunk begins with the data of a write() call.
+*/
+void TFileAioWriter::setRotationHandler(const std::function<QByteArray(const QByteArray &)> &handler)
+{
+    QMutexLocker locker(&d->mutex);
+    d->rotationHandler = handler;
+}
@@ -177,3 +177,11 @@ QString TFileAioWriter::fileName() const
     QMutexLocker locker(&d->mutex);
     return d->fileName;
 }
+
+/*!
+  Sets the \a handler called when the file has been rotated. Rotation is
+  not supported on Windows, so it is never called.
+*/
+void TFileAioWriter::setRotationHandler(const std::function<QByteArray(const QByteArray &)> &)
+{
+}
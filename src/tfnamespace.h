@@ -200,6 +200,34 @@ namespace Tf
         CacheBackend,
         CacheGcProbability,
         CacheEnableCompression,
+        CacheEnableQueryCache,
+        //
+        SqlQuerySlowLogFile,
+        SqlQuerySlowThreshold,
+        SqlQueryRepeatThreshold,
+        //
+        CacheNearCacheSize,
+        CacheNearCacheLifetime,
+        CacheCompressionCodec,
+        CacheCompressionThreshold,
+        CacheZstdLevel,
+        CacheZstdDictionaryFile,
+        //
+        WebSocketEnableRedisPublisher,
+        //
+        SessionTouchUnmodified,
+        //
+        SessionCookieEncryptionKeys,
+        SessionCookieCompressionThreshold,
+        SessionCookieMaxSize,
+        //
+        AccessLogFormat,
+        //
+        LogFileMaxBufferSize,
+        LogFileSyncPolicy,
+        LogFileSyncInterval,
+        LogFileRotationSize,
+        LogFileRotationPeriod,
     };
 
     // Reason codes why a web socket has been closed
@@ -279,6 +307,11 @@ namespace TSql
         LeftJoin,
         RightJoin,
     };
+
+    enum RelationType {
+        BelongsTo = 0,  // The foreign key is on this table
+        HasMany,        // The foreign key is on the related table
+    };
 }
 
 /*!
@@ -0,0 +1,395 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <TKeysetPaginator>
+#include <TAppSettings>
+#include <TCryptMac>
+#include <QDataStream>
+#include <QDateTime>
+#include "tsystemglobal.h"
+
+namespace {
+const quint8 CURSOR_FORMAT_VERSION = 2;
+const int MAC_LENGTH = 16;
+const int MAX_CURSOR_LENGTH = 4096;
+
+// Types of the values in a cursor
+enum ValueType : quint8 {
+    NullValue = 0,
+    BoolValue,
+    IntValue,
+    UIntValue,
+    DoubleValue,
+    StringValue,
+    BytesValue,
+    DateTimeValue,
+};
+
+
+void writeValue(QDataStream &ds, const QVariant &value)
+{
+    if (value.isNull()) {
+        ds << (quint8)NullValue;
+        return;
+    }
+
+    switch (value.type()) {
+    case QVariant::Bool:
+        ds << (quint8)BoolValue << (quint8)value.toBool();
+        break;
+    case QVariant::Int:
+    case QVariant::LongLong:
+        ds << (quint8)IntValue << value.toLongLong();
+        break;
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+        ds << (quint8)UIntValue << value.toULongLong();
+        break;
+    case QVariant::Double:
+        ds << (quint8)DoubleValue << value.toDouble();
+        break;
+    case QVariant::ByteArray:
+        ds << (quint8)BytesValue << value.toByteArray();
+        break;
+    case QVariant::DateTime:
+        ds << (quint8)DateTimeValue << value.toDateTime().toMSecsSinceEpoch();
+        break;
+    default:
+        ds << (quint8)StringValue << value.toString().toUtf8();
+        break;
+    }
+}
+
+
+bool readBytes(QDataStream &ds, QByteArray &bytes)
+{
+    quint32 len;
+    ds >> len;
+    qint64 remaining = ds.device()->size() - ds.device()->pos();
+    if (ds.status() != QDataStream::Ok || len == 0xffffffff || (qint64)len > remaining) {
+        return false;
+    }
+    bytes.resize(len);
+    return ds.readRawData(bytes.data(), len) == (int)len;
+}
+
+
+bool readValue(QDataStream &ds, QVariant &value)
+{
+    quint8 type;
+    ds >> type;
+
+    switch (type) {
+    case NullValue:
+        value = QVariant();
+        break;
+    case BoolValue: {
+        quint8 b;
+        ds >> b;
+        value = (bool)b;
+        break;
+    }
+    case IntValue: {
+        qint64 n;
+        ds >> n;
+        value = n;
+        break;
+    }
+    case UIntValue: {
+        quint64 n;
+        ds >> n;
+        value = n;
+        break;
+    }
+    case DoubleValue: {
+        double d;
+        ds >> d;
+        value = d;
+        break;
+    }
+    case StringValue:
+    case BytesValue: {
+        QByteArray bytes;
+        if (!readBytes(ds, bytes)) {
+            return false;
+        }
+        value = (type == StringValue) ? QVariant(QString::fromUtf8(bytes)) : QVariant(bytes);
+        break;
+    }
+    case DateTimeValue: {
+        qint64 msecs;
+        ds >> msecs;
+        value = QDateTime::fromMSecsSinceEpoch(msecs);
+        break;
+    }
+    default:
+        return false;  // unexpected type
+    }
+    return ds.status() == QDataStream::Ok;
+}
+}
+
+/*!
+  \class TKeysetPaginator
+  \brief The TKeysetPaginator class provides keyset pagination, also
+  known as seek pagination.
+
+  Instead of skipping rows with OFFSET, the next page is retrieved with
+  a WHERE clause such as "(a, b) > (?, ?)" where the values are those of
+  the last item of the previous page. It costs the same for any page
+  and no rows are skipped or duplicated when rows are inserted while
+  paging. The columns must be a unique ordered tuple, such as
+  (created_at, id), and should not contain NULL values. The position
+  is passed between requests as an opaque cursor string.
+  \sa TSqlORMapper::find(const TCriteria &, TKeysetPaginator &),
+  TMongoODMapper::find(const TCriteria &, TKeysetPaginator &)
+*/
+
+/*!
+  Constructs a TKeysetPaginator object using the parameters.
+  \a columns specifies the property indexes of the ordered unique
+  column tuple. \a itemsPerPage specifies the maximum number of items
+  to be shown per page. \a order specifies the sort order of all the
+  columns.
+*/
+TKeysetPaginator::TKeysetPaginator(const QList<int> &columns, int itemsPerPage, Tf::SortOrder order) :
+    _columns(columns),
+    _itemsPerPage(qMax(itemsPerPage, 1)),
+    _sortOrder(order)
+{ }
+
+/*!
+  Copy constructor.
+*/
+TKeysetPaginator::TKeysetPaginator(const TKeysetPaginator &other) :
+    _columns(other._columns),
+    _itemsPerPage(other._itemsPerPage),
+    _sortOrder(other._sortOrder),
+    _cursorValues(other._cursorValues),
+    _nextValues(other._nextValues),
+    _itemCount(other._itemCount)
+{ }
+
+/*!
+  Assignment operator
+*/
+TKeysetPaginator &TKeysetPaginator::operator=(const TKeysetPaginator &other)
+{
+    _columns = other._columns;
+    _itemsPerPage = other._itemsPerPage;
+    _sortOrder = other._sortOrder;
+    _cursorValues = other._cursorValues;
+    _nextValues = other._nextValues;
+    _itemCount = other._itemCount;
+    return *this;
+}
+
+/*!
+  Sets the property indexes of the ordered unique column tuple to
+  \a columns.
+*/
+void TKeysetPaginator::setColumns(const QList<int> &columns)
+{
+    _columns = columns;
+}
+
+/*!
+  Sets the maximum number of items to be shown per page to \a count.
+*/
+void TKeysetPaginator::setItemCountPerPage(int count)
+{
+    _itemsPerPage = qMax(count, 1);
+}
+
+/*!
+  Sets the sort order of the columns to \a order.
+*/
+void TKeysetPaginator::setSortOrder(Tf::SortOrder order)
+{
+    _sortOrder = order;
+}
+
+/*!
+  Sets the position of the current page to the \a cursor string which
+  was returned by nextCursor() on the previous page. An empty cursor
+  means the first page. Returns false if the cursor is invalid for
+  the columns and the sort order of this paginator; the first page is
+  set in that case.
+*/
+bool TKeysetPaginator::setCursor(const QString &cursor)
+{
+    _cursorValues.clear();
+    if (cursor.isEmpty()) {
+        return true;
+    }
+
+    _cursorValues = decode(cursor);
+    if (_cursorValues.isEmpty()) {
+        tSystemWarn("Invalid cursor for keyset pagination: %s", qPrintable(cursor));
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Sets the values of the columns of the last item of the previous page
+  to \a values.
+*/
+void TKeysetPaginator::setCursorValues(const QVariantList &values)
+{
+    _cursorValues = (values.count() == _columns.count()) ? values : QVariantList();
+}
+
+/*!
+  Returns the cursor string of the current page.
+*/
+QString TKeysetPaginator::cursor() const
+{
+    return encode(_cursorValues);
+}
+
+/*!
+  Returns the cursor string of the next page, which is passed to
+  setCursor() on the next request. Returns an empty string if there
+  is no next page.
+*/
+QString TKeysetPaginator::nextCursor() const
+{
+    return hasNext() ? encode(_nextValues) : QString();
+}
+
+/*!
+  Returns true if the next page may exist; otherwise returns false.
+  When the number of items of the last page equals the number of items
+  per page, the next page is empty.
+*/
+bool TKeysetPaginator::hasNext() const
+{
+    return _itemCount >= _itemsPerPage && _nextValues.count() == _columns.count() && !_columns.isEmpty();
+}
+
+/*!
+  Returns the criteria to seek to the position of the current page,
+  such as "(a, b) > (1, 2)". Returns an empty criteria for the first
+  page.
+*/
+TCriteria TKeysetPaginator::criteria() const
+{
+    if (_columns.isEmpty() || _cursorValues.count() != _columns.count()) {
+        return TCriteria();
+    }
+    auto op = (_sortOrder == Tf::AscendingOrder) ? TSql::GreaterThan : TSql::LessThan;
+    return TCriteria(_columns, op, _cursorValues);
+}
+
+/*!
+  Sets the number of the retrieved items to \a itemCount and the values
+  of the columns of the last item to \a lastValues.
+  This function is called by the mappers. Internal use only.
+*/
+void TKeysetPaginator::setPageResult(int itemCount, const QVariantList &lastValues)
+{
+    _itemCount = itemCount;
+    _nextValues = lastValues;
+}
+
+/*!
+  Encodes the \a values to an opaque cursor string, signed with the
+  key returned by cursorKey().
+*/
+QString TKeysetPaginator::encode(const QVariantList &values) const
+{
+    if (values.isEmpty() || values.count() != _columns.count() || _columns.count() > 255) {
+        return QString();
+    }
+
+    QByteArray buf;
+    QDataStream ds(&buf, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_0);
+    ds << CURSOR_FORMAT_VERSION << (quint8)_sortOrder << (quint8)_columns.count();
+    for (int col : _columns) {
+        ds << (qint32)col;
+    }
+    for (auto &value : values) {
+        writeValue(ds, value);
+    }
+
+    buf += TCryptMac::hash(buf, cursorKey(), TCryptMac::Hmac_Sha256).left(MAC_LENGTH);
+    return QString::fromLatin1(buf.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+/*!
+  Decodes the \a cursor string to the values. Returns an empty list
+  if the cursor is forged, broken or was not encoded for the columns
+  and the sort order of this paginator.
+*/
+QVariantList TKeysetPaginator::decode(const QString &cursor) const
+{
+    if (cursor.length() > MAX_CURSOR_LENGTH) {
+        return QVariantList();
+    }
+
+    QByteArray buf = QByteArray::fromBase64(cursor.toLatin1(), QByteArray::Base64UrlEncoding);
+    if (buf.length() <= MAC_LENGTH) {
+        return QVariantList();
+    }
+
+    // Verifies the signature in constant time
+    QByteArray mac = buf.right(MAC_LENGTH);
+    buf.chop(MAC_LENGTH);
+    QByteArray expected = TCryptMac::hash(buf, cursorKey(), TCryptMac::Hmac_Sha256).left(MAC_LENGTH);
+    char diff = 0;
+    for (int i = 0; i < MAC_LENGTH; ++i) {
+        diff |= mac[i] ^ expected[i];
+    }
+    if (diff) {
+        return QVariantList();
+    }
+
+    QDataStream ds(buf);
+    ds.setVersion(QDataStream::Qt_5_0);
+
+    quint8 version = 0;
+    quint8 order = 0;
+    quint8 count = 0;
+    ds >> version >> order >> count;
+    if (ds.status() != QDataStream::Ok || version != CURSOR_FORMAT_VERSION
+        || order != (quint8)_sortOrder || count != _columns.count()) {
+        return QVariantList();
+    }
+
+    for (int col : _columns) {
+        qint32 c;
+        ds >> c;
+        if (c != col) {
+            return QVariantList();
+        }
+    }
+
+    QVariantList values;
+    for (int i = 0; i < count; ++i) {
+        QVariant value;
+        if (!readValue(ds, value)) {
+            return QVariantList();
+        }
+        values << value;
+    }
+
+    if (ds.status() != QDataStream::Ok || !ds.atEnd()) {
+        return QVariantList();
+    }
+    return values;
+}
+
+/*!
+  Returns the key to sign cursors with, the Session.Secret in the
+  application.ini.
+*/
+QByteArray TKeysetPaginator::cursorKey() const
+{
+    return Tf::appSettings()->value(Tf::SessionSecret).toByteArray();
+}
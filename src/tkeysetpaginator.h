@@ -0,0 +1,57 @@
+#ifndef TKEYSETPAGINATOR_H
+#define TKEYSETPAGINATOR_H
+
+#include <QList>
+#include <QVariant>
+#include <TGlobal>
+#include <TCriteria>
+
+
+class T_CORE_EXPORT TKeysetPaginator
+{
+public:
+    TKeysetPaginator(const QList<int> &columns = QList<int>(), int itemsPerPage = 10, Tf::SortOrder order = Tf::AscendingOrder);
+    TKeysetPaginator(const TKeysetPaginator &other);
+    virtual ~TKeysetPaginator() { }
+
+    TKeysetPaginator &operator=(const TKeysetPaginator &other);
+
+    // Setter
+    void setColumns(const QList<int> &columns);
+    void setItemCountPerPage(int count);
+    void setSortOrder(Tf::SortOrder order);
+    bool setCursor(const QString &cursor);
+    void setCursorValues(const QVariantList &values);
+
+    // Getter
+    QList<int> columns() const { return _columns; }
+    int itemCountPerPage() const { return _itemsPerPage; }
+    Tf::SortOrder sortOrder() const { return _sortOrder; }
+    QString cursor() const;
+    QVariantList cursorValues() const { return _cursorValues; }
+    QString nextCursor() const;
+    QVariantList nextCursorValues() const { return _nextValues; }
+    int itemCountOfCurrentPage() const { return _itemCount; }
+    bool isFirstPage() const { return _cursorValues.isEmpty(); }
+    bool hasNext() const;
+    TCriteria criteria() const;
+
+    void setPageResult(int itemCount, const QVariantList &lastValues);  // Internal use
+
+protected:
+    QString encode(const QVariantList &values) const;
+    QVariantList decode(const QString &cursor) const;
+    virtual QByteArray cursorKey() const;
+
+private:
+    QList<int> _columns;
+    int _itemsPerPage {10};
+    Tf::SortOrder _sortOrder {Tf::AscendingOrder};
+    QVariantList _cursorValues;
+    QVariantList _nextValues;
+    int _itemCount {0};
+};
+
+Q_DECLARE_METATYPE(TKeysetPaginator)
+
+#endif // TKEYSETPAGINATOR_H
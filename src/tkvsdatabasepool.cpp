@@ -14,6 +14,7 @@
 #include <QDateTime>
 #include <QMap>
 #include <QThread>
+#include <QElapsedTimer>
 #include <ctime>
 
 /*!
@@ -51,7 +52,6 @@ TKvsDatabasePool *TKvsDatabasePool::instance()
 {
     static TKvsDatabasePool *databasePool = []() {
         auto *pool = new TKvsDatabasePool;
-        pool->maxConnects = Tf::app()->maxNumberOfThreadsPerAppServer();
         pool->init();
         return pool;
     }();
@@ -88,6 +88,11 @@ TKvsDatabasePool::~TKvsDatabasePool()
     delete[] cachedDatabase;
     delete[] lastCachedTime;
     delete[] availableNames;
+    delete[] waitQueue;
+    delete[] poolSettings;
+    delete[] invalidatedTime;
+    delete[] openedTime;
+    delete[] lastUsedTime;
 }
 
 
@@ -97,11 +102,41 @@ void TKvsDatabasePool::init()
         return;
     }
 
-    cachedDatabase = new TStack<QString>[kvsEngineHash()->count()];
-    lastCachedTime = new TAtomic<uint>[kvsEngineHash()->count()];
-    availableNames = new TStack<QString>[kvsEngineHash()->count()];
+    const int count = kvsEngineHash()->count();
+    cachedDatabase = new TStack<QString>[count];
+    lastCachedTime = new TAtomic<uint>[count];
+    availableNames = new TStack<QString>[count];
+    waitQueue = new TPoolWaitQueue[count];
+    poolSettings = new PoolSettings[count];
+    invalidatedTime = new TAtomic<uint>[count];
     bool aval = false;
 
+    // Reads the pool settings
+    const int maxThreads = Tf::app()->maxNumberOfThreadsPerAppServer();
+    for (auto it = kvsEngineHash()->begin(); it != kvsEngineHash()->end(); ++it) {
+        Tf::KvsEngine engine = it.key();
+        const QVariantMap &settings = Tf::app()->kvsSettings(engine);
+        auto &opt = poolSettings[(int)engine];
+
+        int max = settings.value("MaxConnections").toInt();
+        opt.maxConnections = (max > 0) ? max : maxThreads;
+        opt.minIdleConnections = qBound(0, settings.value("MinIdleConnections").toInt(), opt.maxConnections);
+        bool ok;
+        int timeout = settings.value("AcquireTimeout").toInt(&ok);
+        opt.acquireTimeout = ok ? timeout : 10000;
+        int idle = settings.value("ValidationIdleTime").toInt(&ok);
+        opt.validationIdleTime = ok ? idle : -1;
+        opt.maxLifeTime = qMax(settings.value("MaxLifeTime").toInt(), 0);
+        opt.validationCommand = settings.value("ValidationCommand").toString().trimmed();
+        if (opt.validationCommand.isEmpty() && it.value() == QLatin1String("redis")) {
+            opt.validationCommand = QStringLiteral("PING");
+        }
+        maxConnects = qMax(maxConnects, opt.maxConnections);
+    }
+
+    openedTime = new TAtomic<uint>[count * maxConnects];
+    lastUsedTime = new TAtomic<uint>[count * maxConnects];
+
     // Adds databases previously
     for (auto it = kvsEngineHash()->begin(); it != kvsEngineHash()->end(); ++it) {
         Tf::KvsEngine engine = it.key();
@@ -116,7 +151,7 @@ void TKvsDatabasePool::init()
         }
 
         auto &stack = availableNames[(int)engine];
-        for (int i = 0; i < maxConnects; ++i) {
+        for (int i = 0; i < poolSettings[(int)engine].maxConnections; ++i) {
             TKvsDatabase db = TKvsDatabase::addDatabase(drv, QString().sprintf(CONN_NAME_FORMAT, (int)engine, i));
             if (!db.isValid()) {
                 tWarn("KVS init parameter is invalid");
@@ -162,55 +197,167 @@ TKvsDatabase TKvsDatabasePool::database(Tf::KvsEngine engine)
 
     auto &cache = cachedDatabase[(int)engine];
     auto &stack = availableNames[(int)engine];
+    auto &queue = waitQueue[(int)engine];
+    const auto &opt = poolSettings[(int)engine];
+    QElapsedTimer waitTimer;
+    bool ahead = false;  // true once this thread has got a connection
+
+    auto take = [&](QString &name, bool &cached) {
+        cached = cache.pop(name);
+        return cached || stack.pop(name);
+    };
 
     for (;;) {
         QString name;
-        if (cache.pop(name)) {
+        bool cached = false;
+
+        // Takes an idle connection unless others are waiting ahead
+        if ((!ahead && queue.hasWaiters()) || !take(name, cached)) {
+            // Pool exhausted, waits for a connection to be handed over
+            if (!waitTimer.isValid()) {
+                waitTimer.start();
+            }
+
+            int remaining = opt.acquireTimeout - (int)waitTimer.elapsed();
+            if (remaining <= 0 || !queue.wait(remaining, take, name, cached)) {
+                queue.recordExhausted();
+                tError("KVS connection pool exhausted. Waited %d msecs. Increase MaxConnections or AcquireTimeout.", (int)waitTimer.elapsed());
+                tSystemError("KVS connection pool exhausted  engine:%d", (int)engine);
+                break;
+            }
+        }
+        ahead = true;
+
+        if (cached) {
             db = TKvsDatabase::database(name);
-            if (Q_LIKELY(db.isOpen())) {
-                tSystemDebug("Gets cached KVS database: %s", qPrintable(db.connectionName()));
-                db.moveToThread(QThread::currentThread());  // move to thread
-                return db;
-            } else {
+            if (Q_UNLIKELY(!db.isOpen())) {
                 tSystemError("Pooled database is not open: %s  [%s:%d]", qPrintable(db.connectionName()), __FILE__, __LINE__);
                 stack.push(name);
                 continue;
             }
-        }
 
-        if (Q_LIKELY(stack.pop(name))) {
-            db = TKvsDatabase::database(name);
-            if (Q_UNLIKELY(db.isOpen())) {
-                tSystemWarn("Gets a opend KVS database: %s", qPrintable(db.connectionName()));
-                return db;
-            } else {
-                db.moveToThread(QThread::currentThread());  // move to thread
-
-                if (Q_UNLIKELY(!db.open())) {
-                    tError("KVS Database open error. Invalid database settings, or maximum number of KVS connection exceeded.");
-                    tSystemError("KVS database open error: %s", qPrintable(db.connectionName()));
-                    return TKvsDatabase();
-                }
+            db.moveToThread(QThread::currentThread());  // move to thread
 
-                tSystemDebug("KVS opened successfully  env:%s connectname:%s dbname:%s", qPrintable(Tf::app()->databaseEnvironment()), qPrintable(db.connectionName()), qPrintable(db.databaseName()));
-                tSystemDebug("Gets KVS database: %s", qPrintable(db.connectionName()));
-                // Executes post-open statements
-                if (! db.postOpenStatements().isEmpty()) {
-                    for (QString st : db.postOpenStatements()) {
-                        st = st.trimmed();
-                        db.command(st);
-                    }
-                }
+            if (Q_UNLIKELY(isExpired(db, (int)engine))) {
+                tSystemDebug("Pooled KVS database expired: %s", qPrintable(db.connectionName()));
+                queue.recordExpired();
+                closeDatabase(db, false);  // retries with it
+                continue;
+            }
 
-                return db;
+            if (Q_UNLIKELY(!validateDatabase(db, (int)engine))) {
+                tSystemWarn("Pooled KVS database validation failed: %s", qPrintable(db.connectionName()));
+                queue.recordValidationFailure();
+                // Validates every other idle connection on the next borrow
+                invalidatedTime[(int)engine].store((uint)std::time(nullptr));
+                closeDatabase(db, false);  // retries with it
+                continue;
             }
+
+            tSystemDebug("Gets cached KVS database: %s", qPrintable(db.connectionName()));
+            queue.recordAcquire(waitTimer.isValid() ? waitTimer.elapsed() : 0, waitTimer.isValid());
+            return db;
         }
+
+        db = TKvsDatabase::database(name);
+        if (Q_UNLIKELY(db.isOpen())) {
+            tSystemWarn("Gets a opend KVS database: %s", qPrintable(db.connectionName()));
+        } else {
+            db.moveToThread(QThread::currentThread());  // move to thread
+
+            if (Q_UNLIKELY(!openDatabase(db))) {
+                queue.release(name, false, [&]() { stack.push(name); });
+                return TKvsDatabase();
+            }
+        }
+
+        tSystemDebug("Gets KVS database: %s", qPrintable(db.connectionName()));
+        queue.recordAcquire(waitTimer.isValid() ? waitTimer.elapsed() : 0, waitTimer.isValid());
+        return db;
     }
 
     throw RuntimeException("No pooled connection", __FILE__, __LINE__);
 }
 
 
+bool TKvsDatabasePool::openDatabase(TKvsDatabase &database)
+{
+    if (Q_UNLIKELY(!database.open())) {
+        tError("KVS Database open error. Invalid database settings, or maximum number of KVS connection exceeded.");
+        tSystemError("KVS database open error: %s", qPrintable(database.connectionName()));
+        return false;
+    }
+
+    tSystemDebug("KVS opened successfully  env:%s connectname:%s dbname:%s", qPrintable(Tf::app()->databaseEnvironment()), qPrintable(database.connectionName()), qPrintable(database.databaseName()));
+    uint now = (uint)std::time(nullptr);
+    connectionTime(openedTime, database).store(now);
+    connectionTime(lastUsedTime, database).store(now);
+
+    // Executes post-open statements
+    if (! database.postOpenStatements().isEmpty()) {
+        for (QString st : database.postOpenStatements()) {
+            st = st.trimmed();
+            database.command(st);
+        }
+    }
+    return true;
+}
+
+
+/*!
+  Closes the \a database and returns its name to the pool. If \a release
+  is true, the name is handed over to the thread waiting at the head of
+  the queue.
+*/
+void TKvsDatabasePool::closeDatabase(TKvsDatabase &database, bool release)
+{
+    int engine = getEngine(database);
+    QString name = database.connectionName();
+    database.close();
+    tSystemDebug("Closed KVS database connection, name: %s", qPrintable(name));
+    if (release) {
+        waitQueue[engine].release(name, false, [&]() { availableNames[engine].push(name); });
+    } else {
+        availableNames[engine].push(name);
+    }
+}
+
+
+/*!
+  Checks the pooled \a database with ValidationCommand, such as PING, if
+  it has been idle longer than ValidationIdleTime or a connection failure
+  was detected since it was returned.
+*/
+bool TKvsDatabasePool::validateDatabase(TKvsDatabase &database, int engine)
+{
+    const auto &opt = poolSettings[engine];
+    if (opt.validationCommand.isEmpty()) {
+        return true;
+    }
+
+    uint lastUsed = connectionTime(lastUsedTime, database).load();
+    uint invalidated = invalidatedTime[engine].load();
+    uint now = (uint)std::time(nullptr);
+
+    bool needed = (invalidated > 0 && lastUsed <= invalidated)
+        || (opt.validationIdleTime >= 0 && now - lastUsed >= (uint)opt.validationIdleTime);
+    if (!needed) {
+        return true;
+    }
+
+    bool ret = database.command(opt.validationCommand);
+    tSystemDebug("Validated KVS database: %s  result:%d", qPrintable(database.connectionName()), (int)ret);
+    return ret;
+}
+
+
+bool TKvsDatabasePool::isExpired(const TKvsDatabase &database, int engine) const
+{
+    int maxLifeTime = poolSettings[engine].maxLifeTime;
+    return maxLifeTime > 0 && connectionTime(openedTime, database).load() + (uint)maxLifeTime < (uint)std::time(nullptr);
+}
+
+
 bool TKvsDatabasePool::setDatabaseSettings(TKvsDatabase &database, Tf::KvsEngine engine) const
 {
     // Initiates database
@@ -265,15 +412,23 @@ bool TKvsDatabasePool::setDatabaseSettings(TKvsDatabase &database, Tf::KvsEngine
 void TKvsDatabasePool::pool(TKvsDatabase &database)
 {
     if (Q_LIKELY(database.isValid())) {
-        bool ok;
-        int engine = database.connectionName().left(2).toInt(&ok);
-        if (Q_UNLIKELY(!ok)) {
+        int engine = getEngine(database);
+        if (Q_UNLIKELY(engine < 0)) {
             throw RuntimeException("No such KVS engine", __FILE__, __LINE__);
         }
 
-        cachedDatabase[engine].push(database.connectionName());
-        lastCachedTime[engine].store((uint)std::time(nullptr));
-        tSystemDebug("Pooled KVS database: %s", qPrintable(database.connectionName()));
+        if (isExpired(database, engine)) {
+            tSystemDebug("Close expired KVS database: %s", qPrintable(database.connectionName()));
+            waitQueue[engine].recordExpired();
+            closeDatabase(database);
+        } else {
+            uint now = (uint)std::time(nullptr);
+            connectionTime(lastUsedTime, database).store(now);
+            lastCachedTime[engine].store(now);
+            const QString name = database.connectionName();
+            waitQueue[engine].release(name, true, [&]() { cachedDatabase[engine].push(name); });
+            tSystemDebug("Pooled KVS database: %s", qPrintable(database.connectionName()));
+        }
     }
     database = TKvsDatabase();  // Sets an invalid object
 }
@@ -291,11 +446,25 @@ void TKvsDatabasePool::timerEvent(QTimerEvent *event)
             }
 
             auto &cache = cachedDatabase[e];
-            while (lastCachedTime[e].load() < (uint)std::time(nullptr) - 30
+            int minIdle = poolSettings[e].minIdleConnections;
+
+            while (cache.count() > minIdle
+                   && lastCachedTime[e].load() < (uint)std::time(nullptr) - 30
                    && cache.pop(name)) {
-                TKvsDatabase::database(name).close();
-                tSystemDebug("Closed KVS database connection, name: %s", qPrintable(name));
-                availableNames[e].push(name);
+                TKvsDatabase db = TKvsDatabase::database(name);
+                closeDatabase(db);
+            }
+
+            // Keeps the minimum number of idle connections open
+            while (cache.count() < minIdle && availableNames[e].pop(name)) {
+                TKvsDatabase db = TKvsDatabase::database(name);
+                db.moveToThread(QThread::currentThread());
+                if (!openDatabase(db)) {
+                    availableNames[e].push(name);
+                    break;
+                }
+                lastCachedTime[e].store((uint)std::time(nullptr));
+                waitQueue[e].release(name, true, [&]() { cache.push(name); });
             }
         }
     } else {
@@ -304,7 +473,37 @@ void TKvsDatabasePool::timerEvent(QTimerEvent *event)
 }
 
 
+/*!
+  Returns the statistics of the connection pool for the KVS \a engine.
+*/
+TPoolStatistics TKvsDatabasePool::statistics(Tf::KvsEngine engine) const
+{
+    TPoolStatistics stats;
+    if (Tf::app()->isKvsAvailable(engine) && waitQueue) {
+        stats = waitQueue[(int)engine].statistics();
+        stats.idleCount = cachedDatabase[(int)engine].count();
+    }
+    return stats;
+}
+
+
 QString TKvsDatabasePool::driverName(Tf::KvsEngine engine)
 {
     return kvsEngineHash()->value(engine);
 }
+
+
+int TKvsDatabasePool::getEngine(const TKvsDatabase &database)
+{
+    bool ok;
+    int engine = database.connectionName().left(2).toInt(&ok);
+    return (ok && engine >= 0 && engine < (int)Tf::KvsEngine::Num) ? engine : -1;
+}
+
+
+TAtomic<uint> &TKvsDatabasePool::connectionTime(TAtomic<uint> *times, const TKvsDatabase &database) const
+{
+    const QString name = database.connectionName();
+    int idx = name.mid(name.indexOf('_') + 1).toInt();
+    return times[qMax(getEngine(database), 0) * maxConnects + idx];
+}
@@ -10,6 +10,7 @@
 #include <TGlobal>
 #include "tatomic.h"
 #include "tstack.h"
+#include "tpoolwaitqueue.h"
 
 class QSettings;
 
@@ -21,6 +22,7 @@ public:
     ~TKvsDatabasePool();
     TKvsDatabase database(Tf::KvsEngine engine);
     void pool(TKvsDatabase &database);
+    TPoolStatistics statistics(Tf::KvsEngine engine) const;
 
     static TKvsDatabasePool *instance();
 
@@ -28,17 +30,37 @@ protected:
     void init();
     bool setDatabaseSettings(TKvsDatabase &database, Tf::KvsEngine engine) const;
     void timerEvent(QTimerEvent *event);
+    bool openDatabase(TKvsDatabase &database);
+    void closeDatabase(TKvsDatabase &database, bool release = true);
+    bool validateDatabase(TKvsDatabase &database, int engine);
+    bool isExpired(const TKvsDatabase &database, int engine) const;
 
     static QString driverName(Tf::KvsEngine engine);
 
 private:
+    struct PoolSettings {
+        int minIdleConnections {0};
+        int maxConnections {0};
+        int acquireTimeout {10000};    // msecs
+        int validationIdleTime {-1};   // secs, negative value disables it
+        int maxLifeTime {0};           // secs, 0 means unlimited
+        QString validationCommand;
+    };
+
     T_DISABLE_COPY(TKvsDatabasePool)
     T_DISABLE_MOVE(TKvsDatabasePool)
     TKvsDatabasePool();
+    TAtomic<uint> &connectionTime(TAtomic<uint> *times, const TKvsDatabase &database) const;
+    static int getEngine(const TKvsDatabase &database);
 
     TStack<QString> *cachedDatabase {nullptr};
     TAtomic<uint> *lastCachedTime {nullptr};
     TStack<QString> *availableNames {nullptr};
+    TPoolWaitQueue *waitQueue {nullptr};
+    PoolSettings *poolSettings {nullptr};
+    TAtomic<uint> *invalidatedTime {nullptr};
+    TAtomic<uint> *openedTime {nullptr};    // per connection
+    TAtomic<uint> *lastUsedTime {nullptr};  // per connection
     int maxConnects {0};
     QBasicTimer timer;
 };
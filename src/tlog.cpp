@@ -7,6 +7,7 @@
 
 #include "TLog"
 #include "tfcore.h"
+#include "ttracecontext.h"
 #include <QThread>
 
 /*!
@@ -31,19 +32,21 @@ TLog::TLog(int pri, const QByteArray &msg) :
 #else
     threadId((qulonglong)QThread::currentThreadId()),
 #endif
-    message(msg)
+    message(msg),
+    traceId(TTraceContext::current().traceId()),
+    spanId(TTraceContext::current().spanId())
 { }
 
 
 QDataStream &operator<<(QDataStream &out, const TLog &log)
 {
-    out << log.timestamp << log.priority << log.pid << log.threadId << log.message;
+    out << log.timestamp << log.priority << log.pid << log.threadId << log.message << log.traceId << log.spanId;
     return out;
 }
 
 
 QDataStream &operator>>(QDataStream &in, TLog &log)
 {
-    in >> log.timestamp >> log.priority >> log.pid >> log.threadId >> log.message;
+    in >> log.timestamp >> log.priority >> log.pid >> log.threadId >> log.message >> log.traceId >> log.spanId;
     return in;
 }
@@ -22,6 +22,8 @@ public:
     qint64 pid;           //!< PID.
     qulonglong threadId;  //!< Thread ID.
     QByteArray message;   //!< Message.
+    QByteArray traceId;   //!< Trace ID of the request.
+    QByteArray spanId;    //!< Span ID of the request.
 };
 
 #endif // TLOG_H
@@ -8,6 +8,8 @@
 #include <TLogger>
 #include <TWebApplication>
 #include <TSystemGlobal>
+#include "tloglayout.h"
+#include "tlogsampler.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QTextCodec>
@@ -42,6 +44,15 @@ Q_GLOBAL_STATIC(PriorityHash, priorityHash)
 TLogger::TLogger()
 { }
 
+/*!
+  Destructor.
+*/
+TLogger::~TLogger()
+{
+    delete _compiledLayout.loadAcquire();
+    delete[] _samplers.loadAcquire();
+}
+
 /*!
   Returns the value for logger setting \a key. If the setting doesn't exist,
   returns \a defaultValue.
@@ -59,98 +70,34 @@ QVariant TLogger::settingsValue(const QString &k, const QVariant &defaultValue)
 */
 QByteArray TLogger::logToByteArray(const TLog &log) const
 {
-    return logToByteArray(log, layout(), dateTimeFormat(), codec());
+    TLogLayout *compiled = _compiledLayout.loadAcquire();
+    if (Q_UNLIKELY(!compiled)) {
+        compiled = new TLogLayout(layout(), dateTimeFormat());
+        if (!_compiledLayout.testAndSetOrdered(nullptr, compiled)) {
+            delete compiled;
+            compiled = _compiledLayout.loadAcquire();
+        }
+    }
+
+    QByteArray message = compiled->format(log);
+    QTextCodec *c = codec();
+    return (c) ? c->fromUnicode(QString::fromLocal8Bit(message.data(), message.length())) : message;
 }
 
 /*!
   Converts the log \a log to its textual representation and returns
-  a QByteArray containing the data.
+  a QByteArray containing the data. The layout compiled last is reused
+  in each thread.
 */
 QByteArray TLogger::logToByteArray(const TLog &log, const QByteArray &layout, const QByteArray &dateTimeFormat, QTextCodec *codec)
 {
-    QByteArray message;
-    int pos = 0;
-    QByteArray dig;
-    message.reserve(layout.length() + log.message.length() + 100);
-
-    while (pos < layout.length()) {
-        char c = layout.at(pos++);
-        if (c != '%') {
-            message.append(c);
-            continue;
-        }
-
-        dig.resize(0);
-        for (;;) {
-            if (pos >= layout.length()) {
-                message.append('%').append(dig);
-                break;
-            }
-
-            c = layout.at(pos++);
-            if (c >= '0' && c <= '9') {
-                dig += c;
-                continue;
-            }
+    thread_local TLogLayout compiled;
 
-            switch (c) {
-            case 'd':  // %d : timestamp
-                if (!dateTimeFormat.isEmpty()) {
-                    message.append(log.timestamp.toString(dateTimeFormat).toLatin1());
-                } else {
-                    message.append(log.timestamp.toString(Qt::ISODate).toLatin1());
-                }
-                break;
-
-            case 'p':
-            case 'P': {  // %p or %P : priority
-                QByteArray pri = priorityToString((Tf::LogPriority)log.priority);
-                if (c == 'p') {
-                    pri = pri.toLower();
-                }
-                if (!pri.isEmpty()) {
-                    message.append(pri);
-                    int d = dig.toInt() - pri.length();
-                    if (d > 0) {
-                        message.append(QByteArray(d, ' '));
-                    }
-                }
-                break; }
-
-            case 't':
-            case 'T': { // %t or %T : thread ID (dec or hex)
-                const QChar fillChar = (dig.length() > 0 && dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                message.append(QString("%1").arg((qulonglong)log.threadId, dig.toInt(), ((c == 't') ? 10 : 16), fillChar).toLatin1());
-                break; }
-
-            case 'i':
-            case 'I': {  // %i or %I : PID (dec or hex)
-                const QChar fillChar = (dig.length() > 0 && dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                message.append(QString("%1").arg(log.pid, dig.toInt(), ((c == 'i') ? 10 : 16), fillChar).toLatin1());
-                break; }
-
-            case 'n':  // %n : newline
-                message.append('\n');
-                break;
-
-            case 'm':  // %m : message
-                message.append(log.message);
-                break;
-
-            case '%':
-                message.append('%').append(dig);
-                dig.resize(0);
-                continue;
-                break;
-
-            default:
-                message.append('%').append(dig).append(c);
-                break;
-            }
-            break;
-        }
+    if (compiled.layout() != layout || compiled.dateTimeFormat() != dateTimeFormat || compiled.isEmpty()) {
+        compiled.compile(layout, dateTimeFormat);
     }
 
+    QByteArray message = compiled.format(log);
     return (codec) ? codec->fromUnicode(QString::fromLocal8Bit(message.data(), message.length())) : message;
 }
 
@@ -243,6 +190,65 @@ const QString &TLogger::target() const
     return _target;
 }
 
+/*!
+  Returns true if a log of the \a priority is to be written, according
+  to the sampling settings of the priority; "<key>.<Priority>.SampleRate"
+  and "<key>.<Priority>.RateLimit", or "<key>.SampleRate" and
+  "<key>.RateLimit" for all priorities. When logs have been suppressed
+  by the rate limit, a summary line is written before the log.
+*/
+bool TLogger::sample(int priority)
+{
+    TLogSampler &sampler = samplers()[qBound((int)Tf::FatalLevel, priority, (int)Tf::TraceLevel)];
+    if (!sampler.isEnabled()) {
+        return true;
+    }
+
+    quint64 suppressed;
+    if (!sampler.sample(&suppressed)) {
+        return false;
+    }
+
+    if (suppressed > 0) {
+        TLog summary(priority, TLogSampler::suppressedMessage(suppressed));
+        summary.traceId.clear();
+        summary.spanId.clear();
+        this->log(summary);
+    }
+    return true;
+}
+
+/*!
+  Loads the sampling settings of this logger from the logger \a settings.
+  This can be called while logs are written, to apply the settings
+  reloaded.
+*/
+void TLogger::loadSamplingSettings(const QVariantMap &settings)
+{
+    TLogSampler *smp = samplers();
+    for (int pri = Tf::FatalLevel; pri <= Tf::TraceLevel; ++pri) {
+        QByteArray name = priorityToString((Tf::LogPriority)pri);
+        name = name.left(1) + name.mid(1).toLower();
+        smp[pri].loadSettings(settings, key() + "." + name, key());
+    }
+}
+
+
+TLogSampler *TLogger::samplers()
+{
+    TLogSampler *smp = _samplers.loadAcquire();
+    if (Q_UNLIKELY(!smp)) {
+        smp = new TLogSampler[Tf::TraceLevel + 1];
+        if (_samplers.testAndSetOrdered(nullptr, smp)) {
+            loadSamplingSettings(Tf::app()->loggerSettings());
+        } else {
+            delete[] smp;
+            smp = _samplers.loadAcquire();
+        }
+    }
+    return smp;
+}
+
 
 /*!
   \fn virtual QString TLogger::key() const
@@ -3,10 +3,13 @@
 
 #include <QString>
 #include <QVariant>
+#include <QAtomicPointer>
 #include <TGlobal>
 #include <TLog>
 
 class TLog;
+class TLogLayout;
+class TLogSampler;
 class QTextCodec;
 
 
@@ -14,7 +17,7 @@ class T_CORE_EXPORT TLogger
 {
 public:
     TLogger();
-    virtual ~TLogger() { }
+    virtual ~TLogger();
     virtual QString key() const = 0;
     virtual bool isMultiProcessSafe() const = 0;
     virtual bool open() = 0;
@@ -29,6 +32,8 @@ public:
     const QByteArray &dateTimeFormat() const;
     Tf::LogPriority threshold() const;
     const QString &target() const;
+    bool sample(int priority);
+    void loadSamplingSettings(const QVariantMap &settings);
 
     static QByteArray logToByteArray(const TLog &log, const QByteArray &layout, const QByteArray &dateTimeFormat, QTextCodec *codec = 0);
     static QByteArray priorityToString(Tf::LogPriority priority);
@@ -38,11 +43,15 @@ protected:
     QVariant settingsValue(const QString &key, const QVariant &defaultValue = QVariant()) const;
 
 private:
+    TLogSampler *samplers();
+
     mutable QByteArray _layout;
     mutable QByteArray _dateTimeFormat;
     mutable Tf::LogPriority _threshold {(Tf::LogPriority)-1};
     mutable QString  _target;
     mutable QTextCodec *_codec {nullptr};
+    mutable QAtomicPointer<TLogLayout> _compiledLayout;
+    QAtomicPointer<TLogSampler> _samplers;  // per priority
 };
 
 #endif // TLOGGER_H
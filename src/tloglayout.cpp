@@ -0,0 +1,469 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tloglayout.h"
+#include <TLog>
+#include <TAccessLog>
+#include <TAtomic>
+#include <QDateTime>
+
+constexpr int TIMESTAMP_CACHE_SIZE = 4;
+
+namespace {
+    const char *const priorityStrings[] = {"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+    const char *const priorityLowerStrings[] = {"fatal", "error", "warn", "info", "debug", "trace"};
+
+    // Timestamp text of a second, per thread
+    struct TimestampCache {
+        uint layoutId {0};
+        qint64 secs {0};
+        int offset {0};
+        QByteArray text;
+    };
+    thread_local TimestampCache timestampCache[TIMESTAMP_CACHE_SIZE];
+
+
+    inline void appendFill(QByteArray &buffer, int count, char fill)
+    {
+        for (int i = 0; i < count; ++i) {
+            buffer += fill;
+        }
+    }
+
+
+    inline void appendId(QByteArray &buffer, const QByteArray &id)
+    {
+        if (id.isEmpty()) {
+            buffer += '-';
+        } else {
+            buffer += id;
+        }
+    }
+
+
+    void appendJsonString(QByteArray &buffer, const QByteArray &str)
+    {
+        static const char digits[] = "0123456789abcdef";
+
+        buffer += '"';
+        for (char c : str) {
+            switch (c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+            default:
+                if ((uchar)c < 0x20) {
+                    buffer += "\\u00";
+                    buffer += digits[(uchar)c >> 4];
+                    buffer += digits[c & 0xf];
+                } else {
+                    buffer += c;
+                }
+                break;
+            }
+        }
+        buffer += '"';
+    }
+
+
+    void appendNumber(QByteArray &buffer, qint64 num, int base, int width, char fill)
+    {
+        static const char digits[] = "0123456789abcdef";
+        char buf[24];
+        char *end = buf + sizeof(buf);
+        char *p = end;
+        quint64 n = (num < 0) ? -(quint64)num : (quint64)num;
+
+        do {
+            *--p = digits[n % base];
+            n /= base;
+        } while (n > 0);
+
+        int len = end - p + (num < 0);
+        if (num < 0 && fill == '0') {
+            buffer += '-';
+        }
+        if (width > len) {
+            appendFill(buffer, width - len, fill);
+        }
+        if (num < 0 && fill != '0') {
+            buffer += '-';
+        }
+        buffer.append(p, end - p);
+    }
+}
+
+/*!
+  \class TLogLayout
+  \brief The TLogLayout class formats logs by a layout compiled into a
+  list of operations.
+
+  The layout string is interpreted only once, and each log is formatted
+  by the operations without parsing it. The text of a timestamp is reused
+  within the same second unless the date-time format contains
+  milliseconds. The layout "json" formats a log as a JSON object in a
+  line.
+*/
+
+/*!
+  Constructs an empty layout of the \a kind.
+*/
+TLogLayout::TLogLayout(Kind kind) :
+    _kind(kind)
+{ }
+
+/*!
+  Constructs a layout of the \a kind compiled from the \a layout and the
+  \a dateTimeFormat.
+*/
+TLogLayout::TLogLayout(const QByteArray &layout, const QByteArray &dateTimeFormat, Kind kind) :
+    _kind(kind)
+{
+    compile(layout, dateTimeFormat);
+}
+
+
+TLogLayout::OpCode TLogLayout::opCode(char directive) const
+{
+    switch (directive) {
+    case 'd': return Timestamp;
+    case 'c': return TraceId;
+    case 'C': return SpanId;
+    default:  break;
+    }
+
+    if (_kind == ApplicationLog) {
+        switch (directive) {
+        case 'p': return PriorityLower;
+        case 'P': return Priority;
+        case 't': return ThreadId;
+        case 'T': return ThreadIdHex;
+        case 'i': return Pid;
+        case 'I': return PidHex;
+        case 'm': return Message;
+        default:  break;
+        }
+    } else {
+        switch (directive) {
+        case 'h': return RemoteHost;
+        case 'r': return Request;
+        case 's': return StatusCode;
+        case 'O': return ResponseBytes;
+        case 'q': return QueryCount;
+        case 'Q': return QueryTime;
+        default:  break;
+        }
+    }
+    return Literal;
+}
+
+/*!
+  Compiles the \a layout and the \a dateTimeFormat.
+*/
+void TLogLayout::compile(const QByteArray &layout, const QByteArray &dateTimeFormat)
+{
+    static TAtomic<uint> lastId(0);
+
+    _layout = layout;
+    _dateTimeFormat = dateTimeFormat;
+    _ops.clear();
+    _literalLength = 0;
+    _timestampCacheable = !dateTimeFormat.contains('z');
+    _json = (layout.trimmed().toLower() == "json");
+    _id = ++lastId;
+
+    if (_json) {
+        return;
+    }
+
+    QByteArray literal;
+    auto flushLiteral = [&]() {
+        if (!literal.isEmpty()) {
+            Op op;
+            op.literal = literal;
+            _ops << op;
+            _literalLength += literal.length();
+            literal.clear();
+        }
+    };
+
+    int pos = 0;
+    QByteArray dig;
+    while (pos < layout.length()) {
+        char c = layout.at(pos++);
+        if (c != '%') {
+            literal += c;
+            continue;
+        }
+
+        dig.resize(0);
+        for (;;) {
+            if (pos >= layout.length()) {
+                literal.append('%').append(dig);
+                break;
+            }
+
+            c = layout.at(pos++);
+            if (c >= '0' && c <= '9') {
+                dig += c;
+                continue;
+            }
+
+            OpCode code = opCode(c);
+            if (code != Literal) {
+                flushLiteral();
+                Op op;
+                op.code = code;
+                op.width = dig.toInt();
+                op.fill = (dig.startsWith('0')) ? '0' : ' ';
+                _ops << op;
+            } else if (c == 'n') {  // %n : newline
+                literal += '\n';
+            } else if (c == '%') {
+                literal.append('%').append(dig);
+                dig.resize(0);
+                continue;
+            } else {
+                literal.append('%').append(dig).append(c);
+            }
+            break;
+        }
+    }
+    flushLiteral();
+}
+
+
+void TLogLayout::appendTimestamp(const QDateTime &timestamp, QByteArray &buffer) const
+{
+    auto toText = [this](const QDateTime &timestamp) {
+        if (_dateTimeFormat.isEmpty()) {
+            return timestamp.toString(Qt::ISODate).toLatin1();
+        }
+        QString str = timestamp.toString(_dateTimeFormat);
+        return (_kind == AccessLog) ? str.toLocal8Bit() : str.toLatin1();
+    };
+
+    if (!_timestampCacheable || !timestamp.isValid()) {
+        buffer += toText(timestamp);
+        return;
+    }
+
+    qint64 secs = timestamp.toMSecsSinceEpoch() / 1000;
+    int offset = timestamp.offsetFromUtc();
+    auto &cache = timestampCache[_id % TIMESTAMP_CACHE_SIZE];
+    if (cache.layoutId != _id || cache.secs != secs || cache.offset != offset) {
+        cache.layoutId = _id;
+        cache.secs = secs;
+        cache.offset = offset;
+        cache.text = toText(timestamp);
+    }
+    buffer += cache.text;
+}
+
+/*!
+  Returns the text of the application log \a log.
+*/
+QByteArray TLogLayout::format(const TLog &log) const
+{
+    QByteArray buffer;
+    buffer.reserve(_literalLength + log.message.length() + 64);
+    format(log, buffer);
+    return buffer;
+}
+
+/*!
+  Appends the text of the application log \a log to the \a buffer.
+*/
+void TLogLayout::format(const TLog &log, QByteArray &buffer) const
+{
+    if (_json) {
+        formatJson(log, buffer);
+        return;
+    }
+
+    for (const auto &op : _ops) {
+        switch (op.code) {
+        case Literal:
+            buffer += op.literal;
+            break;
+
+        case Timestamp:
+            appendTimestamp(log.timestamp, buffer);
+            break;
+
+        case Priority:
+        case PriorityLower:
+            if (log.priority >= Tf::FatalLevel && log.priority <= Tf::TraceLevel) {
+                const char *pri = (op.code == Priority) ? priorityStrings[log.priority] : priorityLowerStrings[log.priority];
+                int len = qstrlen(pri);
+                buffer.append(pri, len);
+                if (op.width > len) {
+                    appendFill(buffer, op.width - len, ' ');
+                }
+            }
+            break;
+
+        case ThreadId:
+        case ThreadIdHex:
+            appendNumber(buffer, (qint64)log.threadId, (op.code == ThreadId) ? 10 : 16, op.width, op.fill);
+            break;
+
+        case Pid:
+        case PidHex:
+            appendNumber(buffer, log.pid, (op.code == Pid) ? 10 : 16, op.width, op.fill);
+            break;
+
+        case Message:
+            buffer += log.message;
+            break;
+
+        case TraceId:
+            appendId(buffer, log.traceId);
+            break;
+
+        case SpanId:
+            appendId(buffer, log.spanId);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/*!
+  Returns the text of the access log \a log.
+*/
+QByteArray TLogLayout::format(const TAccessLog &log) const
+{
+    QByteArray buffer;
+    buffer.reserve(_literalLength + log.remoteHost.length() + log.request.length() + 64);
+    format(log, buffer);
+    return buffer;
+}
+
+/*!
+  Appends the text of the access log \a log to the \a buffer.
+*/
+void TLogLayout::format(const TAccessLog &log, QByteArray &buffer) const
+{
+    if (_json) {
+        formatJson(log, buffer);
+        return;
+    }
+
+    for (const auto &op : _ops) {
+        switch (op.code) {
+        case Literal:
+            buffer += op.literal;
+            break;
+
+        case Timestamp:
+            appendTimestamp(log.timestamp, buffer);
+            break;
+
+        case RemoteHost:
+            buffer += log.remoteHost;
+            break;
+
+        case Request:
+            buffer += log.request;
+            break;
+
+        case StatusCode:
+            appendNumber(buffer, log.statusCode, 10, 0, ' ');
+            break;
+
+        case ResponseBytes:
+            appendNumber(buffer, log.responseBytes, 10, op.width, op.fill);
+            break;
+
+        case QueryCount:
+            appendNumber(buffer, log.queryCount, 10, 0, ' ');
+            break;
+
+        case QueryTime:  // milliseconds
+            if (log.queryTime < 0) {
+                buffer += '-';
+            }
+            appendNumber(buffer, qAbs(log.queryTime) / 1000, 10, 0, ' ');
+            buffer += '.';
+            appendNumber(buffer, qAbs(log.queryTime) % 1000, 10, 3, '0');
+            break;
+
+        case TraceId:
+            appendId(buffer, log.traceId);
+            break;
+
+        case SpanId:
+            appendId(buffer, log.spanId);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+
+void TLogLayout::formatJson(const TLog &log, QByteArray &buffer) const
+{
+    buffer += "{\"timestamp\":\"";
+    appendTimestamp(log.timestamp, buffer);
+    buffer += "\",\"priority\":\"";
+    if (log.priority >= Tf::FatalLevel && log.priority <= Tf::TraceLevel) {
+        buffer += priorityStrings[log.priority];
+    }
+    buffer += "\",\"pid\":";
+    appendNumber(buffer, log.pid, 10, 0, ' ');
+    buffer += ",\"thread_id\":";
+    appendNumber(buffer, (qint64)log.threadId, 10, 0, ' ');
+    if (!log.traceId.isEmpty()) {
+        buffer += ",\"trace_id\":\"";
+        buffer += log.traceId;
+        buffer += "\",\"span_id\":\"";
+        buffer += log.spanId;
+        buffer += '"';
+    }
+    buffer += ",\"message\":";
+    appendJsonString(buffer, log.message);
+    buffer += "}\n";
+}
+
+
+void TLogLayout::formatJson(const TAccessLog &log, QByteArray &buffer) const
+{
+    buffer += "{\"timestamp\":\"";
+    appendTimestamp(log.timestamp, buffer);
+    buffer += "\",\"remote_host\":";
+    appendJsonString(buffer, log.remoteHost);
+    buffer += ",\"request\":";
+    appendJsonString(buffer, log.request);
+    buffer += ",\"status\":";
+    appendNumber(buffer, log.statusCode, 10, 0, ' ');
+    buffer += ",\"bytes\":";
+    appendNumber(buffer, log.responseBytes, 10, 0, ' ');
+    buffer += ",\"query_count\":";
+    appendNumber(buffer, log.queryCount, 10, 0, ' ');
+    buffer += ",\"query_time_ms\":";
+    if (log.queryTime < 0) {
+        buffer += '-';
+    }
+    appendNumber(buffer, qAbs(log.queryTime) / 1000, 10, 0, ' ');
+    buffer += '.';
+    appendNumber(buffer, qAbs(log.queryTime) % 1000, 10, 3, '0');
+    if (!log.traceId.isEmpty()) {
+        buffer += ",\"trace_id\":\"";
+        buffer += log.traceId;
+        buffer += "\",\"span_id\":\"";
+        buffer += log.spanId;
+        buffer += '"';
+    }
+    buffer += "}\n";
+}
@@ -0,0 +1,77 @@
+#ifndef TLOGLAYOUT_H
+#define TLOGLAYOUT_H
+
+#include <QByteArray>
+#include <QVector>
+#include <TGlobal>
+
+class TLog;
+class TAccessLog;
+class QDateTime;
+
+
+class T_CORE_EXPORT TLogLayout
+{
+public:
+    enum Kind {
+        ApplicationLog,  // layout of TLogger
+        AccessLog,       // layout of TAccessLog
+    };
+
+    TLogLayout(Kind kind = ApplicationLog);
+    TLogLayout(const QByteArray &layout, const QByteArray &dateTimeFormat, Kind kind = ApplicationLog);
+
+    bool isEmpty() const { return _ops.isEmpty() && !_json; }
+    bool isJson() const { return _json; }
+    const QByteArray &layout() const { return _layout; }
+    const QByteArray &dateTimeFormat() const { return _dateTimeFormat; }
+    void compile(const QByteArray &layout, const QByteArray &dateTimeFormat);
+    QByteArray format(const TLog &log) const;
+    QByteArray format(const TAccessLog &log) const;
+    void format(const TLog &log, QByteArray &buffer) const;
+    void format(const TAccessLog &log, QByteArray &buffer) const;
+
+private:
+    enum OpCode : char {
+        Literal,
+        Timestamp,
+        Priority,
+        PriorityLower,
+        ThreadId,
+        ThreadIdHex,
+        Pid,
+        PidHex,
+        Message,
+        RemoteHost,
+        Request,
+        StatusCode,
+        ResponseBytes,
+        QueryCount,
+        QueryTime,
+        TraceId,
+        SpanId,
+    };
+
+    struct Op {
+        OpCode code {Literal};
+        int width {0};
+        char fill {' '};
+        QByteArray literal;
+    };
+
+    OpCode opCode(char directive) const;
+    void appendTimestamp(const QDateTime &timestamp, QByteArray &buffer) const;
+    void formatJson(const TLog &log, QByteArray &buffer) const;
+    void formatJson(const TAccessLog &log, QByteArray &buffer) const;
+
+    Kind _kind {ApplicationLog};
+    QByteArray _layout;
+    QByteArray _dateTimeFormat;
+    QVector<Op> _ops;
+    int _literalLength {0};
+    bool _timestampCacheable {false};
+    bool _json {false};
+    uint _id {0};
+};
+
+#endif // TLOGLAYOUT_H
@@ -0,0 +1,106 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tlogsampler.h"
+#include <ctime>
+
+/*!
+  \class TLogSampler
+  \brief The TLogSampler class thins out logs of a category by sampling
+  one in N logs and limiting the number of logs per second.
+
+  The logs suppressed by the rate limit are counted, and the count is
+  reported to the caller with the first log passing in a later second,
+  so that the caller can write a summary line. The parameters can be
+  changed while other threads are sampling.
+*/
+
+/*!
+  Sets the parameters; one in \a sampleRate logs is sampled, and at most
+  \a rateLimit logs per second pass. A \a rateLimit of 0 means unlimited.
+*/
+void TLogSampler::setParameters(int sampleRate, int rateLimit)
+{
+    _sampleRate.store(qMax(sampleRate, 1));
+    _rateLimit.store(qMax(rateLimit, 0));
+}
+
+/*!
+  Sets the parameters to the values of "<key>.SampleRate" and
+  "<key>.RateLimit" in the \a settings. The values of \a parentKey are
+  used for the ones not found.
+*/
+void TLogSampler::loadSettings(const QVariantMap &settings, const QString &key, const QString &parentKey)
+{
+    auto value = [&](const QString &name, int defaultValue) {
+        QVariant val = settings.value(key + '.' + name);
+        if (val.toString().trimmed().isEmpty() && !parentKey.isEmpty()) {
+            val = settings.value(parentKey + '.' + name);
+        }
+        bool ok;
+        int num = val.toInt(&ok);
+        return (ok) ? num : defaultValue;
+    };
+
+    setParameters(value(QLatin1String("SampleRate"), 1), value(QLatin1String("RateLimit"), 0));
+}
+
+/*!
+  Returns true if the log is to be written. If \a suppressed is not
+  nullptr, the number of logs suppressed by the rate limit in the
+  previous seconds is set to *\a suppressed when a log passes.
+*/
+bool TLogSampler::sample(quint64 *suppressed)
+{
+    return sample((_rateLimit.load() > 0) ? (qint64)std::time(nullptr) : 0, suppressed);
+}
+
+/*!
+  Returns true if the log at the \a second since the epoch is to be
+  written.
+  \sa sample(quint64*)
+*/
+bool TLogSampler::sample(qint64 second, quint64 *suppressed)
+{
+    if (suppressed) {
+        *suppressed = 0;
+    }
+
+    const int rate = _sampleRate.load();
+    if (rate > 1 && _counter.fetchAdd(1) % rate != 0) {
+        return false;
+    }
+
+    const int limit = _rateLimit.load();
+    if (limit <= 0) {
+        return true;
+    }
+
+    qint64 current = _second.load();
+    if (second != current && _second.compareExchangeStrong(current, second)) {
+        _count.store(0);  // a new second
+    }
+
+    if (_count.fetchAdd(1) >= limit) {
+        _suppressed.fetchAdd(1);
+        return false;
+    }
+
+    if (suppressed) {
+        *suppressed = _suppressed.exchange(0);
+    }
+    return true;
+}
+
+/*!
+  Returns the message of the summary line for the \a count of
+  suppressed logs.
+*/
+QByteArray TLogSampler::suppressedMessage(quint64 count)
+{
+    return "(" + QByteArray::number(count) + " logs suppressed by the rate limit)";
+}
@@ -0,0 +1,37 @@
+#ifndef TLOGSAMPLER_H
+#define TLOGSAMPLER_H
+
+#include <QByteArray>
+#include <QVariant>
+#include <TGlobal>
+#include <TAtomic>
+
+
+class T_CORE_EXPORT TLogSampler
+{
+public:
+    TLogSampler() { }
+
+    int sampleRate() const { return _sampleRate.load(); }
+    int rateLimit() const { return _rateLimit.load(); }
+    bool isEnabled() const { return sampleRate() > 1 || rateLimit() > 0; }
+    void setParameters(int sampleRate, int rateLimit);
+    void loadSettings(const QVariantMap &settings, const QString &key, const QString &parentKey = QString());
+    bool sample(quint64 *suppressed = nullptr);
+    bool sample(qint64 second, quint64 *suppressed);
+
+    static QByteArray suppressedMessage(quint64 count);
+
+private:
+    TAtomic<int> _sampleRate {1};  // 1-in-N
+    TAtomic<int> _rateLimit {0};   // per second, 0 means unlimited
+    TAtomic<quint64> _counter {0};
+    TAtomic<qint64> _second {0};
+    TAtomic<int> _count {0};       // logs in the second
+    TAtomic<quint64> _suppressed {0};
+
+    T_DISABLE_COPY(TLogSampler)
+    T_DISABLE_MOVE(TLogSampler)
+};
+
+#endif // TLOGSAMPLER_H
@@ -0,0 +1,261 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <TMongoBulkWrite>
+#include <TMongoDriver>
+#include <TActionContext>
+#include <TSystemGlobal>
+extern "C" {
+#include <mongoc.h>
+}
+
+const QString ObjectIdKey("_id");
+
+
+static TBson toUpdateDocument(const QVariantMap &document)
+{
+    if (document.contains(QStringLiteral("$set"))) {
+        return TBson::toBson(document);
+    }
+
+    QVariantMap tmp = document;
+    tmp.remove(ObjectIdKey);
+    return TBson::toBson(QStringLiteral("$set"), tmp);
+}
+
+/*!
+  \class TMongoBulkWrite
+  \brief The TMongoBulkWrite class sends a batch of write operations on a
+  collection to MongoDB in as few round trips as possible.
+
+  Operations are appended to the bulk operation of the MongoDB C driver
+  as they are called and sent by execute(). An ordered bulk write stops
+  at the first error; an unordered one performs all the operations and
+  may perform them in parallel on the server.
+  \sa TMongoQuery
+*/
+
+/*!
+  Constructs a bulk write on the \a collection of the MongoDB database of
+  the current context.
+*/
+TMongoBulkWrite::TMongoBulkWrite(const QString &collection, bool ordered) :
+    _database(Tf::currentDatabaseContext()->getKvsDatabase(Tf::KvsEngine::MongoDB)),
+    _collection(collection.trimmed()),
+    _ordered(ordered)
+{ }
+
+
+TMongoBulkWrite::~TMongoBulkWrite()
+{
+    clear();
+}
+
+/*!
+  Appends an insertion of the \a document. The '_id' field is generated
+  and set to the \a document if it does not contain one.
+*/
+bool TMongoBulkWrite::insert(QVariantMap &document)
+{
+    if (!document.contains(ObjectIdKey)) {
+        document.insert(ObjectIdKey, TBson::generateObjectId());
+    }
+    return insert(TBson::toBson(document));
+}
+
+/*!
+  Appends an insertion of the \a document converted to BSON already.
+*/
+bool TMongoBulkWrite::insert(const TBson &document)
+{
+    bson_error_t error;
+    auto *blk = bulk();
+    return blk && append(mongoc_bulk_operation_insert_with_opts(blk, (const bson_t *)document.constData(), nullptr, &error), &error);
+}
+
+/*!
+  Appends an update of a document matching the \a criteria with the
+  fields of the \a document. If the \a upsert is true, the document is
+  inserted when no document matches.
+*/
+bool TMongoBulkWrite::updateOne(const QVariantMap &criteria, const QVariantMap &document, bool upsert)
+{
+    return updateOne(criteria, toUpdateDocument(document), upsert);
+}
+
+/*!
+  Appends an update with the \a document converted to BSON already, which
+  must consist of update operators such as '$set'.
+*/
+bool TMongoBulkWrite::updateOne(const QVariantMap &criteria, const TBson &document, bool upsert)
+{
+    bson_error_t error;
+    auto *blk = bulk();
+    if (!blk) {
+        return false;
+    }
+
+    bson_t *opts = BCON_NEW("upsert", BCON_BOOL(upsert));
+    bool res = mongoc_bulk_operation_update_one_with_opts(blk, (const bson_t *)TBson::toBson(criteria).constData(),
+                                                          (const bson_t *)document.constData(), opts, &error);
+    bson_destroy(opts);
+    return append(res, &error);
+}
+
+/*!
+  Appends an update of all the documents matching the \a criteria.
+*/
+bool TMongoBulkWrite::updateMany(const QVariantMap &criteria, const QVariantMap &document, bool upsert)
+{
+    bson_error_t error;
+    auto *blk = bulk();
+    if (!blk) {
+        return false;
+    }
+
+    bson_t *opts = BCON_NEW("upsert", BCON_BOOL(upsert));
+    bool res = mongoc_bulk_operation_update_many_with_opts(blk, (const bson_t *)TBson::toBson(criteria).constData(),
+                                                           (const bson_t *)toUpdateDocument(document).constData(), opts, &error);
+    bson_destroy(opts);
+    return append(res, &error);
+}
+
+/*!
+  Appends a removal of a document matching the \a criteria.
+*/
+bool TMongoBulkWrite::removeOne(const QVariantMap &criteria)
+{
+    bson_error_t error;
+    auto *blk = bulk();
+    return blk && append(mongoc_bulk_operation_remove_one_with_opts(blk, (const bson_t *)TBson::toBson(criteria).constData(), nullptr, &error), &error);
+}
+
+/*!
+  Appends a removal of all the documents matching the \a criteria.
+*/
+bool TMongoBulkWrite::removeMany(const QVariantMap &criteria)
+{
+    bson_error_t error;
+    auto *blk = bulk();
+    return blk && append(mongoc_bulk_operation_remove_many_with_opts(blk, (const bson_t *)TBson::toBson(criteria).constData(), nullptr, &error), &error);
+}
+
+/*!
+  Sends the operations appended to the server. Returns true if all the
+  operations succeeded. The \a reply receives the counts, such as
+  'nInserted', 'nMatched', 'nModified', 'nRemoved' and 'nUpserted', and
+  the 'writeErrors' with the index of each failed operation.
+  The bulk write can be reused for other operations after this call.
+*/
+bool TMongoBulkWrite::execute(QVariantMap *reply)
+{
+    if (!_bulk || _count == 0) {
+        clear();
+        return true;
+    }
+
+    bson_t rep;
+    bson_error_t error;
+    bool res = mongoc_bulk_operation_execute(_bulk, &rep, &error);
+
+    if (reply) {
+        *reply = TBson::fromBson((TBsonObject *)&rep);
+    }
+    if (!res) {
+        tSystemError("MongoDB BulkWrite Error: %s", error.message);
+        _errorString = QString::fromUtf8(error.message);
+        driver()->setLastError(&error);
+    } else {
+        tSystemDebug("MongoDB BulkWrite  operations:%d", _count);
+    }
+
+    bson_destroy(&rep);
+    clear();
+    return res;
+}
+
+/*!
+  Returns the indexes of the insertions not performed, judging from the
+  \a reply of execute() that failed with the \a count of insertions.
+  An \a ordered bulk write performed the insertions before the first
+  error, or before 'nInserted' if no write error is reported. An
+  unordered one failed those of the 'writeErrors'; if none is reported
+  and not all are inserted, which of them failed is unknown, so all of
+  them are returned.
+*/
+QList<int> TMongoBulkWrite::failedIndexes(const QVariantMap &reply, int count, bool ordered)
+{
+    QList<int> failed;
+    const int inserted = reply.value(QStringLiteral("nInserted")).toInt();
+    const QVariantList errors = reply.value(QStringLiteral("writeErrors")).toList();
+
+    for (auto &err : errors) {
+        int index = err.toMap().value(QStringLiteral("index"), -1).toInt();
+        if (index >= 0 && index < count) {
+            failed << index;
+        }
+    }
+
+    if (ordered) {
+        int start = (failed.isEmpty()) ? inserted : failed.first();
+        failed.clear();
+        for (int i = qMax(start, 0); i < count; ++i) {
+            failed << i;
+        }
+    } else if (failed.isEmpty() && inserted < count) {
+        for (int i = 0; i < count; ++i) {
+            failed << i;
+        }
+    }
+    return failed;
+}
+
+/*!
+  Discards the operations not executed.
+*/
+void TMongoBulkWrite::clear()
+{
+    if (_bulk) {
+        mongoc_bulk_operation_destroy(_bulk);
+        _bulk = nullptr;
+    }
+    _count = 0;
+}
+
+
+TMongoDriver *TMongoBulkWrite::driver()
+{
+    return (TMongoDriver *)_database.driver();
+}
+
+
+TMongoBulkWrite::mongoc_bulk_operation_t *TMongoBulkWrite::bulk()
+{
+    if (!_bulk) {
+        if (!_database.isValid()) {
+            tSystemError("TMongoBulkWrite : driver not loaded");
+            return nullptr;
+        }
+        _bulk = driver()->createBulkOperation(_collection, _ordered);
+        if (!_bulk) {
+            tSystemError("TMongoBulkWrite : failed to create a bulk operation");
+        }
+    }
+    return _bulk;
+}
+
+
+bool TMongoBulkWrite::append(bool result, const void *error)
+{
+    if (result) {
+        _count++;
+    } else {
+        _errorString = QString::fromUtf8(((const bson_error_t *)error)->message);
+        tSystemError("MongoDB BulkWrite Error: %s", qPrintable(_errorString));
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+#ifndef TMONGOBULKWRITE_H
+#define TMONGOBULKWRITE_H
+
+#include <QVariant>
+#include <TGlobal>
+#include <TKvsDatabase>
+#include <TBson>
+
+class TMongoDriver;
+
+
+class T_CORE_EXPORT TMongoBulkWrite
+{
+public:
+    TMongoBulkWrite(const QString &collection, bool ordered = true);
+    ~TMongoBulkWrite();
+
+    bool insert(QVariantMap &document);
+    bool insert(const TBson &document);
+    bool updateOne(const QVariantMap &criteria, const QVariantMap &document, bool upsert = false);
+    bool updateOne(const QVariantMap &criteria, const TBson &document, bool upsert = false);
+    bool updateMany(const QVariantMap &criteria, const QVariantMap &document, bool upsert = false);
+    bool upsert(const QVariantMap &criteria, const QVariantMap &document) { return updateOne(criteria, document, true); }
+    bool removeOne(const QVariantMap &criteria);
+    bool removeMany(const QVariantMap &criteria);
+    int count() const { return _count; }
+    bool isOrdered() const { return _ordered; }
+
+    bool execute(QVariantMap *reply = nullptr);
+    void clear();
+    QString lastErrorString() const { return _errorString; }
+
+    static QList<int> failedIndexes(const QVariantMap &reply, int count, bool ordered);
+
+private:
+    typedef struct _mongoc_bulk_operation_t mongoc_bulk_operation_t;
+
+    TMongoDriver *driver();
+    mongoc_bulk_operation_t *bulk();
+    bool append(bool result, const void *error);
+
+    TKvsDatabase _database;
+    QString _collection;
+    bool _ordered {true};
+    mongoc_bulk_operation_t *_bulk {nullptr};
+    int _count {0};
+    QString _errorString;
+
+    T_DISABLE_COPY(TMongoBulkWrite)
+    T_DISABLE_MOVE(TMongoBulkWrite)
+};
+
+#endif // TMONGOBULKWRITE_H
@@ -47,6 +47,17 @@ QVariantMap TMongoCursor::value() const
 }
 
 
+/*!
+  Returns a view of the current document, which reads the fields on
+  demand without converting the document to QVariantMap. The view is
+  valid until next() is called.
+*/
+TBsonView TMongoCursor::valueView() const
+{
+    return TBsonView((mongoCursor) ? bsonDoc : nullptr);
+}
+
+
 QVariantList TMongoCursor::toList()
 {
     QVariantList list;
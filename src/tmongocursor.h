@@ -4,6 +4,7 @@
 #include <QVariant>
 #include <TGlobal>
 #include <TBson>
+#include <TBsonView>
 
 
 class T_CORE_EXPORT TMongoCursor
@@ -15,6 +16,7 @@ public:
 
     bool next();
     QVariantMap value() const;
+    TBsonView valueView() const;
     QVariantList toList();
 
 protected:
@@ -76,6 +76,11 @@ bool TMongoDriver::open(const QString &db, const QString &user, const QString &p
 void TMongoDriver::close()
 {
     if (isOpen()) {
+        mongoCursor->release();
+        for (auto *col : collections) {
+            mongoc_collection_destroy(col);
+        }
+        collections.clear();
         mongoc_client_destroy(mongoClient);
         mongoClient = nullptr;
     }
@@ -87,9 +92,54 @@ bool TMongoDriver::isOpen() const
     return (bool)mongoClient;
 }
 
+/*!
+  Returns the handle of the \a collection, which is created at the first
+  call and cached until the client is closed.
+*/
+mongoc_collection_t *TMongoDriver::getCollection(const QString &collection)
+{
+    mongoc_collection_t *col = collections.value(collection);
+    if (!col) {
+        col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+        if (col) {
+            collections.insert(collection, col);
+        } else {
+            tSystemError("MongoDB GetCollection Error");
+        }
+    }
+    return col;
+}
+
 
+/*!
+  Finds documents of the \a collection. The documents are fetched from
+  the server \a batchSize documents at a time while iterating the cursor;
+  if 0, the default batch size of the server is used.
+*/
 bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria, const QVariantMap &orderBy,
-                        const QStringList &fields, int limit, int skip)
+                        const QStringList &fields, int limit, int skip, int batchSize)
+{
+    return execFind(collection, TBson::toBson(criteria), TBson::toBson(orderBy), fields, limit, skip, batchSize);
+}
+
+/*!
+  Finds documents sorted by the fields of \a sortColumns in the order
+  of the list, which a QVariantMap can not keep, such as a compound
+  sort for keyset pagination.
+*/
+bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria, const QList<QPair<QString, Tf::SortOrder>> &sortColumns,
+                        const QStringList &fields, int limit, int skip, int batchSize)
+{
+    TBson sort;
+    for (auto &p : sortColumns) {
+        sort.insert(p.first, ((p.second == Tf::AscendingOrder) ? 1 : -1));
+    }
+    return execFind(collection, TBson::toBson(criteria), sort, fields, limit, skip, batchSize);
+}
+
+
+bool TMongoDriver::execFind(const QString &collection, const TBson &query, const TBson &sort,
+                            const QStringList &fields, int limit, int skip, int batchSize)
 {
     if (!isOpen()) {
         return false;
@@ -98,9 +148,8 @@ bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria,
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
     if (!col) {
-        tSystemError("MongoDB GetCollection Error");
         return false;
     }
 
@@ -109,22 +158,29 @@ bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria,
         bson_append_int64(opts, "limit", 5, limit);
     }
 
+    if (batchSize > 0) {
+        bson_append_int64(opts, "batchSize", 9, batchSize);
+    }
+
     if (! fields.isEmpty()) {
         bson_append_document(opts, "projection", 10, (bson_t *)TBson::toBson(fields).data());
     }
 
+    const bson_t *sortBson = (const bson_t *)sort.constData();
     mongoc_cursor_t *cursor = nullptr;
     if (serverVersionNumber() < 0x030200) {
-        cursor = mongoc_collection_find_with_opts(col,
-                                                  (bson_t *)TBson::toBson(criteria, orderBy).data(),
-                                                  opts, nullptr);
+        bson_t *legacy = bson_new();
+        BSON_APPEND_DOCUMENT(legacy, "$query", (const bson_t *)query.constData());
+        if (!bson_empty(sortBson)) {
+            BSON_APPEND_DOCUMENT(legacy, "$orderby", sortBson);
+        }
+        cursor = mongoc_collection_find_with_opts(col, legacy, opts, nullptr);
+        bson_destroy(legacy);
     } else {
-        if (!orderBy.isEmpty()) {
-            bson_append_document(opts, "sort", 4, (bson_t *)TBson::toBson(orderBy).data());
+        if (!bson_empty(sortBson)) {
+            bson_append_document(opts, "sort", 4, sortBson);
         }
-        cursor = mongoc_collection_find_with_opts(col,
-                                                  (bson_t *)TBson::toBson(criteria).data(),
-                                                  opts, nullptr);
+        cursor = mongoc_collection_find_with_opts(col, (const bson_t *)query.constData(), opts, nullptr);
     }
     bson_destroy(opts);
     mongoCursor->setCursor(cursor);
@@ -137,8 +193,6 @@ bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria,
     } else {
         tSystemError("MongoDB Cursor Error");
     }
-
-    mongoc_collection_destroy(col);
     return (bool)cursor;
 }
 
@@ -157,6 +211,14 @@ QVariantMap TMongoDriver::findOne(const QString &collection, const QVariantMap &
 
 
 bool TMongoDriver::insertOne(const QString &collection, const QVariantMap &object, QVariantMap *reply)
+{
+    return insertOne(collection, TBson::toBson(object), reply);
+}
+
+/*!
+  Inserts the document \a object converted to BSON already.
+*/
+bool TMongoDriver::insertOne(const QString &collection, const TBson &object, QVariantMap *reply)
 {
     if (!isOpen()) {
         return false;
@@ -165,12 +227,14 @@ bool TMongoDriver::insertOne(const QString &collection, const QVariantMap &objec
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return false;
+    }
+
     bson_t rep;
-    bool res = mongoc_collection_insert_one(col, (bson_t *)TBson::toBson(object).constData(),
+    bool res = mongoc_collection_insert_one(col, (const bson_t *)object.constData(),
                                         nullptr, &rep, &error);
-    mongoc_collection_destroy(col);
-
     if (res) {
         if (reply) {
             *reply = TBson::fromBson((TBsonObject*)&rep);
@@ -179,6 +243,7 @@ bool TMongoDriver::insertOne(const QString &collection, const QVariantMap &objec
         tSystemError("MongoDB Insert Error: %s", error.message);
         setLastError(&error);
     }
+    bson_destroy(&rep);
     return res;
 }
 
@@ -192,10 +257,13 @@ bool TMongoDriver::removeOne(const QString &collection, const QVariantMap &crite
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return false;
+    }
+
     bson_t rep;
     bool res = mongoc_collection_delete_one(col, (bson_t *)TBson::toBson(criteria).constData(), nullptr, &rep, &error);
-    mongoc_collection_destroy(col);
 
     if (res) {
         if (reply) {
@@ -205,6 +273,7 @@ bool TMongoDriver::removeOne(const QString &collection, const QVariantMap &crite
         tSystemError("MongoDB Remove Error: %s", error.message);
         setLastError(&error);
     }
+    bson_destroy(&rep);
     return res;
 }
 
@@ -218,10 +287,13 @@ bool TMongoDriver::removeMany(const QString &collection, const QVariantMap &crit
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return false;
+    }
+
     bson_t rep;
     bool res = mongoc_collection_delete_many(col, (bson_t *)TBson::toBson(criteria).constData(), nullptr, &rep, &error);
-    mongoc_collection_destroy(col);
 
     if (res) {
         if (reply) {
@@ -231,12 +303,23 @@ bool TMongoDriver::removeMany(const QString &collection, const QVariantMap &crit
         tSystemError("MongoDB Remove Error: %s", error.message);
         setLastError(&error);
     }
+    bson_destroy(&rep);
     return res;
 }
 
 
 bool TMongoDriver::updateOne(const QString &collection, const QVariantMap &criteria, const QVariantMap &object,
                              bool upsert, QVariantMap *reply)
+{
+    return updateOne(collection, TBson::toBson(criteria), TBson::toBson(object), upsert, reply);
+}
+
+/*!
+  Updates a document with the \a criteria and the \a object converted to
+  BSON already.
+*/
+bool TMongoDriver::updateOne(const QString &collection, const TBson &criteria, const TBson &object,
+                             bool upsert, QVariantMap *reply)
 {
     if (!isOpen()) {
         return false;
@@ -245,13 +328,16 @@ bool TMongoDriver::updateOne(const QString &collection, const QVariantMap &crite
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return false;
+    }
+
     bson_t rep;
     bson_t *opts = BCON_NEW("upsert", BCON_BOOL(upsert));
-    bool res = mongoc_collection_update_one(col, (bson_t *)TBson::toBson(criteria).data(),
-                                            (bson_t *)TBson::toBson(object).data(), opts, &rep, &error);
-    bson_free(opts);
-    mongoc_collection_destroy(col);
+    bool res = mongoc_collection_update_one(col, (const bson_t *)criteria.constData(),
+                                            (const bson_t *)object.constData(), opts, &rep, &error);
+    bson_destroy(opts);
 
     if (res) {
         if (reply) {
@@ -261,6 +347,7 @@ bool TMongoDriver::updateOne(const QString &collection, const QVariantMap &crite
         tSystemError("MongoDB Update Error: %s", error.message);
         setLastError(&error);
     }
+    bson_destroy(&rep);
     return res;
 }
 
@@ -274,13 +361,16 @@ bool TMongoDriver::updateMany(const QString &collection, const QVariantMap &crit
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return false;
+    }
+
     bson_t rep;
     bson_t *opts = BCON_NEW("upsert", BCON_BOOL(upsert));
     bool res = mongoc_collection_update_many(col, (bson_t *)TBson::toBson(criteria).data(),
                                             (bson_t *)TBson::toBson(object).data(), opts, &rep, &error);
-    bson_free(opts);
-    mongoc_collection_destroy(col);
+    bson_destroy(opts);
 
     if (res) {
         if (reply) {
@@ -290,6 +380,7 @@ bool TMongoDriver::updateMany(const QString &collection, const QVariantMap &crit
         tSystemError("MongoDB UpdateMulti Error: %s", error.message);
         setLastError(&error);
     }
+    bson_destroy(&rep);
     return res;
 }
 
@@ -305,14 +396,16 @@ qint64 TMongoDriver::count(const QString &collection, const QVariantMap &criteri
     bson_error_t error;
     clearError();
 
-    mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return count;
+    }
+
 #if MONGOC_CHECK_VERSION(1,11,0)
     count = mongoc_collection_count_documents(col, (bson_t *)TBson::toBson(criteria).data(), nullptr, nullptr, nullptr, &error);
 #else
     count = mongoc_collection_count(col, MONGOC_QUERY_NONE, (bson_t *)TBson::toBson(criteria).data(), 0, 0, nullptr, &error);
 #endif
-    mongoc_collection_destroy(col);
-
     if (count < 0) {
         tSystemError("MongoDB Count Error: %s", error.message);
         setLastError(&error);
@@ -321,6 +414,28 @@ qint64 TMongoDriver::count(const QString &collection, const QVariantMap &criteri
 }
 
 
+/*!
+  Creates a bulk operation on the \a collection; an \a ordered bulk
+  operation stops at the first error.
+*/
+mongoc_bulk_operation_t *TMongoDriver::createBulkOperation(const QString &collection, bool ordered)
+{
+    if (!isOpen()) {
+        return nullptr;
+    }
+
+    mongoc_collection_t *col = getCollection(collection);
+    if (!col) {
+        return nullptr;
+    }
+
+    bson_t *opts = BCON_NEW("ordered", BCON_BOOL(ordered));
+    mongoc_bulk_operation_t *bulk = mongoc_collection_create_bulk_operation_with_opts(col, opts);
+    bson_destroy(opts);
+    return bulk;
+}
+
+
 void TMongoDriver::clearError()
 {
     errorDomain = 0;
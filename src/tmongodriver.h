@@ -2,11 +2,13 @@
 #define TMONGODRIVER_H
 
 #include <QStringList>
+#include <QHash>
 #include <QVariant>
 #include <TGlobal>
 #include <TKvsDriver>
 
 class TMongoCursor;
+class TBson;
 
 
 class T_CORE_EXPORT TMongoDriver : public TKvsDriver
@@ -21,12 +23,17 @@ public:
     bool isOpen() const;
 
     bool find(const QString &collection, const QVariantMap &criteria, const QVariantMap &orderBy,
-              const QStringList &fields, int limit, int skip);
+              const QStringList &fields, int limit, int skip, int batchSize = 0);
+    bool find(const QString &collection, const QVariantMap &criteria, const QList<QPair<QString, Tf::SortOrder>> &sortColumns,
+              const QStringList &fields, int limit, int skip, int batchSize = 0);
     QVariantMap findOne(const QString &collection, const QVariantMap &criteria,
                         const QStringList &projectFields = QStringList());
     bool insertOne(const QString &collection, const QVariantMap &object, QVariantMap *reply = nullptr);
+    bool insertOne(const QString &collection, const TBson &object, QVariantMap *reply = nullptr);
     bool updateOne(const QString &collection, const QVariantMap &criteria, const QVariantMap &object,
                 bool upsert = false, QVariantMap *reply = nullptr);
+    bool updateOne(const QString &collection, const TBson &criteria, const TBson &object,
+                bool upsert = false, QVariantMap *reply = nullptr);
     bool updateMany(const QString &collection, const QVariantMap &criteria, const QVariantMap &object,
                     bool upsert = false, QVariantMap *reply = nullptr);
     bool removeOne(const QString &collection, const QVariantMap &criteria, QVariantMap *reply = nullptr);
@@ -45,18 +52,26 @@ public:
 private:
     typedef struct _bson_error_t bson_error_t;
     typedef struct _mongoc_client_t mongoc_client_t;
+    typedef struct _mongoc_collection_t mongoc_collection_t;
+    typedef struct _mongoc_bulk_operation_t mongoc_bulk_operation_t;
 
+    bool execFind(const QString &collection, const TBson &query, const TBson &sort,
+                  const QStringList &fields, int limit, int skip, int batchSize);
+    mongoc_collection_t *getCollection(const QString &collection);
+    mongoc_bulk_operation_t *createBulkOperation(const QString &collection, bool ordered);
     void clearError();
     void setLastError(const bson_error_t *error);
 
     mongoc_client_t *mongoClient {nullptr};
     TMongoCursor *mongoCursor {nullptr};
+    QHash<QString, mongoc_collection_t *> collections;
     QString dbName;
     int serverVerionNumber {-1};
     int errorDomain {0};
     int errorCode {0};
     QString errorString;
 
+    friend class TMongoBulkWrite;
     T_DISABLE_COPY(TMongoDriver)
     T_DISABLE_MOVE(TMongoDriver)
 };
@@ -7,9 +7,12 @@
 
 #include <TMongoObject>
 #include <TMongoQuery>
+#include <TMongoBulkWrite>
 #include <TAbstractModel>
 #include <QDateTime>
 #include <QMetaProperty>
+#include <TBson>
+#include <cstring>
 
 const QByteArray LockRevision("lockRevision");
 const QByteArray CreatedAt("createdAt");
@@ -71,8 +74,64 @@ void TMongoObject::setBsonData(const QVariantMap &bson)
     syncToObject();
 }
 
+/*!
+  Sets the properties to the values of the fields of the \a bson
+  directly; only the fields of the properties are converted, in a
+  single pass over the document.
+*/
+void TMongoObject::setBsonData(const TBsonView &bson)
+{
+    QSet<QByteArray> propNames;
+    const QMetaObject *metaObj = metaObject();
+    for (int i = metaObj->propertyOffset(); i < metaObj->propertyCount(); ++i) {
+        propNames << QByteArray(metaObj->property(i).name());
+    }
+
+    QVariantMap::operator=(bson.toVariantMap(propNames));
+    for (auto it = QVariantMap::constBegin(); it != QVariantMap::constEnd(); ++it) {
+        QObject::setProperty(it.key().toLatin1().constData(), it.value());
+    }
+}
+
 
 bool TMongoObject::create()
+{
+    QString id;
+    TBson doc = createDocument(id);
+
+    TMongoQuery mongo(collectionName());
+    bool ret = mongo.insert(doc);
+    if (ret) {
+        objectId() = id;
+        QVariantMap::insert(QStringLiteral("_id"), id);
+    } else {
+        QVariantMap::remove("_id");
+    }
+    return ret;
+}
+
+/*!
+  Appends the insertion of the object to the \a bulk write, which is
+  performed by TMongoBulkWrite::execute(). The object ID is set when
+  the insertion is appended.
+*/
+bool TMongoObject::create(TMongoBulkWrite &bulk)
+{
+    QString id;
+    TBson doc = createDocument(id);
+
+    bool ret = bulk.insert(doc);
+    if (ret) {
+        objectId() = id;
+        QVariantMap::insert(QStringLiteral("_id"), id);
+    } else {
+        QVariantMap::remove("_id");
+    }
+    return ret;
+}
+
+
+TBson TMongoObject::createDocument(QString &id)
 {
     // Sets the values of 'created_at', 'updated_at' or 'modified_at' properties
     for (int i = metaObject()->propertyOffset(); i < metaObject()->propertyCount(); ++i) {
@@ -89,15 +148,10 @@ bool TMongoObject::create()
         }
     }
 
-    syncToVariantMap();
-    QVariantMap::remove("_id"); // remove _id to generate internally
-
-    TMongoQuery mongo(collectionName());
-    bool ret = mongo.insert(*this);
-    if (ret) {
-        syncToObject();  // '_id' reflected
-    }
-    return ret;
+    TBson doc = syncToBson();
+    id = TBson::generateObjectId();
+    doc.insert("_id", id);
+    return doc;
 }
 
 
@@ -142,9 +196,8 @@ bool TMongoObject::update()
 
     cri["_id"] = objectId();
 
-    syncToVariantMap();
     TMongoQuery mongo(collectionName());
-    int cnt = mongo.update(cri, *this);
+    int cnt = mongo.update(cri, TBson::toBson(QStringLiteral("$set"), syncToBson()));
 
     // Optimistic lock check
     if (revIndex >= 0 && cnt == 0) {
@@ -173,11 +226,11 @@ bool TMongoObject::upsert(const QVariantMap &criteria)
         }
     }
 
-    syncToVariantMap();
+    TBson doc = syncToBson();
     QVariantMap::remove("_id");
 
     TMongoQuery mongo(collectionName());
-    return mongo.update(criteria, *this, true);
+    return mongo.update(criteria, TBson::toBson(QStringLiteral("$set"), doc), true);
 }
 
 
@@ -293,6 +346,28 @@ void TMongoObject::syncToVariantMap()
 }
 
 
+/*!
+  Converts the properties except for the object ID to BSON directly,
+  and keeps the values to compare in isModified().
+*/
+TBson TMongoObject::syncToBson()
+{
+    TBson bson;
+    QVariantMap::clear();
+
+    const QMetaObject *metaObj = metaObject();
+    for (int i = metaObj->propertyOffset(); i < metaObj->propertyCount(); ++i) {
+        const char *propName = metaObj->property(i).name();
+        QVariant value = QObject::property(propName);
+        QVariantMap::insert(QLatin1String(propName), value);
+        if (std::strcmp(propName, "_id") != 0) {
+            bson.insert(propName, value);
+        }
+    }
+    return bson;
+}
+
+
 void TMongoObject::clear()
 {
     QVariantMap::clear();
@@ -8,6 +8,9 @@
 #include <QStringList>
 #include <TGlobal>
 #include <TModelObject>
+#include <TBsonView>
+
+class TMongoBulkWrite;
 
 
 class T_CORE_EXPORT TMongoObject : public TModelObject, protected QVariantMap
@@ -21,7 +24,9 @@ public:
     virtual QString collectionName() const;
     virtual QString objectId() const { return QString(); }
     void setBsonData(const QVariantMap &bson);
+    void setBsonData(const TBsonView &bson);
     bool create() override;
+    bool create(TMongoBulkWrite &bulk);
     bool update() override;
     bool upsert(const QVariantMap &criteria);
     bool save() override;
@@ -35,6 +40,8 @@ public:
 protected:
     void syncToVariantMap();
     void syncToObject();
+    TBson syncToBson();
+    TBson createDocument(QString &id);
     virtual QString &objectId() = 0;
 };
 
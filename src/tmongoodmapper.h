@@ -4,8 +4,10 @@
 #include <QVariant>
 #include <TMongoQuery>
 #include <TMongoObject>
+#include <TMongoBulkWrite>
 #include <TCriteriaMongoConverter>
 #include <TCriteria>
+#include <TKeysetPaginator>
 
 /*!
   \class TMongoODMapper
@@ -27,9 +29,13 @@ public:
     TMongoODMapper<T> &offset(int offset);
     TMongoODMapper<T> &orderBy(int column, Tf::SortOrder order = Tf::AscendingOrder);
     TMongoODMapper<T> &orderBy(const QString &column, Tf::SortOrder order = Tf::AscendingOrder);
+    TMongoODMapper<T> &batchSize(int size);
+    TMongoODMapper<T> &projection(const QList<int> &columns);
 
     void setLimit(int limit);
     void setOffset(int offset);
+    void setBatchSize(int size);
+    void setProjection(const QList<int> &columns);
     void setSortOrder(int column, Tf::SortOrder order = Tf::AscendingOrder);
     void setSortOrder(const QString &column, Tf::SortOrder order = Tf::AscendingOrder);
 
@@ -38,11 +44,13 @@ public:
     T findFirstBy(int column, QVariant value);
     T findByObjectId(const QString &id);
     bool find(const TCriteria &cri = TCriteria());
+    bool find(const TCriteria &cri, TKeysetPaginator &paginator);
     bool findBy(int column, QVariant value);
     bool findIn(int column, const QVariantList &values);
     bool next();
     T value() const;
 
+    int insertAll(QList<T> &objects, bool ordered = true);
     int findCount(const TCriteria &cri = TCriteria());
     int findCountBy(int column, QVariant value);
     int updateAll(const TCriteria &cri, int column, QVariant value);
@@ -50,8 +58,14 @@ public:
     int removeAll(const TCriteria &cri = TCriteria());
 
 private:
+    T findOneDocument(const QVariantMap &criteria);
+
     QString sortColumn;
     Tf::SortOrder sortOrder;
+    QStringList projectionFields;
+    TKeysetPaginator *keysetPaginator {nullptr};
+    QStringList keysetFields;
+    int keysetCount {0};
 
     T_DISABLE_COPY(TMongoODMapper)
     T_DISABLE_MOVE(TMongoODMapper)
@@ -87,6 +101,35 @@ inline void TMongoODMapper<T>::setOffset(int offset)
 }
 
 
+/*!
+  Sets the number of documents fetched from the server at a time while
+  iterating with next() to \a size; the documents are converted one at
+  a time by value().
+*/
+template <class T>
+inline void TMongoODMapper<T>::setBatchSize(int size)
+{
+    TMongoQuery::setBatchSize(size);
+}
+
+/*!
+  Limits the fields of the documents found by find() to the \a columns
+  and the object ID. The other properties of the objects are left with
+  the default values, so the objects must not be saved.
+*/
+template <class T>
+inline void TMongoODMapper<T>::setProjection(const QList<int> &columns)
+{
+    projectionFields.clear();
+    for (int column : columns) {
+        QString field = TCriteriaMongoConverter<T>::propertyName(column);
+        if (!field.isEmpty()) {
+            projectionFields << field;
+        }
+    }
+}
+
+
 template <class T>
 inline void TMongoODMapper<T>::setSortOrder(int column, Tf::SortOrder order)
 {
@@ -146,51 +189,135 @@ inline TMongoODMapper<T> &TMongoODMapper<T>::orderBy(const QString &column, Tf::
 
 
 template <class T>
-inline T TMongoODMapper<T>::findOne(const TCriteria &criteria)
+inline TMongoODMapper<T> &TMongoODMapper<T>::batchSize(int size)
+{
+    setBatchSize(size);
+    return *this;
+}
+
+
+template <class T>
+inline TMongoODMapper<T> &TMongoODMapper<T>::projection(const QList<int> &columns)
+{
+    setProjection(columns);
+    return *this;
+}
+
+/*!
+  Finds a document with the \a criteria and maps it to the object
+  directly from BSON.
+*/
+template <class T>
+inline T TMongoODMapper<T>::findOneDocument(const QVariantMap &criteria)
 {
     T t;
-    QVariantMap doc = TMongoQuery::findOne(TCriteriaMongoConverter<T>(criteria).toVariantMap());
-    if (!doc.isEmpty()) {
-        t.setBsonData(doc);
+    int oldLimit = TMongoQuery::limit();
+    int oldOffset = TMongoQuery::offset();
+    TMongoQuery::setLimit(1);
+    TMongoQuery::setOffset(0);
+
+    if (TMongoQuery::find(criteria) && TMongoQuery::next()) {
+        TBsonView doc = TMongoQuery::valueView();
+        if (!doc.isEmpty()) {
+            t.setBsonData(doc);
+        }
     }
+    TMongoQuery::setLimit(oldLimit);
+    TMongoQuery::setOffset(oldOffset);
     return t;
 }
 
 
+template <class T>
+inline T TMongoODMapper<T>::findOne(const TCriteria &criteria)
+{
+    return findOneDocument(TCriteriaMongoConverter<T>(criteria).toVariantMap());
+}
+
+
 template <class T>
 inline T TMongoODMapper<T>::findFirstBy(int column, QVariant value)
 {
-    T t;
-    TCriteria cri(column, value);
-    QVariantMap doc = TMongoQuery::findOne(TCriteriaMongoConverter<T>(cri).toVariantMap());
-    if (!doc.isEmpty()) {
-        t.setBsonData(doc);
-    }
-    return t;
+    return findOne(TCriteria(column, value));
 }
 
 
 template <class T>
 inline T TMongoODMapper<T>::findByObjectId(const QString &id)
 {
-    T t;
-    QVariantMap doc = TMongoQuery::findById(id);
-    if (!doc.isEmpty()) {
-        t.setBsonData(doc);
+    if (id.isEmpty()) {
+        tError("TMongoODMapper::findByObjectId : ObjectId not found");
+        return T();
     }
-    return t;
+    return findOneDocument(QVariantMap({{QStringLiteral("_id"), id}}));
 }
 
 
 template <class T>
 inline bool TMongoODMapper<T>::find(const TCriteria &criteria)
 {
+    keysetPaginator = nullptr;
     QVariantMap order;
     if (!sortColumn.isEmpty()) {
         order.insert(sortColumn, ((sortOrder == Tf::AscendingOrder) ? 1 : -1));
     }
 
-    return TMongoQuery::find(TCriteriaMongoConverter<T>(criteria).toVariantMap(), order);
+    return TMongoQuery::find(TCriteriaMongoConverter<T>(criteria).toVariantMap(), order, projectionFields);
+}
+
+
+/*!
+  Finds the documents of the page of the keyset \a paginator with the
+  criteria \a cri. The documents are sorted by the fields of the
+  paginator and sought past its cursor without skip; the sort order and
+  the offset set to this mapper are not used. The cursor of the next
+  page is set to the \a paginator while iterating with next(), so the
+  \a paginator must be alive until then.
+  \sa TKeysetPaginator
+*/
+template <class T>
+inline bool TMongoODMapper<T>::find(const TCriteria &criteria, TKeysetPaginator &paginator)
+{
+    const QList<int> columns = paginator.columns();
+    if (columns.isEmpty()) {
+        tError("No columns for keyset pagination  [%s:%d]", __FILE__, __LINE__);
+        return false;
+    }
+
+    QList<QPair<QString, Tf::SortOrder>> sortColumns;
+    keysetFields.clear();
+    for (int column : columns) {
+        QString field = TCriteriaMongoConverter<T>::propertyName(column);
+        sortColumns << qMakePair(field, paginator.sortOrder());
+        keysetFields << field;
+    }
+
+    QVariantMap query = TCriteriaMongoConverter<T>(criteria).toVariantMap();
+    QVariantMap seek = TCriteriaMongoConverter<T>(paginator.criteria()).toVariantMap();
+    if (!seek.isEmpty()) {
+        query = (query.isEmpty()) ? seek : QVariantMap({{"$and", QVariantList({query, seek})}});
+    }
+
+    int oldLimit = TMongoQuery::limit();
+    int oldOffset = TMongoQuery::offset();
+    TMongoQuery::setLimit(paginator.itemCountPerPage());
+    TMongoQuery::setOffset(0);
+    QStringList fields = projectionFields;
+    if (!fields.isEmpty()) {
+        for (auto &field : keysetFields) {
+            if (!fields.contains(field)) {
+                fields << field;
+            }
+        }
+    }
+    bool ret = TMongoQuery::find(query, sortColumns, fields);
+    TMongoQuery::setLimit(oldLimit);
+    TMongoQuery::setOffset(oldOffset);
+
+    keysetPaginator = (ret) ? &paginator : nullptr;
+    keysetCount = 0;
+    paginator.setPageResult(0, QVariantList());
+    return ret;
 }
 
 
@@ -211,7 +338,16 @@ inline bool TMongoODMapper<T>::findIn(int column, const QVariantList &values)
 template <class T>
 inline bool TMongoODMapper<T>::next()
 {
-    return TMongoQuery::next();
+    bool ret = TMongoQuery::next();
+    if (ret && keysetPaginator) {
+        TBsonView doc = TMongoQuery::valueView();
+        QVariantList lastValues;
+        for (auto &field : keysetFields) {
+            lastValues << doc.value(field);
+        }
+        keysetPaginator->setPageResult(++keysetCount, lastValues);
+    }
+    return ret;
 }
 
 
@@ -219,7 +355,7 @@ template <class T>
 inline T TMongoODMapper<T>::value() const
 {
     T t;
-    QVariantMap doc = TMongoQuery::value();
+    TBsonView doc = TMongoQuery::valueView();
     if (!doc.isEmpty()) {
         t.setBsonData(doc);
     }
@@ -227,6 +363,41 @@ inline T TMongoODMapper<T>::value() const
 }
 
 
+/*!
+  Inserts the \a objects with a bulk write in as few round trips as
+  possible, and returns the number of the objects inserted. An \a ordered
+  insertion stops at the first error. The object IDs of the objects not
+  inserted are cleared.
+  \sa TMongoBulkWrite
+*/
+template <class T>
+inline int TMongoODMapper<T>::insertAll(QList<T> &objects, bool ordered)
+{
+    TMongoBulkWrite bulk(T().collectionName(), ordered);
+    QList<int> indexes;  // indexes of the objects appended
+
+    for (int i = 0; i < objects.count(); ++i) {
+        if (objects[i].create(bulk)) {
+            indexes << i;
+        } else if (ordered) {
+            break;
+        }
+    }
+
+    QVariantMap reply;
+    bool res = bulk.execute(&reply);
+    int inserted = reply.value(QStringLiteral("nInserted")).toInt();
+
+    // Clears the object IDs of the objects not inserted
+    if (!res) {
+        for (int j : TMongoBulkWrite::failedIndexes(reply, indexes.count(), ordered)) {
+            objects[indexes[j]].clear();
+        }
+    }
+    return inserted;
+}
+
+
 template <class T>
 inline int TMongoODMapper<T>::findCount(const TCriteria &criteria)
 {
@@ -41,7 +41,8 @@ TMongoQuery::TMongoQuery(const TMongoQuery &other) :
     _database(other._database),
     _collection(other._collection),
     _queryLimit(other._queryLimit),
-    _queryOffset(other._queryOffset)
+    _queryOffset(other._queryOffset),
+    _batchSize(other._batchSize)
 { }
 
 /*!
@@ -53,6 +54,7 @@ TMongoQuery &TMongoQuery::operator=(const TMongoQuery &other)
     _collection = other._collection;
     _queryLimit = other._queryLimit;
     _queryOffset = other._queryOffset;
+    _batchSize = other._batchSize;
     return *this;
 }
 
@@ -68,7 +70,21 @@ bool TMongoQuery::find(const QVariantMap &criteria, const QVariantMap &orderBy,
         tSystemError("TMongoQuery::find : driver not loaded");
         return false;
     }
-    return driver()->find(_collection, criteria, orderBy, fields, _queryLimit, _queryOffset);
+    return driver()->find(_collection, criteria, orderBy, fields, _queryLimit, _queryOffset, _batchSize);
+}
+
+/*!
+  Finds documents by the criteria \a criteria in the collection, sorted
+  by the fields of \a sortColumns in the order of the list.
+  \sa TMongoQuery::next()
+*/
+bool TMongoQuery::find(const QVariantMap &criteria, const QList<QPair<QString, Tf::SortOrder>> &sortColumns, const QStringList &fields)
+{
+    if (!_database.isValid()) {
+        tSystemError("TMongoQuery::find : driver not loaded");
+        return false;
+    }
+    return driver()->find(_collection, criteria, sortColumns, fields, _queryLimit, _queryOffset, _batchSize);
 }
 
 /*!
@@ -95,6 +111,19 @@ QVariantMap TMongoQuery::value() const
     return driver()->cursor().value();
 }
 
+/*!
+  Returns a view of the current document, which reads the fields on
+  demand without converting the entire document. The view is valid
+  until next() is called.
+*/
+TBsonView TMongoQuery::valueView() const
+{
+    if (!_database.isValid()) {
+        return TBsonView();
+    }
+    return driver()->cursor().valueView();
+}
+
 /*!
   Finds documents by the criteria \a criteria in the collection
   and returns a retrieved document as a QVariantMap object.
@@ -137,6 +166,19 @@ bool TMongoQuery::insert(QVariantMap &document)
         // Sets Object ID
         document.insert(ObjectIdKey, TBson::generateObjectId());
     }
+    return insert(TBson::toBson(document));
+}
+
+/*!
+  Inserts the document \a document converted to BSON already, which
+  must contain the '_id' field.
+*/
+bool TMongoQuery::insert(const TBson &document)
+{
+    if (!_database.isValid()) {
+        tSystemError("TMongoQuery::insert : driver not loaded");
+        return false;
+    }
 
     int insertedCount = -1;
     QVariantMap reply;
@@ -210,8 +252,25 @@ int TMongoQuery::update(const QVariantMap &criteria, const QVariantMap &document
         doc = tmp;
     }
 
+    return update(criteria, TBson::toBson(doc), upsert);
+}
+
+/*!
+  Updates an existing document of the selection criteria \a criteria in
+  the collection with the \a document converted to BSON already, which
+  must consist of update operators such as '$set'.
+*/
+int TMongoQuery::update(const QVariantMap &criteria, const TBson &document, bool upsert)
+{
+    int modifiedCount = -1;
+
+    if (!_database.isValid()) {
+        tSystemError("TMongoQuery::update : driver not loaded");
+        return modifiedCount;
+    }
+
     QVariantMap reply;
-    bool res = driver()->updateOne(_collection, criteria, doc, upsert, &reply);
+    bool res = driver()->updateOne(_collection, TBson::toBson(criteria), document, upsert, &reply);
     if (res) {
         modifiedCount = reply.value(QStringLiteral("modifiedCount")).toInt();
     }
@@ -358,6 +417,15 @@ const TMongoDriver *TMongoQuery::driver() const
 */
 
 
+/*!
+  \fn void TMongoQuery::setBatchSize(int size)
+  Sets the number of documents fetched from the server at a time while
+  iterating the documents found, to \a size. If 0, the default batch
+  size of the server is used.
+  \sa TMongoQuery::next()
+*/
+
+
 /*!
   \fn void TMongoQuery::lastError() const
   Returns the VariantMap object of the error status of the last operation.
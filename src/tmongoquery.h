@@ -5,6 +5,7 @@
 #include <QStringList>
 #include <TGlobal>
 #include <TKvsDatabase>
+#include <TBsonView>
 
 class TMongoDriver;
 
@@ -20,14 +21,20 @@ public:
     void setLimit(int limit);
     int offset() const;
     void setOffset(int offset);
+    int batchSize() const;
+    void setBatchSize(int size);
     bool find(const QVariantMap &criteria = QVariantMap(), const QVariantMap &orderBy = QVariantMap(), const QStringList &fields = QStringList());
+    bool find(const QVariantMap &criteria, const QList<QPair<QString, Tf::SortOrder>> &sortColumns, const QStringList &fields = QStringList());
     bool next();
     QVariantMap value() const;
+    TBsonView valueView() const;
 
     QVariantMap findOne(const QVariantMap &criteria = QVariantMap(), const QStringList &fields = QStringList());
     QVariantMap findById(const QString &id, const QStringList &fields = QStringList());
     bool insert(QVariantMap &document);
+    bool insert(const TBson &document);
     int update(const QVariantMap &criteria, const QVariantMap &document, bool upsert = false);
+    int update(const QVariantMap &criteria, const TBson &document, bool upsert = false);
     bool updateById(const QVariantMap &document);
     int updateMulti(const QVariantMap &criteria, const QVariantMap &document);
     int remove(const QVariantMap &criteria);
@@ -48,6 +55,7 @@ private:
     QString _collection;
     int _queryLimit {0};
     int _queryOffset {0};
+    int _batchSize {0};
 
     friend class TCacheMongoStore;
 };
@@ -76,4 +84,16 @@ inline void TMongoQuery::setOffset(int offset)
     _queryOffset = offset;
 }
 
+
+inline int TMongoQuery::batchSize() const
+{
+    return _batchSize;
+}
+
+
+inline void TMongoQuery::setBatchSize(int size)
+{
+    _batchSize = size;
+}
+
 #endif // TMONGOQUERY_H
@@ -0,0 +1,106 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tpoolwaitqueue.h"
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+/*!
+  \class TPoolWaitQueue
+  \brief The TPoolWaitQueue class is a FIFO queue of threads waiting for
+  a pooled connection to be released. It also keeps the statistics of
+  the pool.
+
+  A released connection is handed over to the thread at the head of the
+  queue directly, so that no other thread can take it first.
+*/
+
+/*!
+  Waits up to \a msecs milliseconds until a connection is handed over to
+  this thread, and sets its name to \a name; \a cached is set to true if
+  the connection is open. If nobody is waiting, the \a take function is
+  called under the lock first, so that a release between the caller's
+  check and the wait is never lost. Returns false on timeout.
+*/
+bool TPoolWaitQueue::wait(int msecs, const std::function<bool(QString &, bool &)> &take, QString &name, bool &cached)
+{
+    QMutexLocker locker(&_mutex);
+    if (_waiters.isEmpty() && take(name, cached)) {
+        return true;
+    }
+
+    Waiter waiter;
+    _waiters.append(&waiter);
+    _waiterCount++;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!waiter.signaled) {
+        qint64 remaining = msecs - timer.elapsed();
+        if (remaining <= 0 || !waiter.cond.wait(&_mutex, (ulong)remaining)) {
+            break;
+        }
+    }
+
+    _waiters.removeOne(&waiter);
+    _waiterCount--;
+
+    if (!waiter.signaled) {
+        return false;
+    }
+    name = waiter.name;
+    cached = waiter.cached;
+    return true;
+}
+
+/*!
+  Hands over the connection \a name to the thread at the head of the
+  queue, or calls the \a push function to return it to the pool if
+  nobody is waiting. \a cached is true if the connection is open.
+*/
+void TPoolWaitQueue::release(const QString &name, bool cached, const std::function<void()> &push)
+{
+    QMutexLocker locker(&_mutex);
+    for (auto *waiter : _waiters) {
+        if (!waiter->signaled) {
+            waiter->name = name;
+            waiter->cached = cached;
+            waiter->signaled = true;
+            waiter->cond.wakeOne();
+            return;
+        }
+    }
+    push();
+}
+
+
+void TPoolWaitQueue::recordAcquire(qint64 waitMsecs, bool waited)
+{
+    _acquire++;
+    if (waited) {
+        _waited++;
+        _totalWaitMsecs.fetchAdd((quint64)waitMsecs);
+
+        quint64 max = _maxWaitMsecs.load();
+        while ((quint64)waitMsecs > max && !_maxWaitMsecs.compareExchange(max, (quint64)waitMsecs)) { }
+    }
+}
+
+
+TPoolStatistics TPoolWaitQueue::statistics() const
+{
+    TPoolStatistics stats;
+    stats.acquireCount = _acquire.load();
+    stats.waitCount = _waited.load();
+    stats.exhaustedCount = _exhausted.load();
+    stats.totalWaitMsecs = _totalWaitMsecs.load();
+    stats.maxWaitMsecs = _maxWaitMsecs.load();
+    stats.validationFailures = _validationFailures.load();
+    stats.expiredCount = _expired.load();
+    stats.waitingCount = _waiterCount.load();
+    return stats;
+}
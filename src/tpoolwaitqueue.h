@@ -0,0 +1,65 @@
+#ifndef TPOOLWAITQUEUE_H
+#define TPOOLWAITQUEUE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+#include <TGlobal>
+#include <functional>
+#include "tatomic.h"
+#include "tatomicptr.h"
+
+
+struct T_CORE_EXPORT TPoolStatistics
+{
+    quint64 acquireCount {0};       //!< Number of connections handed out.
+    quint64 waitCount {0};          //!< Number of acquisitions that had to wait.
+    quint64 exhaustedCount {0};     //!< Number of acquisitions that timed out.
+    quint64 totalWaitMsecs {0};     //!< Accumulated waiting time in msecs.
+    quint64 maxWaitMsecs {0};       //!< Longest waiting time in msecs.
+    quint64 validationFailures {0}; //!< Number of connections dropped by validation.
+    quint64 expiredCount {0};       //!< Number of connections closed by max life time.
+    int idleCount {0};              //!< Number of pooled idle connections.
+    int waitingCount {0};           //!< Number of threads currently waiting.
+};
+
+
+class T_CORE_EXPORT TPoolWaitQueue
+{
+public:
+    TPoolWaitQueue() {}
+
+    bool hasWaiters() const { return _waiterCount.load() > 0; }
+    bool wait(int msecs, const std::function<bool(QString &, bool &)> &take, QString &name, bool &cached);
+    void release(const QString &name, bool cached, const std::function<void()> &push);
+    void recordAcquire(qint64 waitMsecs, bool waited);
+    void recordExhausted() { _exhausted++; }
+    void recordValidationFailure() { _validationFailures++; }
+    void recordExpired() { _expired++; }
+    TPoolStatistics statistics() const;
+
+private:
+    struct Waiter {
+        QWaitCondition cond;
+        bool signaled {false};
+        QString name;         // connection handed over
+        bool cached {false};  // true if the connection is open
+    };
+
+    mutable QMutex _mutex;
+    QList<Waiter *> _waiters;
+    TAtomic<int> _waiterCount {0};
+    TAtomic<quint64> _acquire {0};
+    TAtomic<quint64> _waited {0};
+    TAtomic<quint64> _exhausted {0};
+    TAtomic<quint64> _totalWaitMsecs {0};
+    TAtomic<quint64> _maxWaitMsecs {0};
+    TAtomic<quint64> _validationFailures {0};
+    TAtomic<quint64> _expired {0};
+
+    T_DISABLE_COPY(TPoolWaitQueue)
+    T_DISABLE_MOVE(TPoolWaitQueue)
+};
+
+#endif // TPOOLWAITQUEUE_H
@@ -9,7 +9,10 @@
 #include "tsystemglobal.h"
 #include "twebsocket.h"
 #include "tsystembus.h"
+#include "tredissubscriber.h"
+#include <TCache>
 #include <TWebApplication>
+#include <TAppSettings>
 #ifdef Q_OS_LINUX
 # include "tepollwebsocket.h"
 #endif
@@ -17,6 +20,44 @@
 #include <QSet>
 
 static QMutex mutex(QMutex::NonRecursive);
+constexpr auto REDIS_CHANNEL_PREFIX = "tf:websocket:";
+constexpr int ORIGIN_ID_LEN = 8;
+
+namespace {
+
+bool redisPublisherEnabled()
+{
+    static bool enabled = Tf::appSettings()->value(Tf::WebSocketEnableRedisPublisher, false).toBool();
+    return enabled;
+}
+
+// ID of this process not to receive the messages it published
+const QByteArray &originId()
+{
+    static const QByteArray id = []() {
+        quint64 num = Tf::random(UINT64_MAX);
+        return QByteArray((const char *)&num, ORIGIN_ID_LEN);
+    }();
+    return id;
+}
+
+QByteArray redisChannel(const QString &topic)
+{
+    return REDIS_CHANNEL_PREFIX + topic.toUtf8();
+}
+
+// Message of a type byte, the origin ID and the data
+QByteArray redisMessage(Tf::SystemOpCode opcode, const QByteArray &data)
+{
+    QByteArray message;
+    message.reserve(1 + ORIGIN_ID_LEN + data.length());
+    message += (char)opcode;
+    message += originId();
+    message += data;
+    return message;
+}
+
+}
 
 
 class Pub : public QObject
@@ -103,6 +144,10 @@ void Pub::publish(const QByteArray &binary, const QObject *sender)
 /*!
   \class TPublisher
   \brief The TPublisher class provides a means of publish subscribe messaging for websocket.
+
+  If WebSocket.EnableRedisPublisher is true, messages are published through
+  Redis channels to the subscribers in all the hosts; otherwise, through
+  the system bus to those in the same host.
 */
 
 TPublisher *TPublisher::instance()
@@ -161,6 +206,9 @@ void TPublisher::unsubscribeFromAll(TAbstractWebSocket *socket)
 
         if (pub->subscriberCounter() == 0) {
             tSystemDebug("release topic: %s", qPrintable(it.key()));
+            if (redisPublisherEnabled()) {
+                TRedisSubscriber::instance()->unsubscribe(redisChannel(it.key()));
+            }
             it.remove();
             delete pub;
         }
@@ -197,7 +245,9 @@ QObject *TPublisher::castToObject(TAbstractWebSocket *socket)
 
 void TPublisher::publish(const QString &topic, const QString &text, TAbstractWebSocket *socket)
 {
-    if (Tf::app()->maxNumberOfAppServers() > 1) {
+    if (redisPublisherEnabled()) {
+        TRedisSubscriber::instance()->publish(redisChannel(topic), redisMessage(Tf::WebSocketPublishText, text.toUtf8()));
+    } else if (Tf::app()->maxNumberOfAppServers() > 1) {
         TSystemBus::instance()->send(Tf::WebSocketPublishText, topic, text.toUtf8());
     }
 
@@ -211,7 +261,9 @@ void TPublisher::publish(const QString &topic, const QString &text, TAbstractWeb
 
 void TPublisher::publish(const QString &topic, const QByteArray &binary, TAbstractWebSocket *socket)
 {
-    if (Tf::app()->maxNumberOfAppServers() > 1) {
+    if (redisPublisherEnabled()) {
+        TRedisSubscriber::instance()->publish(redisChannel(topic), redisMessage(Tf::WebSocketPublishBinary, binary));
+    } else if (Tf::app()->maxNumberOfAppServers() > 1) {
         TSystemBus::instance()->send(Tf::WebSocketPublishBinary, topic, binary);
     }
 
@@ -249,6 +301,10 @@ void TPublisher::receiveSystemBus()
             }
             break; }
 
+        case Tf::CacheInvalidate:
+            TCache::invalidateNearCache(msg.data());
+            break;
+
         default:
             tSystemError("Internal Error  [%s:%d]", __FILE__, __LINE__);
             break;
@@ -257,12 +313,39 @@ void TPublisher::receiveSystemBus()
 }
 
 
+void TPublisher::receiveRedisMessage(const QByteArray &channel, const QByteArray &message)
+{
+    if (message.length() <= ORIGIN_ID_LEN || message.mid(1, ORIGIN_ID_LEN) == originId()) {
+        return;  // published by this process
+    }
+
+    QString topic = QString::fromUtf8(channel.mid((int)strlen(REDIS_CHANNEL_PREFIX)));
+    QByteArray data = message.mid(1 + ORIGIN_ID_LEN);
+    QMutexLocker locker(&mutex);
+
+    Pub *pub = get(topic);
+    if (pub) {
+        if (message.at(0) == Tf::WebSocketPublishText) {
+            pub->publish(QString::fromUtf8(data), nullptr);
+        } else {
+            pub->publish(data, nullptr);
+        }
+    }
+}
+
+
 Pub *TPublisher::create(const QString &topic)
 {
     auto *pub = new Pub(topic);
     pub->moveToThread(Tf::app()->thread());
     pubobj.insert(topic, pub);
     tSystemDebug("create topic: %s", qPrintable(topic));
+
+    if (redisPublisherEnabled()) {
+        TRedisSubscriber::instance()->subscribe(redisChannel(topic), [](const QByteArray &channel, const QByteArray &message) {
+            TPublisher::instance()->receiveRedisMessage(channel, message);
+        });
+    }
     return pub;
 }
 
@@ -277,6 +360,9 @@ void TPublisher::release(const QString &topic)
 {
     Pub *pub = pubobj.take(topic);
     if (pub) {
+        if (redisPublisherEnabled()) {
+            TRedisSubscriber::instance()->unsubscribe(redisChannel(topic));
+        }
         delete pub;
         tSystemDebug("release topic: %s  (total topics:%d)", qPrintable(topic), pubobj.count());
     }
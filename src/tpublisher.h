@@ -32,6 +32,7 @@ protected slots:
 
 private:
     TPublisher();
+    void receiveRedisMessage(const QByteArray &channel, const QByteArray &message);
     QMap<QString, Pub*> pubobj;
 
     T_DISABLE_COPY(TPublisher)
@@ -97,6 +97,24 @@ bool TRedis::exists(const QByteArray &key)
     return (res && resp.value(0).toInt() == 1);
 }
 
+/*!
+  Set the \a key to hold the \a value and set the key to timeout after
+  a given number of \a seconds, only if the key does not exist.
+  Returns true if the key was set.
+*/
+bool TRedis::setNxEx(const QByteArray &key, const QByteArray &value, int seconds)
+{
+    if (!driver()) {
+        return false;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "SET", key, value, "NX", "EX", QByteArray::number(seconds) };
+    bool res = driver()->request(command, resp);
+    // Replies +OK if set, otherwise a null bulk string
+    return (res && resp.isEmpty());
+}
+
 /*!
   Returns the value associated with the \a key; otherwise
   returns an empty bit array.
@@ -204,6 +222,79 @@ int TRedis::del(const QByteArrayList &keys)
     return (res) ? resp.value(0).toInt() : 0;
 }
 
+/*!
+  Sets a timeout of \a seconds on the \a key. Returns false if the key
+  does not exist.
+ */
+bool TRedis::expire(const QByteArray &key, int seconds)
+{
+    if (!driver()) {
+        return false;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "EXPIRE", key, QByteArray::number(seconds) };
+    bool res = driver()->request(command, resp);
+    return (res && resp.value(0).toInt() == 1);
+}
+
+/*!
+  Returns the values of all the specified \a keys in order. For a key that
+  does not exist, a null byte array is returned in its place.
+ */
+QByteArrayList TRedis::mget(const QByteArrayList &keys)
+{
+    if (!driver() || keys.isEmpty()) {
+        return QByteArrayList();
+    }
+
+    TRedisReply reply;
+    QByteArrayList command = { "MGET" };
+    command << keys;
+    bool res = driver()->request(command, reply);
+    return (res) ? reply.toByteArrayList() : QByteArrayList();
+}
+
+/*!
+  Sets the keys to hold the values of the \a pairs of a key and a value
+  atomically.
+ */
+bool TRedis::mset(const QList<QPair<QByteArray, QByteArray>> &pairs)
+{
+    if (!driver()) {
+        return false;
+    }
+    if (pairs.isEmpty()) {
+        return true;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "MSET" };
+    for (auto &p : pairs) {
+        command << p.first << p.second;
+    }
+    return driver()->request(command, resp);
+}
+
+/*!
+  Sets the keys to hold the values of the \a pairs of a key and a value
+  and set them to timeout after a given number of \a seconds. The
+  commands are sent at once in a pipeline.
+ */
+bool TRedis::msetEx(const QList<QPair<QByteArray, QByteArray>> &pairs, int seconds)
+{
+    QList<QByteArrayList> commands;
+    QByteArray secs = QByteArray::number(seconds);
+
+    for (auto &p : pairs) {
+        commands << QByteArrayList({ "SETEX", p.first, secs, p.second });
+    }
+
+    bool ok;
+    pipeline(commands, &ok);
+    return ok;
+}
+
 /*!
   Inserts all the \a values at the tail of the list stored at the \a key.
   Returns the length of the list after the push operation.
@@ -247,16 +338,10 @@ QByteArrayList TRedis::lrange(const QByteArray &key, int start, int end = -1)
         return QByteArrayList();
     }
 
-    QByteArrayList ret;
-    QVariantList resp;
+    TRedisReply reply;
     QByteArrayList command = { "LRANGE", key, QByteArray::number(start), QByteArray::number(end) };
-    bool res = driver()->request(command, resp);
-    if (res) {
-        for (auto &var : (const QVariantList&)resp) {
-            ret << var.toByteArray();
-        }
-    }
-    return ret;
+    bool res = driver()->request(command, reply);
+    return (res) ? reply.toByteArrayList() : QByteArrayList();
 }
 
 /*!
@@ -404,22 +489,205 @@ QList<QPair<QByteArray, QByteArray>> TRedis::hgetAll(const QByteArray &key)
         return ret;
     }
 
-    QVariantList resp;
+    TRedisReply reply;
     QByteArrayList command = { "HGETALL", key };
-    bool res = driver()->request(command, resp);
+    bool res = driver()->request(command, reply);
     if (res) {
-        for (QListIterator<QVariant> it(resp); it.hasNext(); ) {
-            QByteArray f = it.next().toByteArray();
-            if (!it.hasNext()) {
+        ret.reserve(reply.count() / 2);
+        for (auto it = reply.begin(); it != reply.end(); ++it) {
+            QByteArray f = (*it).toByteArray();
+            if (++it == reply.end()) {
                 break;
             }
-            QByteArray v = it.next().toByteArray();
-            ret << qMakePair(f, v);
+            ret << qMakePair(f, (*it).toByteArray());
+        }
+    }
+    return ret;
+}
+
+/*!
+  Posts the \a message to the \a channel. Returns the number of clients
+  that received the message. To receive messages, use TRedisSubscriber.
+ */
+int TRedis::publish(const QByteArray &channel, const QByteArray &message)
+{
+    if (!driver()) {
+        return 0;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "PUBLISH", channel, message };
+    bool res = driver()->request(command, resp);
+    return (res) ? resp.value(0).toInt() : 0;
+}
+
+/*!
+  Appends an entry of the \a fields to the stream stored at the \a key
+  and returns the ID of the entry. If \a maxlen is greater than 0, the
+  stream is trimmed to approximately that length.
+ */
+QByteArray TRedis::xadd(const QByteArray &key, const QList<QPair<QByteArray, QByteArray>> &fields, int maxlen)
+{
+    if (!driver()) {
+        return QByteArray();
+    }
+
+    TRedisReply reply;
+    QByteArrayList command = { "XADD", key };
+    if (maxlen > 0) {
+        command << "MAXLEN" << "~" << QByteArray::number(maxlen);
+    }
+    command << "*";
+    for (auto &f : fields) {
+        command << f.first << f.second;
+    }
+    bool res = driver()->request(command, reply);
+    return (res) ? reply.toByteArray() : QByteArray();
+}
+
+/*!
+  Creates the consumer \a group of the stream stored at the \a key,
+  which delivers the entries after the \a id; the stream is created if
+  it does not exist. Returns false if the group already exists.
+ */
+bool TRedis::xgroupCreate(const QByteArray &key, const QByteArray &group, const QByteArray &id)
+{
+    if (!driver()) {
+        return false;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "XGROUP", "CREATE", key, group, id, "MKSTREAM" };
+    return driver()->request(command, resp);
+}
+
+/*!
+  Reads at most \a count entries of the stream stored at the \a key as
+  the \a consumer of the \a group. The \a id ">" reads entries never
+  delivered to the group, and "0" reads those pending for the consumer.
+  If \a blockMsecs is greater than 0, waits for entries up to that
+  number of milliseconds, which is limited to 4000 because the
+  connection is shared.
+ */
+QList<TRedisStreamEntry> TRedis::xreadGroup(const QByteArray &group, const QByteArray &consumer, const QByteArray &key, int count, int blockMsecs, const QByteArray &id)
+{
+    QList<TRedisStreamEntry> ret;
+    if (!driver()) {
+        return ret;
+    }
+
+    TRedisReply reply;
+    QByteArrayList command = { "XREADGROUP", "GROUP", group, consumer, "COUNT", QByteArray::number(count) };
+    if (blockMsecs > 0) {
+        command << "BLOCK" << QByteArray::number(qMin(blockMsecs, 4000));
+    }
+    command << "STREAMS" << key << id;
+    bool res = driver()->request(command, reply);
+
+    // Replies as [[key, [[id, [field, value, ..]], ..]]], or null if timed out
+    if (res) {
+        const auto entries = reply.at(0).at(1);
+        for (const auto &e : entries) {
+            TRedisStreamEntry entry;
+            entry.id = e.at(0).toByteArray();
+            const auto fields = e.at(1);
+            for (auto it = fields.begin(); it != fields.end(); ++it) {
+                QByteArray f = (*it).toByteArray();
+                if (++it == fields.end()) {
+                    break;
+                }
+                entry.fields << qMakePair(f, (*it).toByteArray());
+            }
+            ret << entry;
         }
     }
     return ret;
 }
 
+/*!
+  Acknowledges the entries of the \a ids as processed by the \a group
+  of the stream stored at the \a key. Returns the number of entries
+  acknowledged.
+ */
+int TRedis::xack(const QByteArray &key, const QByteArray &group, const QByteArrayList &ids)
+{
+    if (!driver() || ids.isEmpty()) {
+        return 0;
+    }
+
+    QVariantList resp;
+    QByteArrayList command = { "XACK", key, group };
+    command << ids;
+    bool res = driver()->request(command, resp);
+    return (res) ? resp.value(0).toInt() : 0;
+}
+
+/*!
+  Evaluates the Lua \a script on the server with the \a keys and
+  \a args, which the script reads as KEYS and ARGV, and returns the
+  reply. If \a ok is not null, it is set to false if the script fails.
+ */
+QVariantList TRedis::eval(const QByteArray &script, const QByteArrayList &keys, const QByteArrayList &args, bool *ok)
+{
+    QVariantList resp;
+    bool res = false;
+
+    if (driver()) {
+        QByteArrayList command = { "EVAL", script, QByteArray::number(keys.count()) };
+        command << keys << args;
+        res = driver()->request(command, resp);
+    }
+    if (ok) {
+        *ok = res;
+    }
+    return resp;
+}
+
+/*!
+  Sends all the \a commands at once and returns their replies in order,
+  which saves the round trip times of sending them one by one. Each
+  command is a list of its name and arguments, such as
+  {"INCR", "counter"}. If \a ok is not null, it is set to false if any
+  of the commands fails; the reply of a failed command is empty.
+ */
+QList<QVariantList> TRedis::pipeline(const QList<QByteArrayList> &commands, bool *ok)
+{
+    QList<QVariantList> resps;
+    bool res = false;
+
+    if (driver()) {
+        res = driver()->request(commands, resps);
+    }
+    if (ok) {
+        *ok = res;
+    }
+    return resps;
+}
+
+/*!
+  Executes all the \a commands atomically in a MULTI/EXEC transaction
+  sent at once, and returns the replies of the commands in order.
+  A reply of an array is returned as a QVariantList in the list, and
+  that of a command failed in the transaction as an invalid QVariant.
+  If \a ok is not null, it is set to false if the transaction is not
+  executed.
+ */
+QVariantList TRedis::transaction(const QList<QByteArrayList> &commands, bool *ok)
+{
+    QList<QByteArrayList> cmds;
+    cmds.reserve(commands.count() + 2);
+    cmds << QByteArrayList({ "MULTI" }) << commands << QByteArrayList({ "EXEC" });
+
+    bool res = false;
+    QList<QVariantList> resps = pipeline(cmds, &res);
+    // Replies QUEUED to each command and then the replies of all by EXEC
+    res = res && resps.count() == cmds.count() && resps.last().count() == commands.count();
+    if (ok) {
+        *ok = res;
+    }
+    return (res) ? resps.last() : QVariantList();
+}
+
 
 void TRedis::flushDb()
 {
@@ -11,6 +11,12 @@
 class TRedisDriver;
 
 
+struct TRedisStreamEntry {
+    QByteArray id;
+    QList<QPair<QByteArray, QByteArray>> fields;
+};
+
+
 class T_CORE_EXPORT TRedis
 {
 public:
@@ -26,6 +32,7 @@ public:
     bool set(const QByteArray &key, const QByteArray &value);
     bool setEx(const QByteArray &key, const QByteArray &value, int seconds);
     bool setNx(const QByteArray &key, const QByteArray &value);
+    bool setNxEx(const QByteArray &key, const QByteArray &value, int seconds);
     QByteArray getSet(const QByteArray &key, const QByteArray &value);
 
     // string
@@ -37,6 +44,12 @@ public:
 
     bool del(const QByteArray &key);
     int del(const QByteArrayList &keys);
+    bool expire(const QByteArray &key, int seconds);
+
+    // multiple keys
+    QByteArrayList mget(const QByteArrayList &keys);
+    bool mset(const QList<QPair<QByteArray, QByteArray>> &pairs);
+    bool msetEx(const QList<QPair<QByteArray, QByteArray>> &pairs, int seconds);
 
     // binary list
     int rpush(const QByteArray &key, const QByteArrayList &values);
@@ -64,6 +77,22 @@ public:
     int hlen(const QByteArray &key);
     QList<QPair<QByteArray, QByteArray>> hgetAll(const QByteArray &key);
 
+    // pub/sub
+    int publish(const QByteArray &channel, const QByteArray &message);
+
+    // stream
+    QByteArray xadd(const QByteArray &key, const QList<QPair<QByteArray, QByteArray>> &fields, int maxlen = 0);
+    bool xgroupCreate(const QByteArray &key, const QByteArray &group, const QByteArray &id = "$");
+    QList<TRedisStreamEntry> xreadGroup(const QByteArray &group, const QByteArray &consumer, const QByteArray &key, int count = 1, int blockMsecs = 0, const QByteArray &id = ">");
+    int xack(const QByteArray &key, const QByteArray &group, const QByteArrayList &ids);
+
+    // scripting
+    QVariantList eval(const QByteArray &script, const QByteArrayList &keys, const QByteArrayList &args, bool *ok = nullptr);
+
+    // pipeline and transaction
+    QList<QVariantList> pipeline(const QList<QByteArrayList> &commands, bool *ok = nullptr);
+    QVariantList transaction(const QList<QByteArrayList> &commands, bool *ok = nullptr);
+
     void flushDb();
 
 private:
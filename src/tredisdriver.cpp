@@ -21,211 +21,115 @@ bool TRedisDriver::command(const QString &cmd)
 
 bool TRedisDriver::request(const QByteArrayList &command, QVariantList &response)
 {
-    if (Q_UNLIKELY(!isOpen())) {
-        tSystemError("Not open Redis session  [%s:%d]", __FILE__, __LINE__);
-        return false;
-    }
-
-    bool ret = true;
-    bool ok = false;
-    QByteArray str;
-
-    QByteArray cmd = toMultiBulk(command);
-    tSystemDebug("Redis command: %s", cmd.data());
-    if (! writeCommand(cmd)) {
-        tSystemError("Redis write error  [%s:%d]", __FILE__, __LINE__);
-        close();
-        return false;
-    }
-    clearBuffer();
-
-    for (;;) {
-        if (! readReply()) {
-            tSystemError("Redis read error   pos:%d  buflen:%d", _pos, _buffer.length());
-            close();
-            break;
-        }
-
-        switch (_buffer.at(_pos)) {
-        case Error:
-            ret = false;
-            str = getLine(&ok);
-            tSystemError("Redis error response: %s", qPrintable(str));
-            break;
-
-        case SimpleString:
-            str = getLine(&ok);
-            tSystemDebug("Redis response: %s", qPrintable(str));
-            break;
-
-        case Integer: {
-            _pos++;
-            int num = getNumber(&ok);
-            if (ok) {
-                response << num;
-            }
-            break; }
-
-        case BulkString:
-            str = parseBulkString(&ok);
-            if (ok) {
-                response << str;
-            }
-            break;
-
-        case Array:
-            response = parseArray(&ok);
-            if (!ok) {
-                response.clear();
-            }
-            break;
-
-        default:
-            tSystemError("Invalid protocol: %c  [%s:%d]", _buffer.at(_pos), __FILE__, __LINE__);
-            ret = false;
-            clearBuffer();
-            close();
-            goto parse_done;
-            break;
-        }
-
-        if (ok) {
-            if (_pos < _buffer.length()) {
-                tSystemError("Invalid format  [%s:%d]", __FILE__, __LINE__);
-            }
-            clearBuffer();
-            break;
-        }
+    QList<TRedisReply> replies;
+    bool ret = request(QList<QByteArrayList>({command}), replies);
+    response = toResponse(replies.value(0));
+    return ret;
+}
 
-        _pos = 0;
-        // retry to read..
-    }
 
-parse_done:
+bool TRedisDriver::request(const QByteArrayList &command, TRedisReply &reply)
+{
+    QList<TRedisReply> replies;
+    bool ret = request(QList<QByteArrayList>({command}), replies);
+    reply = replies.value(0);
     return ret;
 }
 
 
-QByteArray TRedisDriver::getLine(bool *ok)
+bool TRedisDriver::request(const QList<QByteArrayList> &commands, QList<QVariantList> &responses)
 {
-    int idx = _buffer.indexOf(CRLF, _pos);
-    if (idx < 0) {
-        *ok = false;
-        return QByteArray();
-    }
+    QList<TRedisReply> replies;
+    bool ret = request(commands, replies);
 
-    QByteArray ret = _buffer.mid(_pos, idx);
-    _pos = idx + 2;
-    *ok = true;
+    responses.clear();
+    for (auto &reply : (const QList<TRedisReply> &)replies) {
+        responses << toResponse(reply);
+    }
     return ret;
 }
 
-
-QByteArray TRedisDriver::parseBulkString(bool *ok)
+/*!
+  Sends all the \a commands at once and reads their replies in order into
+  \a replies. Returns false if any of them replies an error.
+*/
+bool TRedisDriver::request(const QList<QByteArrayList> &commands, QList<TRedisReply> &replies)
 {
-    QByteArray str;
-    int startpos = _pos;
-
-    Q_ASSERT((int)_buffer[_pos] == BulkString);
-    _pos++;
-
-    int len = getNumber(ok);
-    if (*ok) {
-        if (len < -1) {
-            tSystemError("Invalid length: %d  [%s:%d]", len, __FILE__, __LINE__);
-            *ok = false;
-        } else if (len == -1) {
-            // null string
-            tSystemDebug("Null string parsed");
-        } else {
-            if (_pos + 2 <= _buffer.length()) {
-                str = (len > 0) ? _buffer.mid(_pos, len) : QByteArray("");
-                _pos += len + 2;
-            } else {
-                *ok = false;
-            }
-        }
-    }
+    replies.clear();
 
-    if (! *ok) {
-        _pos = startpos;
+    if (Q_UNLIKELY(!isOpen())) {
+        tSystemError("Not open Redis session  [%s:%d]", __FILE__, __LINE__);
+        return false;
     }
-    return str;
-}
 
+    if (commands.isEmpty()) {
+        return true;
+    }
 
-QVariantList TRedisDriver::parseArray(bool *ok)
-{
-    QVariantList lst;
-    int startpos = _pos;
-    *ok = false;
-
-    Q_ASSERT((int)_buffer[_pos] == Array);
-    _pos++;
-
-    int count = getNumber(ok);
-    while (*ok) {
-        switch (_buffer[_pos]) {
-        case BulkString: {
-            auto str = parseBulkString(ok);
-            if (*ok) {
-                lst << str;
-            }
-            break; }
+    QByteArray cmd;
+    for (auto &c : commands) {
+        cmd += toMultiBulk(c);
+    }
+    tSystemDebug("Redis command: %s", cmd.data());
+    if (! writeCommand(cmd)) {
+        tSystemError("Redis write error  [%s:%d]", __FILE__, __LINE__);
+        close();
+        return false;
+    }
+    _parser.clear();
 
-        case Integer: {
-            _pos++;
-            int num = getNumber(ok);
-            if (*ok) {
-                lst << num;
+    bool ret = true;
+    while (replies.count() < commands.count()) {
+        switch (_parser.parse()) {
+        case TRedisReplyParser::Completed: {
+            auto reply = _parser.takeReply();
+            if (reply.isError()) {
+                ret = false;
+                tSystemError("Redis error response: %s", reply.toByteArray().data());
             }
+            replies << reply;
             break; }
 
-        case Array: {
-            auto var = parseArray(ok);
-            if (*ok) {
-                lst << QVariant(var);
+        case TRedisReplyParser::Incomplete:
+            if (! readReply()) {
+                tSystemError("Redis read error  buflen:%d", _parser.buffer().length());
+                _parser.clear();
+                close();
+                return false;
             }
-            break; }
-
-        default:
-            tSystemError("Bad logic  [%s:%d]", __FILE__, __LINE__);
-            *ok = false;
             break;
-        }
 
-        if (lst.count() >= count) {
-            break;
+        default:
+            tSystemError("Invalid protocol  [%s:%d]", __FILE__, __LINE__);
+            _parser.clear();
+            close();
+            return false;
         }
     }
 
-    if (! *ok) {
-        _pos = startpos;
+    if (_parser.hasPendingData()) {
+        tSystemError("Invalid format  [%s:%d]", __FILE__, __LINE__);
     }
-    return lst;
+    _parser.clear();
+    return ret;
 }
 
-
-int TRedisDriver::getNumber(bool *ok)
+/*!
+  Converts the \a reply into the response list; an array is converted
+  into the list of its elements, and a status or an error into an empty
+  list.
+*/
+QVariantList TRedisDriver::toResponse(const TRedisReply &reply)
 {
-    int idx = _buffer.indexOf(CRLF, _pos);
-    if (idx < 0) {
-        *ok = false;
-        return 0;
+    switch (reply.type()) {
+    case TRedisReply::Invalid:
+    case TRedisReply::SimpleString:
+    case TRedisReply::Error:
+    case TRedisReply::BlobError:
+        return QVariantList();
+    default:
+        return (reply.isAggregate()) ? reply.toVariantList() : QVariantList({reply.toVariant()});
     }
-
-    int num = _buffer.mid(_pos, idx - _pos).toInt();
-    _pos = idx + 2;
-    *ok = true;
-    tSystemDebug("getNumber: %d", num);
-    return num;
-}
-
-
-void TRedisDriver::clearBuffer()
-{
-    _buffer.resize(0);
-    _pos = 0;
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <TGlobal>
 #include <TKvsDriver>
+#include "tredisreply.h"
 #include <QString>
 #include <QVariant>
 #include <QtGlobal>
@@ -23,26 +24,18 @@ public:
     bool isOpen() const override;
     void moveToThread(QThread *thread) override;
     bool request(const QByteArrayList &command, QVariantList &response);
+    bool request(const QByteArrayList &command, TRedisReply &reply);
+    bool request(const QList<QByteArrayList> &commands, QList<QVariantList> &responses);
+    bool request(const QList<QByteArrayList> &commands, QList<TRedisReply> &replies);
 
-protected:
-    enum DataType {
-        SimpleString = '+',
-        Error        = '-',
-        Integer      = ':',
-        BulkString   = '$',
-        Array        = '*',
-    };
+    static QByteArray toBulk(const QByteArray &data);
+    static QByteArray toMultiBulk(const QByteArrayList &data);
 
+protected:
     bool writeCommand(const QByteArray &command);
     bool readReply();
-    QByteArray parseBulkString(bool *ok);
-    QVariantList parseArray(bool *ok);
-    QByteArray getLine(bool *ok);
-    int getNumber(bool *ok);
-    void clearBuffer();
 
-    static QByteArray toBulk(const QByteArray &data);
-    static QByteArray toMultiBulk(const QByteArrayList &data);
+    static QVariantList toResponse(const TRedisReply &reply);
 
 private:
 #ifdef Q_OS_UNIX
@@ -50,8 +43,7 @@ private:
 #else
     QTcpSocket *_client {nullptr};
 #endif
-    QByteArray _buffer;
-    int _pos {0};
+    TRedisReplyParser _parser;
     QString _host;
     quint16 _port {0};
 
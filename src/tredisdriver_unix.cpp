@@ -19,9 +19,7 @@ constexpr int RECV_BUF_SIZE = 128 * 1024;
 
 TRedisDriver::TRedisDriver() :
     TKvsDriver()
-{
-    _buffer.reserve(1023);
-}
+{ }
 
 
 TRedisDriver::~TRedisDriver()
@@ -117,19 +115,16 @@ bool TRedisDriver::readReply()
         return false;
     }
 
-    QByteArray buf;
-    buf.reserve(RECV_BUF_SIZE);
+    // Receives into the buffer of the parser directly
+    QByteArray &buffer = _parser.buffer();
     int timeout = 5000;
     int len = 0;
 
     while (tf_poll_recv(_socket, timeout) == 0) {
-        len = tf_recv(_socket, buf.data(), RECV_BUF_SIZE, 0);
-        if (len <= 0) {
-            break;
-        }
-
-        buf.resize(len);
-        _buffer += buf;
+        int size = buffer.size();
+        buffer.resize(size + RECV_BUF_SIZE);
+        len = tf_recv(_socket, buffer.data() + size, RECV_BUF_SIZE, 0);
+        buffer.resize(size + qMax(len, 0));
         if (len < RECV_BUF_SIZE) {
             break;
         }
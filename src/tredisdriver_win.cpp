@@ -19,9 +19,7 @@ constexpr int RECV_BUF_SIZE = 128 * 1024;
 
 TRedisDriver::TRedisDriver() :
     TKvsDriver()
-{
-    _buffer.reserve(1023);
-}
+{ }
 
 
 TRedisDriver::~TRedisDriver()
@@ -105,13 +103,11 @@ bool TRedisDriver::readReply()
 
     bool ret = _client->waitForReadyRead(5000);
     if (ret) {
-        _buffer += _client->readAll();
+        _parser.append(_client->readAll());
     } else {
         tSystemWarn("Redis response timeout");
     }
 
-    //tSystemDebug("#Redis response length: %d", _buffer.length());
-    //tSystemDebug("#Redis response data: %s", _buffer.data());
     return ret;
 }
 
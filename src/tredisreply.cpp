@@ -0,0 +1,510 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tredisreply.h"
+#include <climits>
+#include <cstring>
+
+constexpr char Attribute = '|';  // RESP3 attribute, skipped
+constexpr int MAX_DEPTH = 64;
+constexpr int MAX_LINE_LENGTH = 1024 * 1024;
+constexpr qint64 MAX_BULK_LENGTH = 512 * 1024 * 1024;
+
+
+static bool parseNumber(const char *p, int length, qint64 *num)
+{
+    const char *end = p + length;
+    bool neg = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+
+    if (p == end) {
+        return false;
+    }
+
+    qint64 n = 0;
+    for (; p < end; ++p) {
+        if (*p < '0' || *p > '9' || n > (LLONG_MAX - 9) / 10) {
+            return false;
+        }
+        n = n * 10 + (*p - '0');
+    }
+    *num = (neg) ? -n : n;
+    return true;
+}
+
+/*!
+  \class TRedisReply
+  \brief The TRedisReply class represents a reply of Redis in RESP2 or
+  RESP3, parsed by TRedisReplyParser.
+
+  Strings are slices of the received buffer shared by all the elements of
+  a reply, so that no element is copied until it is converted by
+  toByteArray() or toVariant(). Elements of aggregates, such as arrays
+  and maps, are accessed by at() or iterators; a map is a sequence of
+  keys and values.
+*/
+
+const TRedisReplyNode *TRedisReply::node() const
+{
+    return (_d && _idx < _d->nodes.count()) ? _d->nodes.constData() + _idx : nullptr;
+}
+
+/*!
+  Returns the type of the reply.
+*/
+TRedisReply::Type TRedisReply::type() const
+{
+    auto n = node();
+    return (n) ? (Type)n->type : Invalid;
+}
+
+/*!
+  Returns true if the reply is a null, such as a null bulk string or a
+  null array of RESP2, or a null of RESP3.
+*/
+bool TRedisReply::isNull() const
+{
+    auto n = node();
+    return !n || n->length < 0;
+}
+
+/*!
+  Returns true if the reply is an array, a map, a set or a push.
+*/
+bool TRedisReply::isAggregate() const
+{
+    switch (type()) {
+    case Array:
+    case Map:
+    case Set:
+    case Push:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+  Returns the number of the elements if the reply is an aggregate;
+  otherwise returns 0. For a map, returns twice the number of pairs.
+*/
+int TRedisReply::count() const
+{
+    return (isAggregate() && !isNull()) ? node()->length : 0;
+}
+
+/*!
+  Returns the element at the \a index of the aggregate.
+*/
+TRedisReply TRedisReply::at(int index) const
+{
+    if (index < 0 || index >= count()) {
+        return TRedisReply();
+    }
+
+    int idx = _idx + 1;
+    for (int i = 0; i < index; ++i) {
+        idx = _d->nodes.at(idx).next;
+    }
+    return TRedisReply(_d, idx);
+}
+
+
+TRedisReply::const_iterator TRedisReply::begin() const
+{
+    return (count() > 0) ? const_iterator(_d, _idx + 1) : end();
+}
+
+
+TRedisReply::const_iterator TRedisReply::end() const
+{
+    auto n = node();
+    return const_iterator(_d, (n) ? n->next : 0);
+}
+
+
+TRedisReply::const_iterator &TRedisReply::const_iterator::operator++()
+{
+    _idx = _d->nodes.at(_idx).next;
+    return *this;
+}
+
+/*!
+  Returns a pointer to the string of the reply, which is not
+  '\\0'-terminated. Returns nullptr for a null or an aggregate.
+*/
+const char *TRedisReply::data() const
+{
+    auto n = node();
+    return (n && !isAggregate() && n->length >= 0) ? _d->buffer.constData() + n->offset : nullptr;
+}
+
+/*!
+  Returns the length of the string of the reply.
+*/
+int TRedisReply::size() const
+{
+    return (data()) ? node()->length : 0;
+}
+
+/*!
+  Returns the string of the reply without copying it. It is valid as long
+  as the reply exists.
+*/
+QByteArray TRedisReply::view() const
+{
+    const char *d = data();
+    return (d) ? QByteArray::fromRawData(d, size()) : QByteArray();
+}
+
+/*!
+  Returns a copy of the string of the reply.
+*/
+QByteArray TRedisReply::toByteArray() const
+{
+    const char *d = data();
+    return (d) ? QByteArray(d, size()) : QByteArray();
+}
+
+/*!
+  Returns the reply converted to an integer.
+*/
+qint64 TRedisReply::toInteger(bool *ok) const
+{
+    qint64 num = 0;
+    bool res = false;
+
+    switch (type()) {
+    case Integer:
+    case SimpleString:
+    case BulkString:
+    case BigNumber:
+        res = parseNumber(data(), size(), &num);
+        break;
+    case Boolean:
+        num = toBool();
+        res = true;
+        break;
+    default:
+        break;
+    }
+
+    if (ok) {
+        *ok = res;
+    }
+    return (res) ? num : 0;
+}
+
+/*!
+  Returns the reply converted to a double.
+*/
+double TRedisReply::toDouble(bool *ok) const
+{
+    switch (type()) {
+    case Double:
+    case SimpleString:
+    case BulkString:
+        return view().toDouble(ok);
+    default:
+        return toInteger(ok);
+    }
+}
+
+/*!
+  Returns the reply converted to a boolean.
+*/
+bool TRedisReply::toBool() const
+{
+    switch (type()) {
+    case Boolean:
+        return size() == 1 && *data() == 't';
+    case Integer:
+        return toInteger() != 0;
+    default:
+        return false;
+    }
+}
+
+/*!
+  Returns copies of the strings of the elements of the aggregate.
+*/
+QByteArrayList TRedisReply::toByteArrayList() const
+{
+    QByteArrayList list;
+    list.reserve(count());
+    for (const auto &elem : *this) {
+        list << elem.toByteArray();
+    }
+    return list;
+}
+
+/*!
+  Returns the reply converted to a QVariant; an aggregate is converted to
+  a QVariantList, and an error to an invalid QVariant.
+*/
+QVariant TRedisReply::toVariant() const
+{
+    switch (type()) {
+    case SimpleString:
+    case BulkString:
+    case VerbatimString:
+    case BigNumber:
+        return QVariant(toByteArray());
+    case Integer:
+        return QVariant(toInteger());
+    case Double:
+        return QVariant(toDouble());
+    case Boolean:
+        return QVariant(toBool());
+    case Array:
+    case Map:
+    case Set:
+    case Push:
+        return QVariant(toVariantList());
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+  Returns the elements of the aggregate converted to QVariant.
+*/
+QVariantList TRedisReply::toVariantList() const
+{
+    QVariantList list;
+    list.reserve(count());
+    for (const auto &elem : *this) {
+        list << elem.toVariant();
+    }
+    return list;
+}
+
+/*!
+  \class TRedisReplyParser
+  \brief The TRedisReplyParser class parses replies of Redis in RESP2 or
+  RESP3 incrementally.
+
+  Data received is appended to buffer() and parse() is called; if it
+  returns Incomplete, the parser keeps the position and resumes from it
+  when called again after more data is appended.
+*/
+
+TRedisReplyParser::TRedisReplyParser()
+{
+    _buffer.reserve(1023);
+}
+
+/*!
+  Returns the buffer to append received data to.
+*/
+QByteArray &TRedisReplyParser::buffer()
+{
+    if (_start > 0) {
+        // Leaves the buffer to the replies taken, copying only the rest
+        int shift = _start;
+        _buffer = _buffer.mid(shift);
+        _pos -= shift;
+        _start = 0;
+        for (auto &node : _nodes) {
+            node.offset -= shift;
+        }
+    }
+    return _buffer;
+}
+
+/*!
+  Parses the data in the buffer. Returns Completed if a reply is parsed
+  entirely, which is taken by takeReply().
+*/
+TRedisReplyParser::Result TRedisReplyParser::parse()
+{
+    if (_completed) {
+        return Completed;
+    }
+
+    while (_pos < _buffer.length()) {
+        const char *buf = _buffer.constData();
+        const int len = _buffer.length();
+        const char *cr = (const char *)std::memchr(buf + _pos, '\r', len - _pos);
+
+        if (!cr) {
+            return (len - _pos > MAX_LINE_LENGTH) ? Failed : Incomplete;
+        }
+        if (cr + 1 == buf + len) {
+            return Incomplete;
+        }
+        if (cr[1] != '\n') {
+            return Failed;
+        }
+
+        TRedisReplyNode node;
+        node.type = buf[_pos];
+        node.offset = _pos + 1;
+        node.length = cr - buf - node.offset;
+        int end = cr - buf + 2;
+        bool aggregate = false;
+        qint64 num;
+
+        switch (node.type) {
+        case TRedisReply::SimpleString:
+        case TRedisReply::Error:
+        case TRedisReply::Double:
+        case TRedisReply::BigNumber:
+            break;
+
+        case TRedisReply::Integer:
+            if (!parseNumber(buf + node.offset, node.length, &num)) {
+                return Failed;
+            }
+            break;
+
+        case TRedisReply::Boolean:
+            if (node.length != 1 || (buf[node.offset] != 't' && buf[node.offset] != 'f')) {
+                return Failed;
+            }
+            break;
+
+        case TRedisReply::Null:
+            if (node.length != 0) {
+                return Failed;
+            }
+            node.length = -1;
+            break;
+
+        case TRedisReply::BulkString:
+        case TRedisReply::BlobError:
+        case TRedisReply::VerbatimString:
+            if (!parseNumber(buf + node.offset, node.length, &num) || num < -1 || num > MAX_BULK_LENGTH) {
+                return Failed;
+            }
+            if (num < 0) {
+                node.length = -1;  // null bulk string of RESP2
+                break;
+            }
+            if (end + num + 2 > len) {
+                return Incomplete;
+            }
+            if (buf[end + num] != '\r' || buf[end + num + 1] != '\n') {
+                return Failed;
+            }
+            node.offset = end;
+            node.length = (int)num;
+            end += (int)num + 2;
+
+            if (node.type == TRedisReply::VerbatimString) {
+                // Skips the format such as 'txt:'
+                if (node.length < 4 || buf[node.offset + 3] != ':') {
+                    return Failed;
+                }
+                node.offset += 4;
+                node.length -= 4;
+            }
+            break;
+
+        case TRedisReply::Array:
+        case TRedisReply::Map:
+        case TRedisReply::Set:
+        case TRedisReply::Push:
+        case Attribute:
+            if (!parseNumber(buf + node.offset, node.length, &num) || num < -1 || num > INT_MAX / 2) {
+                return Failed;
+            }
+            if (num < 0) {
+                node.length = -1;  // null array of RESP2
+                break;
+            }
+            node.length = (node.type == TRedisReply::Map || node.type == Attribute) ? num * 2 : num;
+            aggregate = (node.length > 0);
+            break;
+
+        default:
+            return Failed;
+        }
+
+        _pos = end;
+        int index = _nodes.count();
+        _nodes << node;
+
+        if (aggregate) {
+            if (_stack.count() >= MAX_DEPTH) {
+                return Failed;
+            }
+            _stack << Aggregate {index, node.length};
+        } else if (completeNode(index) == Completed) {
+            _completed = true;
+            return Completed;
+        }
+    }
+    return Incomplete;
+}
+
+
+TRedisReplyParser::Result TRedisReplyParser::completeNode(int index)
+{
+    for (;;) {
+        _nodes[index].next = _nodes.count();
+
+        if (_nodes[index].type == Attribute) {
+            // Attributes are auxiliary data of the reply that follows
+            _nodes.resize(index);
+            return Incomplete;
+        }
+
+        if (_stack.isEmpty()) {
+            return Completed;
+        }
+
+        Aggregate &parent = _stack.last();
+        if (--parent.remaining > 0) {
+            return Incomplete;
+        }
+        index = parent.index;
+        _stack.removeLast();
+    }
+}
+
+/*!
+  Takes the reply parsed and starts parsing the next.
+*/
+TRedisReply TRedisReplyParser::takeReply()
+{
+    if (!_completed) {
+        return TRedisReply();
+    }
+
+    auto data = QSharedPointer<TRedisReplyData>::create();
+    data->buffer = _buffer;
+    data->nodes.swap(_nodes);
+    _stack.clear();
+    _completed = false;
+
+    if (_pos < _buffer.length()) {
+        _start = _pos;
+    } else {
+        _buffer = QByteArray();
+        _pos = 0;
+        _start = 0;
+    }
+    return TRedisReply(data, 0);
+}
+
+/*!
+  Discards the data and the state of parsing.
+*/
+void TRedisReplyParser::clear()
+{
+    _buffer.resize(0);
+    _pos = 0;
+    _start = 0;
+    _nodes.resize(0);
+    _stack.resize(0);
+    _completed = false;
+}
@@ -0,0 +1,134 @@
+#ifndef TREDISREPLY_H
+#define TREDISREPLY_H
+
+#include <TGlobal>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QVariant>
+#include <QVector>
+
+
+struct TRedisReplyNode {
+    char type {0};
+    int offset {0};  // offset of the payload in the buffer
+    int length {0};  // length of the payload, or number of elements of an aggregate; -1 if null
+    int next {0};  // index of the node following this one and its elements
+};
+
+
+struct TRedisReplyData {
+    QByteArray buffer;
+    QVector<TRedisReplyNode> nodes;
+};
+
+
+class T_CORE_EXPORT TRedisReply
+{
+public:
+    enum Type {
+        Invalid        = 0,
+        SimpleString   = '+',
+        Error          = '-',
+        Integer        = ':',
+        BulkString     = '$',
+        Array          = '*',
+        // RESP3
+        Null           = '_',
+        Boolean        = '#',
+        Double         = ',',
+        BigNumber      = '(',
+        BlobError      = '!',
+        VerbatimString = '=',
+        Map            = '%',
+        Set            = '~',
+        Push           = '>',
+    };
+
+    class const_iterator
+    {
+    public:
+        TRedisReply operator*() const { return TRedisReply(_d, _idx); }
+        const_iterator &operator++();
+        bool operator==(const const_iterator &other) const { return _idx == other._idx; }
+        bool operator!=(const const_iterator &other) const { return _idx != other._idx; }
+
+    private:
+        const_iterator(const QSharedPointer<const TRedisReplyData> &d, int idx) : _d(d), _idx(idx) { }
+        QSharedPointer<const TRedisReplyData> _d;
+        int _idx {0};
+        friend class TRedisReply;
+    };
+
+    TRedisReply() { }
+
+    Type type() const;
+    bool isValid() const { return type() != Invalid; }
+    bool isNull() const;
+    bool isError() const { return type() == Error || type() == BlobError; }
+    bool isAggregate() const;
+    int count() const;
+    TRedisReply at(int index) const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    const char *data() const;
+    int size() const;
+    QByteArray view() const;
+    QByteArray toByteArray() const;
+    qint64 toInteger(bool *ok = nullptr) const;
+    double toDouble(bool *ok = nullptr) const;
+    bool toBool() const;
+    QByteArrayList toByteArrayList() const;
+    QVariant toVariant() const;
+    QVariantList toVariantList() const;
+
+private:
+    TRedisReply(const QSharedPointer<const TRedisReplyData> &d, int idx) : _d(d), _idx(idx) { }
+    const TRedisReplyNode *node() const;
+
+    QSharedPointer<const TRedisReplyData> _d;
+    int _idx {0};
+
+    friend class TRedisReplyParser;
+};
+
+
+class T_CORE_EXPORT TRedisReplyParser
+{
+public:
+    enum Result {
+        Completed,
+        Incomplete,
+        Failed,
+    };
+
+    TRedisReplyParser();
+
+    QByteArray &buffer();
+    void append(const QByteArray &data) { buffer() += data; }
+    void append(const char *data, int length) { buffer().append(data, length); }
+    Result parse();
+    TRedisReply takeReply();
+    bool hasPendingData() const { return _pos < _buffer.length(); }
+    void clear();
+
+private:
+    struct Aggregate {
+        int index;
+        int remaining;
+    };
+
+    Result completeNode(int index);
+
+    QByteArray _buffer;
+    int _pos {0};
+    int _start {0};  // start of the reply being parsed
+    QVector<TRedisReplyNode> _nodes;
+    QVector<Aggregate> _stack;
+    bool _completed {false};
+
+    T_DISABLE_COPY(TRedisReplyParser)
+    T_DISABLE_MOVE(TRedisReplyParser)
+};
+
+#endif // TREDISREPLY_H
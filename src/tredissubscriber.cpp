@@ -0,0 +1,310 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tredissubscriber.h"
+#include "tredisdriver.h"
+#include "tredisreply.h"
+#include "tsystemglobal.h"
+#include <TWebApplication>
+#include <QTcpSocket>
+#include <QTimer>
+
+constexpr int DEFAULT_PORT = 6379;
+constexpr int RECONNECT_INTERVAL = 1000;  // msecs
+
+
+class RedisConnection : public QObject
+{
+    Q_OBJECT
+public:
+    RedisConnection(std::function<void()> connected, std::function<void(const TRedisReply &)> received, QObject *parent);
+    void write(const QByteArrayList &command);
+
+public slots:
+    void connectToServer();
+
+protected slots:
+    void writeSocket();
+    void readSocket();
+    void reconnect();
+
+private:
+    QTcpSocket *socket {nullptr};
+    TRedisReplyParser parser;
+    QMutex mutex {QMutex::NonRecursive};
+    QByteArray sendBuffer;
+    QByteArray setupBuffer;  // sent first on each connection
+    bool reconnecting {false};
+    std::function<void()> connectedCallback;
+    std::function<void(const TRedisReply &)> receivedCallback;
+};
+#include "tredissubscriber.moc"
+
+
+RedisConnection::RedisConnection(std::function<void()> connected, std::function<void(const TRedisReply &)> received, QObject *parent) :
+    QObject(parent),
+    socket(new QTcpSocket(this)),
+    connectedCallback(connected),
+    receivedCallback(received)
+{
+    connect(socket, &QTcpSocket::connected, this, [this]() {
+        tSystemDebug("Redis subscriber connected");
+        parser.clear();
+        {
+            QMutexLocker locker(&mutex);
+            sendBuffer.prepend(setupBuffer);
+        }
+        connectedCallback();
+        writeSocket();
+    });
+    connect(socket, SIGNAL(readyRead()), this, SLOT(readSocket()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(reconnect()));
+    connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(reconnect()));
+}
+
+
+void RedisConnection::connectToServer()
+{
+    const QVariantMap &settings = Tf::app()->kvsSettings(Tf::KvsEngine::Redis);
+    QString host = settings.value("HostName").toString().trimmed();
+    int port = settings.value("Port").toInt();
+
+    {
+        QMutexLocker locker(&mutex);
+        setupBuffer.resize(0);
+        for (auto &command : TRedisSubscriber::setupCommands(settings)) {
+            setupBuffer += TRedisDriver::toMultiBulk(command);
+        }
+    }
+
+    reconnecting = false;
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    socket->connectToHost((host.isEmpty()) ? QStringLiteral("localhost") : host, (port > 0) ? port : DEFAULT_PORT);
+}
+
+/*!
+  Appends the \a command to the send buffer; thread-safe.
+*/
+void RedisConnection::write(const QByteArrayList &command)
+{
+    QMutexLocker locker(&mutex);
+    sendBuffer += TRedisDriver::toMultiBulk(command);
+    QMetaObject::invokeMethod(this, "writeSocket", Qt::QueuedConnection); // Writes in main thread
+}
+
+
+void RedisConnection::writeSocket()
+{
+    QMutexLocker locker(&mutex);
+
+    if (socket->state() == QAbstractSocket::ConnectedState && !sendBuffer.isEmpty()) {
+        if (socket->write(sendBuffer) < 0) {
+            tSystemError("Redis subscriber write error  [%s:%d]", __FILE__, __LINE__);
+        }
+        sendBuffer.resize(0);
+    }
+}
+
+
+void RedisConnection::readSocket()
+{
+    parser.append(socket->readAll());
+
+    for (;;) {
+        auto res = parser.parse();
+        if (res == TRedisReplyParser::Completed) {
+            receivedCallback(parser.takeReply());
+        } else {
+            if (res == TRedisReplyParser::Failed) {
+                tSystemError("Invalid protocol  [%s:%d]", __FILE__, __LINE__);
+                reconnect();
+            }
+            break;
+        }
+    }
+}
+
+
+void RedisConnection::reconnect()
+{
+    if (reconnecting) {
+        return;
+    }
+
+    reconnecting = true;
+    tSystemWarn("Redis subscriber disconnected: %s", qPrintable(socket->errorString()));
+    socket->abort();
+    {
+        QMutexLocker locker(&mutex);
+        if (!sendBuffer.isEmpty()) {
+            tSystemWarn("Redis subscriber dropped commands  len:%d", sendBuffer.length());
+            sendBuffer.resize(0);
+        }
+    }
+    QTimer::singleShot(RECONNECT_INTERVAL, this, SLOT(connectToServer()));
+}
+
+/*!
+  \class TRedisSubscriber
+  \brief The TRedisSubscriber class receives messages published to
+  channels of Redis.
+
+  Channels are subscribed on a connection dedicated to the subscription,
+  which is watched by the event loop of the main thread, and are
+  subscribed again when the connection is reestablished. A message
+  received is passed to the callback of the channel or the pattern, and
+  the messageReceived() signal is emitted in the main thread.
+*/
+
+TRedisSubscriber::TRedisSubscriber()
+{
+    _subscriber = new RedisConnection([this]() { resubscribe(); }, [this](const TRedisReply &reply) { dispatch(reply); }, this);
+    _publisher = new RedisConnection([]() { }, [](const TRedisReply &reply) {
+        if (reply.isError()) {
+            tSystemError("Redis error response: %s", reply.toByteArray().data());
+        }
+    }, this);
+}
+
+/*!
+  Returns a global pointer referring to the unique subscriber.
+*/
+TRedisSubscriber *TRedisSubscriber::instance()
+{
+    static TRedisSubscriber *globalInstance = []() {
+        auto *subscriber = new TRedisSubscriber();
+        subscriber->moveToThread(Tf::app()->thread());
+        QMetaObject::invokeMethod(subscriber->_subscriber, "connectToServer", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(subscriber->_publisher, "connectToServer", Qt::QueuedConnection);
+        return subscriber;
+    }();
+    return globalInstance;
+}
+
+/*!
+  Returns the commands sent first on each connection: AUTH with the
+  UserName and the Password if set, and the PostOpenStatements separated
+  by ';', which the connections of TKvsDatabasePool also execute, in the
+  \a settings of redis.ini.
+*/
+QList<QByteArrayList> TRedisSubscriber::setupCommands(const QVariantMap &settings)
+{
+    QList<QByteArrayList> commands;
+
+    QByteArray userName = settings.value("UserName").toString().trimmed().toUtf8();
+    QByteArray password = settings.value("Password").toString().trimmed().toUtf8();
+    if (!password.isEmpty()) {
+        commands << ((userName.isEmpty()) ? QByteArrayList({"AUTH", password}) : QByteArrayList({"AUTH", userName, password}));
+    }
+
+    const QStringList statements = settings.value("PostOpenStatements").toString().trimmed().split(";", QString::SkipEmptyParts);
+    for (auto &st : statements) {
+        QByteArrayList command = st.trimmed().toUtf8().split(' ');
+        command.removeAll("");
+        if (!command.isEmpty()) {
+            commands << command;
+        }
+    }
+    return commands;
+}
+
+/*!
+  Subscribes to the \a channel. The \a callback is called in the main
+  thread with each message published to the channel.
+*/
+void TRedisSubscriber::subscribe(const QByteArray &channel, Callback callback)
+{
+    QMutexLocker locker(&_mutex);
+    _channels.insert(channel, callback);
+    _subscriber->write({"SUBSCRIBE", channel});
+}
+
+/*!
+  Subscribes to the channels matching the glob-style \a pattern.
+*/
+void TRedisSubscriber::psubscribe(const QByteArray &pattern, Callback callback)
+{
+    QMutexLocker locker(&_mutex);
+    _patterns.insert(pattern, callback);
+    _subscriber->write({"PSUBSCRIBE", pattern});
+}
+
+/*!
+  Unsubscribes from the \a channel.
+*/
+void TRedisSubscriber::unsubscribe(const QByteArray &channel)
+{
+    QMutexLocker locker(&_mutex);
+    if (_channels.remove(channel) > 0) {
+        _subscriber->write({"UNSUBSCRIBE", channel});
+    }
+}
+
+/*!
+  Unsubscribes from the channels matching the \a pattern.
+*/
+void TRedisSubscriber::punsubscribe(const QByteArray &pattern)
+{
+    QMutexLocker locker(&_mutex);
+    if (_patterns.remove(pattern) > 0) {
+        _subscriber->write({"PUNSUBSCRIBE", pattern});
+    }
+}
+
+/*!
+  Publishes the \a message to the \a channel asynchronously, without
+  waiting for the reply.
+*/
+void TRedisSubscriber::publish(const QByteArray &channel, const QByteArray &message)
+{
+    _publisher->write({"PUBLISH", channel, message});
+}
+
+
+void TRedisSubscriber::resubscribe()
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!_channels.isEmpty()) {
+        _subscriber->write(QByteArrayList({"SUBSCRIBE"}) + _channels.keys());
+    }
+    if (!_patterns.isEmpty()) {
+        _subscriber->write(QByteArrayList({"PSUBSCRIBE"}) + _patterns.keys());
+    }
+}
+
+
+void TRedisSubscriber::dispatch(const TRedisReply &reply)
+{
+    // Replies as ["message", channel, message] or ["pmessage", pattern, channel, message]
+    QByteArray kind = reply.at(0).view();
+    QByteArray channel;
+    QByteArray message;
+    Callback callback;
+
+    if (kind == "message" && reply.count() == 3) {
+        channel = reply.at(1).toByteArray();
+        message = reply.at(2).toByteArray();
+        QMutexLocker locker(&_mutex);
+        callback = _channels.value(channel);
+    } else if (kind == "pmessage" && reply.count() == 4) {
+        channel = reply.at(2).toByteArray();
+        message = reply.at(3).toByteArray();
+        QMutexLocker locker(&_mutex);
+        callback = _patterns.value(reply.at(1).toByteArray());
+    } else {
+        if (reply.isError()) {
+            tSystemError("Redis error response: %s", reply.toByteArray().data());
+        }
+        return;  // confirmations of subscription
+    }
+
+    if (callback) {
+        callback(channel, message);
+    }
+    emit messageReceived(channel, message);
+}
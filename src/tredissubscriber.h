@@ -0,0 +1,48 @@
+#ifndef TREDISSUBSCRIBER_H
+#define TREDISSUBSCRIBER_H
+
+#include <TGlobal>
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QVariant>
+#include <functional>
+
+class TRedisReply;
+class RedisConnection;
+
+
+class T_CORE_EXPORT TRedisSubscriber : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::function<void(const QByteArray &channel, const QByteArray &message)>;
+
+    void subscribe(const QByteArray &channel, Callback callback = Callback());
+    void psubscribe(const QByteArray &pattern, Callback callback = Callback());
+    void unsubscribe(const QByteArray &channel);
+    void punsubscribe(const QByteArray &pattern);
+    void publish(const QByteArray &channel, const QByteArray &message);
+
+    static TRedisSubscriber *instance();
+    static QList<QByteArrayList> setupCommands(const QVariantMap &settings);  // Internal use
+
+signals:
+    void messageReceived(const QByteArray &channel, const QByteArray &message);
+
+private:
+    TRedisSubscriber();
+    void resubscribe();
+    void dispatch(const TRedisReply &reply);
+
+    RedisConnection *_subscriber {nullptr};
+    RedisConnection *_publisher {nullptr};
+    QMutex _mutex {QMutex::NonRecursive};
+    QMap<QByteArray, Callback> _channels;
+    QMap<QByteArray, Callback> _patterns;
+
+    T_DISABLE_COPY(TRedisSubscriber)
+    T_DISABLE_MOVE(TRedisSubscriber)
+};
+
+#endif // TREDISSUBSCRIBER_H
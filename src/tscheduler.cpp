@@ -96,6 +96,8 @@ void TScheduler::run()
 {
     _rollback = false;
     TDatabaseContext::setCurrentDatabaseContext(this);
+    sqlProfile.clear();
+    sqlProfile.setLabel(metaObject()->className());
 
     try {
         // Executes the job
@@ -130,6 +132,7 @@ void TScheduler::run()
         tSystemError("Caught Exception: %s", e.what());
     }
 
+    sqlProfile.writeSummary();
     TDatabaseContext::release();
     TDatabaseContext::setCurrentDatabaseContext(nullptr);
 
@@ -19,6 +19,29 @@
 */
 
 
+/*!
+  Returns true if the session has been modified since it was found in
+  the session store, or if it is a new session; otherwise returns false.
+  An unmodified session is not written to the store again.
+ */
+bool TSession::isModified() const
+{
+    if (storedId.isEmpty() || sessionId != storedId) {
+        return true;
+    }
+    // Not detached from the data found means not modified
+    return !QVariantMap::isSharedWith(storedData) && *static_cast<const QVariantMap *>(this) != storedData;
+}
+
+/*!
+  Keeps the current ID and data as those in the session store.
+ */
+void TSession::setStored()
+{
+    storedId = sessionId;
+    storedData = *static_cast<const QVariantMap *>(this);
+}
+
 /*!
   Resets the session.
  */
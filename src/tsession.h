@@ -14,6 +14,7 @@ public:
     TSession &operator=(const TSession &other);
 
     QByteArray id() const { return sessionId; }
+    bool isModified() const;
     void reset();
     iterator insert(const QString &key, const QVariant &value);
     int remove(const QString &key);
@@ -24,9 +25,13 @@ public:
 
 private:
     QByteArray sessionId;
+    QByteArray storedId;      // ID of the session found in the store
+    QVariantMap storedData;   // data of the session found in the store
 
     void clear(); // disabled
+    void setStored();
     friend class TSessionCookieStore;
+    friend class TSessionManager;
     friend class TActionContext;
 };
 
@@ -36,13 +41,16 @@ inline TSession::TSession(const QByteArray &id)
 { }
 
 inline TSession::TSession(const TSession &other)
-    : QVariantMap(*static_cast<const QVariantMap *>(&other)), sessionId(other.sessionId)
+    : QVariantMap(*static_cast<const QVariantMap *>(&other)), sessionId(other.sessionId),
+      storedId(other.storedId), storedData(other.storedData)
 { }
 
 inline TSession &TSession::operator=(const TSession &other)
 {
     QVariantMap::operator=(*static_cast<const QVariantMap *>(&other));
     sessionId = other.sessionId;
+    storedId = other.storedId;
+    storedData = other.storedData;
     return *this;
 }
 
@@ -0,0 +1,416 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tsessioncookiecodec.h"
+#include "tsystemglobal.h"
+#include <TCryptAead>
+#include <QDataStream>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QStringList>
+#include <climits>
+#include <cstring>
+
+constexpr auto AEAD_PREFIX = "1.";  // never appears in the signed format
+constexpr int MAX_DEPTH = 32;
+
+/*!
+  \class TSessionCookieCodec
+  \brief The TSessionCookieCodec class encrypts session data into the
+  value of a cookie and decrypts it.
+
+  The data is encoded in a compact binary format with its issued time,
+  compressed with LZ4 if it is large, and encrypted with
+  ChaCha20-Poly1305 by the first key of the key ring; it is decrypted
+  by the key of the ID it carries, so that keys can be rotated.
+  This class is for internal use only.
+  \sa TSessionCookieStore
+*/
+
+namespace {
+    enum Flag : uchar {
+        Compressed = 0x01,
+    };
+
+    enum Tag : uchar {
+        Null = 0,
+        False,
+        True,
+        Integer,
+        Double,
+        String,
+        Bytes,
+        List,
+        Map,
+        DateTime,
+        Other = 0x7f,  // by QDataStream
+    };
+}
+
+
+static void writeBytes(QByteArray &out, const QByteArray &bytes)
+{
+    TSessionCookieCodec::writeVarint(out, bytes.length());
+    out += bytes;
+}
+
+
+static bool readBytes(const char *&p, const char *end, QByteArray &bytes)
+{
+    quint64 len;
+    if (!TSessionCookieCodec::readVarint(p, end, len) || len > (quint64)(end - p)) {
+        return false;
+    }
+    bytes = QByteArray(p, (int)len);
+    p += len;
+    return true;
+}
+
+
+void TSessionCookieCodec::writeVarint(QByteArray &out, quint64 n)
+{
+    while (n >= 0x80) {
+        out += (char)((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    out += (char)n;
+}
+
+
+bool TSessionCookieCodec::readVarint(const char *&p, const char *end, quint64 &n)
+{
+    n = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uchar c = *p++;
+        n |= (quint64)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool TSessionCookieCodec::encodeVariant(QByteArray &out, const QVariant &value, int depth)
+{
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+
+    switch ((int)value.type()) {
+    case QMetaType::UnknownType:
+        out += (char)Null;
+        break;
+
+    case QMetaType::Bool:
+        out += (char)((value.toBool()) ? True : False);
+        break;
+
+    case QMetaType::Int:
+    case QMetaType::LongLong: {
+        qint64 n = value.toLongLong();
+        out += (char)Integer;
+        writeVarint(out, ((quint64)n << 1) ^ (quint64)(n >> 63));  // zigzag
+        break; }
+
+    case QMetaType::Double: {
+        double d = value.toDouble();
+        quint64 bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        out += (char)Double;
+        for (int i = 0; i < 8; ++i) {
+            out += (char)(bits >> (i * 8));
+        }
+        break; }
+
+    case QMetaType::QString:
+        out += (char)String;
+        writeBytes(out, value.toString().toUtf8());
+        break;
+
+    case QMetaType::QByteArray:
+        out += (char)Bytes;
+        writeBytes(out, value.toByteArray());
+        break;
+
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        out += (char)List;
+        writeVarint(out, list.count());
+        for (auto &v : list) {
+            if (!encodeVariant(out, v, depth + 1)) {
+                return false;
+            }
+        }
+        break; }
+
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        out += (char)Map;
+        writeVarint(out, map.count());
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            writeBytes(out, it.key().toUtf8());
+            if (!encodeVariant(out, it.value(), depth + 1)) {
+                return false;
+            }
+        }
+        break; }
+
+    case QMetaType::QDateTime: {
+        qint64 msecs = value.toDateTime().toMSecsSinceEpoch();
+        out += (char)DateTime;
+        writeVarint(out, ((quint64)msecs << 1) ^ (quint64)(msecs >> 63));
+        break; }
+
+    default: {
+        QByteArray ba;
+        QDataStream ds(&ba, QIODevice::WriteOnly);
+        ds << value;
+        if (ds.status() != QDataStream::Ok) {
+            return false;
+        }
+        out += (char)Other;
+        writeBytes(out, ba);
+        break; }
+    }
+    return true;
+}
+
+
+bool TSessionCookieCodec::decodeVariant(const char *&p, const char *end, QVariant &value, int depth)
+{
+    if (p >= end || depth > MAX_DEPTH) {
+        return false;
+    }
+
+    quint64 n;
+    QByteArray bytes;
+
+    switch ((uchar)*p++) {
+    case Null:
+        value = QVariant();
+        return true;
+
+    case False:
+    case True:
+        value = ((uchar)p[-1] == True);
+        return true;
+
+    case Integer: {
+        if (!readVarint(p, end, n)) {
+            return false;
+        }
+        qint64 num = (qint64)(n >> 1) ^ -(qint64)(n & 1);
+        value = (num >= INT_MIN && num <= INT_MAX) ? QVariant((int)num) : QVariant(num);
+        return true; }
+
+    case Double: {
+        if (end - p < 8) {
+            return false;
+        }
+        quint64 bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= (quint64)(uchar)p[i] << (i * 8);
+        }
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        p += 8;
+        value = d;
+        return true; }
+
+    case String:
+        if (!readBytes(p, end, bytes)) {
+            return false;
+        }
+        value = QString::fromUtf8(bytes);
+        return true;
+
+    case Bytes:
+        if (!readBytes(p, end, bytes)) {
+            return false;
+        }
+        value = bytes;
+        return true;
+
+    case List: {
+        if (!readVarint(p, end, n) || n > (quint64)(end - p)) {
+            return false;
+        }
+        QVariantList list;
+        list.reserve((int)n);
+        for (quint64 i = 0; i < n; ++i) {
+            QVariant v;
+            if (!decodeVariant(p, end, v, depth + 1)) {
+                return false;
+            }
+            list << v;
+        }
+        value = list;
+        return true; }
+
+    case Map: {
+        if (!readVarint(p, end, n) || n > (quint64)(end - p)) {
+            return false;
+        }
+        QVariantMap map;
+        for (quint64 i = 0; i < n; ++i) {
+            QVariant v;
+            if (!readBytes(p, end, bytes) || !decodeVariant(p, end, v, depth + 1)) {
+                return false;
+            }
+            map.insert(QString::fromUtf8(bytes), v);
+        }
+        value = map;
+        return true; }
+
+    case DateTime: {
+        if (!readVarint(p, end, n)) {
+            return false;
+        }
+        value = QDateTime::fromMSecsSinceEpoch((qint64)(n >> 1) ^ -(qint64)(n & 1));
+        return true; }
+
+    case Other: {
+        if (!readBytes(p, end, bytes)) {
+            return false;
+        }
+        QDataStream ds(bytes);
+        ds >> value;
+        return ds.status() == QDataStream::Ok; }
+
+    default:
+        return false;
+    }
+}
+
+
+TSessionCookieCodec::TSessionCookieCodec(const QList<Key> &keys, const QByteArray &aad) :
+    _keys(keys),
+    _aad(aad)
+{ }
+
+/*!
+  Returns true if the \a cookie is of the encrypted format.
+*/
+bool TSessionCookieCodec::isEncrypted(const QByteArray &cookie)
+{
+    return cookie.startsWith(AEAD_PREFIX);
+}
+
+/*!
+  Parses the key ring \a keys listed as 'id:base64key' separated by
+  commas or whitespaces. Invalid keys are skipped.
+*/
+QList<TSessionCookieCodec::Key> TSessionCookieCodec::parseKeys(const QString &keys)
+{
+    QList<Key> ring;
+    const QStringList entries = keys.split(QRegularExpression("[,\\s]+"), QString::SkipEmptyParts);
+
+    for (auto &entry : entries) {
+        int idx = entry.indexOf(':');
+        bool ok;
+        int id = entry.left(idx).toInt(&ok);
+        QByteArray key = QByteArray::fromBase64(entry.mid(idx + 1).toLatin1());
+        if (idx < 0 || !ok || id < 0 || id > 255 || key.length() != TCryptAead::KeyLength) {
+            tSystemError("Invalid key in Session.CookieEncryptionKeys: %s", qPrintable(entry.left(idx)));
+            continue;
+        }
+        ring << qMakePair((uchar)id, key);
+    }
+    return ring;
+}
+
+/*!
+  Returns the value of a cookie that holds the \a data issued at
+  \a issued in seconds since the epoch, encrypted with the \a nonce
+  of TCryptAead::NonceLength bytes. Returns an empty byte array if
+  the data can not be serialized.
+*/
+QByteArray TSessionCookieCodec::encode(const QVariantMap &data, qint64 issued, const QByteArray &nonce) const
+{
+    if (_keys.isEmpty() || nonce.length() != TCryptAead::NonceLength) {
+        return QByteArray();
+    }
+
+    QByteArray body;
+    writeVarint(body, issued);
+    if (!encodeVariant(body, QVariant(data))) {
+        return QByteArray();
+    }
+
+    uchar flags = 0;
+    if (_compressionThreshold > 0 && body.length() >= _compressionThreshold) {
+        QByteArray compressed = Tf::lz4Compress(body);
+        if (compressed.length() < body.length()) {
+            body = compressed;
+            flags |= Compressed;
+        }
+    }
+    body.prepend((char)flags);
+
+    const auto &key = _keys.first();
+    QByteArray cookie;
+    cookie += (char)key.first;
+    cookie += nonce;
+    cookie += TCryptAead::encrypt(body, key.second, nonce, _aad);
+    return AEAD_PREFIX + cookie.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+}
+
+/*!
+  Decrypts the \a cookie into the \a data. Returns false if it is
+  tampered, encrypted by an unknown key, or expired at \a now in
+  seconds since the epoch.
+*/
+bool TSessionCookieCodec::decode(const QByteArray &cookie, QVariantMap &data, qint64 now) const
+{
+    if (!isEncrypted(cookie)) {
+        return false;
+    }
+
+    QByteArray bytes = QByteArray::fromBase64(cookie.mid(qstrlen(AEAD_PREFIX)), QByteArray::Base64UrlEncoding);
+    if (bytes.length() < 1 + TCryptAead::NonceLength + TCryptAead::TagLength) {
+        return false;
+    }
+
+    uchar keyId = bytes[0];
+    for (const auto &key : _keys) {
+        if (key.first != keyId) {
+            continue;
+        }
+
+        bool ok;
+        QByteArray body = TCryptAead::decrypt(bytes.mid(1 + TCryptAead::NonceLength), key.second, bytes.mid(1, TCryptAead::NonceLength), _aad, &ok);
+        if (!ok || body.isEmpty()) {
+            return false;
+        }
+
+        uchar flags = body[0];
+        body.remove(0, 1);
+        if (flags & Compressed) {
+            body = Tf::lz4Uncompress(body);
+        }
+
+        const char *p = body.constData();
+        const char *end = p + body.length();
+        quint64 issued;
+        if (!readVarint(p, end, issued)) {
+            return false;
+        }
+
+        if (_lifeTime > 0 && (qint64)issued + _lifeTime < now) {
+            return false;  // expired
+        }
+
+        QVariant map;
+        if (!decodeVariant(p, end, map) || map.type() != QVariant::Map) {
+            return false;
+        }
+        data = map.toMap();
+        return true;
+    }
+    return false;
+}
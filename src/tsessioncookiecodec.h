@@ -0,0 +1,43 @@
+#ifndef TSESSIONCOOKIECODEC_H
+#define TSESSIONCOOKIECODEC_H
+
+#include <TGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QVariant>
+
+
+class T_CORE_EXPORT TSessionCookieCodec
+{
+public:
+    typedef QPair<uchar, QByteArray> Key;
+
+    TSessionCookieCodec(const QList<Key> &keys, const QByteArray &aad = QByteArray());
+
+    bool isEnabled() const { return !_keys.isEmpty(); }
+    void setCompressionThreshold(int threshold) { _compressionThreshold = threshold; }
+    void setLifeTime(qint64 seconds) { _lifeTime = seconds; }
+    void setMaxSize(int size) { _maxSize = size; }
+    int maxSize() const { return _maxSize; }
+    bool exceedsMaxSize(const QByteArray &cookie) const { return _maxSize > 0 && cookie.length() > _maxSize; }
+
+    QByteArray encode(const QVariantMap &data, qint64 issued, const QByteArray &nonce) const;
+    bool decode(const QByteArray &cookie, QVariantMap &data, qint64 now) const;
+
+    static bool isEncrypted(const QByteArray &cookie);
+    static QList<Key> parseKeys(const QString &keys);
+    static void writeVarint(QByteArray &out, quint64 n);
+    static bool readVarint(const char *&p, const char *end, quint64 &n);
+    static bool encodeVariant(QByteArray &out, const QVariant &value, int depth = 0);
+    static bool decodeVariant(const char *&p, const char *end, QVariant &value, int depth = 0);
+
+private:
+    QList<Key> _keys;  // the first key is the current one
+    QByteArray _aad;
+    int _compressionThreshold {256};
+    qint64 _lifeTime {0};
+    int _maxSize {0};
+};
+
+#endif // TSESSIONCOOKIECODEC_H
@@ -6,15 +6,23 @@
  */
 
 #include "tsessioncookiestore.h"
+#include "tsessionmanager.h"
+#include "tsessioncookiecodec.h"
 #include <TAppSettings>
 #include <TSystemGlobal>
+#include <TCryptAead>
 #include <QByteArray>
 #include <QDataStream>
 #include <QCryptographicHash>
+#include <QDateTime>
 
 /*!
   \class TSessionCookieStore
   \brief The TSessionCookieStore class stores HTTP sessions into a cookie.
+
+  If Session.CookieEncryptionKeys is set, the session data is encrypted
+  by TSessionCookieCodec, and expires after the session lifetime since
+  it was stored. Otherwise the data is only signed with Session.Secret.
 */
 
 
@@ -25,13 +33,44 @@ static const QByteArray &sessionSecret()
 }
 
 
+static const TSessionCookieCodec &cookieCodec()
+{
+    static const TSessionCookieCodec codec = []() {
+        QString keys = Tf::appSettings()->value(Tf::SessionCookieEncryptionKeys).toStringList().join(",");
+        TSessionCookieCodec cdc(TSessionCookieCodec::parseKeys(keys), TSession::sessionName());
+        cdc.setCompressionThreshold(Tf::appSettings()->value(Tf::SessionCookieCompressionThreshold, 256).toInt());
+        cdc.setLifeTime(TSessionStore::lifeTimeSecs());
+        cdc.setMaxSize(Tf::appSettings()->value(Tf::SessionCookieMaxSize, 4000).toInt());
+        return cdc;
+    }();
+    return codec;
+}
+
+
 bool TSessionCookieStore::store(TSession &session)
 {
+    const auto &codec = cookieCodec();
+
     if (session.isEmpty()) {
         session.sessionId = "";
         return true;
     }
 
+    if (codec.isEnabled()) {
+        QByteArray nonce = QByteArray::fromHex(TSessionManager::instance().generateId()).left(TCryptAead::NonceLength);
+        QByteArray id = codec.encode(*static_cast<const QVariantMap *>(&session), QDateTime::currentMSecsSinceEpoch() / 1000, nonce);
+        if (id.isEmpty()) {
+            tSystemError("Failed to store session. Must set objects that can be serialized.");
+            return false;
+        }
+        if (codec.exceedsMaxSize(id)) {
+            tSystemError("Cookie session too large: %d bytes (Session.CookieMaxSize=%d)", id.length(), codec.maxSize());
+            return false;
+        }
+        session.sessionId = id;
+        return true;
+    }
+
 #ifndef TF_NO_DEBUG
     {
         QByteArray badummy;
@@ -57,7 +96,12 @@ bool TSessionCookieStore::store(TSession &session)
 
     ba = Tf::lz4Compress(ba);
     QByteArray digest = QCryptographicHash::hash(ba + sessionSecret(), QCryptographicHash::Sha1);
-    session.sessionId = ba.toBase64() + "_" + digest.toBase64();
+    QByteArray id = ba.toBase64() + "_" + digest.toBase64();
+    if (codec.exceedsMaxSize(id)) {
+        tSystemError("Cookie session too large: %d bytes (Session.CookieMaxSize=%d)", id.length(), codec.maxSize());
+        return false;
+    }
+    session.sessionId = id;
     return true;
 }
 
@@ -69,6 +113,14 @@ TSession TSessionCookieStore::find(const QByteArray &id)
         return session;
     }
 
+    if (TSessionCookieCodec::isEncrypted(id)) {
+        if (!cookieCodec().decode(id, *static_cast<QVariantMap *>(&session), QDateTime::currentMSecsSinceEpoch() / 1000)) {
+            tSystemWarn("Received a tampered cookie, an expired one or that of other web application.");
+            session.reset();
+        }
+        return session;
+    }
+
     QByteArrayList balst = id.split('_');
 
     if (balst.count() == 2) {
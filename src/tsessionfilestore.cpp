@@ -7,96 +7,165 @@
 
 #include "tsessionfilestore.h"
 #include "tsystemglobal.h"
-#include "tfcore.h"
 #include <TWebApplication>
+#include <TAtomic>
 #include <QFile>
+#include <QSaveFile>
 #include <QDir>
+#include <QDirIterator>
 #include <QDataStream>
-#include <QReadWriteLock>
 
 constexpr auto SESSION_DIR_NAME = "session";
+constexpr int SHARD_COUNT = 256;
 
-static QReadWriteLock rwLock(QReadWriteLock::Recursive);  // Global read-write lock
+
+static bool isValidId(const QByteArray &id)
+{
+    if (id.isEmpty() || id.length() > 128) {
+        return false;
+    }
+    for (char c : id) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+            return false;  // not to access outside of the directory
+        }
+    }
+    return true;
+}
+
+
+static int shardOf(const QByteArray &id)
+{
+    // FNV-1a, independent of the process
+    quint32 hash = 2166136261u;
+    for (char c : id) {
+        hash = (hash ^ (uchar)c) * 16777619u;
+    }
+    return hash % SHARD_COUNT;
+}
+
+
+static QString shardName(int shard)
+{
+    return QString::number(shard, 16).rightJustified(2, QLatin1Char('0'));
+}
+
+
+static QString sessionFilePath(const QByteArray &id)
+{
+    return TSessionFileStore::sessionDirPath() + shardName(shardOf(id)) + QLatin1Char('/') + QLatin1String(id);
+}
+
+// Path of the flat layout of older versions
+static QString legacySessionFilePath(const QByteArray &id)
+{
+    return TSessionFileStore::sessionDirPath() + QLatin1String(id);
+}
+
+
+static int removeExpiredFiles(const QString &dirPath, const QDateTime &expire)
+{
+    int res = 0;
+    QDirIterator it(dirPath, QDir::Files);
+    while (it.hasNext()) {
+        it.next();
+        if (it.fileInfo().lastModified() < expire) {
+            if (QFile::remove(it.filePath())) {
+                res++;
+            }
+        }
+    }
+    return res;
+}
 
 /*!
   \class TSessionFileStore
   \brief The TSessionFileStore class stores HTTP sessions to files.
+
+  Session files are distributed in 256 subdirectories by the hash of the
+  session ID. A file is written to a temporary file and renamed to the
+  session file atomically, so that it is read without any lock.
+  A session file of the flat layout of older versions is still read,
+  and is moved to its subdirectory when the session is stored next.
 */
 
 bool TSessionFileStore::store(TSession &session)
 {
-    QDir dir(sessionDirPath());
+    if (!isValidId(session.id())) {
+        tSystemError("Invalid session ID: %s", session.id().data());
+        return false;
+    }
+
+    QString path = sessionFilePath(session.id());
+    QDir dir = QFileInfo(path).absoluteDir();
     if (!dir.exists()) {
         dir.mkpath(".");
     }
 
-    bool res = false;
-    QWriteLocker locker(&rwLock);  // lock for threads
-    QFile file(sessionDirPath() + session.id());
+    QByteArray buffer;
+    QDataStream dsbuf(&buffer, QIODevice::WriteOnly);
+    dsbuf << *static_cast<const QVariantMap *>(&session);
+    buffer = Tf::lz4Compress(buffer);  // compress
 
-    if (file.open(QIODevice::ReadWrite)) {
-        auto reslock = tf_lockfile(file.handle(), true, true);  // blocking flock for processes
-        int err = errno;
-        if (reslock < 0) {
-            tSystemWarn("flock error  errno:%d", err);
-        }
-
-        QByteArray buffer;
-        QDataStream dsbuf(&buffer, QIODevice::WriteOnly);
-        dsbuf << *static_cast<const QVariantMap *>(&session);
-        buffer = Tf::lz4Compress(buffer);  // compress
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        tSystemError("Failed to open a session file: %s", qPrintable(path));
+        return false;
+    }
 
-        file.resize(0); // truncate
-        QDataStream ds(&file);
-        ds << buffer;
-        file.close();
+    QDataStream ds(&file);
+    ds << buffer;
+    if (ds.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        tSystemError("Failed to store session. Must set objects that can be serialized.");
+        return false;
+    }
 
-        res = (ds.status() == QDataStream::Ok);
-        if (!res) {
-            tSystemError("Failed to store session. Must set objects that can be serialized.");
-        }
+    bool ret = file.commit();  // renames to the session file
+    if (ret) {
+        QFile::remove(legacySessionFilePath(session.id()));  // migrated
     }
-    return res;
+    return ret;
 }
 
 
 TSession TSessionFileStore::find(const QByteArray &id)
 {
-    QFileInfo fi(sessionDirPath() + id);
-    QDateTime modified = QDateTime::currentDateTime().addSecs(-lifeTimeSecs());
+    if (!isValidId(id)) {
+        return TSession();
+    }
 
-    if (fi.exists() && fi.lastModified() >= modified) {
-        QReadLocker locker(&rwLock);  // lock for threads
-        QFile file(fi.filePath());
+    QFile file(sessionFilePath(id));
+    if (!file.open(QIODevice::ReadOnly)) {
+        file.setFileName(legacySessionFilePath(id));
+        if (!file.open(QIODevice::ReadOnly)) {
+            return TSession();
+        }
+    }
 
-        if (file.open(QIODevice::ReadOnly)) {
-            auto reslock = tf_lockfile(file.handle(), false, true);  // blocking flock for processes
-            int err = errno;
-            if (reslock < 0) {
-                tSystemWarn("flock error  errno:%d", err);
-            }
+    QDateTime modified = QDateTime::currentDateTime().addSecs(-lifeTimeSecs());
+    if (QFileInfo(file).lastModified() < modified) {
+        return TSession();
+    }
 
-            QDataStream ds(&file);
-            QByteArray buffer;
-            ds >> buffer;
-            file.close();
-            buffer = Tf::lz4Uncompress(buffer);
-            TSession result(id);
+    QDataStream ds(&file);
+    QByteArray buffer;
+    ds >> buffer;
+    file.close();
+    buffer = Tf::lz4Uncompress(buffer);
+    TSession result(id);
 
-            if (buffer.isEmpty()) {
-                tSystemError("Failed to load a session from the file store.");
-                return result;
-            }
+    if (buffer.isEmpty()) {
+        tSystemError("Failed to load a session from the file store.");
+        return result;
+    }
 
-            QDataStream dsbuf(&buffer, QIODevice::ReadOnly);
-            dsbuf >> *static_cast<QVariantMap *>(&result);
+    QDataStream dsbuf(&buffer, QIODevice::ReadOnly);
+    dsbuf >> *static_cast<QVariantMap *>(&result);
 
-            if (ds.status() == QDataStream::Ok) {
-                return result;
-            } else {
-                tSystemError("Failed to load a session from the file store.");
-            }
-        }
+    if (ds.status() == QDataStream::Ok) {
+        return result;
+    } else {
+        tSystemError("Failed to load a session from the file store.");
     }
     return TSession();
 }
@@ -104,30 +173,54 @@ TSession TSessionFileStore::find(const QByteArray &id)
 
 bool TSessionFileStore::remove(const QByteArray &id)
 {
-    return QFile::remove(sessionDirPath() + id);
-}
+    if (!isValidId(id)) {
+        return false;
+    }
 
+    bool ret = QFile::remove(sessionFilePath(id));
+    return QFile::remove(legacySessionFilePath(id)) || ret;
+}
 
+/*!
+  Removes the expired session files in one of the subdirectories in turn,
+  so that a pass does not scan all the session files.
+*/
 int TSessionFileStore::gc(const QDateTime &expire)
 {
-    int res = 0;
-    QDir dir(sessionDirPath());
-    if (dir.exists()) {
-        const QList<QFileInfo> lst = dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
-        for (auto &fi : lst) {
-            if (fi.lastModified() < expire) {
-                if (dir.remove(fi.fileName())) {
-                    res++;
-                }
-            } else {
-                break;
-            }
-        }
+    static TAtomic<uint> nextShard(0);
+
+    uint shard = nextShard.fetchAdd(1) % SHARD_COUNT;
+    int res = removeExpiredFiles(sessionDirPath() + shardName(shard), expire);
+    if (shard == 0) {
+        // Files of the flat layout of older versions
+        res += removeExpiredFiles(sessionDirPath(), expire);
     }
     return res;
 }
 
 
+bool TSessionFileStore::touch(const QByteArray &id)
+{
+#if QT_VERSION >= 0x050a00  // 5.10.0
+    if (!isValidId(id)) {
+        return false;
+    }
+
+    QFile file(sessionFilePath(id));
+    if (!file.exists()) {
+        file.setFileName(legacySessionFilePath(id));
+        if (!file.exists()) {
+            return false;
+        }
+    }
+    // Updates the modification time only
+    return file.open(QIODevice::ReadWrite) && file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#else
+    return TSessionStore::touch(id);
+#endif
+}
+
+
 QString TSessionFileStore::sessionDirPath()
 {
     static const QString path = Tf::app()->tmpPath() + QLatin1String(SESSION_DIR_NAME) + "/";
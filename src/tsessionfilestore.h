@@ -12,6 +12,7 @@ public:
     bool store(TSession &session) override;
     bool remove(const QByteArray &id) override;
     int gc(const QDateTime &expire) override;
+    bool touch(const QByteArray &id) override;
 
     static QString sessionDirPath();
 };
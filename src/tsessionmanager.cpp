@@ -10,27 +10,55 @@
 #include "tsessionstorefactory.h"
 #include <TAppSettings>
 #include <TSessionStore>
-#include <TAtomic>
-#include <QHostInfo>
-#include <QCryptographicHash>
-#include <QThread>
-#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#if QT_VERSION >= 0x050a00
+# include <QRandomGenerator>
+#elif defined(Q_OS_WIN)
+# include <windows.h>
+# include <ntsecapi.h>  // RtlGenRandom in Advapi32
+#endif
 
+constexpr int SESSION_ID_BYTES = 20;  // 160 bits
 
-static QByteArray createHash()
+
+static QByteArray randomBytes(int length)
 {
-    static TAtomic<quint32> seq(0);
-    QByteArray data;
-    data.reserve(127);
-
-    data.append(QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
-    data.append(QHostInfo::localHostName());
-    data.append(QByteArray::number(++seq));
-    data.append(QByteArray::number(QCoreApplication::applicationPid()));
-    data.append(QByteArray::number((qulonglong)QThread::currentThread()));
-    data.append(QByteArray::number((qulonglong)qApp));
-    data.append(QByteArray::number(Tf::rand32_r()));
-    return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+    QByteArray bytes(length, '\0');
+#if QT_VERSION >= 0x050a00
+    // Cryptographically secure generator of the system
+    QRandomGenerator::system()->fillRange((quint32 *)bytes.data(), length / (int)sizeof(quint32));
+#elif defined(Q_OS_WIN)
+    if (!RtlGenRandom(bytes.data(), (ULONG)length)) {
+        throw RuntimeException("Unable to generate random bytes", __FILE__, __LINE__);
+    }
+#else
+    static QFile urandom("/dev/urandom");
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if (!urandom.isOpen() && !urandom.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        throw RuntimeException("Unable to open /dev/urandom", __FILE__, __LINE__);
+    }
+    if (urandom.read(bytes.data(), length) != length) {
+        throw RuntimeException("Unable to read /dev/urandom", __FILE__, __LINE__);
+    }
+#endif
+    return bytes;
+}
+
+
+namespace {
+    class SessionStoreHolder {
+    public:
+        ~SessionStoreHolder()
+        {
+            TSessionStoreFactory::destroy(type, store);
+        }
+
+        QString type;
+        TSessionStore *store {nullptr};
+    };
 }
 
 
@@ -42,17 +70,36 @@ TSessionManager::~TSessionManager()
 { }
 
 
+/*!
+  Returns the session store of the current thread, which is created at
+  the first call and reused until the thread finishes.
+*/
+TSessionStore *TSessionManager::sessionStore() const
+{
+    thread_local SessionStoreHolder holder;
+
+    if (Q_UNLIKELY(!holder.store)) {
+        holder.type = storeType();
+        holder.store = TSessionStoreFactory::create(holder.type);
+        if (Q_UNLIKELY(!holder.store)) {
+            tSystemError("Session store not found: %s", qPrintable(storeType()));
+        }
+    }
+    return holder.store;
+}
+
+
 TSession TSessionManager::findSession(const QByteArray &id)
 {
     TSession session;
 
     if (!id.isEmpty()) {
-        TSessionStore *store = TSessionStoreFactory::create(storeType());
+        TSessionStore *store = sessionStore();
         if (Q_LIKELY(store)) {
             session = store->find(id);
-            TSessionStoreFactory::destroy(storeType(), store);
-        } else {
-            tSystemError("Session store not found: %s", qPrintable(storeType()));
+            if (!session.id().isEmpty()) {
+                session.setStored();
+            }
         }
     }
     return session;
@@ -66,28 +113,48 @@ bool TSessionManager::store(TSession &session)
         return false;
     }
 
+    static const bool CookieStore = (storeType() == QLatin1String("cookie"));
+    if (!CookieStore && !session.isModified()) {
+        // Writes nothing but the expiration time
+        tSystemDebug("Session not modified: %s", session.id().data());
+        touch(session.id());
+        return true;
+    }
+
     bool res = false;
-    TSessionStore *store = TSessionStoreFactory::create(storeType());
+    TSessionStore *store = sessionStore();
     if (Q_LIKELY(store)) {
         res = store->store(session);
-        TSessionStoreFactory::destroy(storeType(), store);
-    } else {
-        tSystemError("Session store not found: %s", qPrintable(storeType()));
+        if (res) {
+            session.setStored();
+        }
     }
     return res;
 }
 
+/*!
+  Refreshes the expiration time of the session with the ID \a id, which
+  is not modified, if Session.TouchUnmodified is true in application.ini.
+*/
+bool TSessionManager::touch(const QByteArray &id)
+{
+    static const bool TouchUnmodified = Tf::appSettings()->value(Tf::SessionTouchUnmodified, true).toBool();
+
+    if (!TouchUnmodified || id.isEmpty()) {
+        return false;
+    }
+
+    TSessionStore *store = sessionStore();
+    return (Q_LIKELY(store)) ? store->touch(id) : false;
+}
+
 
 bool TSessionManager::remove(const QByteArray &id)
 {
     if (!id.isEmpty()) {
-        TSessionStore *store = TSessionStoreFactory::create(storeType());
+        TSessionStore *store = sessionStore();
         if (Q_LIKELY(store)) {
-            bool ret = store->remove(id);
-            TSessionStoreFactory::destroy(storeType(), store);
-            return ret;
-        } else {
-            tSystemError("Session store not found: %s", qPrintable(storeType()));
+            return store->remove(id);
         }
     }
     return false;
@@ -100,21 +167,13 @@ QString TSessionManager::storeType() const
     return type;
 }
 
-
+/*!
+  Generates a new session ID of 160 bits from a cryptographically secure
+  random number generator; it is unique without looking up the store.
+*/
 QByteArray TSessionManager::generateId()
 {
-    QByteArray id;
-    int i;
-    for (i = 0; i < 3; ++i) {
-        id = createHash();   // Hash algorithm is important!
-        if (findSession(id).isEmpty())
-            break;
-    }
-
-    if (i == 3)
-        throw RuntimeException("Unable to generate a unique session ID", __FILE__, __LINE__);
-
-    return id;
+    return randomBytes(SESSION_ID_BYTES).toHex();
 }
 
 
@@ -129,12 +188,11 @@ void TSessionManager::collectGarbage()
         if (r == 0) {
             tSystemDebug("Session garbage collector started");
 
-            TSessionStore *store = TSessionStoreFactory::create(storeType());
+            TSessionStore *store = sessionStore();
             if (store) {
                 int gclifetime = Tf::appSettings()->value(Tf::SessionGcMaxLifeTime).toInt();
                 QDateTime expire = QDateTime::currentDateTime().addSecs(-gclifetime);
                 store->gc(expire);
-                TSessionStoreFactory::destroy(storeType(), store);
             }
         }
     }
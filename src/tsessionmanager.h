@@ -5,6 +5,8 @@
 #include <TGlobal>
 #include <TSession>
 
+class TSessionStore;
+
 
 class T_CORE_EXPORT TSessionManager
 {
@@ -13,6 +15,7 @@ public:
 
     TSession findSession(const QByteArray &id);
     bool store(TSession &session);
+    bool touch(const QByteArray &id);
     bool remove(const QByteArray &id);
     QString storeType() const;
     QByteArray generateId();
@@ -22,6 +25,8 @@ public:
     static int sessionLifeTime();
 
 private:
+    TSessionStore *sessionStore() const;
+
     T_DISABLE_COPY(TSessionManager)
     T_DISABLE_MOVE(TSessionManager)
     TSessionManager();
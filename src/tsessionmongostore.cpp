@@ -95,3 +95,11 @@ int TSessionMongoStore::gc(const QDateTime &expire)
     int cnt = mapper.removeAll(cri);
     return cnt;
 }
+
+
+bool TSessionMongoStore::touch(const QByteArray &id)
+{
+    TMongoODMapper<TSessionMongoObject> mapper;
+    int cnt = mapper.updateAll(TCriteria(TSessionMongoObject::SessionId, QString::fromUtf8(id)), TSessionMongoObject::UpdatedAt, QDateTime::currentDateTime());
+    return (cnt > 0);
+}
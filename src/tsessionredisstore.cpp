@@ -77,3 +77,10 @@ int TSessionRedisStore::gc(const QDateTime &)
 {
     return 0;
 }
+
+
+bool TSessionRedisStore::touch(const QByteArray &id)
+{
+    TRedis redis;
+    return redis.expire('_' + id, lifeTimeSecs());
+}
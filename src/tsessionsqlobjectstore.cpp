@@ -118,3 +118,13 @@ int TSessionSqlObjectStore::gc(const QDateTime &expire)
     int cnt = mapper.removeAll(cri);
     return cnt;
 }
+
+
+bool TSessionSqlObjectStore::touch(const QByteArray &id)
+{
+    createSessionTable();
+
+    TSqlORMapper<TSessionObject> mapper;
+    int cnt = mapper.updateAll(TCriteria(TSessionObject::Id, id), TSessionObject::UpdatedAt, QDateTime::currentDateTime());
+    return (cnt > 0);
+}
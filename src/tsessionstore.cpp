@@ -9,6 +9,18 @@
 #include <TAppSettings>
 
 
+/*!
+  Refreshes the expiration time of the session with the ID \a id without
+  changing its data. This default implementation finds the session and
+  stores it again; reimplement it with a cheaper operation of the store.
+*/
+bool TSessionStore::touch(const QByteArray &id)
+{
+    TSession session = find(id);
+    return session.id().isEmpty() || store(session);
+}
+
+
 qint64 TSessionStore::lifeTimeSecs()
 {
     static qint64 lifetime = []() {
@@ -16,6 +16,7 @@ public:
     virtual bool store(TSession &sesion) = 0;
     virtual bool remove(const QByteArray &id) = 0;
     virtual int gc(const QDateTime &expire) = 0;
+    virtual bool touch(const QByteArray &id);
 
     static qint64 lifeTimeSecs();
 };
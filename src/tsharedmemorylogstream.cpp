@@ -7,9 +7,61 @@
 
 #include "tsharedmemorylogstream.h"
 #include <TSystemGlobal>
+#include <TWebApplication>
 #include <QSharedMemory>
+#include <QDataStream>
+#include <QDateTime>
+#include <QThread>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+constexpr auto CREATE_KEY = "TreeFrogLogRing";
+constexpr quint32 RING_MAGIC = 0x54464c52;  // "TFLR"
+constexpr quint32 COMMITTED = 0x80000000;
+constexpr quint32 PADDING = 0x40000000;
+constexpr quint32 LENGTH_MASK = 0x3fffffff;
+constexpr int DRAIN_INTERVAL = 200;       // msecs
+constexpr qint64 DRAIN_LOCK_TIMEOUT = 10000;  // msecs
+constexpr qint64 STALL_TIMEOUT = 5000;    // msecs
+constexpr qint64 BLOCK_TIMEOUT = 1000;    // msecs
+constexpr qint64 ATTACH_TIMEOUT = 1000;   // msecs
+
+/*
+  Ring buffer in the shared memory; 'head' is the position reserved by
+  producers, 'tail' the position consumed. Each record is a 32-bit word
+  of the length and flags followed by the data, aligned to 8 bytes.
+*/
+struct TLogRingHeader {
+    std::atomic<quint64> head;
+    std::atomic<quint64> tail;
+    std::atomic<quint64> dropped;
+    std::atomic<quint64> blocked;
+    std::atomic<qint64> drainLock;  // msecs when acquired, or 0
+    quint32 magic;
+    quint32 capacity;
+    std::atomic<quint64> reportedDropped;  // count written to the system log
+    char reserved[8];
+};
+
+
+static inline quint32 alignedSize(int length)
+{
+    return (sizeof(quint32) + length + 7) & ~7u;
+}
+
+
+static inline qint64 currentMSecs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
 
-constexpr auto CREATE_KEY = "TreeFrogLogStream";
+// One ring buffer per application
+static QString ringKey()
+{
+    auto *app = qobject_cast<TWebApplication *>(qApp);
+    return (app) ? QString("%1_%2").arg(CREATE_KEY).arg(qHash(app->webRootPath()), 0, 16) : QString(CREATE_KEY);
+}
 
 
 class TSharedMemoryLocker
@@ -22,25 +74,68 @@ private:
     QSharedMemory *sm;
 };
 
+/*!
+  \class TSharedMemoryLogStream
+  \brief The TSharedMemoryLogStream class provides a log stream buffered
+  in a ring buffer of shared memory by multiple processes.
+
+  Processes reserve space in the buffer with atomic operations, without
+  any lock, and one of them at a time drains the buffer to the loggers.
+  If the buffer is full, a log is dropped or the writer waits for it to
+  be drained, according to the overflow policy. The number of the logs
+  dropped is written to the system log as it grows.
+*/
 
 TSharedMemoryLogStream::TSharedMemoryLogStream(const QList<TLogger *> loggers, int size, QObject *parent)
     : TAbstractLogStream(loggers, parent),
-      shareMem(new QSharedMemory(CREATE_KEY))
+      shareMem(new QSharedMemory(ringKey()))
 {
-    if (size < dataSizeOf(QList<TLog>())) {
-        tSystemError("Shared memory size not enough: %d (bytes)", shareMem->size());
+    if (size < (int)sizeof(TLogRingHeader) + 1024) {
+        tSystemError("Shared memory size not enough: %d (bytes)", size);
+        return;
+    }
+
+    if (!std::atomic<quint64>().is_lock_free()) {
+        tSystemError("Lock-free atomic operations not supported");
         return;
     }
 
     if (shareMem->create(size)) {
         TSharedMemoryLocker locker(shareMem);
-        clearBuffer();
+        auto *hdr = new (shareMem->data()) TLogRingHeader;
+        hdr->head.store(0);
+        hdr->tail.store(0);
+        hdr->dropped.store(0);
+        hdr->blocked.store(0);
+        hdr->drainLock.store(0);
+        hdr->reportedDropped.store(0);
+        hdr->capacity = (size - sizeof(TLogRingHeader)) & ~7u;
+        std::memset(ringData(), 0, hdr->capacity);
+        hdr->magic = RING_MAGIC;
     } else {
         if (shareMem->error() != QSharedMemory::AlreadyExists) {
             tSystemError("Shared memory create error: %s", qPrintable(shareMem->errorString()));
+        } else if (!shareMem->attach()) {
+            tSystemError("Shared memory attach error: %s", qPrintable(shareMem->errorString()));
         } else {
-            if (!shareMem->attach()) {
-                tSystemError("Shared memory attach error: %s", qPrintable(shareMem->errorString()));
+            // The creator takes the lock only after create(), so the
+            // memory may not be initialized yet; waits for the magic
+            const qint64 started = currentMSecs();
+            quint32 magic = 0;
+            for (;;) {
+                {
+                    TSharedMemoryLocker locker(shareMem);
+                    magic = header()->magic;
+                }
+                if (magic != 0 || currentMSecs() - started > ATTACH_TIMEOUT) {
+                    break;
+                }
+                QThread::msleep(10);
+            }
+
+            if (magic != RING_MAGIC) {
+                tSystemError("Shared memory of an incompatible log stream: %s", qPrintable(shareMem->key()));
+                shareMem->detach();
             }
         }
     }
@@ -54,119 +149,274 @@ TSharedMemoryLogStream::~TSharedMemoryLogStream()
 }
 
 
-void TSharedMemoryLogStream::writeLog(const TLog &log)
+TLogRingHeader *TSharedMemoryLogStream::header() const
 {
-    TSharedMemoryLocker locker(shareMem);
-    if (isNonBufferingMode()) {
-        QList<TLog> logs;
-        logs << log;
-        loggerWriteLog(logs);
-        return;
-    }
-
-    QList<TLog> logList = smRead();
-    logList << log;
-    if (smWrite(logList)) {
-        if (!timer.isActive())
-            timer.start(200, this);
-    } else {
-        loggerWriteLog(logList);
-        clearBuffer();
-    }
+    return (TLogRingHeader *)shareMem->data();
 }
 
 
-void TSharedMemoryLogStream::flush()
+char *TSharedMemoryLogStream::ringData() const
 {
-    if (isNonBufferingMode())
-        return;
-
-    TSharedMemoryLocker locker(shareMem);
-    loggerWriteLog(smRead());
-    clearBuffer();
+    return (char *)shareMem->data() + sizeof(TLogRingHeader);
 }
 
-
-QString TSharedMemoryLogStream::errorString() const
+/*!
+  Sets the overflow policy to \a policy, which is Drop by default.
+*/
+void TSharedMemoryLogStream::setOverflowPolicy(OverflowPolicy policy)
 {
-    return shareMem->errorString();
+    this->policy = policy;
 }
 
-
-void TSharedMemoryLogStream::loggerWriteLog(const QList<TLog> &logs)
+/*!
+  Returns the number of logs dropped by all the processes.
+*/
+quint64 TSharedMemoryLogStream::droppedCount() const
 {
-    loggerOpen();
-    loggerWrite(logs);
-    loggerFlush();
-    loggerClose(MultiProcessUnsafe);
+    return (shareMem->data()) ? header()->dropped.load() : 0;
 }
 
-
-void TSharedMemoryLogStream::clearBuffer()
+/*!
+  Returns the number of times that writers of all the processes waited
+  for the buffer to be drained.
+*/
+quint64 TSharedMemoryLogStream::blockedCount() const
 {
-    smWrite(QList<TLog>());
-    timer.stop();
+    return (shareMem->data()) ? header()->blocked.load() : 0;
 }
 
 
-void TSharedMemoryLogStream::setNonBufferingMode()
+void TSharedMemoryLogStream::writeLog(const TLog &log, quint64 loggers)
 {
-    tSystemDebug("TSharedMemoryLogStream::setNonBufferingMode()");
-    if (!isNonBufferingMode()) {
-        flush();
-        shareMem->detach();
+    if (isNonBufferingMode()) {
+        loggerOpen();
+        loggerWrite(log, loggers);
+        loggerFlush();
+        loggerClose(MultiProcessUnsafe);
+        return;
     }
-    TAbstractLogStream::setNonBufferingMode();
-}
 
-
-QList<TLog> TSharedMemoryLogStream::smRead()
-{
-    QList<TLog> logs;
     if (!shareMem->data()) {
-        tSystemError("Shared memory not attached");
-        return logs;
+        return;
     }
 
-    QByteArray buffer((char *)shareMem->data(), shareMem->size());
-    QDataStream ds(&buffer, QIODevice::ReadOnly);
-    ds >> logs;
-    if (ds.status() != QDataStream::Ok) {
-        tSystemError("Shared memory read error");
-        clearBuffer();
-        return QList<TLog>();
+    QByteArray record;
+    QDataStream ds(&record, QIODevice::WriteOnly);
+    ds << log << loggers;
+
+    if (!push(record)) {
+        header()->dropped.fetch_add(1);  // reported by the timer
     }
-    return logs;
-}
 
+    if (!timer.isActive()) {
+        timer.start(DRAIN_INTERVAL, this);
+    }
+}
 
-bool TSharedMemoryLogStream::smWrite(const QList<TLog> &logs)
+/*!
+  Reserves space for the \a record in the ring buffer and copies it.
+  Returns false if the record is not written.
+*/
+bool TSharedMemoryLogStream::push(const QByteArray &record)
 {
-    QByteArray buffer;
-    QDataStream ds(&buffer, QIODevice::WriteOnly);
-    ds << logs;
+    TLogRingHeader *hdr = header();
+    const quint64 capacity = hdr->capacity;
+    const quint32 size = alignedSize(record.length());
 
-    if (buffer.size() > shareMem->size()) {
-        // over the shared memory size
+    if ((quint32)record.length() > LENGTH_MASK || size > capacity / 2) {
+        tSystemError("Log too large for the shared memory: %d (bytes)", record.length());
         return false;
     }
 
-    if (!shareMem->data()) {
-        tSystemError("Shared memory not attached");
-        return false;
+    quint64 h = hdr->head.load(std::memory_order_acquire);
+    quint64 pad;
+    qint64 blockedSince = 0;
+
+    for (;;) {
+        quint64 pos = h % capacity;
+        pad = (pos + size > capacity) ? capacity - pos : 0;  // skips to the start
+
+        if (h + pad + size - hdr->tail.load(std::memory_order_acquire) > capacity) {
+            // Full
+            if (policy == Drop) {
+                return false;
+            }
+
+            if (!blockedSince) {
+                blockedSince = currentMSecs();
+                hdr->blocked.fetch_add(1);
+            } else if (currentMSecs() - blockedSince > BLOCK_TIMEOUT) {
+                return false;
+            }
+
+            if (drain(false) == 0) {
+                QThread::yieldCurrentThread();
+            }
+            h = hdr->head.load(std::memory_order_acquire);
+            continue;
+        }
+
+        if (hdr->head.compare_exchange_weak(h, h + pad + size, std::memory_order_acq_rel)) {
+            break;
+        }
     }
 
-    memcpy(shareMem->data(), buffer.constData(), buffer.size());
+    char *data = ringData();
+    if (pad > 0) {
+        auto *word = reinterpret_cast<std::atomic<quint32> *>(data + h % capacity);
+        word->store(COMMITTED | PADDING, std::memory_order_release);
+        h += pad;
+    }
+
+    char *p = data + h % capacity;
+    auto *word = reinterpret_cast<std::atomic<quint32> *>(p);
+    word->store(record.length(), std::memory_order_relaxed);  // reserved
+    std::atomic_thread_fence(std::memory_order_release);  // the length before the data
+    std::memcpy(p + sizeof(quint32), record.constData(), record.length());
+    word->store(COMMITTED | record.length(), std::memory_order_release);
     return true;
 }
 
+/*!
+  Writes the logs in the ring buffer to the loggers, if no other process
+  is draining it or if \a wait is true. Returns the number of logs.
+*/
+int TSharedMemoryLogStream::drain(bool wait)
+{
+    if (!shareMem->data()) {
+        return 0;
+    }
+
+    TLogRingHeader *hdr = header();
+    const qint64 started = currentMSecs();
+
+    // Acquires the right to consume
+    for (;;) {
+        qint64 lock = hdr->drainLock.load(std::memory_order_acquire);
+        qint64 now = currentMSecs();
+        if ((lock == 0 || now - lock > DRAIN_LOCK_TIMEOUT)
+            && hdr->drainLock.compare_exchange_strong(lock, now, std::memory_order_acq_rel)) {
+            break;
+        }
+        if (!wait || now - started > DRAIN_LOCK_TIMEOUT) {
+            return 0;
+        }
+        QThread::msleep(1);
+    }
+
+    const quint64 capacity = hdr->capacity;
+    char *data = ringData();
+    quint64 t = hdr->tail.load(std::memory_order_relaxed);
+    const quint64 h = hdr->head.load(std::memory_order_acquire);
+    QList<TLog> logs;
+    QList<quint64> loggers;  // of each log
+
+    while (t < h) {
+        quint64 pos = t % capacity;
+        auto *word = reinterpret_cast<std::atomic<quint32> *>(data + pos);
+        quint32 w = word->load(std::memory_order_acquire);
+        quint32 size;
+
+        if (w & COMMITTED) {
+            if (w & PADDING) {
+                size = capacity - pos;
+            } else {
+                quint32 len = w & LENGTH_MASK;
+                size = alignedSize(len);
+                QByteArray record = QByteArray::fromRawData(data + pos + sizeof(quint32), len);
+                QDataStream ds(record);
+                TLog log;
+                quint64 lgrs;
+                ds >> log >> lgrs;
+                if (ds.status() == QDataStream::Ok) {
+                    logs << log;
+                    loggers << lgrs;
+                }
+            }
+        } else {
+            // Being written
+            qint64 now = currentMSecs();
+            if (stalledPos != t || stalledSince == 0) {
+                stalledPos = t;
+                stalledHead = h;
+                stalledSince = now;
+            }
+            if (now - stalledSince < STALL_TIMEOUT) {
+                break;
+            }
+
+            // Skips the record of a writer that has died
+            if (w != 0) {
+                size = alignedSize(w & LENGTH_MASK);
+                hdr->dropped.fetch_add(1);
+            } else {
+                // Died before storing the length. The record ends at the
+                // next length stored; the writers which reserved before
+                // stalledHead have stored theirs long since. Its space,
+                // never written, is skipped up to the end of the buffer
+                // at a time.
+                size = 8;
+                while (t + size < stalledHead && pos + size < capacity
+                       && reinterpret_cast<std::atomic<quint32> *>(data + pos + size)->load(std::memory_order_acquire) == 0) {
+                    size += 8;
+                }
+
+                if (pos + size == capacity && t + size < stalledHead) {
+                    stalledPos = t + size;  // continues at the start
+                } else {
+                    hdr->dropped.fetch_add(1);
+                }
+            }
+        }
+
+        // Clears the space for following records
+        std::memset(data + pos + sizeof(quint32), 0, size - sizeof(quint32));
+        word->store(0, std::memory_order_relaxed);
+        t += size;
+    }
+    hdr->tail.store(t, std::memory_order_release);
+    hdr->drainLock.store(0, std::memory_order_release);
+
+    if (!logs.isEmpty()) {
+        loggerOpen();
+        for (int i = 0; i < logs.count(); ++i) {
+            loggerWrite(logs[i], loggers[i]);
+        }
+        loggerFlush();
+        loggerClose(MultiProcessUnsafe);
+    }
+    return logs.count();
+}
+
+
+void TSharedMemoryLogStream::flush()
+{
+    drain(true);
+}
+
+
+QString TSharedMemoryLogStream::errorString() const
+{
+    return shareMem->errorString();
+}
+
+/*!
+  Returns true if the ring buffer in the shared memory is available.
+*/
+bool TSharedMemoryLogStream::isAvailable() const
+{
+    return shareMem->data();
+}
+
 
-int TSharedMemoryLogStream::dataSizeOf(const QList<TLog> &logs)
+void TSharedMemoryLogStream::setNonBufferingMode()
 {
-    QByteArray ba;
-    QDataStream ds(&ba, QIODevice::WriteOnly);
-    ds << logs;
-    return ba.size();
+    tSystemDebug("TSharedMemoryLogStream::setNonBufferingMode()");
+    if (!isNonBufferingMode()) {
+        timer.stop();
+        flush();
+    }
+    TAbstractLogStream::setNonBufferingMode();
 }
 
 
@@ -177,6 +427,22 @@ void TSharedMemoryLogStream::timerEvent(QTimerEvent *event)
         return;
     }
 
-    flush();
-    timer.stop();
+    drain(false);
+    TLogRingHeader *hdr = header();
+    if (!hdr) {
+        timer.stop();
+        return;
+    }
+
+    // Reports the logs dropped since the last report of any process
+    quint64 reported = hdr->reportedDropped.load();
+    quint64 dropped = hdr->dropped.load();
+    if (dropped > reported && hdr->reportedDropped.compare_exchange_strong(reported, dropped)) {
+        tSystemWarn("Shared memory log stream dropped %llu logs (total dropped:%llu blocked:%llu)",
+            dropped - reported, dropped, (quint64)hdr->blocked.load());
+    }
+
+    if (hdr->tail.load() == hdr->head.load()) {
+        timer.stop();
+    }
 }
@@ -5,34 +5,48 @@
 #include "tabstractlogstream.h"
 
 class QSharedMemory;
+struct TLogRingHeader;
 
 
 class T_CORE_EXPORT TSharedMemoryLogStream : public TAbstractLogStream
 {
 public:
-    TSharedMemoryLogStream(const QList<TLogger *> loggers, int size = 4096, QObject *parent = 0);
+    enum OverflowPolicy {
+        Drop = 0,  // drops a log if the buffer is full
+        Block,     // waits for the buffer to be drained
+    };
+
+    TSharedMemoryLogStream(const QList<TLogger *> loggers, int size = 1024 * 1024, QObject *parent = 0);
     ~TSharedMemoryLogStream();
 
-    void writeLog(const TLog &);
+    void writeLog(const TLog &log, quint64 loggers = AllLoggers);
     void flush();
     QString errorString() const;
+    bool isAvailable() const;
     void setNonBufferingMode();
+    OverflowPolicy overflowPolicy() const { return policy; }
+    void setOverflowPolicy(OverflowPolicy policy);
+    quint64 droppedCount() const;
+    quint64 blockedCount() const;
 
 protected:
-    void loggerWriteLog(const QList<TLog> &logs);
-    void clearBuffer();
-    QList<TLog> smRead();
-    bool smWrite(const QList<TLog> &logs);
-    static int dataSizeOf(const QList<TLog> &logs);
+    bool push(const QByteArray &record);
+    int drain(bool wait);
     void timerEvent(QTimerEvent *event);
 
 private:
+    TLogRingHeader *header() const;
+    char *ringData() const;
+
     QSharedMemory *shareMem;
     QBasicTimer timer;
+    OverflowPolicy policy {Drop};
+    quint64 stalledPos {0};
+    quint64 stalledHead {0};
+    qint64 stalledSince {0};
 
     T_DISABLE_COPY(TSharedMemoryLogStream)
     T_DISABLE_MOVE(TSharedMemoryLogStream)
 };
 
 #endif // TSHAREDMEMORYLOGSTREAM_H
-
@@ -8,13 +8,16 @@
 #include "tsqldatabasepool.h"
 #include "tsqldatabase.h"
 #include "tsqldriverextensionfactory.h"
+#include "tcachesqlitestore.h"
 #include "tsystemglobal.h"
 #include <TWebApplication>
 #include <TSqlQuery>
+#include <QSqlQuery>
 #include <TAppSettings>
 #include <QMutexLocker>
 #include <QFileInfo>
 #include <QDir>
+#include <QElapsedTimer>
 #include <ctime>
 
 constexpr auto CONN_NAME_FORMAT = "rdb%02d_%d";
@@ -24,7 +27,6 @@ TSqlDatabasePool *TSqlDatabasePool::instance()
 {
     static TSqlDatabasePool *databasePool = []() {
         auto *pool = new TSqlDatabasePool;
-        pool->maxConnects = Tf::app()->maxNumberOfThreadsPerAppServer();
         pool->init();
         return pool;
     }();
@@ -58,6 +60,11 @@ TSqlDatabasePool::~TSqlDatabasePool()
     delete[] cachedDatabase;
     delete[] lastCachedTime;
     delete[] availableNames;
+    delete[] waitQueue;
+    delete[] poolSettings;
+    delete[] invalidatedTime;
+    delete[] openedTime;
+    delete[] lastUsedTime;
 }
 
 
@@ -74,6 +81,19 @@ static QString driverType(int databaseId)
 }
 
 
+static QString defaultValidationQuery(const QString &driverType)
+{
+    if (driverType == QLatin1String("QOCI")) {
+        return QStringLiteral("SELECT 1 FROM DUAL");
+    } else if (driverType == QLatin1String("QDB2")) {
+        return QStringLiteral("SELECT 1 FROM SYSIBM.SYSDUMMY1");
+    } else if (driverType == QLatin1String("QIBASE")) {
+        return QStringLiteral("SELECT 1 FROM RDB$DATABASE");
+    }
+    return QStringLiteral("SELECT 1");
+}
+
+
 void TSqlDatabasePool::init()
 {
     if (Tf::app()->sqlDatabaseSettingsCount() == 0) {
@@ -81,14 +101,44 @@ void TSqlDatabasePool::init()
         return;
     }
 
-    cachedDatabase = new TStack<QString>[Tf::app()->sqlDatabaseSettingsCount()];
-    lastCachedTime = new TAtomic<uint>[Tf::app()->sqlDatabaseSettingsCount()];
-    availableNames = new TStack<QString>[Tf::app()->sqlDatabaseSettingsCount()];
+    const int count = Tf::app()->sqlDatabaseSettingsCount();
+    cachedDatabase = new TStack<QString>[count];
+    lastCachedTime = new TAtomic<uint>[count];
+    availableNames = new TStack<QString>[count];
+    waitQueue = new TPoolWaitQueue[count];
+    poolSettings = new PoolSettings[count];
+    invalidatedTime = new TAtomic<uint>[count];
     bool aval = false;
     tSystemDebug("SQL database available");
 
+    // Reads the pool settings
+    const int maxThreads = Tf::app()->maxNumberOfThreadsPerAppServer();
+    for (int j = 0; j < count; ++j) {
+        auto settings = Tf::app()->sqlDatabaseSettings(j);
+        auto &opt = poolSettings[j];
+
+        int max = settings.value("MaxConnections").toInt();
+        opt.maxConnections = (max > 0) ? max : maxThreads;
+        opt.minIdleConnections = qBound(0, settings.value("MinIdleConnections").toInt(), opt.maxConnections);
+        bool ok;
+        int timeout = settings.value("AcquireTimeout").toInt(&ok);
+        opt.acquireTimeout = ok ? timeout : 10000;
+        int idle = settings.value("ValidationIdleTime").toInt(&ok);
+        opt.validationIdleTime = ok ? idle : -1;
+        opt.maxLifeTime = qMax(settings.value("MaxLifeTime").toInt(), 0);
+        opt.validationQuery = settings.value("ValidationQuery").toString().trimmed();
+        if (opt.validationQuery.isEmpty()) {
+            opt.validationQuery = defaultValidationQuery(settings.value("DriverType").toString().trimmed());
+        }
+        maxConnects = qMax(maxConnects, opt.maxConnections);
+        tSystemDebug("SQL pool settings  id:%d max:%d minIdle:%d timeout:%d validationIdle:%d maxLifeTime:%d", j, opt.maxConnections, opt.minIdleConnections, opt.acquireTimeout, opt.validationIdleTime, opt.maxLifeTime);
+    }
+
+    openedTime = new TAtomic<uint>[count * maxConnects];
+    lastUsedTime = new TAtomic<uint>[count * maxConnects];
+
     // Adds databases previously
-    for (int j = 0; j < Tf::app()->sqlDatabaseSettingsCount(); ++j) {
+    for (int j = 0; j < count; ++j) {
         QString type = driverType(j);
         if (type.isEmpty()) {
             continue;
@@ -96,7 +146,7 @@ void TSqlDatabasePool::init()
         aval = true;
 
         auto &stack = availableNames[j];
-        for (int i = 0; i < maxConnects; ++i) {
+        for (int i = 0; i < poolSettings[j].maxConnections; ++i) {
             TSqlDatabase &db = TSqlDatabase::addDatabase(type, QString().sprintf(CONN_NAME_FORMAT, j, i));
             if (!db.isValid()) {
                 tWarn("Parameter 'DriverType' is invalid");
@@ -123,54 +173,140 @@ QSqlDatabase TSqlDatabasePool::database(int databaseId)
     if (Q_LIKELY(databaseId >= 0 && databaseId < Tf::app()->sqlDatabaseSettingsCount())) {
         auto &cache = cachedDatabase[databaseId];
         auto &stack = availableNames[databaseId];
+        auto &queue = waitQueue[databaseId];
+        const auto &opt = poolSettings[databaseId];
+        QElapsedTimer waitTimer;
+        bool ahead = false;  // true once this thread has got a connection
+
+        auto take = [&](QString &name, bool &cached) {
+            cached = cache.pop(name);
+            return cached || stack.pop(name);
+        };
 
         for (;;) {
             QString name;
-            if (cache.pop(name)) {
+            bool cached = false;
+
+            // Takes an idle connection unless others are waiting ahead
+            if ((!ahead && queue.hasWaiters()) || !take(name, cached)) {
+                // Pool exhausted, waits for a connection to be handed over
+                if (!waitTimer.isValid()) {
+                    waitTimer.start();
+                }
+
+                int remaining = opt.acquireTimeout - (int)waitTimer.elapsed();
+                if (remaining <= 0 || !queue.wait(remaining, take, name, cached)) {
+                    queue.recordExhausted();
+                    tError("SQL connection pool exhausted. Waited %d msecs. Increase MaxConnections or AcquireTimeout.", (int)waitTimer.elapsed());
+                    tSystemError("SQL connection pool exhausted  databaseId:%d", databaseId);
+                    break;
+                }
+            }
+            ahead = true;
+
+            if (cached) {
                 tdb = TSqlDatabase::database(name);
-                if (Q_LIKELY(tdb.sqlDatabase().isOpen())) {
-                    tSystemDebug("Gets cached database: %s", qPrintable(tdb.connectionName()));
-                    return tdb.sqlDatabase();
-                } else {
+                if (Q_UNLIKELY(!tdb.sqlDatabase().isOpen())) {
                     tSystemError("Pooled database is not open: %s  [%s:%d]", qPrintable(tdb.connectionName()), __FILE__, __LINE__);
                     stack.push(name);
                     continue;
                 }
-            }
 
-            if (Q_LIKELY(stack.pop(name))) {
-                auto tdb = TSqlDatabase::database(name);
-                if (Q_UNLIKELY(tdb.sqlDatabase().isOpen())) {
-                    tSystemWarn("Gets a opend database: %s", qPrintable(tdb.connectionName()));
-                    return tdb.sqlDatabase();
-                } else {
-                    if (Q_UNLIKELY(!tdb.sqlDatabase().open())) {
-                        tError("Database open error. Invalid database settings, or maximum number of SQL connection exceeded.");
-                        tSystemError("SQL database open error: %s", qPrintable(tdb.sqlDatabase().connectionName()));
-                        stack.push(name);
-                        return QSqlDatabase();
-                    }
-
-                    tSystemDebug("SQL database opened successfully (env:%s)", qPrintable(Tf::app()->databaseEnvironment()));
-                    tSystemDebug("Gets database: %s", qPrintable(tdb.sqlDatabase().connectionName()));
-
-                    // Executes setup-queries
-                    if (! tdb.postOpenStatements().isEmpty()) {
-                        TSqlQuery query(tdb.sqlDatabase());
-                        for (QString st : tdb.postOpenStatements()) {
-                            st = st.trimmed();
-                            query.exec(st);
-                        }
-                    }
-                    return tdb.sqlDatabase();
+                if (Q_UNLIKELY(isExpired(tdb.sqlDatabase(), databaseId))) {
+                    tSystemDebug("Pooled database expired: %s", qPrintable(tdb.connectionName()));
+                    queue.recordExpired();
+                    closeDatabase(tdb.sqlDatabase(), false);  // retries with it
+                    continue;
+                }
+
+                if (Q_UNLIKELY(!validateDatabase(tdb, databaseId))) {
+                    tSystemWarn("Pooled database validation failed: %s", qPrintable(tdb.connectionName()));
+                    queue.recordValidationFailure();
+                    // Validates every other idle connection on the next borrow
+                    invalidatedTime[databaseId].store((uint)std::time(nullptr));
+                    closeDatabase(tdb.sqlDatabase(), false);  // retries with it
+                    continue;
                 }
+
+                tSystemDebug("Gets cached database: %s", qPrintable(tdb.connectionName()));
+                queue.recordAcquire(waitTimer.isValid() ? waitTimer.elapsed() : 0, waitTimer.isValid());
+                return tdb.sqlDatabase();
+            }
+
+            auto tdb = TSqlDatabase::database(name);
+            if (Q_UNLIKELY(tdb.sqlDatabase().isOpen())) {
+                tSystemWarn("Gets a opend database: %s", qPrintable(tdb.connectionName()));
+            } else if (Q_UNLIKELY(!openDatabase(tdb))) {
+                queue.release(name, false, [&]() { stack.push(name); });
+                return QSqlDatabase();
             }
+
+            tSystemDebug("Gets database: %s", qPrintable(tdb.sqlDatabase().connectionName()));
+            queue.recordAcquire(waitTimer.isValid() ? waitTimer.elapsed() : 0, waitTimer.isValid());
+            return tdb.sqlDatabase();
         }
     }
     throw RuntimeException("No pooled connection", __FILE__, __LINE__);
 }
 
 
+bool TSqlDatabasePool::openDatabase(TSqlDatabase &database)
+{
+    if (Q_UNLIKELY(!database.sqlDatabase().open())) {
+        tError("Database open error. Invalid database settings, or maximum number of SQL connection exceeded.");
+        tSystemError("SQL database open error: %s", qPrintable(database.sqlDatabase().connectionName()));
+        return false;
+    }
+
+    tSystemDebug("SQL database opened successfully (env:%s)", qPrintable(Tf::app()->databaseEnvironment()));
+    uint now = (uint)std::time(nullptr);
+    connectionTime(openedTime, database.sqlDatabase()).store(now);
+    connectionTime(lastUsedTime, database.sqlDatabase()).store(now);
+
+    // Executes setup-queries
+    if (! database.postOpenStatements().isEmpty()) {
+        TSqlQuery query(database.sqlDatabase());
+        for (QString st : database.postOpenStatements()) {
+            st = st.trimmed();
+            query.exec(st);
+        }
+    }
+    return true;
+}
+
+
+/*!
+  Checks the pooled \a database with a cheap query if it has been idle
+  longer than ValidationIdleTime or a connection failure was detected
+  since it was returned.
+*/
+bool TSqlDatabasePool::validateDatabase(const TSqlDatabase &database, int databaseId)
+{
+    const auto &opt = poolSettings[databaseId];
+    uint lastUsed = connectionTime(lastUsedTime, database.sqlDatabase()).load();
+    uint invalidated = invalidatedTime[databaseId].load();
+    uint now = (uint)std::time(nullptr);
+
+    bool needed = (invalidated > 0 && lastUsed <= invalidated)
+        || (opt.validationIdleTime >= 0 && now - lastUsed >= (uint)opt.validationIdleTime);
+    if (!needed) {
+        return true;
+    }
+
+    QSqlQuery query(database.sqlDatabase());
+    bool ret = query.exec(opt.validationQuery);
+    tSystemDebug("Validated database: %s  result:%d", qPrintable(database.connectionName()), (int)ret);
+    return ret;
+}
+
+
+bool TSqlDatabasePool::isExpired(const QSqlDatabase &database, int databaseId) const
+{
+    int maxLifeTime = poolSettings[databaseId].maxLifeTime;
+    return maxLifeTime > 0 && connectionTime(openedTime, database).load() + (uint)maxLifeTime < (uint)std::time(nullptr);
+}
+
+
 bool TSqlDatabasePool::setDatabaseSettings(TSqlDatabase &database, int databaseId)
 {
     // Initiates database
@@ -249,10 +385,17 @@ void TSqlDatabasePool::pool(QSqlDatabase &database, bool forceClose)
             if (forceClose) {
                 tSystemWarn("Force close database: %s", qPrintable(database.connectionName()));
                 closeDatabase(database);
+            } else if (isExpired(database, databaseId)) {
+                tSystemDebug("Close expired database: %s", qPrintable(database.connectionName()));
+                waitQueue[databaseId].recordExpired();
+                closeDatabase(database);
             } else {
                 // pool
-                cachedDatabase[databaseId].push(database.connectionName());
-                lastCachedTime[databaseId].store((uint)std::time(nullptr));
+                uint now = (uint)std::time(nullptr);
+                connectionTime(lastUsedTime, database).store(now);
+                lastCachedTime[databaseId].store(now);
+                const QString name = database.connectionName();
+                waitQueue[databaseId].release(name, true, [&]() { cachedDatabase[databaseId].push(name); });
                 tSystemDebug("Pooled database: %s", qPrintable(database.connectionName()));
             }
         } else {
@@ -271,15 +414,25 @@ void TSqlDatabasePool::timerEvent(QTimerEvent *event)
         // Closes extra-connection
         for (int i = 0; i < Tf::app()->sqlDatabaseSettingsCount(); ++i) {
             auto &cache = cachedDatabase[i];
-            if (cache.count() == 0) {
-                continue;
-            }
+            int minIdle = poolSettings[i].minIdleConnections;
 
-            while (lastCachedTime[i].load() < (uint)std::time(nullptr) - 30
+            while (cache.count() > minIdle
+                   && lastCachedTime[i].load() < (uint)std::time(nullptr) - 30
                    && cache.pop(name)) {
                 QSqlDatabase db = TSqlDatabase::database(name).sqlDatabase();
                 closeDatabase(db);
             }
+
+            // Keeps the minimum number of idle connections open
+            while (cache.count() < minIdle && availableNames[i].pop(name)) {
+                TSqlDatabase tdb = TSqlDatabase::database(name);
+                if (!openDatabase(tdb)) {
+                    availableNames[i].push(name);
+                    break;
+                }
+                lastCachedTime[i].store((uint)std::time(nullptr));
+                waitQueue[i].release(name, true, [&]() { cache.push(name); });
+            }
         }
     } else {
         QObject::timerEvent(event);
@@ -287,13 +440,41 @@ void TSqlDatabasePool::timerEvent(QTimerEvent *event)
 }
 
 
-void TSqlDatabasePool::closeDatabase(QSqlDatabase &database)
+/*!
+  Closes the \a database and returns its name to the pool. If \a release
+  is true, the name is handed over to the thread waiting at the head of
+  the queue.
+*/
+void TSqlDatabasePool::closeDatabase(QSqlDatabase &database, bool release)
 {
     int id = getDatabaseId(database);
     QString name = database.connectionName();
+    if (id == Tf::app()->databaseIdForCache()) {
+        // A reopened connection may get the same handle
+        TCacheSQLiteStore::releaseStatements(name);
+    }
     database.close();
     tSystemDebug("Closed database connection, name: %s", qPrintable(name));
-    availableNames[id].push(name);
+    if (release) {
+        waitQueue[id].release(name, false, [&]() { availableNames[id].push(name); });
+    } else {
+        availableNames[id].push(name);
+    }
+}
+
+
+/*!
+  Returns the statistics of the connection pool for the database
+  specified by \a databaseId.
+*/
+TPoolStatistics TSqlDatabasePool::statistics(int databaseId) const
+{
+    TPoolStatistics stats;
+    if (databaseId >= 0 && databaseId < Tf::app()->sqlDatabaseSettingsCount() && waitQueue) {
+        stats = waitQueue[databaseId].statistics();
+        stats.idleCount = cachedDatabase[databaseId].count();
+    }
+    return stats;
 }
 
 
@@ -307,3 +488,19 @@ int TSqlDatabasePool::getDatabaseId(const QSqlDatabase &database)
     }
     return -1;
 }
+
+
+int TSqlDatabasePool::getConnectionIndex(const QSqlDatabase &database)
+{
+    const QString name = database.connectionName();
+    bool ok;
+    int idx = name.mid(name.indexOf('_') + 1).toInt(&ok);
+    return (ok && idx >= 0) ? idx : 0;
+}
+
+
+TAtomic<uint> &TSqlDatabasePool::connectionTime(TAtomic<uint> *times, const QSqlDatabase &database) const
+{
+    int id = qMax(getDatabaseId(database), 0);
+    return times[id * maxConnects + getConnectionIndex(database)];
+}
@@ -11,6 +11,7 @@
 #include <TGlobal>
 #include "tatomic.h"
 #include "tstack.h"
+#include "tpoolwaitqueue.h"
 
 class TSqlDatabase;
 
@@ -23,6 +24,8 @@ public:
     QSqlDatabase database(int databaseId = 0);
     void pool(QSqlDatabase &database, bool forceClose = false);
 
+    TPoolStatistics statistics(int databaseId = 0) const;
+
     static TSqlDatabasePool *instance();
     static bool setDatabaseSettings(TSqlDatabase &database, int databaseId);
     static int getDatabaseId(const QSqlDatabase &database);
@@ -30,14 +33,33 @@ public:
 protected:
     void init();
     void timerEvent(QTimerEvent *event);
-    void closeDatabase(QSqlDatabase &database);
+    void closeDatabase(QSqlDatabase &database, bool release = true);
+    bool openDatabase(TSqlDatabase &database);
+    bool validateDatabase(const TSqlDatabase &database, int databaseId);
+    bool isExpired(const QSqlDatabase &database, int databaseId) const;
 
 private:
+    struct PoolSettings {
+        int minIdleConnections {0};
+        int maxConnections {0};
+        int acquireTimeout {10000};    // msecs
+        int validationIdleTime {-1};   // secs, negative value disables it
+        int maxLifeTime {0};           // secs, 0 means unlimited
+        QString validationQuery;
+    };
+
     TSqlDatabasePool();
+    TAtomic<uint> &connectionTime(TAtomic<uint> *times, const QSqlDatabase &database) const;
+    static int getConnectionIndex(const QSqlDatabase &database);
 
     TStack<QString> *cachedDatabase {nullptr};
     TAtomic<uint> *lastCachedTime {nullptr};
     TStack<QString> *availableNames {nullptr};
+    TPoolWaitQueue *waitQueue {nullptr};
+    PoolSettings *poolSettings {nullptr};
+    TAtomic<uint> *invalidatedTime {nullptr};
+    TAtomic<uint> *openedTime {nullptr};    // per connection
+    TAtomic<uint> *lastUsedTime {nullptr};  // per connection
     int maxConnects {0};
     QBasicTimer timer;
 
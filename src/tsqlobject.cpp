@@ -10,6 +10,7 @@
 #include <TSystemGlobal>
 #include "tsqldatabase.h"
 #include "tsqldriverextension.h"
+#include "tsqlquerycache.h"
 #include <QtSql>
 #include <QCoreApplication>
 #include <QMetaObject>
@@ -37,7 +38,7 @@ TSqlObject::TSqlObject()
  */
 TSqlObject::TSqlObject(const TSqlObject &other)
     : TModelObject(), QSqlRecord(*static_cast<const QSqlRecord *>(&other)),
-      sqlError(other.sqlError)
+      sqlError(other.sqlError), relatedObjectsMap(other.relatedObjectsMap)
 { }
 
 /*!
@@ -47,6 +48,7 @@ TSqlObject &TSqlObject::operator=(const TSqlObject &other)
 {
     QSqlRecord::operator=(*static_cast<const QSqlRecord *>(&other));
     sqlError = other.sqlError;
+    relatedObjectsMap = other.relatedObjectsMap;
     return *this;
 }
 
@@ -183,6 +185,7 @@ bool TSqlObject::create()
                 QSqlRecord::setValue(autoValueIndex(), lastid);
             }
         }
+        TSqlQueryCache::invalidate(tableName(), databaseId());
     }
     return ret;
 }
@@ -291,6 +294,7 @@ bool TSqlObject::update()
             sqlError = QSqlError(msg, QString(), QSqlError::UnknownError);
             throw SqlException(msg, __FILE__, __LINE__);
         }
+        TSqlQueryCache::invalidate(tableName(), databaseId());
     }
     return ret;
 }
@@ -364,6 +368,7 @@ bool TSqlObject::save()
                 QSqlRecord::setValue(autoValueIndex(), lastid);
             }
         }
+        TSqlQueryCache::invalidate(tableName(), databaseId());
     }
     return ret;
 }
@@ -439,6 +444,7 @@ bool TSqlObject::remove()
             }
             tWarn("Row was deleted by another transaction, %s", qPrintable(tableName()));
         }
+        TSqlQueryCache::invalidate(tableName(), databaseId());
         clear();
     }
     return ret;
@@ -7,8 +7,11 @@
 #include <QDateTime>
 #include <QVariantMap>
 #include <QStringList>
+#include <QMap>
 #include <TGlobal>
 #include <TModelObject>
+#include <TSqlRelation>
+#include <memory>
 
 
 class T_CORE_EXPORT TSqlObject : public TModelObject, public QSqlRecord
@@ -33,13 +36,54 @@ public:
     bool isNull() const override { return QSqlRecord::isEmpty(); }
     bool isNew() const { return QSqlRecord::isEmpty(); }
     bool isModified() const;
-    void clear() override { QSqlRecord::clear(); }
+    void clear() override { QSqlRecord::clear(); relatedObjectsMap.clear(); }
     QSqlError error() const { return sqlError; }
 
+    bool isRelationLoaded(const QByteArray &name) const { return relatedObjectsMap.contains(name); }
+    template <class C> QList<C> relatedObjects(const QByteArray &name) const;
+    template <class C> C relatedObject(const QByteArray &name) const;
+    template <class C> void setRelatedObjects(const QByteArray &name, const QList<C> &objects);
+
 protected:
     void syncToSqlRecord();
     void syncToObject();
     QSqlError sqlError;
+
+private:
+    QMap<QByteArray, std::shared_ptr<TSqlRelatedObjectsHolder>> relatedObjectsMap;
 };
 
+/*!
+  Returns the objects of the relation \a name loaded eagerly by
+  TSqlORMapper::with().
+  \sa TSqlRelation
+*/
+template <class C>
+inline QList<C> TSqlObject::relatedObjects(const QByteArray &name) const
+{
+    auto holder = std::dynamic_pointer_cast<TSqlRelatedObjects<C>>(relatedObjectsMap.value(name));
+    return (holder) ? holder->list : QList<C>();
+}
+
+/*!
+  Returns the object of the belongs-to relation \a name loaded eagerly
+  by TSqlORMapper::with().
+  \sa TSqlRelation
+*/
+template <class C>
+inline C TSqlObject::relatedObject(const QByteArray &name) const
+{
+    QList<C> list = relatedObjects<C>(name);
+    return (list.isEmpty()) ? C() : list.first();
+}
+
+/*!
+  Sets the \a objects to the relation \a name.
+*/
+template <class C>
+inline void TSqlObject::setRelatedObjects(const QByteArray &name, const QList<C> &objects)
+{
+    relatedObjectsMap.insert(name, std::make_shared<TSqlRelatedObjects<C>>(objects));
+}
+
 #endif // TSQLOBJECT_H
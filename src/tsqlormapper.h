@@ -4,13 +4,21 @@
 #include <QtSql>
 #include <QList>
 #include <QMap>
+#include <QSet>
+#include <QElapsedTimer>
 #include <TGlobal>
 #include <TSqlObject>
 #include <TCriteria>
 #include <TCriteriaConverter>
 #include <TSqlQuery>
 #include <TSqlJoin>
+#include <TSqlRelation>
+#include <TKeysetPaginator>
+#include "tsqlquerycache.h"
+#include "tsqlprofiler.h"
 #include "tsystemglobal.h"
+#include <functional>
+#include <limits>
 
 /*!
   \class TSqlORMapper
@@ -35,18 +43,22 @@ public:
     TSqlORMapper<T> &orderBy(int column, Tf::SortOrder order = Tf::AscendingOrder);
     TSqlORMapper<T> &orderBy(const QString &column, Tf::SortOrder order = Tf::AscendingOrder);
     template <class C> TSqlORMapper<T> &join(int column, const TSqlJoin<C> &join);
+    TSqlORMapper<T> &cache(int seconds);
+    template <class C> TSqlORMapper<T> &with(const TSqlRelation<C> &relation);
 
     void setLimit(int limit);
     void setOffset(int offset);
     void setSortOrder(int column, Tf::SortOrder order = Tf::AscendingOrder);
     void setSortOrder(const QString &column, Tf::SortOrder order = Tf::AscendingOrder);
     template <class C> void setJoin(int column, const TSqlJoin<C> &join);
+    void setCacheLifetime(int seconds);
     void reset();
 
     T findFirst(const TCriteria &cri = TCriteria());
     T findFirstBy(int column, QVariant value);
     T findByPrimaryKey(QVariant pk);
     int find(const TCriteria &cri = TCriteria());
+    int find(const TCriteria &cri, TKeysetPaginator &paginator);
     int findBy(int column, QVariant value);
     int findIn(int column, const QVariantList &values);
     int rowCount() const;
@@ -95,6 +107,11 @@ protected:
     virtual void clear();
     virtual QString selectStatement() const;
     virtual int rowCount(const QModelIndex &parent) const;
+    bool execSelect();
+    QStringList queryTables() const;
+    QSqlRecord recordAt(int i) const;
+    template <class C> void loadRelation(const TSqlRelation<C> &relation);
+    static QByteArray relationKey(const QVariant &value);
 
 private:
     QString queryFilter;
@@ -104,6 +121,12 @@ private:
     int joinCount {0};
     QStringList joinClauses;
     QStringList joinWhereClauses;
+    QStringList joinTables;
+    int cacheLifetime {0};
+    bool cacheHit {false};
+    QList<QSqlRecord> cachedRecords;
+    QList<std::function<void()>> relationLoaders;
+    QList<std::function<void(const QSqlRecord &, T &)>> relationSetters;
 
     T_DISABLE_COPY(TSqlORMapper)
     T_DISABLE_MOVE(TSqlORMapper)
@@ -142,8 +165,7 @@ inline T TSqlORMapper<T>::findFirst(const TCriteria &cri)
 
     int oldLimit = queryLimit;
     queryLimit = 1;
-    bool ret = select();
-    Tf::writeQueryLog(query().lastQuery(), ret, lastError());
+    execSelect();
     queryLimit = oldLimit;
 
     //tSystemDebug("findFirst() rowCount: %d", rowCount());
@@ -192,13 +214,203 @@ inline int TSqlORMapper<T>::find(const TCriteria &cri)
         setFilter(QString());
     }
 
+    bool ret = execSelect();
+    //tSystemDebug("find() rowCount: %d", rowCount());
+    return ret ? rowCount() : -1;
+}
+
+/*!
+  Retrieves the page of the keyset \a paginator with the criteria \a cri
+  from the table and returns the number of the ORM objects. The rows are
+  sorted by the columns of the paginator and sought past its cursor
+  without OFFSET; the sort order and the offset set to this mapper are
+  not used. The cursor of the next page is set to the \a paginator.
+  \sa TKeysetPaginator
+*/
+template <class T>
+inline int TSqlORMapper<T>::find(const TCriteria &cri, TKeysetPaginator &paginator)
+{
+    const QList<int> columns = paginator.columns();
+    if (columns.isEmpty()) {
+        tError("No columns for keyset pagination  [%s:%d]", __FILE__, __LINE__);
+        return -1;
+    }
+
+    TCriteria criteria(cri);
+    TCriteria seek = paginator.criteria();
+    if (!seek.isEmpty()) {
+        criteria.add(seek);
+    }
+
+    auto oldSortColumns = sortColumns;
+    int oldLimit = queryLimit;
+    int oldOffset = queryOffset;
+    sortColumns.clear();
+    for (int column : columns) {
+        setSortOrder(column, paginator.sortOrder());
+    }
+    queryLimit = paginator.itemCountPerPage();
+    queryOffset = 0;
+
+    int cnt = find(criteria);
+
+    sortColumns = oldSortColumns;
+    queryLimit = oldLimit;
+    queryOffset = oldOffset;
+
+    QVariantList lastValues;
+    if (cnt > 0) {
+        T obj = last();
+        const QMetaObject *metaObject = obj.metaObject();
+        for (int column : columns) {
+            lastValues << metaObject->property(metaObject->propertyOffset() + column).read(&obj);
+        }
+    }
+    paginator.setPageResult(qMax(cnt, 0), lastValues);
+    return cnt;
+}
+
+/*!
+  Executes the SELECT statement, or reads its result from the query
+  cache if cache() is set. This function is for internal use only.
+*/
+template <class T>
+inline bool TSqlORMapper<T>::execSelect()
+{
+    QByteArray key;
+    cacheHit = false;
+    cachedRecords.clear();
+
+    if (cacheLifetime > 0 && TSqlQueryCache::isAvailable()) {
+        key = TSqlQueryCache::key(selectStatement(), QVariantList(), queryTables(), T().databaseId());
+        if (TSqlQueryCache::get(key, cachedRecords)) {
+            cacheHit = true;
+            return true;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
     bool ret = select();
     while (canFetchMore()) { // For SQLite, not report back the size of a query
         fetchMore();
     }
+    TSqlProfiler::recordQuery(query().lastQuery(), ret, timer.nsecsElapsed() / 1000);
     Tf::writeQueryLog(query().lastQuery(), ret, lastError());
-    //tSystemDebug("find() rowCount: %d", rowCount());
-    return ret ? rowCount() : -1;
+
+    if (ret && !key.isEmpty()) {
+        QList<QSqlRecord> records;
+        for (int i = 0; i < QSqlTableModel::rowCount(); ++i) {
+            records << record(i);
+        }
+        TSqlQueryCache::set(key, records, cacheLifetime);
+    }
+
+    // Eager loading
+    relationSetters.clear();
+    if (ret && rowCount() > 0) {
+        for (auto &loader : relationLoaders) {
+            loader();
+        }
+    }
+    return ret;
+}
+
+/*!
+  Returns the record at the index \a i of the results.
+*/
+template <class T>
+inline QSqlRecord TSqlORMapper<T>::recordAt(int i) const
+{
+    return (cacheHit) ? cachedRecords.at(i) : record(i);
+}
+
+/*!
+  Loads the records of the \a relation for all the results with
+  queries of "WHERE foreign_column IN (...)", each of which has up to
+  500 keys to stay within the limits of the databases, 999 parameters
+  of SQLite and 1000 items of Oracle. This function is for internal
+  use only.
+*/
+template <class T>
+template <class C> inline void TSqlORMapper<T>::loadRelation(const TSqlRelation<C> &relation)
+{
+    const QMetaObject *metaObject = T().metaObject();
+    const QString field = metaObject->property(metaObject->propertyOffset() + relation.column()).name();
+    if (field.isEmpty()) {
+        tError("Invalid relation column: %s  [%s:%d]", relation.name().data(), __FILE__, __LINE__);
+        return;
+    }
+
+    QVariantList keys;
+    QSet<QByteArray> keySet;
+    for (int i = 0; i < rowCount(); ++i) {
+        QVariant key = recordAt(i).value(field);
+        if (!key.isNull() && !keySet.contains(relationKey(key))) {
+            keySet << relationKey(key);
+            keys << key;
+        }
+    }
+
+    const int batchSize = 500;
+    QHash<QByteArray, QList<C>> related;
+    const QMetaObject *foreignMetaObject = C().metaObject();
+    const QMetaProperty foreignProperty = foreignMetaObject->property(foreignMetaObject->propertyOffset() + relation.foreignColumn());
+
+    for (int i = 0; i < keys.count(); i += batchSize) {
+        TSqlORMapper<C> mapper;
+        mapper.findIn(relation.foreignColumn(), keys.mid(i, batchSize));
+        for (const auto &obj : mapper) {
+            related[relationKey(foreignProperty.read(&obj))] << obj;
+        }
+    }
+
+    const QByteArray name = relation.name();
+    relationSetters << [related, name, field](const QSqlRecord &record, T &obj) {
+        obj.template setRelatedObjects<C>(name, related.value(relationKey(record.value(field))));
+    };
+}
+
+/*!
+  Returns the key to match the \a value of a relation column with.
+  Integers are compared as the same type, since the drivers return
+  them as a type other than that of the property; the other values
+  are compared without converting to strings. This function is for
+  internal use only.
+*/
+template <class T>
+inline QByteArray TSqlORMapper<T>::relationKey(const QVariant &value)
+{
+    QVariant val = value;
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+        val = value.toLongLong();
+        break;
+    case QVariant::ULongLong:
+        if (value.toULongLong() <= (quint64)std::numeric_limits<qint64>::max()) {
+            val = value.toLongLong();
+        }
+        break;
+    default:
+        break;
+    }
+
+    QByteArray key;
+    QDataStream ds(&key, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_4);
+    ds << val;
+    return key;
+}
+
+/*!
+  Returns the names of the tables read by the SELECT statement.
+*/
+template <class T>
+inline QStringList TSqlORMapper<T>::queryTables() const
+{
+    return QStringList(tableName()) + joinTables;
 }
 
 /*!
@@ -231,7 +443,7 @@ inline int TSqlORMapper<T>::findIn(int column, const QVariantList &values)
 template <class T>
 inline int TSqlORMapper<T>::rowCount() const
 {
-    return QSqlTableModel::rowCount();
+    return (cacheHit) ? cachedRecords.count() : QSqlTableModel::rowCount();
 }
 
 /*!
@@ -240,7 +452,7 @@ inline int TSqlORMapper<T>::rowCount() const
 template <class T>
 inline int TSqlORMapper<T>::rowCount(const QModelIndex &parent) const
 {
-    return QSqlTableModel::rowCount(parent);
+    return (cacheHit) ? cachedRecords.count() : QSqlTableModel::rowCount(parent);
 }
 
 /*!
@@ -273,7 +485,11 @@ inline T TSqlORMapper<T>::value(int i) const
 {
     T rec;
     if (i >= 0 && i < rowCount()) {
-        rec.setRecord(record(i), QSqlError());
+        const QSqlRecord rcd = recordAt(i);
+        rec.setRecord(rcd, QSqlError());
+        for (auto &setter : relationSetters) {
+            setter(rcd, rec);
+        }
     } else {
         tSystemDebug("no such record, index: %d  rowCount:%d", i, rowCount());
     }
@@ -300,6 +516,19 @@ inline void TSqlORMapper<T>::setOffset(int offset)
     queryOffset = offset;
 }
 
+/*!
+  Sets the lifetime of the query cache to \a seconds. If it is greater
+  than 0, the results of find(), findFirst() and findCount() are stored
+  in the cache and served from it until a write to the tables.
+  Cache.EnableQueryCache in the application.ini must be true.
+  \sa TSqlQueryCache
+*/
+template <class T>
+inline void TSqlORMapper<T>::setCacheLifetime(int seconds)
+{
+    cacheLifetime = seconds;
+}
+
 /*!
   Sets the sort order for \a column to \a order.
 */
@@ -353,6 +582,31 @@ inline TSqlORMapper<T> &TSqlORMapper<T>::offset(int o)
     return *this;
 }
 
+/*!
+  Sets the lifetime of the query cache to \a seconds.
+  \sa setCacheLifetime()
+*/
+template <class T>
+inline TSqlORMapper<T> &TSqlORMapper<T>::cache(int seconds)
+{
+    setCacheLifetime(seconds);
+    return *this;
+}
+
+/*!
+  Loads the records of the \a relation eagerly on the next find(),
+  with one query per relation instead of one query per row.
+  The loaded objects are set to each ORM object and obtained by
+  TSqlObject::relatedObjects() or TSqlObject::relatedObject().
+  \sa TSqlRelation
+*/
+template <class T>
+template <class C> inline TSqlORMapper<T> &TSqlORMapper<T>::with(const TSqlRelation<C> &relation)
+{
+    relationLoaders << [this, relation]() { loadRelation<C>(relation); };
+    return *this;
+}
+
 /*!
   Sets the sort order for \a column to \a order.
 */
@@ -475,12 +729,26 @@ inline int TSqlORMapper<T>::findCount(const TCriteria &cri)
     query += selectStatement();
     query += QLatin1String(") t");
 
+    QByteArray key;
+    QList<QSqlRecord> records;
+    if (cacheLifetime > 0 && TSqlQueryCache::isAvailable()) {
+        key = TSqlQueryCache::key(query, QVariantList(), queryTables(), T().databaseId());
+        if (TSqlQueryCache::get(key, records) && !records.isEmpty()) {
+            return records.first().value(0).toInt();
+        }
+    }
+
     int cnt = -1;
     TSqlQuery q(database());
     bool res = q.exec(query);
     if (res) {
         q.next();
         cnt = q.value(0).toInt();
+
+        if (!key.isEmpty()) {
+            records << q.record();
+            TSqlQueryCache::set(key, records, cacheLifetime);
+        }
     }
     return cnt;
 }
@@ -550,6 +818,9 @@ int TSqlORMapper<T>::updateAll(const TCriteria &cri, const QMap<int, QVariant> &
 
     TSqlQuery sqlQuery(db);
     bool res = sqlQuery.exec(upd);
+    if (res) {
+        TSqlQueryCache::invalidate(tableName(), T().databaseId());
+    }
     return res ? sqlQuery.numRowsAffected() : -1;
 }
 
@@ -588,6 +859,9 @@ inline int TSqlORMapper<T>::removeAll(const TCriteria &cri)
 
     TSqlQuery sqlQuery(db);
     bool res = sqlQuery.exec(del);
+    if (res) {
+        TSqlQueryCache::invalidate(T().tableName(), T().databaseId());
+    }
     return res ? sqlQuery.numRowsAffected() : -1;
 }
 
@@ -625,6 +899,7 @@ template <class C> inline void TSqlORMapper<T>::setJoin(int column, const TSqlJo
     QSqlDatabase db = database();
 
     clause += C().tableName();
+    joinTables << C().tableName();
     clause += QLatin1Char(' ');
     clause += alias;
     clause += QLatin1String(" ON ");
@@ -669,6 +944,12 @@ inline void TSqlORMapper<T>::clear()
     joinCount = 0;
     joinClauses.clear();
     joinWhereClauses.clear();
+    joinTables.clear();
+    cacheLifetime = 0;
+    cacheHit = false;
+    cachedRecords.clear();
+    relationLoaders.clear();
+    relationSetters.clear();
 
     // Don't call the setTable() here,
     // or it causes a segmentation fault.
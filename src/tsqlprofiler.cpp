@@ -0,0 +1,186 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tsqlprofiler.h"
+#include "tdatabasecontext.h"
+#include "tsystemglobal.h"
+#include <TWebApplication>
+#include <TAppSettings>
+#include <QRegularExpression>
+
+/*!
+  \class TSqlProfiler
+  \brief The TSqlProfiler class collects statistics of the SQL queries
+  executed in a context, such as the number of the queries, the total
+  time and the slowest statement.
+
+  A query that takes longer than SqlQuerySlowThreshold milliseconds is
+  written to the slow query log, SqlQuerySlowLogFile. When the same
+  statement shape runs more than SqlQueryRepeatThreshold times in one
+  action, a warning of N+1 queries is output.
+  \sa TDatabaseContext::sqlProfiler()
+*/
+
+namespace {
+    qint64 slowQueryThreshold()
+    {
+        // Milliseconds; negative value means disabled
+        static const qint64 threshold = Tf::appSettings()->value(Tf::SqlQuerySlowThreshold, -1).toLongLong();
+        return threshold;
+    }
+
+    int repeatQueryThreshold()
+    {
+        static const int threshold = Tf::appSettings()->value(Tf::SqlQueryRepeatThreshold, 0).toInt();
+        return threshold;
+    }
+
+    void writeSlowQueryLog(const QByteArray &label, const QString &query, bool success, qint64 usecs)
+    {
+        qint64 threshold = slowQueryThreshold();
+        if (threshold >= 0 && usecs >= threshold * 1000) {
+            Tf::traceSlowQueryLog("[%s] %.3f ms %s%s", label.data(), usecs / 1000.0,
+                                  (success ? "" : "(Query failed) "), qPrintable(query));
+        }
+    }
+}
+
+/*!
+  Clears the statistics.
+*/
+void TSqlProfiler::clear()
+{
+    _label.clear();
+    _queryCount = 0;
+    _totalTime = 0;
+    _slowestTime = 0;
+    _slowestQuery.clear();
+    _shapeCounts.clear();
+}
+
+/*!
+  Records the \a query which took \a usecs microseconds.
+*/
+void TSqlProfiler::record(const QString &query, bool success, qint64 usecs)
+{
+    _queryCount++;
+    _totalTime += usecs;
+    if (usecs >= _slowestTime) {
+        _slowestTime = usecs;
+        _slowestQuery = query;
+    }
+
+    writeSlowQueryLog(_label, query, success, usecs);
+
+    int threshold = repeatQueryThreshold();
+    if (threshold > 0) {
+        const QString sh = shape(query);
+        int cnt = ++_shapeCounts[sh];
+        if (cnt == threshold + 1) {
+            tWarn("N+1 queries suspected in %s: the same statement ran more than %d times: %s",
+                  _label.data(), threshold, qPrintable(sh));
+        }
+    }
+}
+
+/*!
+  Returns the summary of the statistics, such as
+  "12 queries, 34.567 ms total, slowest 10.000 ms".
+*/
+QByteArray TSqlProfiler::summary() const
+{
+    QByteArray sum;
+    sum.reserve(64);
+    sum += QByteArray::number(_queryCount);
+    sum += (_queryCount == 1) ? " query, " : " queries, ";
+    sum += QByteArray::number(_totalTime / 1000.0, 'f', 3);
+    sum += " ms total, slowest ";
+    sum += QByteArray::number(_slowestTime / 1000.0, 'f', 3);
+    sum += " ms";
+    return sum;
+}
+
+/*!
+  Writes the summary line and the slowest statement to the SQL
+  query log.
+*/
+void TSqlProfiler::writeSummary() const
+{
+    if (_queryCount > 0) {
+        Tf::traceQueryLog("[Profile] %s: %s: %s", _label.data(), summary().data(), qPrintable(_slowestQuery));
+    }
+}
+
+/*!
+  Records the \a query which took \a usecs microseconds to the SQL
+  profiler of the current database context.
+*/
+void TSqlProfiler::recordQuery(const QString &query, bool success, qint64 usecs)
+{
+    TDatabaseContext *context = TDatabaseContext::currentDatabaseContext();
+    if (context) {
+        context->sqlProfiler().record(query, success, usecs);
+    } else {
+        writeSlowQueryLog(QByteArray(), query, success, usecs);
+    }
+}
+
+/*!
+  Returns the shape of the \a query, in which literal values are
+  replaced with '?', so that statements which differ only in values
+  have the same shape.
+*/
+QString TSqlProfiler::shape(const QString &query)
+{
+    static const QRegularExpression placeholderList("\\?(?:\\s*,\\s*\\?)+");
+
+    QString ret;
+    ret.reserve(query.length());
+    const int len = query.length();
+    bool space = false;
+
+    for (int i = 0; i < len; ++i) {
+        const QChar c = query[i];
+        if (c.isSpace()) {
+            space = true;
+            continue;
+        }
+
+        if (space && !ret.isEmpty()) {
+            ret += QLatin1Char(' ');
+        }
+        space = false;
+
+        if (c == QLatin1Char('\'')) {
+            // String literal
+            for (++i; i < len; ++i) {
+                if (query[i] == QLatin1Char('\\')) {
+                    ++i;
+                } else if (query[i] == QLatin1Char('\'')) {
+                    if (i + 1 < len && query[i + 1] == QLatin1Char('\'')) {
+                        ++i;
+                    } else {
+                        break;
+                    }
+                }
+            }
+            ret += QLatin1Char('?');
+        } else if (c.isDigit() && (ret.isEmpty() || !(ret.at(ret.length() - 1).isLetterOrNumber() || ret.at(ret.length() - 1) == QLatin1Char('_')))) {
+            // Numeric literal
+            while (i + 1 < len && (query[i + 1].isDigit() || query[i + 1] == QLatin1Char('.'))) {
+                ++i;
+            }
+            ret += QLatin1Char('?');
+        } else {
+            ret += c;
+        }
+    }
+
+    // IN (?, ?, ?) and IN (?) have the same shape
+    ret.replace(placeholderList, QStringLiteral("?"));
+    return ret;
+}
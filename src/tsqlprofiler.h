@@ -0,0 +1,41 @@
+#ifndef TSQLPROFILER_H
+#define TSQLPROFILER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TSqlProfiler
+{
+public:
+    TSqlProfiler() { }
+
+    void clear();
+    void setLabel(const QByteArray &label) { _label = label; }
+    QByteArray label() const { return _label; }
+    void record(const QString &query, bool success, qint64 usecs);
+    int queryCount() const { return _queryCount; }
+    qint64 totalTime() const { return _totalTime; }
+    qint64 slowestTime() const { return _slowestTime; }
+    QString slowestQuery() const { return _slowestQuery; }
+    QByteArray summary() const;
+    void writeSummary() const;
+
+    static void recordQuery(const QString &query, bool success, qint64 usecs);
+    static QString shape(const QString &query);
+
+private:
+    QByteArray _label;
+    int _queryCount {0};
+    qint64 _totalTime {0};  // microseconds
+    qint64 _slowestTime {0};
+    QString _slowestQuery;
+    QHash<QString, int> _shapeCounts;
+
+    T_DISABLE_COPY(TSqlProfiler)
+    T_DISABLE_MOVE(TSqlProfiler)
+};
+
+#endif // TSQLPROFILER_H
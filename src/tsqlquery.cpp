@@ -9,7 +9,9 @@
 #include <TWebApplication>
 #include <TAppSettings>
 #include "tsystemglobal.h"
+#include "tsqlprofiler.h"
 #include <QMap>
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QMutexLocker>
 
@@ -163,7 +165,10 @@ TSqlQuery &TSqlQuery::prepare(const QString &query)
 */
 bool TSqlQuery::exec(const QString &query)
 {
+    QElapsedTimer timer;
+    timer.start();
     bool ret = QSqlQuery::exec(query);
+    TSqlProfiler::recordQuery(query, ret, timer.nsecsElapsed() / 1000);
     Tf::writeQueryLog(query, ret, lastError());
     return ret;
 }
@@ -174,7 +179,10 @@ bool TSqlQuery::exec(const QString &query)
 */
 bool TSqlQuery::exec()
 {
+    QElapsedTimer timer;
+    timer.start();
     bool ret = QSqlQuery::exec();
+    TSqlProfiler::recordQuery(executedQuery(), ret, timer.nsecsElapsed() / 1000);
     Tf::writeQueryLog(executedQuery(), ret, lastError());
     return ret;
 }
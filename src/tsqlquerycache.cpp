@@ -0,0 +1,219 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tsqlquerycache.h"
+#include <TWebApplication>
+#include <TAppSettings>
+#include <TDatabaseContext>
+#include <TCache>
+#include <QSqlField>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include "tsystemglobal.h"
+
+/*!
+  \class TSqlQueryCache
+  \brief The TSqlQueryCache class stores results of SELECT statements in
+  the cache of TCache. Each entry is keyed by the normalized SQL and the
+  bound values, and tagged with the version of the tables it reads, so
+  that a write to a table invalidates all the entries read from it.
+  \sa TSqlORMapper::cache(), TSqlQueryORMapper::cache()
+*/
+
+constexpr auto KEY_PREFIX = "tfqc:";
+constexpr auto TAG_PREFIX = "tfqt:";
+constexpr int TAG_LIFETIME = 7 * 24 * 3600;  // 7 days
+
+
+static TCache *currentCache()
+{
+    auto *context = TDatabaseContext::currentDatabaseContext();
+    return (context) ? context->cache() : nullptr;
+}
+
+/*!
+  Returns true if the query cache is enabled by Cache.EnableQueryCache
+  in the application.ini and the cache module is available.
+*/
+bool TSqlQueryCache::isAvailable()
+{
+    static const bool enable = Tf::app()->cacheEnabled() && Tf::appSettings()->value(Tf::CacheEnableQueryCache, false).toBool();
+    return enable;
+}
+
+/*!
+  Returns the normalized form of \a query, which whitespaces are
+  simplified.
+*/
+QString TSqlQueryCache::normalize(const QString &query)
+{
+    return query.simplified();
+}
+
+/*!
+  Returns a key for the result of \a query executed with \a boundValues
+  on the database \a databaseId. The current versions of \a tables are
+  mixed into the key.
+*/
+QByteArray TSqlQueryCache::key(const QString &query, const QVariantList &boundValues, const QStringList &tables, int databaseId)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(databaseId));
+    hash.addData(normalize(query).toUtf8());
+
+    for (auto &val : boundValues) {
+        // The serialization, unlike the string form, tells apart any
+        // two values
+        QByteArray bytes;
+        QDataStream ds(&bytes, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_5_4);
+        ds << val;
+        hash.addData("\x1f", 1);
+        hash.addData(QByteArray::number(val.userType()));
+        hash.addData(bytes);
+    }
+
+    for (auto &table : tables) {
+        hash.addData("\x1e", 1);
+        hash.addData(tagVersion(table, databaseId));
+    }
+    return QByteArray(KEY_PREFIX) + hash.result().toHex();
+}
+
+/*!
+  Reads the records cached with the \a key into \a records. Returns true
+  if found; otherwise returns false.
+*/
+bool TSqlQueryCache::get(const QByteArray &key, QList<QSqlRecord> &records)
+{
+    TCache *cache = currentCache();
+    if (!cache) {
+        return false;
+    }
+
+    QByteArray data = cache->get(key);
+    if (data.isEmpty()) {
+        return false;
+    }
+
+    QDataStream ds(data);
+    QStringList names;
+    QList<int> types;
+    int count = 0;
+    ds >> names >> types >> count;
+    if (ds.status() != QDataStream::Ok || names.count() != types.count()) {
+        return false;
+    }
+
+    QSqlRecord base;
+    for (int i = 0; i < names.count(); ++i) {
+        base.append(QSqlField(names[i], (QVariant::Type)types[i]));
+    }
+
+    records.clear();
+    records.reserve(count);
+    for (int r = 0; r < count; ++r) {
+        QSqlRecord rec = base;
+        for (int i = 0; i < names.count(); ++i) {
+            QVariant val;
+            ds >> val;
+            rec.setValue(i, val);
+        }
+        records << rec;
+    }
+
+    if (ds.status() != QDataStream::Ok) {
+        records.clear();
+        return false;
+    }
+    tSystemDebug("Query cache hit: %s", key.data());
+    return true;
+}
+
+/*!
+  Stores the \a records in the cache with the \a key for \a seconds.
+*/
+bool TSqlQueryCache::set(const QByteArray &key, const QList<QSqlRecord> &records, int seconds)
+{
+    TCache *cache = currentCache();
+    if (!cache || seconds <= 0) {
+        return false;
+    }
+
+    QStringList names;
+    QList<int> types;
+    if (!records.isEmpty()) {
+        const QSqlRecord &first = records.first();
+        for (int i = 0; i < first.count(); ++i) {
+            names << first.fieldName(i);
+            types << (int)first.field(i).type();
+        }
+    }
+
+    QByteArray data;
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds << names << types << records.count();
+    for (auto &rec : records) {
+        for (int i = 0; i < names.count(); ++i) {
+            ds << rec.value(i);
+        }
+    }
+    return cache->set(key, data, seconds);
+}
+
+/*!
+  Invalidates all the entries that read the \a table on the database
+  \a databaseId. If a transaction is active in the current context,
+  the entries are invalidated after it is committed.
+  \sa TDatabaseContext::invalidateQueryCache()
+*/
+void TSqlQueryCache::invalidate(const QString &table, int databaseId)
+{
+    if (!isAvailable()) {
+        return;
+    }
+
+    auto *context = TDatabaseContext::currentDatabaseContext();
+    if (context) {
+        context->invalidateQueryCache(table, databaseId);
+    }
+}
+
+/*!
+  Invalidates all the entries in the \a cache that read the \a table
+  on the database \a databaseId immediately.
+*/
+void TSqlQueryCache::invalidate(TCache *cache, const QString &table, int databaseId)
+{
+    if (!isAvailable()) {
+        return;
+    }
+
+    if (cache) {
+        QByteArray tagKey = QByteArray(TAG_PREFIX) + QByteArray::number(databaseId) + ':' + table.toUtf8();
+        cache->set(tagKey, QByteArray::number((qulonglong)Tf::rand64_r(), 36), TAG_LIFETIME);
+        tSystemDebug("Query cache invalidated: %s", table.toUtf8().data());
+    }
+}
+
+
+QByteArray TSqlQueryCache::tagVersion(const QString &table, int databaseId)
+{
+    TCache *cache = currentCache();
+    if (!cache) {
+        return QByteArray();
+    }
+
+    QByteArray tagKey = QByteArray(TAG_PREFIX) + QByteArray::number(databaseId) + ':' + table.toUtf8();
+    QByteArray version = cache->get(tagKey);
+    if (version.isEmpty()) {
+        // A new version never matches the entries stored before the tag was lost
+        version = QByteArray::number((qulonglong)Tf::rand64_r(), 36);
+        cache->set(tagKey, version, TAG_LIFETIME);
+    }
+    return version;
+}
@@ -0,0 +1,28 @@
+#ifndef TSQLQUERYCACHE_H
+#define TSQLQUERYCACHE_H
+
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariant>
+#include <QList>
+#include <TGlobal>
+
+class TCache;
+
+
+class T_CORE_EXPORT TSqlQueryCache
+{
+public:
+    static bool isAvailable();
+    static QByteArray key(const QString &query, const QVariantList &boundValues, const QStringList &tables, int databaseId);
+    static bool get(const QByteArray &key, QList<QSqlRecord> &records);
+    static bool set(const QByteArray &key, const QList<QSqlRecord> &records, int seconds);
+    static void invalidate(const QString &table, int databaseId = 0);
+    static void invalidate(TCache *cache, const QString &table, int databaseId);
+    static QString normalize(const QString &query);
+
+private:
+    static QByteArray tagVersion(const QString &table, int databaseId);
+};
+
+#endif // TSQLQUERYCACHE_H
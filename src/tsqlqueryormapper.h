@@ -6,6 +6,7 @@
 #include <TSqlQuery>
 #include <TCriteriaConverter>
 #include <TSystemGlobal>
+#include "tsqlquerycache.h"
 
 /*!
   \class TSqlQueryORMapper
@@ -27,13 +28,18 @@ public:
     TSqlQueryORMapper<T> &bind(const QString &placeholder, const QVariant &val);
     TSqlQueryORMapper<T> &bind(int pos, const QVariant &val);
     TSqlQueryORMapper<T> &addBind(const QVariant &val);
+    TSqlQueryORMapper<T> &cache(int seconds, const QStringList &tables);
     bool exec(const QString &query);
     bool exec();
     T execFirst(const QString &query);
     T execFirst();
     int numRowsAffected() const;
     int size() const;
+    bool first();
+    bool last();
     bool next();
+    bool previous();
+    int at() const;
     T value() const;
     QString fieldName(int index) const;
 
@@ -61,12 +67,22 @@ public:
         inline ConstIterator(TSqlQueryORMapper<T> *mapper, int i) : m(mapper), it(i) {}
         friend class TSqlQueryORMapper;
     };
+
+private:
+    bool cachedExec(const QString &query, const QVariantList &values, bool prepared);
+
+    int dbId {0};
+    int cacheLifetime {0};
+    QStringList cacheTables;
+    bool useCachedRecords {false};
+    QList<QSqlRecord> cachedRecords;
+    int cachedPos {-1};
 };
 
 
 template <class T>
 inline TSqlQueryORMapper<T>::TSqlQueryORMapper(int databaseId)
-    : TSqlQuery(databaseId)
+    : TSqlQuery(databaseId), dbId(databaseId)
 { }
 
 
@@ -109,9 +125,29 @@ inline TSqlQueryORMapper<T> &TSqlQueryORMapper<T>::addBind(const QVariant &val)
 }
 
 
+/*!
+  Stores the result of the next SELECT statement in the query cache for
+  \a seconds, tagged with \a tables which the statement reads. A write
+  to the tables through TSqlObject or TSqlORMapper invalidates it.
+  Cache.EnableQueryCache in the application.ini must be true.
+  \sa TSqlQueryCache
+*/
+template <class T>
+inline TSqlQueryORMapper<T> &TSqlQueryORMapper<T>::cache(int seconds, const QStringList &tables)
+{
+    cacheLifetime = seconds;
+    cacheTables = tables;
+    return *this;
+}
+
+
 template <class T>
 inline bool TSqlQueryORMapper<T>::exec(const QString &query)
 {
+    useCachedRecords = false;
+    if (cacheLifetime > 0 && TSqlQueryCache::isAvailable()) {
+        return cachedExec(query, QVariantList(), false);
+    }
     return TSqlQuery::exec(query);
 }
 
@@ -119,10 +155,38 @@ inline bool TSqlQueryORMapper<T>::exec(const QString &query)
 template <class T>
 inline bool TSqlQueryORMapper<T>::exec()
 {
+    useCachedRecords = false;
+    if (cacheLifetime > 0 && TSqlQueryCache::isAvailable()) {
+        return cachedExec(lastQuery(), boundValues().values(), true);
+    }
     return TSqlQuery::exec();
 }
 
 
+template <class T>
+inline bool TSqlQueryORMapper<T>::cachedExec(const QString &query, const QVariantList &values, bool prepared)
+{
+    cachedRecords.clear();
+    cachedPos = -1;
+
+    QByteArray key = TSqlQueryCache::key(query, values, cacheTables, dbId);
+    if (TSqlQueryCache::get(key, cachedRecords)) {
+        useCachedRecords = true;
+        return true;
+    }
+
+    bool ret = (prepared) ? TSqlQuery::exec() : TSqlQuery::exec(query);
+    if (ret && isSelect()) {
+        while (TSqlQuery::next()) {
+            cachedRecords << record();
+        }
+        TSqlQueryCache::set(key, cachedRecords, cacheLifetime);
+        useCachedRecords = true;  // the rows are served from the records read
+    }
+    return ret;
+}
+
+
 template <class T>
 inline T TSqlQueryORMapper<T>::execFirst(const QString &query)
 {
@@ -147,21 +211,78 @@ inline int TSqlQueryORMapper<T>::numRowsAffected() const
 template <class T>
 inline int TSqlQueryORMapper<T>::size() const
 {
-    return TSqlQuery::size();
+    return (useCachedRecords) ? cachedRecords.count() : TSqlQuery::size();
+}
+
+
+template <class T>
+inline bool TSqlQueryORMapper<T>::first()
+{
+    if (useCachedRecords) {
+        cachedPos = 0;
+        return !cachedRecords.isEmpty();
+    }
+    return TSqlQuery::first();
 }
 
 
 template <class T>
 inline bool TSqlQueryORMapper<T>::next()
 {
+    if (useCachedRecords) {
+        cachedPos = qMin(cachedPos + 1, cachedRecords.count());
+        return cachedPos < cachedRecords.count();
+    }
     return TSqlQuery::next();
 }
 
 
+template <class T>
+inline bool TSqlQueryORMapper<T>::last()
+{
+    if (useCachedRecords) {
+        cachedPos = cachedRecords.count() - 1;
+        return !cachedRecords.isEmpty();
+    }
+    return TSqlQuery::last();
+}
+
+
+template <class T>
+inline bool TSqlQueryORMapper<T>::previous()
+{
+    if (useCachedRecords) {
+        cachedPos = qMax(cachedPos - 1, -1);
+        return cachedPos >= 0;
+    }
+    return TSqlQuery::previous();
+}
+
+
+template <class T>
+inline int TSqlQueryORMapper<T>::at() const
+{
+    if (useCachedRecords) {
+        if (cachedPos < 0) {
+            return QSql::BeforeFirstRow;
+        }
+        return (cachedPos < cachedRecords.count()) ? cachedPos : (int)QSql::AfterLastRow;
+    }
+    return TSqlQuery::at();
+}
+
+
 template <class T>
 inline T TSqlQueryORMapper<T>::value() const
 {
     T rec;
+    if (useCachedRecords) {
+        if (cachedPos >= 0 && cachedPos < cachedRecords.count()) {
+            rec.setRecord(cachedRecords.at(cachedPos), QSqlError());
+        }
+        return rec;
+    }
+
     QSqlRecord r = record();
     rec.setRecord(r, lastError());
     return rec;
@@ -0,0 +1,66 @@
+#ifndef TSQLRELATION_H
+#define TSQLRELATION_H
+
+#include <QByteArray>
+#include <QList>
+#include <TGlobal>
+
+/*!
+  \class TSqlRelation
+  \brief The TSqlRelation class represents an association to the
+  records of other table, which is loaded eagerly by
+  TSqlORMapper::with().
+
+  For TSql::BelongsTo, \a column is the foreign key of this table and
+  \a foreignColumn is the key of the related table, usually its primary
+  key. For TSql::HasMany, \a column is the key of this table, usually
+  its primary key, and \a foreignColumn is the foreign key of the
+  related table.
+  \sa TSqlORMapper::with(), TSqlObject::relatedObjects()
+*/
+
+
+template <class T>
+class TSqlRelation
+{
+public:
+    TSqlRelation(const QByteArray &name, TSql::RelationType type, int column, int foreignColumn);
+
+    QByteArray name() const { return _name; }
+    TSql::RelationType type() const { return _type; }
+    int column() const { return _column; }
+    int foreignColumn() const { return _foreignColumn; }
+
+private:
+    QByteArray _name;
+    TSql::RelationType _type;
+    int _column;
+    int _foreignColumn;
+};
+
+
+template <class T>
+inline TSqlRelation<T>::TSqlRelation(const QByteArray &name, TSql::RelationType type, int column, int foreignColumn)
+    : _name(name), _type(type), _column(column), _foreignColumn(foreignColumn)
+{ }
+
+
+/*!
+  Internal use only.
+*/
+class TSqlRelatedObjectsHolder
+{
+public:
+    virtual ~TSqlRelatedObjectsHolder() { }
+};
+
+
+template <class T>
+class TSqlRelatedObjects : public TSqlRelatedObjectsHolder
+{
+public:
+    TSqlRelatedObjects(const QList<T> &objects) : list(objects) { }
+    QList<T> list;
+};
+
+#endif // TSQLRELATION_H
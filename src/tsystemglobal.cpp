@@ -8,6 +8,8 @@
 #include "tsystemglobal.h"
 #include "taccesslogstream.h"
 #include "tfileaiowriter.h"
+#include "tloglayout.h"
+#include "tlogsampler.h"
 #include <TWebApplication>
 #include <TAppSettings>
 #include <TLogger>
@@ -29,26 +31,61 @@ constexpr auto DEFAULT_ACCESSLOG_DATETIME_FORMAT = "yyyy-MM-ddThh:mm:ss";
 namespace {
     TAccessLogStream *accesslogstrm = nullptr;
     TAccessLogStream *sqllogstrm = nullptr;
+    TAccessLogStream *slowsqllogstrm = nullptr;
     TFileAioWriter systemLog;
-    QByteArray syslogLayout = DEFAULT_SYSTEMLOG_LAYOUT;
-    QByteArray syslogDateTimeFormat = DEFAULT_SYSTEMLOG_DATETIME_FORMAT;
-    QByteArray accessLogLayout = DEFAULT_ACCESSLOG_LAYOUT;
-    QByteArray accessLogDateTimeFormat;
+    TLogLayout syslogLayout(DEFAULT_SYSTEMLOG_LAYOUT, DEFAULT_SYSTEMLOG_DATETIME_FORMAT);
+    TLogLayout accessLogLayout(DEFAULT_ACCESSLOG_LAYOUT, QByteArray(), TLogLayout::AccessLog);
+    bool binaryAccessLog = false;
+    TLogSampler accessLogSampler;
+    TLogSampler queryLogSampler;
 
 
     void tSystemMessage(int priority, const char *msg, va_list ap)
     {
         TLog log(priority, QString().vsprintf(msg, ap).toLocal8Bit());
-        QByteArray buf = TLogger::logToByteArray(log, syslogLayout, syslogDateTimeFormat);
+        QByteArray buf = syslogLayout.format(log);
         systemLog.write(buf.data(), buf.length());
     }
+
+    // Returns true if a query log is to be written; call it before
+    // formatting the log
+    bool sampleQueryLog()
+    {
+        quint64 suppressed;
+        if (!queryLogSampler.sample(&suppressed)) {
+            return false;
+        }
+        if (suppressed > 0) {
+            sqllogstrm->writeLog(syslogLayout.format(TLog(-1, TLogSampler::suppressedMessage(suppressed))));
+        }
+        return true;
+    }
+
+
+    void writeQueryLogMessage(const QByteArray &msg)
+    {
+        TLog log(-1, msg);
+        sqllogstrm->writeLog(syslogLayout.format(log));
+    }
 }
 
 
 void Tf::writeAccessLog(const TAccessLog &log)
 {
     if (accesslogstrm) {
-        accesslogstrm->writeLog(log.toByteArray(accessLogLayout, accessLogDateTimeFormat));
+        quint64 suppressed;
+        if (!accessLogSampler.sample(&suppressed)) {
+            return;
+        }
+        if (suppressed > 0) {
+            tSystemInfo("Access log %s", TLogSampler::suppressedMessage(suppressed).data());
+        }
+
+        if (binaryAccessLog) {
+            accesslogstrm->writeLog(log);
+        } else {
+            accesslogstrm->writeLog(accessLogLayout.format(log));
+        }
     }
 }
 
@@ -61,12 +98,33 @@ void Tf::setupSystemLogger()
         logdir.mkpath(".");
     }
 
+    // Options of log files
+    TFileAioWriter::Options options;
+    options.maxBufferSize = Tf::appSettings()->value(Tf::LogFileMaxBufferSize, options.maxBufferSize).toInt();
+    options.syncInterval = Tf::appSettings()->value(Tf::LogFileSyncInterval, options.syncInterval).toInt();
+    options.rotationSize = Tf::appSettings()->value(Tf::LogFileRotationSize, 0).toLongLong();
+
+    QString policy = Tf::appSettings()->value(Tf::LogFileSyncPolicy).toString().toLower();
+    if (policy == QLatin1String("interval")) {
+        options.syncPolicy = TFileAioWriter::SyncInterval;
+    } else if (policy == QLatin1String("always")) {
+        options.syncPolicy = TFileAioWriter::SyncAlways;
+    }
+
+    QString period = Tf::appSettings()->value(Tf::LogFileRotationPeriod).toString().toLower();
+    if (period == QLatin1String("hourly")) {
+        options.rotationPeriod = TFileAioWriter::Hourly;
+    } else if (period == QLatin1String("daily")) {
+        options.rotationPeriod = TFileAioWriter::Daily;
+    }
+    TFileAioWriter::setDefaultOptions(options);
+
     // system log
     systemLog.setFileName(Tf::app()->systemLogFilePath());
     systemLog.open();
 
-    syslogLayout = Tf::appSettings()->value(Tf::SystemLogLayout, DEFAULT_SYSTEMLOG_LAYOUT).toByteArray();
-    syslogDateTimeFormat = Tf::appSettings()->value(Tf::SystemLogDateTimeFormat, DEFAULT_SYSTEMLOG_DATETIME_FORMAT).toByteArray();
+    syslogLayout.compile(Tf::appSettings()->value(Tf::SystemLogLayout, DEFAULT_SYSTEMLOG_LAYOUT).toByteArray(),
+                         Tf::appSettings()->value(Tf::SystemLogDateTimeFormat, DEFAULT_SYSTEMLOG_DATETIME_FORMAT).toByteArray());
 }
 
 
@@ -84,8 +142,10 @@ void Tf::setupAccessLogger()
         accesslogstrm = new TAccessLogStream(accesslogpath);
     }
 
-    accessLogLayout = Tf::appSettings()->value(Tf::AccessLogLayout, DEFAULT_ACCESSLOG_LAYOUT).toByteArray();
-    accessLogDateTimeFormat = Tf::appSettings()->value(Tf::AccessLogDateTimeFormat, DEFAULT_ACCESSLOG_DATETIME_FORMAT).toByteArray();
+    accessLogLayout.compile(Tf::appSettings()->value(Tf::AccessLogLayout, DEFAULT_ACCESSLOG_LAYOUT).toByteArray(),
+                            Tf::appSettings()->value(Tf::AccessLogDateTimeFormat, DEFAULT_ACCESSLOG_DATETIME_FORMAT).toByteArray());
+    binaryAccessLog = (Tf::appSettings()->value(Tf::AccessLogFormat).toString().toLower() == QLatin1String("binary"));
+    accessLogSampler.loadSettings(Tf::app()->loggerSettings(), QLatin1String("AccessLog"));
 }
 
 
@@ -103,6 +163,21 @@ void Tf::setupQueryLogger()
     if (!sqllogstrm && !querylogpath.isEmpty()) {
         sqllogstrm = new TAccessLogStream(querylogpath);
     }
+
+    // sql slow query log
+    QString slowlogpath = Tf::app()->sqlQuerySlowLogFilePath();
+    if (!slowsqllogstrm && !slowlogpath.isEmpty()) {
+        slowsqllogstrm = new TAccessLogStream(slowlogpath);
+    }
+
+    queryLogSampler.loadSettings(Tf::app()->loggerSettings(), QLatin1String("QueryLog"));
+}
+
+
+void Tf::loadLogSamplingSettings(const QVariantMap &settings)
+{
+    accessLogSampler.loadSettings(settings, QLatin1String("AccessLog"));
+    queryLogSampler.loadSettings(settings, QLatin1String("QueryLog"));
 }
 
 
@@ -110,6 +185,8 @@ void Tf::releaseQueryLogger()
 {
     delete sqllogstrm;
     sqllogstrm = nullptr;
+    delete slowsqllogstrm;
+    slowsqllogstrm = nullptr;
 }
 
 
@@ -168,29 +245,50 @@ void tSystemTrace(const char *, ...) { }
 
 void Tf::traceQueryLog(const char *msg, ...)
 {
-    if (sqllogstrm) {
+    if (sqllogstrm && sampleQueryLog()) {
+        va_list ap;
+        va_start(ap, msg);
+        writeQueryLogMessage(QString().vsprintf(msg, ap).toLocal8Bit());
+        va_end(ap);
+    }
+}
+
+
+void Tf::traceSlowQueryLog(const char *msg, ...)
+{
+    if (slowsqllogstrm) {
         va_list ap;
         va_start(ap, msg);
         TLog log(-1, QString().vsprintf(msg, ap).toLocal8Bit());
-        QByteArray buf = TLogger::logToByteArray(log, syslogLayout, syslogDateTimeFormat);
-        sqllogstrm->writeLog(buf);
+        QByteArray buf = syslogLayout.format(log);
+        slowsqllogstrm->writeLog(buf);
         va_end(ap);
     }
 }
 
 
+/*!
+  Writes the query log of the \a query. Failed queries are always
+  written; the others are sampled by the QueryLog settings.
+*/
 void Tf::writeQueryLog(const QString &query, bool success, const QSqlError &error)
 {
-    QString q = query;
+    if (!sqllogstrm) {
+        return;
+    }
 
-    if (!success) {
-        QString err = (!error.databaseText().isEmpty()) ? error.databaseText() : error.text().trimmed();
-        if (!err.isEmpty()) {
-            err = QLatin1Char('[') + err + QLatin1String("] ");
+    if (success) {
+        if (sampleQueryLog()) {
+            writeQueryLogMessage(query.toLocal8Bit());
         }
-        q = QLatin1String("(Query failed) ") + err + query;
+        return;
+    }
+
+    QString err = (!error.databaseText().isEmpty()) ? error.databaseText() : error.text().trimmed();
+    if (!err.isEmpty()) {
+        err = QLatin1Char('[') + err + QLatin1String("] ");
     }
-    Tf::traceQueryLog("%s", qPrintable(q));
+    writeQueryLogMessage((QLatin1String("(Query failed) ") + err + query).toLocal8Bit());
 }
 
 
@@ -19,6 +19,7 @@ namespace Tf
     T_CORE_EXPORT void releaseAccessLogger(); // internal use
     T_CORE_EXPORT void setupQueryLogger();    // internal use
     T_CORE_EXPORT void releaseQueryLogger();  // internal use
+    T_CORE_EXPORT void loadLogSamplingSettings(const QVariantMap &settings);  // internal use
     T_CORE_EXPORT void writeAccessLog(const TAccessLog &log);  // write access log
     T_CORE_EXPORT void writeQueryLog(const QString &query, bool success, const QSqlError &error);
     T_CORE_EXPORT void traceQueryLog(const char *, ...) // SQL query log
@@ -26,6 +27,11 @@ namespace Tf
         __attribute__ ((format (printf, 1, 2)))
 #endif
     ;
+    T_CORE_EXPORT void traceSlowQueryLog(const char *, ...) // SQL slow query log
+#if defined(Q_CC_GNU) && !defined(__INSURE__)
+        __attribute__ ((format (printf, 1, 2)))
+#endif
+    ;
 
     enum SystemOpCode {
         InvalidOpCode           = 0x00,
@@ -33,7 +39,8 @@ namespace Tf
         WebSocketSendBinary     = 0x02,
         WebSocketPublishText    = 0x03,
         WebSocketPublishBinary  = 0x04,
-        MaxOpCode               = 0x04,
+        CacheInvalidate         = 0x05,
+        MaxOpCode               = 0x05,
     };
 
     T_CORE_EXPORT QMap<QString, QVariant> settingsToMap(QSettings &settings, const QString &env = QString());
@@ -0,0 +1,140 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "ttracecontext.h"
+
+namespace {
+
+thread_local TTraceContext currentTraceContext;
+
+
+// Random hex digits, not all zero
+QByteArray randomId(int bytes)
+{
+    QByteArray id(bytes, '\0');
+    do {
+        for (int i = 0; i < bytes; i += 8) {
+            quint64 r = Tf::rand64_r();
+            for (int j = i; j < qMin(i + 8, bytes); ++j) {
+                id[j] = (char)(r >> ((j - i) * 8));
+            }
+        }
+    } while (id.count('\0') == bytes);
+    return id.toHex();
+}
+
+
+bool isLowerHex(const QByteArray &str)
+{
+    for (char c : str) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return !str.isEmpty();
+}
+
+
+bool isZero(const QByteArray &str)
+{
+    return str.count('0') == str.length();
+}
+
+}  // namespace
+
+/*!
+  \class TTraceContext
+  \brief The TTraceContext class holds the trace context of a request,
+  as specified in W3C Trace Context.
+
+  The IDs are written in the application logs, the access log and the
+  SQL query log, so that the lines for the same request can be
+  correlated across the log files.
+*/
+
+/*!
+  Returns the value of the traceparent header for this context, which
+  propagates it to downstream services.
+*/
+QByteArray TTraceContext::toTraceParent() const
+{
+    if (!isValid()) {
+        return QByteArray();
+    }
+
+    QByteArray str;
+    str.reserve(55);
+    str += "00-";
+    str += _traceId;
+    str += '-';
+    str += _spanId;
+    str += '-';
+    str += QByteArray::number(_flags, 16).rightJustified(2, '0');
+    return str;
+}
+
+/*!
+  Returns a context of a new trace.
+*/
+TTraceContext TTraceContext::generate()
+{
+    TTraceContext context;
+    context._traceId = randomId(16);
+    context._spanId = randomId(8);
+    context._flags = 0x01;  // sampled
+    return context;
+}
+
+/*!
+  Returns a child context of the value of a traceparent header
+  \a traceParent; the trace ID and the flags are inherited and a new span
+  ID is generated. A new trace is generated if the value is invalid.
+*/
+TTraceContext TTraceContext::fromTraceParent(const QByteArray &traceParent)
+{
+    // version-traceid-parentid-flags
+    const QList<QByteArray> fields = traceParent.trimmed().split('-');
+    if (fields.count() < 4 || fields[0].length() != 2 || !isLowerHex(fields[0]) || fields[0] == "ff"
+        || fields[1].length() != 32 || !isLowerHex(fields[1]) || isZero(fields[1])
+        || fields[2].length() != 16 || !isLowerHex(fields[2]) || isZero(fields[2])
+        || fields[3].length() != 2 || !isLowerHex(fields[3])
+        || (fields[0] == "00" && fields.count() != 4)) {
+        return generate();
+    }
+
+    TTraceContext context;
+    context._traceId = fields[1];
+    context._parentId = fields[2];
+    context._spanId = randomId(8);
+    context._flags = fields[3].toUInt(nullptr, 16);
+    return context;
+}
+
+/*!
+  Returns the context of the request processed in the current thread;
+  an invalid context is returned outside requests.
+*/
+const TTraceContext &TTraceContext::current()
+{
+    return currentTraceContext;
+}
+
+/*!
+  Sets the context of the current thread to \a context.
+*/
+void TTraceContext::setCurrent(const TTraceContext &context)
+{
+    currentTraceContext = context;
+}
+
+/*!
+  Clears the context of the current thread.
+*/
+void TTraceContext::clearCurrent()
+{
+    currentTraceContext = TTraceContext();
+}
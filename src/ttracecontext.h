@@ -0,0 +1,33 @@
+#ifndef TTRACECONTEXT_H
+#define TTRACECONTEXT_H
+
+#include <QByteArray>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TTraceContext
+{
+public:
+    TTraceContext() { }
+
+    bool isValid() const { return !_traceId.isEmpty(); }
+    const QByteArray &traceId() const { return _traceId; }
+    const QByteArray &spanId() const { return _spanId; }
+    const QByteArray &parentId() const { return _parentId; }
+    bool isSampled() const { return _flags & 0x01; }
+    QByteArray toTraceParent() const;
+
+    static TTraceContext generate();
+    static TTraceContext fromTraceParent(const QByteArray &traceParent);
+    static const TTraceContext &current();
+    static void setCurrent(const TTraceContext &context);
+    static void clearCurrent();
+
+private:
+    QByteArray _traceId;   // 32 hex digits
+    QByteArray _spanId;    // 16 hex digits
+    QByteArray _parentId;  // 16 hex digits
+    quint8 _flags {0};
+};
+
+#endif // TTRACECONTEXT_H
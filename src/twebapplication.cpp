@@ -8,6 +8,7 @@
 #include <TWebApplication>
 #include <TSystemGlobal>
 #include <TAppSettings>
+#include <TDebug>
 #include "tdatabasecontextmainthread.h"
 #include "tcachefactory.h"
 #include <QDir>
@@ -16,6 +17,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <cstdlib>
+#include <csignal>
 #include <thread>  // for hardware_concurrency()
 
 constexpr auto DEFAULT_INTERNET_MEDIA_TYPE  = "text/plain";
@@ -166,6 +168,7 @@ TWebApplication::TWebApplication(int &argc, char **argv)
             } else if (TCacheFactory::dbType(backend) == TCacheStore::KVS) {
                 _kvsSettings[(int)Tf::KvsEngine::CacheKvs] = settings;
             }
+            _cacheSettings = settings;
         }
     }
 }
@@ -465,10 +468,31 @@ QString TWebApplication::sqlQueryLogFilePath() const
     return path;
 }
 
+/*!
+  Returns the absolute file path of the SQL slow query log, which is set
+  by the setting \a SqlQuerySlowLogFile in the application.ini.
+*/
+QString TWebApplication::sqlQuerySlowLogFilePath() const
+{
+    QString path = Tf::appSettings()->value(Tf::SqlQuerySlowLogFile).toString();
+    if (!path.isEmpty()) {
+        QFileInfo fi(path);
+        path = (fi.isAbsolute()) ? fi.absoluteFilePath() : webRootPath() + fi.filePath();
+    }
+    return path;
+}
+
 
 void TWebApplication::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == _timer.timerId()) {
+#if defined(Q_OS_UNIX)
+        if (takeReloadRequest()) {
+            // Reloads the logger settings, not exiting
+            Tf::reloadLoggerSettings();
+        }
+#endif
+
         if (signalNumber() >= 0) {
             tSystemDebug("TWebApplication trapped signal  number:%d", signalNumber());
             //timer.stop();   /* Don't stop this timer */
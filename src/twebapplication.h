@@ -55,6 +55,7 @@ public:
     bool cacheEnabled() const;
     QString cacheBackend() const;
     int databaseIdForCache() const;
+    const QVariantMap &cacheSettings() const { return _cacheSettings; }
     const QVariantMap &loggerSettings() const { return _loggerSetting; }
     const QVariantMap &validationSettings() const { return _validationSetting; }
     QString validationErrorMessage(int rule) const;
@@ -66,6 +67,7 @@ public:
     QString systemLogFilePath() const;
     QString accessLogFilePath() const;
     QString sqlQueryLogFilePath() const;
+    QString sqlQuerySlowLogFilePath() const;
     QTextCodec *codecForInternal() const { return _codecInternal; }
     QTextCodec *codecForHttpOutput() const { return _codecHttp; }
     int applicationServerId() const { return _appServerId; }
@@ -91,6 +93,7 @@ private slots:
 protected:
     void timerEvent(QTimerEvent *event);
     static int signalNumber();
+    static bool takeReloadRequest();
 
 private:
     QString _webRootAbsolutePath;
@@ -107,6 +110,7 @@ private:
     mutable MultiProcessingModule _mpm  {Invalid};
     QMap<QString, QVariantMap> _configMap;
     int _cacheSqlDbIndex {-1};
+    QVariantMap _cacheSettings;
 
     static void resetSignalNumber();
 
@@ -12,11 +12,18 @@
 
 namespace {
     volatile sig_atomic_t unixSignal = -1;
+    volatile sig_atomic_t reloadRequested = 0;
 
     void signalHandler(int signum)
     {
         unixSignal = signum;
     }
+
+    // SIGUSR1 does not overwrite a pending signal to stop
+    void reloadSignalHandler(int)
+    {
+        reloadRequested = 1;
+    }
 }
 
 
@@ -27,7 +34,7 @@ void TWebApplication::watchUnixSignal(int sig, bool watch)
         memset(&sa, 0, sizeof(sa));
         sa.sa_flags = SA_RESTART;
         if (watch) {
-            sa.sa_handler = signalHandler;
+            sa.sa_handler = (sig == SIGUSR1) ? reloadSignalHandler : signalHandler;
             _timer.start(500, this);
         } else {
             sa.sa_handler = SIG_DFL;
@@ -64,3 +71,15 @@ void TWebApplication::resetSignalNumber()
 {
     ::unixSignal = -1;
 }
+
+/*!
+  Returns true if SIGUSR1 has been received since the last call.
+*/
+bool TWebApplication::takeReloadRequest()
+{
+    if (!::reloadRequested) {
+        return false;
+    }
+    ::reloadRequested = 0;
+    return true;
+}
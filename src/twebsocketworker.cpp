@@ -78,6 +78,9 @@ void TWebSocketWorker::execute(int opcode, const QByteArray &payload)
         return;
     }
 
+    sqlProfile.clear();
+    sqlProfile.setLabel(es.toLatin1());
+
     try {
         tSystemDebug("Found endpoint: %s", qPrintable(es));
         tSystemDebug("TWebSocketWorker opcode: %d", opcode);
@@ -331,4 +334,5 @@ void TWebSocketWorker::execute(int opcode, const QByteArray &payload)
         tError("Caught Exception: %s", e.what());
         tSystemError("Caught Exception: %s", e.what());
     }
+    sqlProfile.writeSummary();
 }
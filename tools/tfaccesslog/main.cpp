@@ -0,0 +1,369 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <QtCore>
+#include <TAccessLog>
+#include <TAccessLogDecoder>
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+
+constexpr auto DEFAULT_LAYOUT = "%h %d \"%r\" %s %O%n";
+constexpr auto DEFAULT_DATETIME_FORMAT = "yyyy-MM-dd hh:mm:ss";
+
+namespace {
+
+enum Format {
+    Text,
+    Json,
+    Csv,
+};
+
+
+struct Filter {
+    int statusMin {0};
+    int statusMax {INT_MAX};
+    QByteArray host;
+    QByteArray pathPrefix;
+    QDateTime since;
+    QDateTime until;
+
+    bool match(const TAccessLog &log, const QByteArray &path) const
+    {
+        return log.statusCode >= statusMin && log.statusCode <= statusMax
+            && (host.isEmpty() || log.remoteHost == host)
+            && (pathPrefix.isEmpty() || path.startsWith(pathPrefix))
+            && (!since.isValid() || log.timestamp >= since)
+            && (!until.isValid() || log.timestamp < until);
+    }
+};
+
+
+struct Statistics {
+    qint64 count {0};
+    qint64 bytes {0};
+    qint64 queryTime {0};  // microseconds
+};
+
+
+void write(const QByteArray &data)
+{
+    std::fwrite(data.constData(), 1, data.length(), stdout);
+}
+
+
+void error(const QString &message)
+{
+    std::fprintf(stderr, "%s\n", qPrintable(message));
+}
+
+
+QByteArray csvField(const QByteArray &field)
+{
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        QByteArray quoted = field;
+        quoted.replace('"', "\"\"");
+        return '"' + quoted + '"';
+    }
+    return field;
+}
+
+
+QByteArray queryTimeText(qint64 usecs)
+{
+    return QByteArray::number(usecs / 1000.0, 'f', 3);
+}
+
+
+// Method, target and protocol of the request line
+QList<QByteArray> splitRequest(const QByteArray &request)
+{
+    int first = request.indexOf(' ');
+    int last = request.lastIndexOf(' ');
+
+    if (first < 0) {
+        return QList<QByteArray>() << QByteArray() << request << QByteArray();
+    } else if (first == last) {
+        return QList<QByteArray>() << request.left(first) << request.mid(first + 1) << QByteArray();
+    }
+    return QList<QByteArray>() << request.left(first) << request.mid(first + 1, last - first - 1) << request.mid(last + 1);
+}
+
+
+QByteArray toJson(const TAccessLog &log)
+{
+    const QList<QByteArray> req = splitRequest(log.request);
+    QJsonObject obj;
+    obj.insert("timestamp", log.timestamp.toString(Qt::ISODate));
+    obj.insert("remote_host", QString::fromLatin1(log.remoteHost));
+    obj.insert("method", QString::fromLatin1(req[0]));
+    obj.insert("target", QString::fromUtf8(req[1]));
+    obj.insert("protocol", QString::fromLatin1(req[2]));
+    obj.insert("status", log.statusCode);
+    obj.insert("bytes", log.responseBytes);
+    obj.insert("query_count", log.queryCount);
+    obj.insert("query_time_ms", log.queryTime / 1000.0);
+    if (!log.traceId.isEmpty()) {
+        obj.insert("trace_id", QString::fromLatin1(log.traceId));
+        obj.insert("span_id", QString::fromLatin1(log.spanId));
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+
+QByteArray toCsv(const TAccessLog &log)
+{
+    const QList<QByteArray> req = splitRequest(log.request);
+    QByteArray line;
+    line += log.timestamp.toString(Qt::ISODate).toLatin1();
+    line += ',';
+    line += csvField(log.remoteHost);
+    for (auto &s : req) {
+        line += ',';
+        line += csvField(s);
+    }
+    line += ',';
+    line += QByteArray::number(log.statusCode);
+    line += ',';
+    line += QByteArray::number(log.responseBytes);
+    line += ',';
+    line += QByteArray::number(log.queryCount);
+    line += ',';
+    line += queryTimeText(log.queryTime);
+    line += ',';
+    line += log.traceId;
+    line += ',';
+    line += log.spanId;
+    line += '\n';
+    return line;
+}
+
+
+QByteArray aggregationKey(const QString &key, const TAccessLog &log, const QList<QByteArray> &req)
+{
+    if (key == "status") {
+        return QByteArray::number(log.statusCode);
+    } else if (key == "host") {
+        return log.remoteHost;
+    } else if (key == "path") {
+        int idx = req[1].indexOf('?');
+        return (idx < 0) ? req[1] : req[1].left(idx);
+    } else if (key == "method") {
+        return req[0];
+    } else if (key == "minute") {
+        return log.timestamp.toString("yyyy-MM-ddThh:mm").toLatin1();
+    } else if (key == "hour") {
+        return log.timestamp.toString("yyyy-MM-ddThh").toLatin1();
+    } else if (key == "day") {
+        return log.timestamp.toString("yyyy-MM-dd").toLatin1();
+    }
+    return QByteArray();
+}
+
+
+void printStatistics(const QString &key, const QHash<QByteArray, Statistics> &stats, Format format)
+{
+    QList<QByteArray> keys = stats.keys();
+    if (key == "minute" || key == "hour" || key == "day") {
+        std::sort(keys.begin(), keys.end());
+    } else {
+        std::sort(keys.begin(), keys.end(), [&](const QByteArray &a, const QByteArray &b) {
+            qint64 ca = stats.value(a).count;
+            qint64 cb = stats.value(b).count;
+            return (ca != cb) ? ca > cb : a < b;
+        });
+    }
+
+    if (format == Csv) {
+        write(key.toLatin1() + ",count,bytes,avg_query_time_ms\n");
+    } else if (format == Text) {
+        write(QString("%1 %2 %3 %4\n").arg("count", 10).arg("bytes", 14).arg("avg_query_ms", 12).arg(key).toLatin1());
+    }
+
+    for (auto &k : keys) {
+        const Statistics &st = stats[k];
+        QByteArray avg = queryTimeText((st.count > 0) ? st.queryTime / st.count : 0);
+
+        switch (format) {
+        case Json: {
+            QJsonObject obj;
+            obj.insert(key, QString::fromUtf8(k));
+            obj.insert("count", (double)st.count);
+            obj.insert("bytes", (double)st.bytes);
+            obj.insert("avg_query_time_ms", avg.toDouble());
+            write(QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n');
+            break;
+        }
+        case Csv:
+            write(csvField(k) + ',' + QByteArray::number(st.count) + ',' + QByteArray::number(st.bytes) + ',' + avg + '\n');
+            break;
+        default:
+            write(QString("%1 %2 %3 %4\n").arg(st.count, 10).arg(st.bytes, 14).arg(QString(avg), 12).arg(QString::fromUtf8(k)).toUtf8());
+            break;
+        }
+    }
+}
+
+
+bool parseStatus(const QString &str, Filter &filter)
+{
+    QString s = str.toLower();
+    bool ok;
+
+    if (s.length() == 3 && s.endsWith("xx")) {
+        int c = s.left(1).toInt(&ok);
+        filter.statusMin = c * 100;
+        filter.statusMax = c * 100 + 99;
+        return ok;
+    }
+    filter.statusMin = filter.statusMax = s.toInt(&ok);
+    return ok;
+}
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationVersion(TF_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts binary access logs of TreeFrog to text, JSON or CSV.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {{"f", "format"}, "Output format: text, json or csv. [text]", "format", "text"},
+        {{"l", "layout"}, "Layout of the text output.", "layout", DEFAULT_LAYOUT},
+        {{"t", "datetime-format"}, "Date-time format of the text output.", "format", DEFAULT_DATETIME_FORMAT},
+        {{"s", "status"}, "Filters by the status code, or its class such as 5xx.", "status"},
+        {"host", "Filters by the remote host.", "host"},
+        {{"p", "path"}, "Filters by the prefix of the request target.", "prefix"},
+        {"since", "Filters the logs at or after the date-time (ISO 8601).", "datetime"},
+        {"until", "Filters the logs before the date-time (ISO 8601).", "datetime"},
+        {{"a", "aggregate"}, "Aggregates by status, host, path, method, minute, hour or day.", "key"},
+    });
+    parser.addPositionalArgument("files", "Binary access log files; '-' for the standard input.", "file...");
+    parser.process(app);
+
+    Format format;
+    QString fmt = parser.value("format").toLower();
+    if (fmt == "text") {
+        format = Text;
+    } else if (fmt == "json") {
+        format = Json;
+    } else if (fmt == "csv") {
+        format = Csv;
+    } else {
+        error(QString("invalid format: %1").arg(fmt));
+        return 1;
+    }
+
+    Filter filter;
+    if (parser.isSet("status") && !parseStatus(parser.value("status"), filter)) {
+        error(QString("invalid status: %1").arg(parser.value("status")));
+        return 1;
+    }
+    filter.host = parser.value("host").toLatin1();
+    filter.pathPrefix = parser.value("path").toUtf8();
+
+    for (auto name : {"since", "until"}) {
+        if (parser.isSet(name)) {
+            QDateTime dt = QDateTime::fromString(parser.value(name), Qt::ISODate);
+            if (!dt.isValid()) {
+                error(QString("invalid date-time: %1").arg(parser.value(name)));
+                return 1;
+            }
+            (qstrcmp(name, "since") == 0 ? filter.since : filter.until) = dt;
+        }
+    }
+
+    const QString aggregate = parser.value("aggregate").toLower();
+    if (!aggregate.isEmpty() && !QStringList({"status", "host", "path", "method", "minute", "hour", "day"}).contains(aggregate)) {
+        error(QString("invalid aggregation key: %1").arg(aggregate));
+        return 1;
+    }
+
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    const QByteArray layout = parser.value("layout").toUtf8();
+    const QByteArray dateTimeFormat = parser.value("datetime-format").toUtf8();
+    QHash<QByteArray, Statistics> stats;
+    int ret = 0;
+
+    if (aggregate.isEmpty() && format == Csv) {
+        write("timestamp,remote_host,method,target,protocol,status,bytes,query_count,query_time_ms,trace_id,span_id\n");
+    }
+
+    for (auto &fileName : files) {
+        QFile file;
+        QByteArray data;
+
+        if (fileName == "-") {
+            file.open(stdin, QIODevice::ReadOnly);
+            data = file.readAll();
+        } else {
+            file.setFileName(fileName);
+            if (!file.open(QIODevice::ReadOnly)) {
+                error(QString("cannot open file: %1").arg(fileName));
+                ret = 1;
+                continue;
+            }
+            uchar *map = (file.size() > 0) ? file.map(0, file.size()) : nullptr;
+            data = (map) ? QByteArray::fromRawData((const char *)map, file.size()) : file.readAll();
+        }
+
+        if (!TAccessLogDecoder::isBinary(data)) {
+            error(QString("not a binary access log: %1").arg(fileName));
+            ret = 1;
+            continue;
+        }
+
+        bool ok;
+        const QList<TAccessLog> logs = TAccessLogDecoder::decode(data, &ok);
+        if (!ok) {
+            error(QString("broken frame found: %1").arg(fileName));
+            ret = 1;
+        }
+
+        for (auto &log : logs) {
+            const QList<QByteArray> req = splitRequest(log.request);
+            if (!filter.match(log, req[1])) {
+                continue;
+            }
+
+            if (!aggregate.isEmpty()) {
+                Statistics &st = stats[aggregationKey(aggregate, log, req)];
+                st.count++;
+                st.bytes += log.responseBytes;
+                st.queryTime += log.queryTime;
+                continue;
+            }
+
+            switch (format) {
+            case Json:
+                write(toJson(log));
+                break;
+            case Csv:
+                write(toCsv(log));
+                break;
+            default:
+                write(log.toByteArray(layout, dateTimeFormat));
+                break;
+            }
+        }
+    }
+
+    if (!aggregate.isEmpty()) {
+        printStatistics(aggregate, stats, format);
+    }
+    std::fflush(stdout);
+    return ret;
+}
@@ -18,6 +18,7 @@
 
 #ifdef Q_OS_UNIX
 # include <sys/utsname.h>
+# include <csignal>
 #endif
 #ifdef Q_OS_WIN
 # include <windows.h>
@@ -118,7 +119,7 @@ static void usage()
 {
     constexpr auto text =
         "Usage: %1 [-d] [-p port] [-e environment] [-r] [application-directory]\n" \
-        "Usage: %1 [-k stop|abort|restart|status] [application-directory]\n" \
+        "Usage: %1 [-k stop|abort|restart|reload-log|status] [application-directory]\n" \
         "%2"                                                            \
         "Options:\n"                                                    \
         "  -d              : run as a daemon process\n"                 \
@@ -394,6 +395,15 @@ static int killTreeFrogProcess(const QString &cmd)
         pi.restart();
         printf("Sent a restart request\n");
 
+#if defined(Q_OS_UNIX)
+    } else if (cmd == "reload-log") {  // reload-log command
+        const QList<qint64> pids = pi.childProcessIds();
+        for (auto cpid : pids) {
+            ::kill(cpid, SIGUSR1);  // the servers reload the logger settings
+        }
+        printf("Sent a request to reload the logger settings\n");
+#endif
+
     } else {
         usage();
         return 1;
@@ -13,6 +13,7 @@
 #include <TThreadApplicationServer>
 #include <TMultiplexingServer>
 #include <TJSLoader>
+#include <TCache>
 #include <TSystemGlobal>
 #include <cstdlib>
 #include "thazardptrmanager.h"
@@ -96,6 +97,7 @@ int main(int argc, char *argv[])
 
 #if defined(Q_OS_UNIX)
     webapp.watchUnixSignal(SIGTERM);
+    webapp.watchUnixSignal(SIGUSR1);  // reloads the logger settings
     if (!debug) {
         webapp.ignoreUnixSignal(SIGINT);
     }
@@ -194,6 +196,9 @@ int main(int argc, char *argv[])
         goto finish;
     }
 
+    // Receives the invalidations of the near cache in main thread
+    TCache::nearCacheEnabled();
+
     QObject::connect(&webapp, &QCoreApplication::aboutToQuit, [=](){ server->stop(); });
     ret = webapp.exec();
 
@@ -1,2 +1,2 @@
 TEMPLATE=subdirs
-SUBDIRS=tfmanager tfserver tmake tspawn
+SUBDIRS=tfmanager tfserver tmake tspawn tfaccesslog
@@ -25,6 +25,10 @@ constexpr auto SQLOBJECT_PROPERTY_TEMPLATE =         \
     "    Q_PROPERTY(%1 %2 READ get%2 WRITE set%2)\n" \
     "    T_DEFINE_PROPERTY(%1, %2)\n";
 
+constexpr auto SQLOBJECT_RELATION_TEMPLATE =                            \
+    "    template <class C = %1Object>\n"                                  \
+    "    static TSqlRelation<C> %2Relation() { return TSqlRelation<C>(\"%2\", %3, %4, C::%5); }\n";
+
 constexpr auto SQLOBJECT_FOOTER_TEMPLATE = \
     "};\n"                         \
     "\n"                           \
@@ -54,6 +58,22 @@ static bool isNumericType(const QString &typeName)
 }
 
 
+// Returns the singular form of the table name, roughly
+static QString singularize(const QString &name)
+{
+    QString str = name.toLower();
+    if (str.endsWith("ies")) {
+        str.chop(3);
+        str += QLatin1Char('y');
+    } else if (str.endsWith("ses") || str.endsWith("xes") || str.endsWith("ches") || str.endsWith("shes")) {
+        str.chop(2);
+    } else if (str.endsWith(QLatin1Char('s')) && !str.endsWith("ss")) {
+        str.chop(1);
+    }
+    return str;
+}
+
+
 SqlObjGenerator::SqlObjGenerator(const QString &model, const QString &table)
     : tableSch(new TableSchema(table))
 {
@@ -125,6 +145,27 @@ QString SqlObjGenerator::generate(const QString &dstDir)
     output += tableSch->tableName();
     output += QLatin1String("\"); }\n\n");
 
+    // Relations, detected from the foreign keys named as 'xxx_id'
+    QString relations;
+    QStringList forwardDecls;
+    for (auto &rel : detectRelations()) {
+        relations += QString(SQLOBJECT_RELATION_TEMPLATE).arg(rel.model, rel.name, rel.type, rel.column, rel.foreignColumn);
+        if (rel.model != modelName && !forwardDecls.contains(rel.model)) {
+            forwardDecls << rel.model;
+        }
+    }
+    if (!relations.isEmpty()) {
+        output += QLatin1String("    // Relations\n");
+        output += relations;
+        output += QLatin1String("\n");
+
+        QString decls;
+        for (auto &m : forwardDecls) {
+            decls += QString("class %1Object;\n").arg(m);
+        }
+        output.replace(QLatin1String("#include <QSharedData>\n\n"), QLatin1String("#include <QSharedData>\n\n") + decls);
+    }
+
     // Property macros part
     output += QLatin1String("private:    /*** Don't modify below this line ***/\n    Q_OBJECT\n");
     it.toFront();
@@ -144,6 +185,55 @@ QString SqlObjGenerator::generate(const QString &dstDir)
 }
 
 
+QList<SqlObjGenerator::Relation> SqlObjGenerator::detectRelations() const
+{
+    QList<Relation> relations;
+    const QStringList tables = TableSchema::tables();
+    const QString table = tableSch->tableName();
+    const QString pkName = tableSch->primaryKeyFieldName();
+
+    auto modelOf = [&](const QString &tbl) {
+        return (tbl == table) ? modelName : fieldNameToEnumName(tbl);
+    };
+
+    // Belongs-to
+    for (auto &field : tableSch->getFieldList()) {
+        const QString name = field.first.toLower();
+        if (field.first == pkName || !name.endsWith("_id") || name.length() <= 3) {
+            continue;
+        }
+
+        const QString base = name.left(name.length() - 3);
+        for (auto &tbl : tables) {
+            if (tbl.toLower() != base && singularize(tbl) != base) {
+                continue;
+            }
+            QString foreignPk = TableSchema(tbl).primaryKeyFieldName();
+            if (!foreignPk.isEmpty()) {
+                relations << Relation {fieldNameToVariableName(base), QStringLiteral("TSql::BelongsTo"), modelOf(tbl),
+                                       fieldNameToEnumName(field.first), fieldNameToEnumName(foreignPk)};
+            }
+            break;
+        }
+    }
+
+    // Has-many
+    if (!pkName.isEmpty()) {
+        const QString foreignKey = singularize(table) + QLatin1String("_id");
+        for (auto &tbl : tables) {
+            for (auto &field : TableSchema(tbl).getFieldList()) {
+                if (field.first.toLower() == foreignKey) {
+                    relations << Relation {fieldNameToVariableName(tbl), QStringLiteral("TSql::HasMany"), modelOf(tbl),
+                                           fieldNameToEnumName(pkName), fieldNameToEnumName(field.first)};
+                    break;
+                }
+            }
+        }
+    }
+    return relations;
+}
+
+
 QList<QPair<QString, QVariant::Type>> SqlObjGenerator::fieldList() const
 {
     return tableSch->getFieldTypeList();
@@ -22,6 +22,15 @@ public:
     QString model() const { return modelName; }
 
 private:
+    struct Relation {
+        QString name;
+        QString type;
+        QString model;
+        QString column;
+        QString foreignColumn;
+    };
+    QList<Relation> detectRelations() const;
+
     QString modelName;
     TableSchema *tableSch {nullptr};
 };